@@ -791,12 +791,18 @@ rsRetVal actionDbgPrint(action_t *pThis)
 
 /* prepare the calling parameters for doAction()
  * rgerhards, 2009-05-07
+ * String parameters are cached inside the batch element: if another action
+ * already rendered the same template into the same parameter slot and the
+ * message was not modified since (see MsgSetModified()), we reuse that
+ * string. Templates that use the current time are always rendered, as
+ * ttNow differs between actions.
  */
 static rsRetVal
 prepareDoActionParams(action_t *pAction, batch_obj_t *pElem, struct syslogTime *ttNow)
 {
 	int i;
 	msg_t *pMsg;
+	struct template *pTpl;
 	struct json_object *json;
 	DEFiRet;
 
@@ -808,9 +814,21 @@ prepareDoActionParams(action_t *pAction, batch_obj_t *pElem, struct syslogTime *
 	for(i = 0 ; i < pAction->iNumTpls ; ++i) {
 		switch(pAction->eParamPassing) {
 			case ACT_STRING_PASSING:
-				CHKiRet(tplToString(pAction->ppTpl[i], pMsg, &(pElem->staticActStrings[i]),
+				pTpl = pAction->ppTpl[i];
+				if(   pElem->pCachedTpl[i] == pTpl
+				   && pElem->cachedModCount[i] == pMsg->iModCount) {
+					/* a previous action of this batch already rendered it */
+					pElem->staticActParams[i] = pElem->staticActStrings[i];
+					break;
+				}
+				pElem->pCachedTpl[i] = NULL;
+				CHKiRet(tplToString(pTpl, pMsg, &(pElem->staticActStrings[i]),
 					&pElem->staticLenStrings[i], ttNow));
 				pElem->staticActParams[i] = pElem->staticActStrings[i];
+				if(pTpl->bMsgOnly) {
+					pElem->pCachedTpl[i] = pTpl;
+					pElem->cachedModCount[i] = pMsg->iModCount;
+				}
 				break;
 			case ACT_ARRAY_PASSING:
 				CHKiRet(tplToArray(pAction->ppTpl[i], pMsg, (uchar***) &(pElem->staticActParams[i]), ttNow));
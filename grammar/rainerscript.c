@@ -1074,6 +1074,18 @@ done:
 }
 
 
+/* free the members of an evaluation result. Strings are owned by the
+ * result, json-c objects are references obtained from the message.
+ */
+static inline void
+varFreeMembers(struct var *r)
+{
+	if(r->datatype == 'S')
+		es_deleteStr(r->d.estr);
+	else if(r->datatype == 'J')
+		json_object_put(r->d.json);
+}
+
 /* ensure that retval is a number; if string is no number,
  * try to convert it to one. The semantics from es_str2num()
  * are used (bSuccess tells if the conversion went well or not).
@@ -1086,7 +1098,7 @@ var2Number(struct var *r, int *bSuccess)
 		n = es_str2num(r->d.estr, bSuccess);
 	} else {
 		if(r->datatype == 'J') {
-			n = (r->d.json == NULL) ? 0 : json_object_get_int(r->d.json);
+			n = (r->d.json == NULL) ? 0 : json_object_get_int64(r->d.json);
 		} else {
 			n = r->d.n;
 		}
@@ -1280,7 +1292,7 @@ doFuncCall(struct cnffunc *func, struct var *ret, void* usrptr)
 		}
 		ret->datatype = 'S';
 		if(bMustFree) es_deleteStr(estr);
-		if(r[0].datatype == 'S') es_deleteStr(r[0].d.estr);
+		varFreeMembers(&r[0]);
 		free(str);
 		break;
 	case CNFFUNC_TOLOWER:
@@ -1291,7 +1303,7 @@ doFuncCall(struct cnffunc *func, struct var *ret, void* usrptr)
 		es_tolower(estr);
 		ret->datatype = 'S';
 		ret->d.estr = estr;
-		if(r[0].datatype == 'S') es_deleteStr(r[0].d.estr);
+		varFreeMembers(&r[0]);
 		break;
 	case CNFFUNC_CSTR:
 		cnfexprEval(func->expr[0], &r[0], usrptr);
@@ -1300,7 +1312,7 @@ doFuncCall(struct cnffunc *func, struct var *ret, void* usrptr)
 			estr = es_strdup(estr);
 		ret->datatype = 'S';
 		ret->d.estr = estr;
-		if(r[0].datatype == 'S') es_deleteStr(r[0].d.estr);
+		varFreeMembers(&r[0]);
 		break;
 	case CNFFUNC_CNUM:
 		if(func->expr[0]->nodetype == 'N') {
@@ -1311,7 +1323,7 @@ doFuncCall(struct cnffunc *func, struct var *ret, void* usrptr)
 		} else {
 			cnfexprEval(func->expr[0], &r[0], usrptr);
 			ret->d.n = var2Number(&r[0], NULL);
-			if(r[0].datatype == 'S') es_deleteStr(r[0].d.estr);
+			varFreeMembers(&r[0]);
 		}
 		ret->datatype = 'N';
 		break;
@@ -1329,7 +1341,7 @@ doFuncCall(struct cnffunc *func, struct var *ret, void* usrptr)
 		}
 		ret->datatype = 'N';
 		if(bMustFree) free(str);
-		if(r[0].datatype == 'S') es_deleteStr(r[0].d.estr);
+		varFreeMembers(&r[0]);
 		break;
 	case CNFFUNC_FIELD:
 		cnfexprEval(func->expr[0], &r[0], usrptr);
@@ -1359,9 +1371,9 @@ doFuncCall(struct cnffunc *func, struct var *ret, void* usrptr)
 		}
 		ret->datatype = 'S';
 		if(bMustFree) free(str);
-		if(r[0].datatype == 'S') es_deleteStr(r[0].d.estr);
-		if(r[1].datatype == 'S') es_deleteStr(r[1].d.estr);
-		if(r[2].datatype == 'S') es_deleteStr(r[2].d.estr);
+		varFreeMembers(&r[0]);
+		varFreeMembers(&r[1]);
+		varFreeMembers(&r[2]);
 		break;
 	case CNFFUNC_PRIFILT:
 		pPrifilt = (struct funcData_prifilt*) func->funcdata;
@@ -1388,17 +1400,13 @@ doFuncCall(struct cnffunc *func, struct var *ret, void* usrptr)
 static inline void
 evalVar(struct cnfvar *var, void *usrptr, struct var *ret)
 {
-	rsRetVal localRet;
 	es_str_t *estr;
-	struct json_object *json;
 
 	if(var->name[0] == '$' && var->name[1] == '!') {
 		/* TODO: unify string libs */
 		estr = es_newStrFromBuf(var->name+1, strlen(var->name)-1);
-		localRet = msgGetCEEPropJSON((msg_t*)usrptr, estr, &json);
+		msgGetCEEPropVar((msg_t*)usrptr, estr, ret);
 		es_deleteStr(estr);
-		ret->datatype = 'J';
-		ret->d.json = (localRet == RS_RET_OK) ? json : NULL;
 	} else {
 		ret->datatype = 'S';
 		ret->d.estr = cnfGetVar(var->name, usrptr);
@@ -1447,8 +1455,8 @@ evalStrArrayCmp(es_str_t *estr_l, struct cnfarray* ar, int cmpop)
 }
 
 #define FREE_BOTH_RET \
-		if(r.datatype == 'S') es_deleteStr(r.d.estr); \
-		if(l.datatype == 'S') es_deleteStr(l.d.estr)
+		varFreeMembers(&r); \
+		varFreeMembers(&l)
 
 #define COMP_NUM_BINOP(x) \
 	cnfexprEval(expr->l, &l, usrptr); \
@@ -1475,9 +1483,9 @@ evalStrArrayCmp(es_str_t *estr_l, struct cnfarray* ar, int cmpop)
 
 #define FREE_TWO_STRINGS \
 		if(bMustFree) es_deleteStr(estr_r);  \
-		if(expr->r->nodetype != 'S' && expr->r->nodetype != 'A' && r.datatype == 'S') es_deleteStr(r.d.estr);  \
+		if(expr->r->nodetype != 'S' && expr->r->nodetype != 'A') varFreeMembers(&r);  \
 		if(bMustFree2) es_deleteStr(estr_l);  \
-		if(l.datatype == 'S') es_deleteStr(l.d.estr)
+		varFreeMembers(&l)
 
 /* evaluate an expression.
  * Note that we try to avoid malloc whenever possible (because of
@@ -1528,7 +1536,7 @@ cnfexprEval(struct cnfexpr *expr, struct var *ret, void* usrptr)
 						if(bMustFree) es_deleteStr(estr_r);
 					}
 				}
-				if(r.datatype == 'S') es_deleteStr(r.d.estr);
+				varFreeMembers(&r);
 			}
 		} else if(l.datatype == 'J') {
 			estr_l = var2String(&l, &bMustFree);
@@ -1550,7 +1558,7 @@ cnfexprEval(struct cnfexpr *expr, struct var *ret, void* usrptr)
 						if(bMustFree) es_deleteStr(estr_r);
 					}
 				}
-				if(r.datatype == 'S') es_deleteStr(r.d.estr);
+				varFreeMembers(&r);
 			}
 			if(bMustFree) es_deleteStr(estr_l);
 		} else {
@@ -1567,9 +1575,9 @@ cnfexprEval(struct cnfexpr *expr, struct var *ret, void* usrptr)
 			} else {
 				ret->d.n = (l.d.n == r.d.n); /*CMP*/
 			}
-			if(r.datatype == 'S') es_deleteStr(r.d.estr);
+			varFreeMembers(&r);
 		}
-		if(l.datatype == 'S') es_deleteStr(l.d.estr);
+		varFreeMembers(&l);
 		break;
 	case CMP_NE:
 		cnfexprEval(expr->l, &l, usrptr);
@@ -1797,9 +1805,9 @@ cnfexprEval(struct cnfexpr *expr, struct var *ret, void* usrptr)
 				ret->d.n = 1ll;
 			else 
 				ret->d.n = 0ll;
-			if(r.datatype == 'S') es_deleteStr(r.d.estr); 
+			varFreeMembers(&r); 
 		}
-		if(l.datatype == 'S') es_deleteStr(l.d.estr);
+		varFreeMembers(&l);
 		break;
 	case AND:
 		cnfexprEval(expr->l, &l, usrptr);
@@ -1810,17 +1818,17 @@ cnfexprEval(struct cnfexpr *expr, struct var *ret, void* usrptr)
 				ret->d.n = 1ll;
 			else 
 				ret->d.n = 0ll;
-			if(r.datatype == 'S') es_deleteStr(r.d.estr); 
+			varFreeMembers(&r); 
 		} else {
 			ret->d.n = 0ll;
 		}
-		if(l.datatype == 'S') es_deleteStr(l.d.estr);
+		varFreeMembers(&l);
 		break;
 	case NOT:
 		cnfexprEval(expr->r, &r, usrptr);
 		ret->datatype = 'N';
 		ret->d.n = !var2Number(&r, &convok_r);
-		if(r.datatype == 'S') es_deleteStr(r.d.estr);
+		varFreeMembers(&r);
 		break;
 	case 'N':
 		ret->datatype = 'N';
@@ -1871,7 +1879,7 @@ cnfexprEval(struct cnfexpr *expr, struct var *ret, void* usrptr)
 		cnfexprEval(expr->r, &r, usrptr);
 		ret->datatype = 'N';
 		ret->d.n = -var2Number(&r, &convok_r);
-		if(r.datatype == 'S') es_deleteStr(r.d.estr);
+		varFreeMembers(&r);
 		break;
 	case 'F':
 		doFuncCall((struct cnffunc*) expr, ret, usrptr);
@@ -1986,9 +1994,12 @@ int
 cnfexprEvalBool(struct cnfexpr *expr, void *usrptr)
 {
 	int convok;
+	int bRet;
 	struct var ret;
 	cnfexprEval(expr, &ret, usrptr);
-	return var2Number(&ret, &convok);
+	bRet = var2Number(&ret, &convok);
+	varFreeMembers(&ret);
+	return bRet;
 }
 
 inline static void
@@ -3320,6 +3331,9 @@ varDelete(struct var *v)
 		cnfarrayContentDestruct(v->d.ar);
 		free(v->d.ar);
 		break;
+	case 'J':
+		json_object_put(v->d.json);
+		break;
 	default:break;
 	}
 }
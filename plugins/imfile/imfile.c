@@ -30,10 +30,18 @@
 #include <string.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <dirent.h>
+#include <fnmatch.h>
 #include <pthread.h>		/* do NOT remove: will soon be done by the module generation macros */
 #ifdef HAVE_SYS_STAT_H
 #	include <sys/stat.h>
 #endif
+#ifdef HAVE_INOTIFY_INIT
+#	include <sys/inotify.h>
+#	include <poll.h>
+#endif
 #include "rsyslog.h"		/* error codes etc... */
 #include "dirty.h"
 #include "cfsysline.h"		/* access to config file objects */
@@ -49,6 +57,7 @@
 #include "stringbuf.h"
 #include "ruleset.h"
 #include "ratelimit.h"
+#include "hashtable.h"
 
 MODULE_TYPE_INPUT	/* must be present for input modules, do not remove */
 MODULE_TYPE_NOKEEP
@@ -70,9 +79,12 @@ static int bLegacyCnfModGlobalsPermitted;/* are legacy module-global config para
 #define NUM_MULTISUB 1024 /* default max number of submits */
 #define DFLT_PollInterval 10
 
+#define OPMODE_POLLING 0
+#define OPMODE_INOTIFY 1
+
 typedef struct fileInfo_s {
 	uchar *pszFileName;
-	uchar *pszTag;
+	uchar *pszTag;	/* points into the instance config, not owned */
 	size_t lenTag;
 	uchar *pszStateFile; /* file in which state between runs is to be stored */
 	int iFacility;
@@ -84,7 +96,19 @@ typedef struct fileInfo_s {
 	int readMode;	/* which mode to use in ReadMulteLine call? */
 	ruleset_t *pRuleset;	/* ruleset to bind listener to (use system default if unspecified) */
 	ratelimit_t *ratelimiter;
-	multi_submit_t multiSub;
+	int nMultiSub;	/* max number of messages to submit in one batch */
+	multi_submit_t *pMultiSub;	/* the reader's batch, flushed after each file */
+	instanceConf_t *pInst;	/* the input() this file belongs to */
+	int iScanGen;	/* last wildcard scan that found this file */
+	ino_t inode;	/* identifies a file found via a wildcard across renames */
+	struct fileInfo_s *pNext, *pPrev;	/* the reader's list of files */
+#ifdef HAVE_INOTIFY_INIT
+	uchar *pszBaseName;	/* file name without directory part */
+	int iDirWatch;	/* index of our directory in dirWatches[] */
+	sbool bPending;	/* inotify reported activity, file needs to be read */
+	sbool bSymlink;	/* file is a symlink, inotify does not report its activity */
+	struct fileInfo_s *pNextPending;	/* queue of files to be read */
+#endif
 } fileInfo_t;
 
 static struct configSettings_s {
@@ -113,6 +137,10 @@ struct instanceConf_s {
 	int readMode;
 	int maxLinesAtOnce;
 	ruleset_t *pBindRuleset;	/* ruleset to bind listener to (use system default if unspecified) */
+	/* the following is set up on activation, pszDirName is NULL if that failed */
+	uchar *pszDirName;	/* directory the file resides in, "." if none given */
+	uchar *pszFileBaseName;	/* file name without directory, points into pszFileName */
+	sbool bWildcard;	/* is the file name a pattern? */
 	struct instanceConf_s *next;
 };
 
@@ -125,21 +153,71 @@ static rsRetVal resetConfigVariables(uchar __attribute__((unused)) *pp, void __a
 struct modConfData_s {
 	rsconf_t *pConf;	/* our overall config object */
 	int iPollInterval;	/* number of seconds to sleep when there was no file activity */
+	int opMode;		/* OPMODE_POLLING or OPMODE_INOTIFY */
+	int nThreads;		/* number of reader threads */
 	instanceConf_t *root, *tail;
 	sbool configSetViaV2Method;
 };
 static modConfData_t *loadModConf = NULL;/* modConf ptr to use for the current load process */
 static modConfData_t *runModConf = NULL;/* modConf ptr to use for the current load process */
 
-static int iFilPtr = 0;		/* number of files to be monitored; pointer to next free spot during config */
-#define MAX_INPUT_FILES 100
-static fileInfo_t files[MAX_INPUT_FILES];
-
 static prop_t *pInputName = NULL;	/* there is only one global inputName for all messages generated by this input */
 
+#ifdef HAVE_INOTIFY_INIT
+/* In inotify mode, we watch the directories the monitored files reside in
+ * rather than the files themselves. Directory watches report modifications
+ * of the files inside them, but also their creation and renaming, which is
+ * what we need to follow rotation and to pick up files that do not yet exist.
+ * Multiple files in the same directory share a single watch.
+ */
+typedef struct dirWatch_s {
+	instanceConf_t *pInst;	/* an input() in this directory, provides its name */
+	int wd;		/* inotify watch descriptor, -1 if not (yet) watched */
+	ino_t inode;	/* inode of the watched directory */
+	sbool bCheck;	/* a file was deleted, check if directory still is the same */
+	sbool bRescan;	/* a file matching a wildcard was created, renamed or deleted */
+	instanceConf_t **ppWild;	/* the wildcard input()s in this directory */
+	int nWild;
+} dirWatch_t;
+#endif
+
+/* The monitored files are partitioned across reader threads. Each reader
+ * services only its own files, so the file state (streams, offsets, state
+ * files) needs no locking. Reader 0 is the input thread itself, additional
+ * readers are only started if module parameter "threads" is greater than one.
+ * Configured files are assigned round-robin on activation. A file found via a
+ * wildcard is owned by the reader selected by its inode number, so every
+ * reader looks for wildcard matches, but only picks up those it owns. The
+ * inode, unlike the name, stays the same if the file is renamed.
+ */
+static struct wrkrInfo_s {
+	pthread_t tid;		/* the reader's thread ID (unused for reader 0) */
+	int id;			/* reader number */
+	sbool bRunning;		/* is the reader thread still running? (guarded by mutWrkr) */
+	struct hashtable *ht;	/* the files this reader services, by name */
+	fileInfo_t *pFilesRoot, *pFilesLast;	/* the same files, in the order added */
+	int nFiles;
+	multi_submit_t multiSub;	/* shared by all files, see pollFile() */
+	int iScanGen;		/* number of the last wildcard scan */
+#ifdef HAVE_INOTIFY_INIT
+	int ino_fd;		/* inotify instance, -1 if not active */
+	dirWatch_t *dirWatches;	/* watched directories */
+	int nDirWatches;
+	fileInfo_t *pPendRoot, *pPendLast;	/* queue of files to be read */
+	int nSymlinks;		/* number of files that are symlinks */
+#endif
+} *wrkrInfo = NULL;
+static int nWrkrs = 0;			/* number of reader threads */
+static struct hashtable *htLiteral = NULL; /* names of the configured (non-wildcard)
+					    * files, read-only while running */
+static pthread_mutex_t mutWrkr;
+static pthread_cond_t condWrkrTerm;	/* signalled when a reader terminates */
+
 /* module-global parameters */
 static struct cnfparamdescr modpdescr[] = {
-	{ "pollinginterval", eCmdHdlrPositiveInt, 0 }
+	{ "pollinginterval", eCmdHdlrPositiveInt, 0 },
+	{ "mode", eCmdHdlrGetWord, 0 },
+	{ "threads", eCmdHdlrPositiveInt, 0 }
 };
 static struct cnfparamblk modpblk =
 	{ CNFPARAMBLK_VERSION,
@@ -168,35 +246,50 @@ static struct cnfparamblk inppblk =
 
 #include "im-helper.h" /* must be included AFTER the type definitions! */
 
-/* enqueue the read file line as a message. The provided string is
- * not freed - thuis must be done by the caller.
+/* enqueue the read file line as a message. The line is copied into
+ * the message, so the caller keeps ownership of the provided buffer.
  */
-static rsRetVal enqLine(fileInfo_t *pInfo, cstr_t *cstrLine)
+static rsRetVal enqLine(fileInfo_t *pInfo, uchar *pLine, size_t lenLine)
 {
 	DEFiRet;
 	msg_t *pMsg;
+	struct syslogTime st;
+	time_t tt;
 
-	if(rsCStrLen(cstrLine) == 0) {
+	if(lenLine == 0) {
 		/* we do not process empty lines */
 		FINALIZE;
 	}
 
-	CHKiRet(msgConstruct(&pMsg));
+	datetime.getCurrTimeCached(&st, &tt, glbl.GetCoarseClock());
+	CHKiRet(msgConstructWithTime(&pMsg, &st, tt));
 	MsgSetFlowControlType(pMsg, eFLOWCTL_FULL_DELAY);
 	MsgSetInputName(pMsg, pInputName);
-	MsgSetRawMsg(pMsg, (char*)rsCStrGetSzStr(cstrLine), cstrLen(cstrLine));
+	MsgSetRawMsg(pMsg, (char*)pLine, lenLine);
 	MsgSetMSGoffs(pMsg, 0);	/* we do not have a header... */
 	MsgSetHOSTNAME(pMsg, glbl.GetLocalHostName(), ustrlen(glbl.GetLocalHostName()));
 	MsgSetTAG(pMsg, pInfo->pszTag, pInfo->lenTag);
 	pMsg->iFacility = LOG_FAC(pInfo->iFacility);
 	pMsg->iSeverity = LOG_PRI(pInfo->iSeverity);
 	MsgSetRuleset(pMsg, pInfo->pRuleset);
-	ratelimitAddMsg(pInfo->ratelimiter, &pInfo->multiSub, pMsg);
+	ratelimitAddMsg(pInfo->ratelimiter, pInfo->pMultiSub, pMsg);
 finalize_it:
 	RETiRet;
 }
 
 
+/* return the stream type to use for a file. A configured file is monitored
+ * by name, so the stream reopens it when it is rotated. A file found via a
+ * wildcard sticks with the file it has opened: if it is renamed, we follow
+ * it (see scanWildcard()), and a new file under the old name is a new one.
+ */
+static inline strmType_t
+fileStrmType(fileInfo_t *pThis)
+{
+	return pThis->pInst->bWildcard ? STREAMTYPE_FILE_SINGLE : STREAMTYPE_FILE_MONITOR;
+}
+
+
 /* try to open a file. This involves checking if there is a status file and,
  * if so, reading it in. Processing continues from the last know location.
  */
@@ -234,6 +327,9 @@ openFile(fileInfo_t *pThis)
 
 	/* read back in the object */
 	CHKiRet(obj.Deserialize(&pThis->pStrm, (uchar*) "strm", psSF, NULL, pThis));
+	/* a file found via a wildcard may have been renamed since the state was saved */
+	CHKiRet(strm.SetsType(pThis->pStrm, fileStrmType(pThis)));
+	CHKiRet(strm.SetFName(pThis->pStrm, pThis->pszFileName, ustrlen(pThis->pszFileName)));
 
 	strm.CheckFileChange(pThis->pStrm);
 	CHKiRet(strm.SeekCurrOffs(pThis->pStrm));
@@ -251,7 +347,7 @@ finalize_it:
 			strm.Destruct(&pThis->pStrm);
 		CHKiRet(strm.Construct(&pThis->pStrm));
 		CHKiRet(strm.SettOperationsMode(pThis->pStrm, STREAMMODE_READ));
-		CHKiRet(strm.SetsType(pThis->pStrm, STREAMTYPE_FILE_MONITOR));
+		CHKiRet(strm.SetsType(pThis->pStrm, fileStrmType(pThis)));
 		CHKiRet(strm.SetFName(pThis->pStrm, pThis->pszFileName, strlen((char*) pThis->pszFileName)));
 		CHKiRet(strm.ConstructFinalize(pThis->pStrm));
 	}
@@ -273,20 +369,21 @@ static void pollFileCancelCleanup(void *pArg)
 }
 
 
-/* poll a file, need to check file rollover etc. open file if not open */
-#pragma GCC diagnostic ignored "-Wempty-body"
-static rsRetVal pollFile(fileInfo_t *pThis, int *pbHadFileData)
+/* read the lines available in a file and submit them. This is the part of
+ * pollFile() that runs while the cancel cleanup handler is active. It is a
+ * function of its own so that iRet is not modified between the setjmp() done
+ * by pthread_cleanup_push() and pthread_cleanup_pop() (-Wclobbered).
+ */
+static rsRetVal
+pollFileLines(fileInfo_t *pThis, int *pbHadFileData, cstr_t **ppCStr)
 {
-	cstr_t *pCStr = NULL;
+	uchar *pLine;
+	size_t lenLine;
 	int nProcessed = 0;
 	DEFiRet;
 
-	ASSERT(pbHadFileData != NULL);
-
-	/* Note: we must do pthread_cleanup_push() immediately, because the POXIS macros
-	 * otherwise do not work if I include the _cleanup_pop() inside an if... -- rgerhards, 2008-08-14
-	 */
-	pthread_cleanup_push(pollFileCancelCleanup, &pCStr);
+	/* the batch is shared by all files of the reader, but always empty here */
+	pThis->pMultiSub->maxElem = pThis->nMultiSub;
 	if(pThis->pStrm == NULL) {
 		CHKiRet(openFile(pThis)); /* open file */
 	}
@@ -295,11 +392,19 @@ static rsRetVal pollFile(fileInfo_t *pThis, int *pbHadFileData)
 	while(glbl.GetGlobalInputTermState() == 0) {
 		if(pThis->maxLinesAtOnce != 0 && nProcessed >= pThis->maxLinesAtOnce)
 			break;
-		CHKiRet(strm.ReadLine(pThis->pStrm, &pCStr, pThis->readMode));
-		++nProcessed;
-		*pbHadFileData = 1; /* this is just a flag, so set it and forget it */
-		CHKiRet(enqLine(pThis, pCStr)); /* process line */
-		rsCStrDestruct(&pCStr); /* discard string (must be done by us!) */
+		if(pThis->readMode == 0) {
+			/* single lines are taken directly from the stream buffer */
+			CHKiRet(strm.ReadLineSlice(pThis->pStrm, &pLine, &lenLine));
+			++nProcessed;
+			*pbHadFileData = 1; /* this is just a flag, so set it and forget it */
+			CHKiRet(enqLine(pThis, pLine, lenLine)); /* process line */
+		} else {
+			CHKiRet(strm.ReadLine(pThis->pStrm, ppCStr, pThis->readMode));
+			++nProcessed;
+			*pbHadFileData = 1; /* this is just a flag, so set it and forget it */
+			CHKiRet(enqLine(pThis, rsCStrGetBufBeg(*ppCStr), cstrLen(*ppCStr))); /* process line */
+			rsCStrDestruct(ppCStr); /* discard string (must be done by us!) */
+		}
 		if(pThis->iPersistStateInterval > 0 && pThis->nRecords++ >= pThis->iPersistStateInterval) {
 			persistStrmState(pThis);
 			pThis->nRecords = 0;
@@ -307,9 +412,31 @@ static rsRetVal pollFile(fileInfo_t *pThis, int *pbHadFileData)
 	}
 
 finalize_it:
-	multiSubmitFlush(&pThis->multiSub);
+	multiSubmitFlush(pThis->pMultiSub);
+	RETiRet;
+}
+
+
+/* poll a file, need to check file rollover etc. open file if not open */
+#pragma GCC diagnostic ignored "-Wempty-body"
+static rsRetVal pollFile(fileInfo_t *pThis, int *pbHadFileData)
+{
+	cstr_t *pCStr = NULL;
+	DEFiRet;
+
+	ASSERT(pbHadFileData != NULL);
+
+	/* Note: we must do pthread_cleanup_push() immediately, because the POXIS macros
+	 * otherwise do not work if I include the _cleanup_pop() inside an if... -- rgerhards, 2008-08-14
+	 */
+	pthread_cleanup_push(pollFileCancelCleanup, &pCStr);
+	iRet = pollFileLines(pThis, pbHadFileData, &pCStr);
 	pthread_cleanup_pop(0);
 
+	/* the file may have been replaced between the wildcard scan and opening it */
+	if(pThis->pInst->bWildcard && pThis->pStrm != NULL && pThis->pStrm->fd != -1)
+		pThis->inode = pThis->pStrm->inode;
+
 	if(pCStr != NULL) {
 		rsCStrDestruct(&pCStr);
 	}
@@ -341,6 +468,9 @@ createInstance(instanceConf_t **pinst)
 	inst->maxLinesAtOnce = 10240;
 	inst->iPersistStateInterval = 0;
 	inst->readMode = 0;
+	inst->pszDirName = NULL;
+	inst->pszFileBaseName = NULL;
+	inst->bWildcard = 0;
 
 	/* node created, let's add to config */
 	if(loadModConf->tail == NULL) {
@@ -400,41 +530,418 @@ finalize_it:
 }
 
 
-/* This function is called when a new listener (monitor) shall be added. */
-static inline rsRetVal
-addListner(instanceConf_t *inst)
+/* return the reader a file found via a wildcard is owned by */
+static inline struct wrkrInfo_s *
+wildcardOwner(ino_t inode)
+{
+	return &wrkrInfo[inode % nWrkrs];
+}
+
+
+/* check if a file is configured explicitly. Such a file is monitored by its
+ * own input(), even if it also matches a wildcard.
+ */
+static inline int
+isLiteralFile(uchar *pszFileName)
 {
+	return hashtable_search(htLiteral, pszFileName) != NULL;
+}
+
+
+#ifdef HAVE_INOTIFY_INIT
+/* queue a file for reading, if it is not already queued */
+static inline void
+setPending(struct wrkrInfo_s *pWrkr, fileInfo_t *pFile)
+{
+	if(pFile->bPending)
+		return;
+	pFile->bPending = 1;
+	pFile->pNextPending = NULL;
+	if(pWrkr->pPendLast == NULL)
+		pWrkr->pPendRoot = pFile;
+	else
+		pWrkr->pPendLast->pNextPending = pFile;
+	pWrkr->pPendLast = pFile;
+}
+
+
+/* check if a file is a symlink. The directory watch only reports activity on
+ * the link itself, not on the file it points to, so symlinked files need to
+ * be polled (see inoCheckDirs()).
+ */
+static void
+checkSymlink(struct wrkrInfo_s *pWrkr, fileInfo_t *pFile)
+{
+	struct stat stat_buf;
+	sbool bSymlink;
+
+	bSymlink = lstat((char*) pFile->pszFileName, &stat_buf) == 0 && S_ISLNK(stat_buf.st_mode);
+	if(bSymlink != pFile->bSymlink) {
+		DBGPRINTF("imfile: file '%s' is %sa symlink\n", pFile->pszFileName, bSymlink ? "" : "no longer ");
+		pFile->bSymlink = bSymlink;
+		pWrkr->nSymlinks += bSymlink ? 1 : -1;
+	}
+}
+#endif
+
+
+/* destruct a file object. It must already have been removed from its reader. */
+static void
+destructFile(fileInfo_t *pThis)
+{
+	if(pThis->pStrm != NULL)
+		strm.Destruct(&pThis->pStrm);
+	if(pThis->ratelimiter != NULL)
+		ratelimitDestruct(pThis->ratelimiter);
+	free(pThis->pszFileName);
+	free(pThis->pszStateFile);
+	free(pThis);
+}
+
+
+/* Add a file to be monitored to a reader. pszFileName is either the name
+ * configured or, for wildcards, the name of the file found to match. In
+ * the latter case, the state file name configured is used as prefix for the
+ * file's own state file. iDirWatch is only used in inotify mode.
+ */
+static rsRetVal
+addFile(struct wrkrInfo_s *pWrkr, instanceConf_t *inst, uchar *pszFileName,
+	int __attribute__((unused)) iDirWatch, fileInfo_t **ppFile)
+{
+	fileInfo_t *pThis = NULL;
+	uchar *pszKey;
+	uchar pszSFNam[MAXFNAME];
+	size_t lenDirPrefix;
 	DEFiRet;
-	fileInfo_t *pThis;
-
-	if(iFilPtr < MAX_INPUT_FILES) {
-		pThis = &files[iFilPtr];
-		//TODO: optimize, save strdup?
-		pThis->pszFileName = (uchar*) strdup((char*) inst->pszFileName);
-		pThis->pszTag = (uchar*) strdup((char*) inst->pszTag);
-		pThis->lenTag = ustrlen(pThis->pszTag);
-		pThis->pszStateFile = (uchar*) strdup((char*) inst->pszStateFile);
-
-		CHKiRet(ratelimitNew(&pThis->ratelimiter, "imfile", (char*)inst->pszFileName));
-		CHKmalloc(pThis->multiSub.ppMsgs = MALLOC(inst->nMultiSub * sizeof(msg_t*)));
-		pThis->multiSub.maxElem = inst->nMultiSub;
-		pThis->multiSub.nElem = 0;
-		pThis->iSeverity = inst->iSeverity;
-		pThis->iFacility = inst->iFacility;
-		pThis->maxLinesAtOnce = inst->maxLinesAtOnce;
-		pThis->iPersistStateInterval = inst->iPersistStateInterval;
-		pThis->readMode = inst->readMode;
-		pThis->pRuleset = inst->pBindRuleset;
-		pThis->nRecords = 0;
+
+	lenDirPrefix = inst->pszFileBaseName - inst->pszFileName;
+	CHKmalloc(pThis = calloc(1, sizeof(fileInfo_t)));
+	CHKmalloc(pThis->pszFileName = ustrdup(pszFileName));
+	if(inst->bWildcard) {
+		snprintf((char*)pszSFNam, sizeof(pszSFNam), "%s-%s", (char*) inst->pszStateFile,
+			 (char*) pszFileName + lenDirPrefix);
+		CHKmalloc(pThis->pszStateFile = ustrdup(pszSFNam));
 	} else {
-		errmsg.LogError(0, RS_RET_OUT_OF_DESRIPTORS,
-				"Too many file monitors configured - ignoring %s",
+		CHKmalloc(pThis->pszStateFile = ustrdup(inst->pszStateFile));
+	}
+	pThis->pszTag = inst->pszTag;
+	pThis->lenTag = ustrlen(pThis->pszTag);
+
+	CHKiRet(ratelimitNew(&pThis->ratelimiter, "imfile", (char*)pszFileName));
+	pThis->nMultiSub = inst->nMultiSub;
+	pThis->pMultiSub = &pWrkr->multiSub;
+	pThis->iSeverity = inst->iSeverity;
+	pThis->iFacility = inst->iFacility;
+	pThis->maxLinesAtOnce = inst->maxLinesAtOnce;
+	pThis->iPersistStateInterval = inst->iPersistStateInterval;
+	pThis->readMode = inst->readMode;
+	pThis->pRuleset = inst->pBindRuleset;
+	pThis->nRecords = 0;
+	pThis->pInst = inst;
+	pThis->iScanGen = pWrkr->iScanGen;
+#	ifdef HAVE_INOTIFY_INIT
+	pThis->pszBaseName = pThis->pszFileName + lenDirPrefix;
+	pThis->iDirWatch = iDirWatch;
+#	endif
+
+	/* the hash table takes ownership of the key */
+	CHKmalloc(pszKey = ustrdup(pszFileName));
+	if(!hashtable_insert(pWrkr->ht, pszKey, pThis)) {
+		free(pszKey);
+		ABORT_FINALIZE(RS_RET_OUT_OF_MEMORY);
+	}
+	pThis->pPrev = pWrkr->pFilesLast;
+	if(pWrkr->pFilesLast == NULL)
+		pWrkr->pFilesRoot = pThis;
+	else
+		pWrkr->pFilesLast->pNext = pThis;
+	pWrkr->pFilesLast = pThis;
+	++pWrkr->nFiles;
+#	ifdef HAVE_INOTIFY_INIT
+	checkSymlink(pWrkr, pThis);
+	/* a file showing up while we are running needs to be read */
+	if(pWrkr->ino_fd != -1)
+		setPending(pWrkr, pThis);
+#	endif
+
+	if(ppFile != NULL)
+		*ppFile = pThis;
+
+finalize_it:
+	if(iRet != RS_RET_OK && pThis != NULL)
+		destructFile(pThis);
+	RETiRet;
+}
+
+
+/* remove the state file of a file found via a wildcard */
+static void
+unlinkStateFile(fileInfo_t *pFile)
+{
+	uchar pszSFNam[MAXFNAME];
+
+	snprintf((char*)pszSFNam, sizeof(pszSFNam), "%s/%s",
+		 (char*) glbl.GetWorkDir(), (char*)pFile->pszStateFile);
+	unlink((char*)pszSFNam);
+}
+
+
+/* A file found via a wildcard was renamed to another name matching the
+ * wildcard. We keep reading it where we are, only its name and state file
+ * change. The caller must already have removed it from the hash table and
+ * removed its old state file.
+ */
+static rsRetVal
+renameFile(struct wrkrInfo_s *pWrkr, fileInfo_t *pFile, uchar *pszNewName)
+{
+	uchar *pszName = NULL;
+	uchar *pszStateFile = NULL;
+	uchar *pszKey;
+	uchar pszSFNam[MAXFNAME];
+	size_t lenDirPrefix;
+	DEFiRet;
+
+	DBGPRINTF("imfile: file '%s' was renamed to '%s'\n", pFile->pszFileName, pszNewName);
+	lenDirPrefix = pFile->pInst->pszFileBaseName - pFile->pInst->pszFileName;
+	CHKmalloc(pszName = ustrdup(pszNewName));
+	snprintf((char*)pszSFNam, sizeof(pszSFNam), "%s-%s", (char*) pFile->pInst->pszStateFile,
+		 (char*) pszNewName + lenDirPrefix);
+	CHKmalloc(pszStateFile = ustrdup(pszSFNam));
+	if(pFile->pStrm != NULL)
+		CHKiRet(strm.SetFName(pFile->pStrm, pszNewName, ustrlen(pszNewName)));
+	/* the hash table takes ownership of the key */
+	CHKmalloc(pszKey = ustrdup(pszNewName));
+	if(!hashtable_insert(pWrkr->ht, pszKey, pFile)) {
+		free(pszKey);
+		ABORT_FINALIZE(RS_RET_OUT_OF_MEMORY);
+	}
+
+	free(pFile->pszFileName);
+	free(pFile->pszStateFile);
+	pFile->pszFileName = pszName;
+	pFile->pszStateFile = pszStateFile;
+	pszName = pszStateFile = NULL;
+#	ifdef HAVE_INOTIFY_INIT
+	pFile->pszBaseName = pFile->pszFileName + lenDirPrefix;
+	checkSymlink(pWrkr, pFile);
+	/* events for the new name may already have been dropped */
+	if(pWrkr->ino_fd != -1)
+		setPending(pWrkr, pFile);
+#	endif
+	/* save the state under the new name right away, so that the position
+	 * is not lost if we are aborted
+	 */
+	if(pFile->pStrm != NULL)
+		persistStrmState(pFile);
+
+finalize_it:
+	free(pszName);
+	free(pszStateFile);
+	RETiRet;
+}
+
+
+/* A file found via a wildcard is gone (deleted or renamed). We still have it
+ * open, so we process what is left in it. Then we release it, including its
+ * state file: should a file of that name show up again, it is a new one.
+ */
+static void
+removeFile(struct wrkrInfo_s *pWrkr, fileInfo_t *pFile)
+{
+	int bHadFileData;
+#	ifdef HAVE_INOTIFY_INIT
+	fileInfo_t *pPrev;
+#	endif
+
+	DBGPRINTF("imfile: file '%s' is gone, releasing it\n", pFile->pszFileName);
+	if(pFile->pStrm != NULL) {
+		while(glbl.GetGlobalInputTermState() == 0
+		      && pollFile(pFile, &bHadFileData) == RS_RET_OK)
+			/* just process the remaining lines */;
+	}
+	unlinkStateFile(pFile);
+
+	/* the name may already be taken by a renamed file, see scanWildcard() */
+	if(hashtable_search(pWrkr->ht, pFile->pszFileName) == pFile)
+		hashtable_remove(pWrkr->ht, pFile->pszFileName);
+	if(pFile->pPrev == NULL)
+		pWrkr->pFilesRoot = pFile->pNext;
+	else
+		pFile->pPrev->pNext = pFile->pNext;
+	if(pFile->pNext == NULL)
+		pWrkr->pFilesLast = pFile->pPrev;
+	else
+		pFile->pNext->pPrev = pFile->pPrev;
+	--pWrkr->nFiles;
+#	ifdef HAVE_INOTIFY_INIT
+	if(pFile->bSymlink)
+		--pWrkr->nSymlinks;
+	if(pFile->bPending) {
+		if(pWrkr->pPendRoot == pFile) {
+			pPrev = NULL;
+			pWrkr->pPendRoot = pFile->pNextPending;
+		} else {
+			for(pPrev = pWrkr->pPendRoot ; pPrev->pNextPending != pFile ; pPrev = pPrev->pNextPending)
+				/* just search */;
+			pPrev->pNextPending = pFile->pNextPending;
+		}
+		if(pWrkr->pPendLast == pFile)
+			pWrkr->pPendLast = pPrev;
+	}
+#	endif
+	destructFile(pFile);
+}
+
+
+/* Scan the directory of a wildcard input() for matching files. Files we own
+ * that we do not yet know are added, the ones of this input() that are no
+ * longer present are removed. A file is identified by its inode, so if one
+ * of our files shows up under another matching name, it was renamed and we
+ * continue to read it under its new name. If the directory cannot be read
+ * for other reasons than it not existing, we keep what we have.
+ */
+static rsRetVal
+scanWildcard(struct wrkrInfo_s *pWrkr, instanceConf_t *inst, int iDirWatch)
+{
+	DIR *pDir;
+	struct dirent *pEnt;
+	struct stat stat_buf;
+	fileInfo_t *pFile, *pNext;
+	struct scanEnt_s {
+		uchar *pszName;
+		ino_t inode;
+		sbool bClaimed;	/* name is already monitored */
+	} *pEnts = NULL, *pNewEnts;
+	int nEnts = 0;
+	int maxEnts = 0;
+	uchar pszName[MAXFNAME];
+	size_t lenDirPrefix;
+	int iScanGen;
+	int i;
+	DEFiRet;
+
+	if((pDir = opendir((char*) inst->pszDirName)) == NULL && errno != ENOENT) {
+		DBGPRINTF("imfile: cannot read directory '%s', errno %d\n", inst->pszDirName, errno);
+		FINALIZE;
+	}
+
+	/* first collect the matching files we own, renames can only be detected
+	 * once we know all of them
+	 */
+	lenDirPrefix = inst->pszFileBaseName - inst->pszFileName;
+	memcpy(pszName, inst->pszFileName, lenDirPrefix);
+	while(pDir != NULL && (pEnt = readdir(pDir)) != NULL) {
+		if(fnmatch((char*) inst->pszFileBaseName, pEnt->d_name, FNM_PERIOD) != 0
+		   || lenDirPrefix + strlen(pEnt->d_name) >= sizeof(pszName))
+			continue;
+		strcpy((char*) pszName + lenDirPrefix, pEnt->d_name);
+		if(isLiteralFile(pszName) || stat((char*) pszName, &stat_buf) != 0
+		   || !S_ISREG(stat_buf.st_mode) || wildcardOwner(stat_buf.st_ino) != pWrkr)
+			continue;
+		if(nEnts == maxEnts) {
+			CHKmalloc(pNewEnts = realloc(pEnts, (maxEnts + 64) * sizeof(struct scanEnt_s)));
+			pEnts = pNewEnts;
+			maxEnts += 64;
+		}
+		CHKmalloc(pEnts[nEnts].pszName = ustrdup(pszName));
+		pEnts[nEnts].inode = stat_buf.st_ino;
+		pEnts[nEnts].bClaimed = 0;
+		++nEnts;
+	}
+
+	/* files still present under their name */
+	iScanGen = ++pWrkr->iScanGen;
+	for(i = 0 ; i < nEnts ; ++i) {
+		if((pFile = hashtable_search(pWrkr->ht, pEnts[i].pszName)) == NULL)
+			continue;
+		if(pFile->pInst != inst) {
+			pEnts[i].bClaimed = 1; /* matches another input() in this directory */
+		} else if(pFile->inode == pEnts[i].inode) {
+			pEnts[i].bClaimed = 1;
+			pFile->iScanGen = iScanGen;
+		}
+	}
+
+	/* the others were renamed or are gone. As files may have been rotated
+	 * to each other's names, all their names and state files are released
+	 * before any of them is renamed.
+	 */
+	for(pFile = pWrkr->pFilesRoot ; pFile != NULL ; pFile = pNext) {
+		pNext = pFile->pNext;
+		if(pFile->pInst != inst || pFile->iScanGen == iScanGen)
+			continue;
+		hashtable_remove(pWrkr->ht, pFile->pszFileName);
+		for(i = 0 ; i < nEnts && (pEnts[i].bClaimed || pEnts[i].inode != pFile->inode) ; ++i)
+			/* just search */;
+		if(i == nEnts)
+			removeFile(pWrkr, pFile);
+	}
+	for(pFile = pWrkr->pFilesRoot ; pFile != NULL ; pFile = pFile->pNext) {
+		if(pFile->pInst == inst && pFile->iScanGen != iScanGen)
+			unlinkStateFile(pFile);
+	}
+	for(pFile = pWrkr->pFilesRoot ; pFile != NULL ; pFile = pNext) {
+		pNext = pFile->pNext;
+		if(pFile->pInst != inst || pFile->iScanGen == iScanGen)
+			continue;
+		for(i = 0 ; i < nEnts && (pEnts[i].bClaimed || pEnts[i].inode != pFile->inode) ; ++i)
+			/* just search */;
+		if(i < nEnts && renameFile(pWrkr, pFile, pEnts[i].pszName) == RS_RET_OK) {
+			pEnts[i].bClaimed = 1;
+			pFile->iScanGen = iScanGen;
+		} else {
+			removeFile(pWrkr, pFile);
+		}
+	}
+
+	/* what is left is new */
+	for(i = 0 ; i < nEnts ; ++i) {
+		if(pEnts[i].bClaimed
+		   || addFile(pWrkr, inst, pEnts[i].pszName, iDirWatch, &pFile) != RS_RET_OK)
+			continue;
+		pFile->inode = pEnts[i].inode;
+		DBGPRINTF("imfile: reader %d found new file '%s'\n", pWrkr->id, pEnts[i].pszName);
+	}
+
+finalize_it:
+	/* if the scan is incomplete (out of memory), we better keep what we have */
+	if(pDir != NULL)
+		closedir(pDir);
+	for(i = 0 ; i < nEnts ; ++i)
+		free(pEnts[i].pszName);
+	free(pEnts);
+	RETiRet;
+}
+
+
+/* split the configured file name into directory and file name part. This is
+ * done once on activation, so it is not needed for every file we find.
+ */
+static rsRetVal
+setupInstance(instanceConf_t *inst)
+{
+	uchar *pSlash;
+	DEFiRet;
+
+	pSlash = (uchar*) strrchr((char*) inst->pszFileName, '/');
+	if(pSlash == NULL) {
+		CHKmalloc(inst->pszDirName = ustrdup(UCHAR_CONSTANT(".")));
+		inst->pszFileBaseName = inst->pszFileName;
+	} else {
+		CHKmalloc(inst->pszDirName = (uchar*) strndup((char*) inst->pszFileName,
+			  (pSlash == inst->pszFileName) ? 1 : pSlash - inst->pszFileName));
+		inst->pszFileBaseName = pSlash + 1;
+	}
+	if(containsGlobWildcard((char*) inst->pszDirName)) {
+		errmsg.LogError(0, RS_RET_CONFIG_ERROR, "imfile: wildcards are only supported "
+				"in the file name, not in the directory: '%s' - not monitored",
 				inst->pszFileName);
-		ABORT_FINALIZE(RS_RET_OUT_OF_DESRIPTORS);
+		free(inst->pszDirName);
+		inst->pszDirName = NULL;
+		ABORT_FINALIZE(RS_RET_CONFIG_ERROR);
 	}
-	++iFilPtr;	/* we got a new file to monitor */
+	inst->bWildcard = containsGlobWildcard((char*) inst->pszFileBaseName);
 
-	resetConfigVariables(NULL, NULL); /* values are both dummies */
 finalize_it:
 	RETiRet;
 }
@@ -500,6 +1007,8 @@ CODESTARTbeginCnfLoad
 	pModConf->pConf = pConf;
 	/* init our settings */
 	loadModConf->iPollInterval = DFLT_PollInterval;
+	loadModConf->opMode = OPMODE_POLLING;
+	loadModConf->nThreads = 1;
 	loadModConf->configSetViaV2Method = 0;
 	bLegacyCnfModGlobalsPermitted = 1;
 	/* init legacy config vars */
@@ -537,6 +1046,21 @@ CODESTARTsetModCnf
 			continue;
 		if(!strcmp(modpblk.descr[i].name, "pollinginterval")) {
 			loadModConf->iPollInterval = (int) pvals[i].val.d.n;
+		} else if(!strcmp(modpblk.descr[i].name, "mode")) {
+			if(!es_strbufcmp(pvals[i].val.d.estr, (uchar*)"polling",
+					 sizeof("polling")-1)) {
+				loadModConf->opMode = OPMODE_POLLING;
+			} else if(!es_strbufcmp(pvals[i].val.d.estr, (uchar*)"inotify",
+					 sizeof("inotify")-1)) {
+				loadModConf->opMode = OPMODE_INOTIFY;
+			} else {
+				char *cstr = es_str2cstr(pvals[i].val.d.estr, NULL);
+				errmsg.LogError(0, RS_RET_INVLD_MODE,
+					"imfile: invalid mode '%s' - using polling", cstr);
+				free(cstr);
+			}
+		} else if(!strcmp(modpblk.descr[i].name, "threads")) {
+			loadModConf->nThreads = (int) pvals[i].val.d.n;
 		} else {
 			dbgprintf("imfile: program error, non-handled "
 			  "param '%s' in beginCnfLoad\n", modpblk.descr[i].name);
@@ -561,7 +1085,10 @@ CODESTARTendCnfLoad
 		/* persist module-specific settings from legacy config system */
 		loadModConf->iPollInterval = cs.iPollInterval;
 	}
-	dbgprintf("imfile: polling interval is %d\n", loadModConf->iPollInterval);
+	dbgprintf("imfile: polling interval is %d, mode %s, %d reader threads\n",
+		  loadModConf->iPollInterval,
+		  loadModConf->opMode == OPMODE_INOTIFY ? "inotify" : "polling",
+		  loadModConf->nThreads);
 
 	loadModConf = NULL; /* done loading */
 	/* free legacy config vars */
@@ -591,17 +1118,67 @@ ENDcheckCnf
  */
 BEGINactivateCnf
 	instanceConf_t *inst;
+	struct wrkrInfo_s *pWrkr;
+	uchar *pszKey;
+	int nFiles = 0;
+	int bWildcards = 0;
+	int maxMultiSub = 1;
+	int i;
 CODESTARTactivateCnf
 	runModConf = pModConf;
 	for(inst = runModConf->root ; inst != NULL ; inst = inst->next) {
-		addListner(inst);
+		if(setupInstance(inst) != RS_RET_OK)
+			continue;
+		if(inst->bWildcard)
+			bWildcards = 1;
+		else
+			++nFiles;
+		if(inst->nMultiSub > maxMultiSub)
+			maxMultiSub = inst->nMultiSub;
 	}
 	/* if we could not set up any listners, there is no point in running... */
-	if(iFilPtr == 0) {
+	if(nFiles == 0 && !bWildcards) {
 		errmsg.LogError(0, NO_ERRCODE, "imfile: no file monitors could be started, "
 				"input not activated.\n");
 		ABORT_FINALIZE(RS_RET_NO_RUN);
 	}
+
+	/* there is no point in having more readers than files. With wildcards, we
+	 * do not know how many files there will be.
+	 */
+	nWrkrs = (bWildcards || runModConf->nThreads < nFiles) ? runModConf->nThreads : nFiles;
+	CHKmalloc(wrkrInfo = calloc(nWrkrs, sizeof(struct wrkrInfo_s)));
+	for(i = 0 ; i < nWrkrs ; ++i) {
+		wrkrInfo[i].id = i;
+		CHKmalloc(wrkrInfo[i].ht = create_hashtable(64, hash_from_string, key_equals_string, NULL));
+		CHKmalloc(wrkrInfo[i].multiSub.ppMsgs = MALLOC(maxMultiSub * sizeof(msg_t*)));
+		wrkrInfo[i].multiSub.maxElem = maxMultiSub;
+#		ifdef HAVE_INOTIFY_INIT
+		wrkrInfo[i].ino_fd = -1;
+#		endif
+	}
+	/* configured files are distributed round-robin, files matching wildcards
+	 * are added by the readers when they find them
+	 */
+	CHKmalloc(htLiteral = create_hashtable(64, hash_from_string, key_equals_string, NULL));
+	i = 0;
+	for(inst = runModConf->root ; inst != NULL ; inst = inst->next) {
+		if(inst->pszDirName == NULL || inst->bWildcard)
+			continue;
+		if(isLiteralFile(inst->pszFileName)) {
+			errmsg.LogError(0, RS_RET_CONFIG_ERROR, "imfile: file '%s' is configured "
+					"more than once - ignoring duplicate", inst->pszFileName);
+			continue;
+		}
+		/* the hash table takes ownership of the key */
+		CHKmalloc(pszKey = ustrdup(inst->pszFileName));
+		if(!hashtable_insert(htLiteral, pszKey, inst)) {
+			free(pszKey);
+			ABORT_FINALIZE(RS_RET_OUT_OF_MEMORY);
+		}
+		pWrkr = &wrkrInfo[i++ % nWrkrs];
+		addFile(pWrkr, inst, inst->pszFileName, -1, NULL);
+	}
 finalize_it:
 ENDactivateCnf
 
@@ -614,6 +1191,7 @@ CODESTARTfreeCnf
 		free(inst->pszFileName);
 		free(inst->pszTag);
 		free(inst->pszStateFile);
+		free(inst->pszDirName);
 		del = inst;
 		inst = inst->next;
 		free(del);
@@ -641,11 +1219,7 @@ inputModuleCleanup(void __attribute__((unused)) *arg)
 }
 
 
-/* This function is called by the framework to gather the input. The module stays
- * most of its lifetime inside this function. It MUST NEVER exit this function. Doing
- * so would end module processing and rsyslog would NOT reschedule the module. If
- * you exit from this function, you violate the interface specification!
- *
+/* Monitor files by polling.
  * We go through all files and remember if at least one had data. If so, we do
  * another run (until no data was present in any file). Then we sleep for
  * PollInterval seconds and restart the whole process. This ensures that as
@@ -661,21 +1235,28 @@ inputModuleCleanup(void __attribute__((unused)) *arg)
  * On spamming the main queue: keep in mind that it will automatically rate-limit
  * ourselfes if we begin to overrun it. So we really do not need to care here.
  */
-#pragma GCC diagnostic ignored "-Wempty-body"
-BEGINrunInput
-	int i;
+static rsRetVal
+doPolling(struct wrkrInfo_s *pWrkr)
+{
+	fileInfo_t *pFile;
+	instanceConf_t *inst;
 	int bHadFileData; /* were there at least one file with data during this run? */
-CODESTARTrunInput
-	pthread_cleanup_push(inputModuleCleanup, NULL);
+	DEFiRet;
+
 	while(glbl.GetGlobalInputTermState() == 0) {
 		do {
+			/* look for new and removed files matching our wildcards */
+			for(inst = runModConf->root ; inst != NULL ; inst = inst->next) {
+				if(inst->pszDirName != NULL && inst->bWildcard)
+					scanWildcard(pWrkr, inst, -1);
+			}
 			bHadFileData = 0;
-			for(i = 0 ; i < iFilPtr ; ++i) {
+			for(pFile = pWrkr->pFilesRoot ; pFile != NULL ; pFile = pFile->pNext) {
 				if(glbl.GetGlobalInputTermState() == 1)
 					break; /* terminate input! */
-				pollFile(&files[i], &bHadFileData);
+				pollFile(pFile, &bHadFileData);
 			}
-		} while(iFilPtr > 1 && bHadFileData == 1 && glbl.GetGlobalInputTermState() == 0); /* warning: do...while()! */
+		} while(pWrkr->nFiles > 1 && bHadFileData == 1 && glbl.GetGlobalInputTermState() == 0); /* warning: do...while()! */
 
 		/* Note: the additional 10ns wait is vitally important. It guards rsyslog against totally
 		 * hogging the CPU if the users selects a polling interval of 0 seconds. It doesn't hurt any
@@ -684,6 +1265,461 @@ CODESTARTrunInput
 		if(glbl.GetGlobalInputTermState() == 0)
 			srSleep(runModConf->iPollInterval, 10);
 	}
+
+	RETiRet;
+}
+
+
+#ifdef HAVE_INOTIFY_INIT
+/* try to (re)establish the inotify watch for a directory. If that works, all
+ * files inside it are flagged for reading, as we may have missed data while
+ * the directory was not watched. For the same reason, the directory is
+ * scanned for files matching its wildcards, which also releases the files
+ * that are gone in case the directory does no longer exist.
+ */
+static void
+inoWatchDir(struct wrkrInfo_s *pWrkr, int iDir)
+{
+	dirWatch_t *pDir = &pWrkr->dirWatches[iDir];
+	fileInfo_t *pFile;
+	struct stat stat_buf;
+	int i;
+
+	pDir->bCheck = 0;
+	pDir->wd = inotify_add_watch(pWrkr->ino_fd, (char*) pDir->pInst->pszDirName,
+				     IN_CREATE | IN_MODIFY | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE);
+	if(pDir->wd == -1) {
+		DBGPRINTF("imfile: cannot watch directory '%s', errno %d - polling its "
+			  "files instead\n", pDir->pInst->pszDirName, errno);
+	} else {
+		pDir->inode = (stat((char*) pDir->pInst->pszDirName, &stat_buf) == 0) ? stat_buf.st_ino : 0;
+		DBGPRINTF("imfile: reader %d watching directory '%s', wd %d\n", pWrkr->id,
+			  pDir->pInst->pszDirName, pDir->wd);
+		for(pFile = pWrkr->pFilesRoot ; pFile != NULL ; pFile = pFile->pNext) {
+			if(pFile->iDirWatch == iDir)
+				setPending(pWrkr, pFile);
+		}
+	}
+	for(i = 0 ; i < pDir->nWild ; ++i)
+		scanWildcard(pWrkr, pDir->ppWild[i], iDir);
+}
+
+
+/* return the index of the directory watch for an input(), create it if it
+ * does not yet exist. Directories are identified by the name the user gave
+ * them, which is what we need to build file names from inotify events.
+ */
+static int
+inoDirWatchIdx(struct wrkrInfo_s *pWrkr, instanceConf_t *inst)
+{
+	dirWatch_t *pDir;
+	size_t lenDirPrefix;
+	int i;
+
+	lenDirPrefix = inst->pszFileBaseName - inst->pszFileName;
+	for(i = 0 ; i < pWrkr->nDirWatches ; ++i) {
+		pDir = &pWrkr->dirWatches[i];
+		if((size_t) (pDir->pInst->pszFileBaseName - pDir->pInst->pszFileName) == lenDirPrefix
+		   && !strncmp((char*) pDir->pInst->pszFileName, (char*) inst->pszFileName, lenDirPrefix))
+			return i;
+	}
+	pDir = &pWrkr->dirWatches[pWrkr->nDirWatches];
+	pDir->pInst = inst;
+	pDir->wd = -1;
+	return pWrkr->nDirWatches++;
+}
+
+
+/* set up inotify for a reader: create its instance and build the directory
+ * watch table from its files and all wildcard input()s. Watches are only
+ * tried here; directories that cannot be watched (e.g. because they do not yet
+ * exist) are retried every polling interval.
+ */
+static rsRetVal
+inoInit(struct wrkrInfo_s *pWrkr)
+{
+	fileInfo_t *pFile;
+	instanceConf_t *inst;
+	dirWatch_t *pDir;
+	instanceConf_t **ppWild;
+	int nDirs;
+	int j;
+	DEFiRet;
+
+	nDirs = pWrkr->nFiles;
+	for(inst = runModConf->root ; inst != NULL ; inst = inst->next) {
+		if(inst->pszDirName != NULL && inst->bWildcard)
+			++nDirs;
+	}
+	CHKmalloc(pWrkr->dirWatches = calloc(nDirs, sizeof(dirWatch_t)));
+	if((pWrkr->ino_fd = inotify_init()) == -1) {
+		char errStr[1024];
+		rs_strerror_r(errno, errStr, sizeof(errStr));
+		errmsg.LogError(0, RS_RET_ERR, "imfile: cannot initialize inotify (%s) - "
+				"falling back to polling mode", errStr);
+		ABORT_FINALIZE(RS_RET_ERR);
+	}
+
+	for(pFile = pWrkr->pFilesRoot ; pFile != NULL ; pFile = pFile->pNext) {
+		pFile->iDirWatch = inoDirWatchIdx(pWrkr, pFile->pInst);
+		/* always read once on startup, there may be data we did not yet process */
+		setPending(pWrkr, pFile);
+	}
+	for(inst = runModConf->root ; inst != NULL ; inst = inst->next) {
+		if(inst->pszDirName == NULL || !inst->bWildcard)
+			continue;
+		pDir = &pWrkr->dirWatches[inoDirWatchIdx(pWrkr, inst)];
+		CHKmalloc(ppWild = realloc(pDir->ppWild, (pDir->nWild + 1) * sizeof(instanceConf_t*)));
+		pDir->ppWild = ppWild;
+		pDir->ppWild[pDir->nWild++] = inst;
+	}
+
+	for(j = 0 ; j < pWrkr->nDirWatches ; ++j)
+		inoWatchDir(pWrkr, j);
+
+finalize_it:
+	RETiRet;
+}
+
+
+/* handle an inotify event for a file inside a watched directory. The file
+ * is looked up by name. Files we do not yet know are added if they are created
+ * with a name matching one of the directory's wildcards and are ours. If files
+ * matching a wildcard are deleted or renamed, the directory is scanned once
+ * all pending events are processed, as only the scan can tell a rename within
+ * the wildcard (which we follow) from a file that is gone.
+ */
+static void
+inoFileEvent(struct wrkrInfo_s *pWrkr, int iDir, struct inotify_event *ev)
+{
+	dirWatch_t *pDir = &pWrkr->dirWatches[iDir];
+	fileInfo_t *pFile;
+	struct stat stat_buf;
+	uchar pszName[MAXFNAME];
+	size_t lenDirPrefix;
+	int i;
+
+	lenDirPrefix = pDir->pInst->pszFileBaseName - pDir->pInst->pszFileName;
+	if(lenDirPrefix + strlen(ev->name) >= sizeof(pszName))
+		return;
+	memcpy(pszName, pDir->pInst->pszFileName, lenDirPrefix);
+	strcpy((char*) pszName + lenDirPrefix, ev->name);
+
+	if((pFile = hashtable_search(pWrkr->ht, pszName)) != NULL) {
+		setPending(pWrkr, pFile);
+		if(ev->mask & (IN_CREATE | IN_MOVED_TO))
+			checkSymlink(pWrkr, pFile);
+		if(pFile->pInst->bWildcard && !(ev->mask & IN_MODIFY))
+			pDir->bRescan = 1;
+		/* if the directory itself is removed while we still have
+		 * the file open, no IN_IGNORED is reported for it. */
+		if(ev->mask & IN_DELETE)
+			pDir->bCheck = 1;
+	} else if(pDir->nWild > 0 && (ev->mask & (IN_CREATE | IN_MOVED_TO))
+		  && !(ev->mask & IN_ISDIR) && !isLiteralFile(pszName)) {
+		for(i = 0 ; i < pDir->nWild ; ++i) {
+			if(fnmatch((char*) pDir->ppWild[i]->pszFileBaseName, ev->name, FNM_PERIOD) == 0)
+				break;
+		}
+		if(i < pDir->nWild && (ev->mask & IN_MOVED_TO)) {
+			pDir->bRescan = 1; /* may be one of our files renamed */
+		} else if(i < pDir->nWild
+			  && stat((char*) pszName, &stat_buf) == 0 && S_ISREG(stat_buf.st_mode)
+			  && wildcardOwner(stat_buf.st_ino) == pWrkr
+			  && addFile(pWrkr, pDir->ppWild[i], pszName, iDir, &pFile) == RS_RET_OK) {
+			pFile->inode = stat_buf.st_ino;
+			DBGPRINTF("imfile: reader %d found new file '%s'\n", pWrkr->id, pszName);
+		}
+	}
+}
+
+
+/* scan the directories flagged for it for files matching their wildcards */
+static void
+inoRescanDirs(struct wrkrInfo_s *pWrkr)
+{
+	dirWatch_t *pDir;
+	int i, j;
+
+	for(i = 0 ; i < pWrkr->nDirWatches ; ++i) {
+		pDir = &pWrkr->dirWatches[i];
+		if(pDir->bRescan) {
+			pDir->bRescan = 0;
+			for(j = 0 ; j < pDir->nWild ; ++j)
+				scanWildcard(pWrkr, pDir->ppWild[j], i);
+		}
+	}
+}
+
+
+/* read and process the pending inotify events. Events only queue files
+ * for reading; reading them is done by the caller. The exception are files
+ * found by a wildcard that are gone, these are read and released right away
+ * when their directory is scanned after the events are processed.
+ */
+static void
+inoProcessEvents(struct wrkrInfo_s *pWrkr)
+{
+	char evBuf[32 * 1024] __attribute__((aligned(__alignof__(struct inotify_event))));
+	struct inotify_event *ev;
+	dirWatch_t *dirWatches = pWrkr->dirWatches;
+	fileInfo_t *pFile;
+	ssize_t lenRead;
+	char *p;
+	int i, j;
+
+	lenRead = read(pWrkr->ino_fd, evBuf, sizeof(evBuf));
+	if(lenRead <= 0) {
+		DBGPRINTF("imfile: error reading inotify events, errno %d\n", errno);
+		return;
+	}
+
+	for(p = evBuf ; p < evBuf + lenRead ; p += sizeof(struct inotify_event) + ev->len) {
+		ev = (struct inotify_event*) p;
+		if(ev->mask & IN_Q_OVERFLOW) {
+			DBGPRINTF("imfile: inotify event queue overflow, reading all files\n");
+			for(pFile = pWrkr->pFilesRoot ; pFile != NULL ; pFile = pFile->pNext)
+				setPending(pWrkr, pFile);
+			for(i = 0 ; i < pWrkr->nDirWatches ; ++i) {
+				for(j = 0 ; j < dirWatches[i].nWild ; ++j)
+					scanWildcard(pWrkr, dirWatches[i].ppWild[j], i);
+			}
+		} else if(ev->mask & IN_IGNORED) {
+			/* watch was removed, most probably the directory is gone */
+			for(i = 0 ; i < pWrkr->nDirWatches ; ++i) {
+				if(dirWatches[i].wd == ev->wd) {
+					DBGPRINTF("imfile: watch for directory '%s' removed\n",
+						  dirWatches[i].pInst->pszDirName);
+					dirWatches[i].wd = -1;
+				}
+			}
+		} else if(ev->len > 0) {
+			/* the same directory may be watched under different names */
+			for(i = 0 ; i < pWrkr->nDirWatches ; ++i) {
+				if(dirWatches[i].wd == ev->wd)
+					inoFileEvent(pWrkr, i, ev);
+			}
+		}
+	}
+
+	inoRescanDirs(pWrkr);
+}
+
+
+/* called every polling interval while there are problematic directories or
+ * symlinked files: retry directories we could not watch and check if
+ * directories we have doubts about were removed or replaced. Files in
+ * directories still not watched and symlinked files are polled. As the file a
+ * symlink points to may be replaced without the watch noticing, directories
+ * with symlinked files found via a wildcard are scanned as well.
+ */
+static void
+inoCheckDirs(struct wrkrInfo_s *pWrkr)
+{
+	dirWatch_t *dirWatches = pWrkr->dirWatches;
+	fileInfo_t *pFile;
+	struct stat stat_buf;
+	int i;
+
+	for(i = 0 ; i < pWrkr->nDirWatches ; ++i) {
+		if(dirWatches[i].bCheck) {
+			dirWatches[i].bCheck = 0;
+			if(stat((char*) dirWatches[i].pInst->pszDirName, &stat_buf) == 0
+			   && stat_buf.st_ino == dirWatches[i].inode)
+				continue;
+			DBGPRINTF("imfile: directory '%s' was removed or replaced\n",
+				  dirWatches[i].pInst->pszDirName);
+			inotify_rm_watch(pWrkr->ino_fd, dirWatches[i].wd);
+			dirWatches[i].wd = -1;
+		}
+		if(dirWatches[i].wd == -1)
+			inoWatchDir(pWrkr, i);
+	}
+	for(pFile = pWrkr->pFilesRoot ; pFile != NULL ; pFile = pFile->pNext) {
+		if(dirWatches[pFile->iDirWatch].wd == -1 || pFile->bSymlink)
+			setPending(pWrkr, pFile);
+		if(pFile->bSymlink && pFile->pInst->bWildcard)
+			dirWatches[pFile->iDirWatch].bRescan = 1;
+	}
+	inoRescanDirs(pWrkr);
+}
+
+
+/* Monitor files via inotify.
+ * Only files inotify reported activity for are read. Rotation is handled by
+ * the stream class: it detects the inode change at EOF and reopens the file,
+ * which we trigger when the new file is created or moved into place. A file
+ * is read until EOF, but at most maxLinesAtOnce lines in a row; if there is
+ * more, it is queued again behind the other pending files, so that busy files
+ * do not starve the others. Idle files cost nothing, no matter how many.
+ * Files in directories that cannot be watched are polled every
+ * PollingInterval seconds, so polling remains as fallback.
+ */
+static rsRetVal
+doInotify(struct wrkrInfo_s *pWrkr)
+{
+	fileInfo_t *pFile;
+	struct pollfd pfd;
+	int bHadFileData; /* required by pollFile(), not used here */
+	int bCheckDirs;
+	time_t tNow;
+	time_t tNextCheck = 0; /* when inoCheckDirs() is due, 0 if not needed */
+	int timeout;
+	int i;
+	DEFiRet;
+
+	pfd.fd = pWrkr->ino_fd;
+	pfd.events = POLLIN;
+	while(glbl.GetGlobalInputTermState() == 0) {
+		while(pWrkr->pPendRoot != NULL && glbl.GetGlobalInputTermState() == 0) {
+			pFile = pWrkr->pPendRoot;
+			pWrkr->pPendRoot = pFile->pNextPending;
+			if(pWrkr->pPendRoot == NULL)
+				pWrkr->pPendLast = NULL;
+			pFile->bPending = 0;
+			/* pollFile() returns RS_RET_OK only if it stopped before EOF */
+			if(pollFile(pFile, &bHadFileData) == RS_RET_OK)
+				setPending(pWrkr, pFile);
+		}
+
+		bCheckDirs = pWrkr->nSymlinks > 0;
+		for(i = 0 ; i < pWrkr->nDirWatches ; ++i) {
+			if(pWrkr->dirWatches[i].wd == -1 || pWrkr->dirWatches[i].bCheck)
+				bCheckDirs = 1;
+		}
+		/* The directories are checked based on a deadline, not when poll()
+		 * times out, as busy files would otherwise delay the check forever.
+		 * The additional 10ms guard against hogging the CPU with an interval
+		 * of 0, see the polling mode.
+		 */
+		if(bCheckDirs) {
+			datetime.GetTime(&tNow);
+			/* the second condition guards against the clock being set back */
+			if(tNextCheck == 0 || tNextCheck - tNow > runModConf->iPollInterval)
+				tNextCheck = tNow + runModConf->iPollInterval;
+			timeout = (tNextCheck > tNow ? (tNextCheck - tNow) * 1000 : 0) + 10;
+		} else {
+			tNextCheck = 0;
+			timeout = -1;
+		}
+
+		/* a SIGTTIN sent for termination interrupts poll() */
+		if(glbl.GetGlobalInputTermState() == 1)
+			break;
+		i = poll(&pfd, 1, timeout);
+		if(i > 0) {
+			inoProcessEvents(pWrkr);
+		} else if(i < 0 && errno != EINTR) {
+			DBGPRINTF("imfile: poll() on inotify descriptor failed, errno %d\n", errno);
+			srSleep(runModConf->iPollInterval, 10);
+		}
+		if(tNextCheck != 0 && datetime.GetTime(&tNow) >= tNextCheck) {
+			inoCheckDirs(pWrkr);
+			tNextCheck = tNow + runModConf->iPollInterval;
+		}
+	}
+
+	RETiRet;
+}
+#endif /* #ifdef HAVE_INOTIFY_INIT */
+
+
+/* monitor the files of a single reader, in inotify mode if requested and
+ * possible, else by polling.
+ */
+static void
+monitorFiles(struct wrkrInfo_s *pWrkr)
+{
+#ifdef HAVE_INOTIFY_INIT
+	if(runModConf->opMode == OPMODE_INOTIFY && inoInit(pWrkr) == RS_RET_OK)
+		doInotify(pWrkr);
+	else
+#endif
+		doPolling(pWrkr);
+}
+
+
+/* thread function for the additional reader threads (reader 0 is run
+ * directly by the input thread). Note that we inherit the signal mask of
+ * the input thread, so SIGTTIN can be used to awake us on termination.
+ */
+static void *
+wrkr(void *myself)
+{
+	struct wrkrInfo_s *me = (struct wrkrInfo_s*) myself;
+
+	monitorFiles(me);
+
+	pthread_mutex_lock(&mutWrkr);
+	me->bRunning = 0;
+	pthread_cond_broadcast(&condWrkrTerm);
+	pthread_mutex_unlock(&mutWrkr);
+	return NULL;
+}
+
+
+/* start the additional reader threads. Failure to start one of them is
+ * not fatal, but its files are not monitored.
+ */
+static inline void
+startWorkers(void)
+{
+	int i;
+	int r;
+
+	DBGPRINTF("imfile: starting %d reader threads\n", nWrkrs);
+	for(i = 1 ; i < nWrkrs ; ++i) {
+		wrkrInfo[i].bRunning = 1;
+		r = pthread_create(&wrkrInfo[i].tid, NULL, wrkr, &(wrkrInfo[i]));
+		if(r != 0) {
+			errmsg.LogError(r, NO_ERRCODE, "imfile: error creating reader thread %d - "
+					"the files assigned to it are not monitored", i);
+			wrkrInfo[i].bRunning = 0;
+		}
+	}
+}
+
+
+/* stop the additional reader threads. They are usually blocked in poll()
+ * or sleeping, so we awake them via SIGTTIN until they have noticed the
+ * termination request.
+ */
+static inline void
+stopWorkers(void)
+{
+	struct timespec tTimeout;
+	int i;
+
+	for(i = 1 ; i < nWrkrs ; ++i) {
+		pthread_mutex_lock(&mutWrkr);
+		if(!wrkrInfo[i].bRunning) {
+			pthread_mutex_unlock(&mutWrkr);
+			continue;
+		}
+		while(wrkrInfo[i].bRunning) {
+			pthread_kill(wrkrInfo[i].tid, SIGTTIN);
+			timeoutComp(&tTimeout, 100);
+			pthread_cond_timedwait(&condWrkrTerm, &mutWrkr, &tTimeout);
+		}
+		pthread_mutex_unlock(&mutWrkr);
+		pthread_join(wrkrInfo[i].tid, NULL);
+		DBGPRINTF("imfile: reader thread %d terminated\n", i);
+	}
+}
+
+
+/* This function is called by the framework to gather the input. The module stays
+ * most of its lifetime inside this function. It MUST NEVER exit this function. Doing
+ * so would end module processing and rsyslog would NOT reschedule the module. If
+ * you exit from this function, you violate the interface specification!
+ */
+#pragma GCC diagnostic ignored "-Wempty-body"
+BEGINrunInput
+CODESTARTrunInput
+	pthread_cleanup_push(inputModuleCleanup, NULL);
+	startWorkers();
+	monitorFiles(&wrkrInfo[0]);
+	stopWorkers();
 	DBGPRINTF("imfile: terminating upon request of rsyslog core\n");
 	
 	pthread_cleanup_pop(0); /* just for completeness, but never called... */
@@ -762,27 +1798,48 @@ finalize_it:
  * shall free any resources and prepare the module for unload.
  */
 BEGINafterRun
+	fileInfo_t *pFile, *pNext;
 	int i;
+#	ifdef HAVE_INOTIFY_INIT
+	int j;
+#	endif
 CODESTARTafterRun
 	/* Close files and persist file state information. We do NOT abort on error iRet as that makes
 	 * matters worse (at least we can try persisting the others...). Please note that, under stress
 	 * conditions, it may happen that we are terminated before we actuall could open all streams. So
 	 * before we change anything, we need to make sure the stream was open.
 	 */
-	for(i = 0 ; i < iFilPtr ; ++i) {
-		if(files[i].pStrm != NULL) { /* stream open? */
-			persistStrmState(&files[i]);
-			strm.Destruct(&(files[i].pStrm));
+	for(i = 0 ; i < nWrkrs ; ++i) {
+		for(pFile = wrkrInfo[i].pFilesRoot ; pFile != NULL ; pFile = pNext) {
+			pNext = pFile->pNext;
+			if(pFile->pStrm != NULL) /* stream open? */
+				persistStrmState(pFile);
+			destructFile(pFile);
 		}
-		ratelimitDestruct(files[i].ratelimiter);
-		free(files[i].multiSub.ppMsgs);
-		free(files[i].pszFileName);
-		free(files[i].pszTag);
-		free(files[i].pszStateFile);
+		if(wrkrInfo[i].ht != NULL)
+			hashtable_destroy(wrkrInfo[i].ht, 0); /* files are already gone */
+		free(wrkrInfo[i].multiSub.ppMsgs);
+	}
+	if(htLiteral != NULL) {
+		hashtable_destroy(htLiteral, 0); /* values are the input()s, not owned */
+		htLiteral = NULL;
 	}
 
 	if(pInputName != NULL)
 		prop.Destruct(&pInputName);
+
+	for(i = 0 ; i < nWrkrs ; ++i) {
+#		ifdef HAVE_INOTIFY_INIT
+		for(j = 0 ; j < wrkrInfo[i].nDirWatches ; ++j)
+			free(wrkrInfo[i].dirWatches[j].ppWild);
+		free(wrkrInfo[i].dirWatches);
+		if(wrkrInfo[i].ino_fd != -1)
+			close(wrkrInfo[i].ino_fd);
+#		endif
+	}
+	free(wrkrInfo);
+	wrkrInfo = NULL;
+	nWrkrs = 0;
 ENDafterRun
 
 
@@ -806,6 +1863,8 @@ CODESTARTmodExit
 	objRelease(errmsg, CORE_COMPONENT);
 	objRelease(prop, CORE_COMPONENT);
 	objRelease(ruleset, CORE_COMPONENT);
+	pthread_mutex_destroy(&mutWrkr);
+	pthread_cond_destroy(&condWrkrTerm);
 ENDmodExit
 
 
@@ -875,6 +1934,8 @@ CODEmodInit_QueryRegCFSLineHdlr
 	CHKiRet(objUse(strm, CORE_COMPONENT));
 	CHKiRet(objUse(ruleset, CORE_COMPONENT));
 	CHKiRet(objUse(prop, CORE_COMPONENT));
+	pthread_mutex_init(&mutWrkr, NULL);
+	pthread_cond_init(&condWrkrTerm, NULL);
 
 	DBGPRINTF("imfile: version %s initializing\n", VERSION);
 	CHKiRet(omsdRegCFSLineHdlr((uchar *)"inputfilename", 0, eCmdHdlrGetWord,
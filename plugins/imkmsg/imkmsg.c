@@ -112,7 +112,8 @@ enqMsg(uchar *msg, uchar* pszTag, int iFacility, int iSeverity, struct timeval *
 	MsgSetTAG(pMsg, pszTag, ustrlen(pszTag));
 	pMsg->iFacility = iFacility;
 	pMsg->iSeverity = iSeverity;
-	pMsg->json = json;
+	if(json != NULL)
+		msgAddJSON(pMsg, (uchar*)"!", json);
 	CHKiRet(submitMsg(pMsg));
 
 finalize_it:
@@ -44,6 +44,7 @@
 #include <unistd.h>
 #include <stdarg.h>
 #include <ctype.h>
+#include <signal.h>
 #include <netinet/in.h>
 #include <netdb.h>
 #include <sys/types.h>
@@ -68,6 +69,7 @@
 #include "msg.h"
 #include "statsobj.h"
 #include "ratelimit.h"
+#include "atomic.h"
 #include "net.h" /* for permittedPeers, may be removed when this is removed */
 
 /* the define is from tcpsrv.h, we need to find a new (but easier!!!) abstraction layer some time ... */
@@ -92,6 +94,7 @@ DEFobjCurrIf(statsobj)
 static void * wrkr(void *myself);
 
 #define DFLT_wrkrMax 2
+#define MAX_wrkrMax 16
 
 /* config settings */
 typedef struct configSettings_s {
@@ -212,6 +215,7 @@ struct ptcpsess_s {
 	ptcpsess_t *prev, *next;
 	int sock;
 	epolld_t *epd;
+	struct wrkrInfo_s *pWrkr; /* worker owning this session (its epoll set) */
 //--- from tcps_sess.h
 	int iMsg;		 /* index of next char to store in msg */
 	int bAtStrtOfFram;	/* are we at the very beginning of a new frame? */
@@ -245,16 +249,26 @@ struct ptcplstn_s {
 
 /* The following structure controls the worker threads. Global data is
  * needed for their access.
+ * Each worker owns its own epoll set together with the sessions registered
+ * in it, so events are processed by the thread that received them, without
+ * any handoff between threads. Worker 0 is the input thread itself, the
+ * others are the "helper" threads. Listeners are registered with all epoll
+ * sets (with EPOLLEXCLUSIVE, so that only one worker is awoken for a
+ * connection request) and newly accepted sessions are handed to the least
+ * loaded worker. Without EPOLLEXCLUSIVE, listeners are served by worker 0
+ * only, which then distributes the sessions.
  */
 static struct wrkrInfo_s {
 	pthread_t tid;	/* the worker's thread ID */
-	pthread_cond_t run;
-	struct epoll_event *event; /* event == NULL -> idle */
+	int efd;	/* the worker's epoll descriptor */
+	int nSess;	/* number of sessions owned by this worker */
+	DEF_ATOMIC_HELPER_MUT(mutNSess);
+	sbool bRunning;	/* is the worker thread still running? (guarded by wrkrMut) */
 	long long unsigned numCalled;	/* how often was this called */
-} wrkrInfo[16];
+} wrkrInfo[MAX_wrkrMax+1];
+static int nWrkrs = 0;			/* number of workers, including the input thread */
 static pthread_mutex_t wrkrMut;
-static pthread_cond_t wrkrIdle;
-static int wrkrRunning;
+static pthread_cond_t wrkrTerm;		/* signalled when a worker terminates */
 
 
 /* type of object stored in epoll descriptor */
@@ -276,7 +290,6 @@ struct epolld_s {
 /* global data */
 pthread_attr_t wrkrThrdAttr;	/* Attribute for session threads; read only after startup */
 static ptcpsrv_t *pSrvRoot = NULL;
-static int epollfd = -1;			/* (sole) descriptor for epoll */
 static int iMaxLine; /* maximum size of a single message */
 
 /* forward definitions */
@@ -661,15 +674,20 @@ finalize_it:
  * function or some related code).
  * rgerhards, 2009-04-23
  * EXTRACT from tcps_sess.c
+ * The message text is now passed in explicitely. It is either the session's
+ * message buffer or, if a complete frame is contained in the receive buffer,
+ * a pointer right into the receive buffer. In the later case, the frame is
+ * copied just once, into the message object.
  */
 static rsRetVal
-doSubmitMsg(ptcpsess_t *pThis, struct syslogTime *stTime, time_t ttGenTime, multi_submit_t *pMultiSub)
+doSubmitMsgBuf(ptcpsess_t *pThis, uchar *pBuf, int lenBuf, struct syslogTime *stTime, time_t ttGenTime,
+	       multi_submit_t *pMultiSub)
 {
 	msg_t *pMsg;
 	ptcpsrv_t *pSrv;
 	DEFiRet;
 
-	if(pThis->iMsg == 0) {
+	if(lenBuf == 0) {
 		DBGPRINTF("discarding zero-sized message\n");
 		FINALIZE;
 	}
@@ -677,7 +695,7 @@ doSubmitMsg(ptcpsess_t *pThis, struct syslogTime *stTime, time_t ttGenTime, mult
 
 	/* we now create our own message object and submit it to the queue */
 	CHKiRet(msgConstructWithTime(&pMsg, stTime, ttGenTime));
-	MsgSetRawMsg(pMsg, (char*)pThis->pMsg, pThis->iMsg);
+	MsgSetRawMsg(pMsg, (char*)pBuf, lenBuf);
 	MsgSetInputName(pMsg, pSrv->pInputName);
 	MsgSetFlowControlType(pMsg, eFLOWCTL_LIGHT_DELAY);
 	pMsg->msgFlags  = NEEDS_PARSING | PARSE_HOSTNAME;
@@ -697,95 +715,150 @@ finalize_it:
 }
 
 
-/* process the data received. As TCP is stream based, we need to process the
- * data inside a state machine. The actual data received is passed in byte-by-byte
- * from DataRcvd, and this function here compiles messages from them and submits
- * the end result to the queue. Introducing this function fixes a long-term bug ;)
- * rgerhards, 2008-03-14
- * EXTRACT from tcps_sess.c
- */
+/* submit the message assembled inside the session's message buffer */
 static inline rsRetVal
-processDataRcvd(ptcpsess_t *pThis, char c, struct syslogTime *stTime, time_t ttGenTime, multi_submit_t *pMultiSub)
+doSubmitMsg(ptcpsess_t *pThis, struct syslogTime *stTime, time_t ttGenTime, multi_submit_t *pMultiSub)
 {
-	DEFiRet;
+	return doSubmitMsgBuf(pThis, pThis->pMsg, pThis->iMsg, stTime, ttGenTime, pMultiSub);
+}
 
-	if(pThis->inputState == eAtStrtFram) {
-		if(pThis->bSuppOctetFram && isdigit((int) c)) {
-			pThis->inputState = eInOctetCnt;
-			pThis->iOctetsRemain = 0;
-			pThis->eFraming = TCP_FRAMING_OCTET_COUNTING;
-		} else {
-			pThis->inputState = eInMsg;
-			pThis->eFraming = TCP_FRAMING_OCTET_STUFFING;
-		}
-	}
 
-	if(pThis->inputState == eInOctetCnt) {
-		if(isdigit(c)) {
-			pThis->iOctetsRemain = pThis->iOctetsRemain * 10 + c - '0';
-		} else { /* done with the octet count, so this must be the SP terminator */
-			DBGPRINTF("TCP Message with octet-counter, size %d.\n", pThis->iOctetsRemain);
-			if(c != ' ') {
-				errmsg.LogError(0, NO_ERRCODE, "Framing Error in received TCP message: "
-					    "delimiter is not SP but has ASCII value %d.\n", c);
-			}
-			if(pThis->iOctetsRemain < 1) {
-				/* TODO: handle the case where the octet count is 0! */
-				DBGPRINTF("Framing Error: invalid octet count\n");
-				errmsg.LogError(0, NO_ERRCODE, "Framing Error in received TCP message: "
-					    "invalid octet count %d.\n", pThis->iOctetsRemain);
-			} else if(pThis->iOctetsRemain > iMaxLine) {
-				/* while we can not do anything against it, we can at least log an indication
-				 * that something went wrong) -- rgerhards, 2008-03-14
-				 */
-				DBGPRINTF("truncating message with %d octets - max msg size is %d\n",
-					  pThis->iOctetsRemain, iMaxLine);
-				errmsg.LogError(0, NO_ERRCODE, "received oversize message: size is %d bytes, "
-					        "max msg size is %d, truncating...\n", pThis->iOctetsRemain, iMaxLine);
-			}
-			pThis->inputState = eInMsg;
+/* process one character of the octet count. This is done byte-by-byte, as
+ * the count is just a few characters long. When the terminating SP is found,
+ * we switch over to the message itself.
+ */
+static inline void
+processOctetCnt(ptcpsess_t *pThis, char c)
+{
+	if(isdigit(c)) {
+		pThis->iOctetsRemain = pThis->iOctetsRemain * 10 + c - '0';
+	} else { /* done with the octet count, so this must be the SP terminator */
+		DBGPRINTF("TCP Message with octet-counter, size %d.\n", pThis->iOctetsRemain);
+		if(c != ' ') {
+			errmsg.LogError(0, NO_ERRCODE, "Framing Error in received TCP message: "
+				    "delimiter is not SP but has ASCII value %d.\n", c);
 		}
-	} else {
-		assert(pThis->inputState == eInMsg);
-		if(pThis->iMsg >= iMaxLine) {
-			/* emergency, we now need to flush, no matter if we are at end of message or not... */
-			DBGPRINTF("error: message received is larger than max msg size, we split it\n");
-			doSubmitMsg(pThis, stTime, ttGenTime, pMultiSub);
-			/* we might think if it is better to ignore the rest of the
-			 * message than to treat it as a new one. Maybe this is a good
-			 * candidate for a configuration parameter...
-			 * rgerhards, 2006-12-04
+		if(pThis->iOctetsRemain < 1) {
+			/* TODO: handle the case where the octet count is 0! */
+			DBGPRINTF("Framing Error: invalid octet count\n");
+			errmsg.LogError(0, NO_ERRCODE, "Framing Error in received TCP message: "
+				    "invalid octet count %d.\n", pThis->iOctetsRemain);
+		} else if(pThis->iOctetsRemain > iMaxLine) {
+			/* while we can not do anything against it, we can at least log an indication
+			 * that something went wrong) -- rgerhards, 2008-03-14
 			 */
+			DBGPRINTF("truncating message with %d octets - max msg size is %d\n",
+				  pThis->iOctetsRemain, iMaxLine);
+			errmsg.LogError(0, NO_ERRCODE, "received oversize message: size is %d bytes, "
+				        "max msg size is %d, truncating...\n", pThis->iOctetsRemain, iMaxLine);
 		}
+		pThis->inputState = eInMsg;
+	}
+}
+
 
-		if((   (c == '\n')
-		   || ((pThis->pLstn->pSrv->iAddtlFrameDelim != TCPSRV_NO_ADDTL_DELIMITER)
-		       && (c == pThis->pLstn->pSrv->iAddtlFrameDelim))
-		   ) && pThis->eFraming == TCP_FRAMING_OCTET_STUFFING) { /* record delimiter? */
+/* process message data of an octet-counted frame. As we know the frame size,
+ * we do not need to look at the data at all but can jump right to the end of
+ * the frame (or the end of the receive buffer, whatever comes first). If the
+ * complete frame is inside the receive buffer, it is submitted directly from
+ * there. Otherwise, the part we have is copied to the session's message buffer.
+ * On return, *ppData has been advanced past the data consumed.
+ */
+static inline void
+processOctetCntFrame(ptcpsess_t *pThis, char **ppData, char *pEnd, struct syslogTime *stTime,
+		     time_t ttGenTime, multi_submit_t *pMultiSub)
+{
+	char *pData = *ppData;
+	int iChunk;
+
+	if(pThis->iOctetsRemain < 1) {
+		/* invalid octet count - as in previous versions, we consume a single byte */
+		iChunk = 1;
+	} else {
+		iChunk = pThis->iOctetsRemain;
+		if(iChunk > pEnd - pData)
+			iChunk = pEnd - pData;
+	}
+
+	if(pThis->iMsg == 0 && iChunk == pThis->iOctetsRemain && iChunk <= iMaxLine) {
+		/* complete frame inside receive buffer */
+		doSubmitMsgBuf(pThis, (uchar*) pData, iChunk, stTime, ttGenTime, pMultiSub);
+		pThis->inputState = eAtStrtFram;
+	} else {
+		/* the session buffer is never full here, our caller made sure of that */
+		if(iChunk > iMaxLine - pThis->iMsg)
+			iChunk = iMaxLine - pThis->iMsg;
+		memcpy(pThis->pMsg + pThis->iMsg, pData, iChunk);
+		pThis->iMsg += iChunk;
+		pThis->iOctetsRemain -= iChunk;
+		if(pThis->iOctetsRemain < 1) {
+			/* we have end of frame! */
 			doSubmitMsg(pThis, stTime, ttGenTime, pMultiSub);
 			pThis->inputState = eAtStrtFram;
-		} else {
-			/* IMPORTANT: here we copy the actual frame content to the message - for BOTH framing modes!
-			 * If we have a message that is larger than the max msg size, we truncate it. This is the best
-			 * we can do in light of what the engine supports. -- rgerhards, 2008-03-14
-			 */
-			if(pThis->iMsg < iMaxLine) {
-				*(pThis->pMsg + pThis->iMsg++) = c;
-			}
 		}
+	}
+	*ppData = pData + iChunk;
+}
 
-		if(pThis->eFraming == TCP_FRAMING_OCTET_COUNTING) {
-			/* do we need to find end-of-frame via octet counting? */
-			pThis->iOctetsRemain--;
-			if(pThis->iOctetsRemain < 1) {
-				/* we have end of frame! */
-				doSubmitMsg(pThis, stTime, ttGenTime, pMultiSub);
-				pThis->inputState = eAtStrtFram;
-			}
-		}
+
+/* process message data of an octet-stuffed frame. We search for the frame
+ * delimiter with memchr(), which is much faster than looking at each byte
+ * individually (libc uses vector instructions for it on most platforms).
+ * As the LF may be far away, its location is cached in *ppLF, so that
+ * we need to search for it only once per receive buffer, even if the
+ * additional frame delimiter is used much more frequently.
+ * If the complete frame is inside the receive buffer, it is submitted
+ * directly from there. Otherwise, the part we have is copied to the
+ * session's message buffer. On return, *ppData has been advanced past
+ * the data consumed.
+ */
+static inline void
+processOctetStuffFrame(ptcpsess_t *pThis, char **ppData, char *pEnd, char **ppLF,
+		       struct syslogTime *stTime, time_t ttGenTime, multi_submit_t *pMultiSub)
+{
+	char *pData = *ppData;
+	char *pLimit;
+	char *pDelim;
+	char *pAddtl;
+	int iAddtlFrameDelim;
+	int iChunk;
+
+	/* we look at most at as many bytes as fit into the session buffer */
+	iChunk = iMaxLine - pThis->iMsg;
+	if(iChunk > pEnd - pData)
+		iChunk = pEnd - pData;
+	pLimit = pData + iChunk;
+
+	if(*ppLF == NULL || *ppLF < pData) {
+		*ppLF = memchr(pData, '\n', pEnd - pData);
+		if(*ppLF == NULL)
+			*ppLF = pEnd;
 	}
+	pDelim = (*ppLF < pLimit) ? *ppLF : pLimit;
 
-	RETiRet;
+	iAddtlFrameDelim = pThis->pLstn->pSrv->iAddtlFrameDelim;
+	if(iAddtlFrameDelim != TCPSRV_NO_ADDTL_DELIMITER) {
+		pAddtl = memchr(pData, iAddtlFrameDelim, pDelim - pData);
+		if(pAddtl != NULL)
+			pDelim = pAddtl;
+	}
+
+	if(pDelim < pLimit) { /* record delimiter found */
+		if(pThis->iMsg == 0) {
+			/* complete frame inside receive buffer */
+			doSubmitMsgBuf(pThis, (uchar*) pData, pDelim - pData, stTime, ttGenTime, pMultiSub);
+		} else {
+			memcpy(pThis->pMsg + pThis->iMsg, pData, pDelim - pData);
+			pThis->iMsg += pDelim - pData;
+			doSubmitMsg(pThis, stTime, ttGenTime, pMultiSub);
+		}
+		pThis->inputState = eAtStrtFram;
+		*ppData = pDelim + 1; /* skip delimiter */
+	} else {
+		memcpy(pThis->pMsg + pThis->iMsg, pData, iChunk);
+		pThis->iMsg += iChunk;
+		*ppData = pLimit;
+	}
 }
 
 
@@ -804,6 +877,11 @@ processDataRcvd(ptcpsess_t *pThis, char c, struct syslogTime *stTime, time_t ttG
  * this *is* the *correct* reception step for all the data we received, because
  * we have just received a bunch of data! -- rgerhards, 2009-06-16
  * EXTRACT from tcps_sess.c
+ * As TCP is stream based, we need to process the data inside a state machine.
+ * This was originally done byte-by-byte, but we now process the message data
+ * in chunks: for octet-counted frames, we jump over the announced length, for
+ * octet-stuffed frames we search the delimiter via memchr(). Only the octet
+ * count itself is still processed byte-by-byte.
  */
 static rsRetVal
 DataRcvd(ptcpsess_t *pThis, char *pData, size_t iLen)
@@ -813,26 +891,57 @@ DataRcvd(ptcpsess_t *pThis, char *pData, size_t iLen)
 	struct syslogTime stTime;
 	time_t ttGenTime;
 	char *pEnd;
+	char *pLF = NULL; /* location of next LF inside receive buffer, if already known */
 	DEFiRet;
 
 	assert(pData != NULL);
 	assert(iLen > 0);
 
-	datetime.getCurrTime(&stTime, &ttGenTime);
+	datetime.getCurrTimeCached(&stTime, &ttGenTime, glbl.GetCoarseClock());
 	multiSub.ppMsgs = pMsgs;
 	multiSub.maxElem = CONF_NUM_MULTISUB;
 	multiSub.nElem = 0;
 
-	 /* We now copy the message to the session buffer. */
 	pEnd = pData + iLen; /* this is one off, which is intensional */
 
 	while(pData < pEnd) {
-		CHKiRet(processDataRcvd(pThis, *pData++, &stTime, ttGenTime, &multiSub));
+		switch(pThis->inputState) {
+		case eAtStrtFram:
+			/* decide on framing, the byte itself is processed in the new state */
+			if(pThis->bSuppOctetFram && isdigit((int) *pData)) {
+				pThis->inputState = eInOctetCnt;
+				pThis->iOctetsRemain = 0;
+				pThis->eFraming = TCP_FRAMING_OCTET_COUNTING;
+			} else {
+				pThis->inputState = eInMsg;
+				pThis->eFraming = TCP_FRAMING_OCTET_STUFFING;
+			}
+			break;
+		case eInOctetCnt:
+			processOctetCnt(pThis, *pData++);
+			break;
+		case eInMsg:
+			if(pThis->iMsg >= iMaxLine) {
+				/* emergency, we now need to flush, no matter if we are at end of message or not... */
+				DBGPRINTF("error: message received is larger than max msg size, we split it\n");
+				doSubmitMsg(pThis, &stTime, ttGenTime, &multiSub);
+				/* we might think if it is better to ignore the rest of the
+				 * message than to treat it as a new one. Maybe this is a good
+				 * candidate for a configuration parameter...
+				 * rgerhards, 2006-12-04
+				 */
+			}
+			if(pThis->eFraming == TCP_FRAMING_OCTET_COUNTING) {
+				processOctetCntFrame(pThis, &pData, pEnd, &stTime, ttGenTime, &multiSub);
+			} else {
+				processOctetStuffFrame(pThis, &pData, pEnd, &pLF, &stTime, ttGenTime, &multiSub);
+			}
+			break;
+		}
 	}
 
 	iRet = multiSubmitFlush(&multiSub);
 
-finalize_it:
 	RETiRet;
 }
 
@@ -854,10 +963,10 @@ initConfigSettings(void)
 }
 
 
-/* add socket to the epoll set
+/* add socket to the epoll set efd
  */
 static inline rsRetVal
-addEPollSock(epolld_type_t typ, void *ptr, int sock, epolld_t **pEpd)
+addEPollSock(epolld_type_t typ, void *ptr, int sock, epolld_t **pEpd, int efd)
 {
 	DEFiRet;
 	epolld_t *epd = NULL;
@@ -867,9 +976,13 @@ addEPollSock(epolld_type_t typ, void *ptr, int sock, epolld_t **pEpd)
 	epd->ptr = ptr;
 	*pEpd = epd;
 	epd->ev.events = EPOLLIN|EPOLLET;
+#	ifdef EPOLLEXCLUSIVE
+	if(typ == epolld_lstn)
+		epd->ev.events |= EPOLLEXCLUSIVE;
+#	endif
 	epd->ev.data.ptr = (void*) epd;
 
-	if(epoll_ctl(epollfd, EPOLL_CTL_ADD, sock, &(epd->ev)) != 0) {
+	if(epoll_ctl(efd, EPOLL_CTL_ADD, sock, &(epd->ev)) != 0) {
 		char errStr[1024];
 		int eno = errno;
 		errmsg.LogError(0, RS_RET_EPOLL_CTL_FAILED, "os error (%d) during epoll ADD: %s",
@@ -877,7 +990,7 @@ addEPollSock(epolld_type_t typ, void *ptr, int sock, epolld_t **pEpd)
 		ABORT_FINALIZE(RS_RET_EPOLL_CTL_FAILED);
 	}
 
-	DBGPRINTF("imptcp: added socket %d to epoll[%d] set\n", sock, epollfd);
+	DBGPRINTF("imptcp: added socket %d to epoll[%d] set\n", sock, efd);
 
 finalize_it:
 	if(iRet != RS_RET_OK) {
@@ -894,13 +1007,13 @@ finalize_it:
  * event (it's simple because we have it at hand).
  */
 static inline rsRetVal
-removeEPollSock(int sock, epolld_t *epd)
+removeEPollSock(int sock, epolld_t *epd, int efd)
 {
 	DEFiRet;
 
-	DBGPRINTF("imptcp: removing socket %d from epoll[%d] set\n", sock, epollfd);
+	DBGPRINTF("imptcp: removing socket %d from epoll[%d] set\n", sock, efd);
 
-	if(epoll_ctl(epollfd, EPOLL_CTL_DEL, sock, &(epd->ev)) != 0) {
+	if(epoll_ctl(efd, EPOLL_CTL_DEL, sock, &(epd->ev)) != 0) {
 		char errStr[1024];
 		int eno = errno;
 		errmsg.LogError(0, RS_RET_EPOLL_CTL_FAILED, "os error (%d) during epoll DEL: %s",
@@ -921,6 +1034,9 @@ addLstn(ptcpsrv_t *pSrv, int sock, int isIPv6)
 	DEFiRet;
 	ptcplstn_t *pLstn;
 	uchar statname[64];
+#	ifdef EPOLLEXCLUSIVE
+	int i;
+#	endif
 
 	CHKmalloc(pLstn = malloc(sizeof(ptcplstn_t)));
 	pLstn->pSrv = pSrv;
@@ -945,13 +1061,43 @@ addLstn(ptcpsrv_t *pSrv, int sock, int isIPv6)
 		pSrv->pLstn->prev = pLstn;
 	pSrv->pLstn = pLstn;
 
-	iRet = addEPollSock(epolld_lstn, pLstn, sock, &pLstn->epd);
+	CHKiRet(addEPollSock(epolld_lstn, pLstn, sock, &pLstn->epd, wrkrInfo[0].efd));
+#	ifdef EPOLLEXCLUSIVE
+	/* share the listener with all other workers, the kernel awakes only one of them */
+	for(i = 1 ; i < nWrkrs ; ++i) {
+		if(epoll_ctl(wrkrInfo[i].efd, EPOLL_CTL_ADD, sock, &(pLstn->epd->ev)) != 0) {
+			char errStr[1024];
+			int eno = errno;
+			errmsg.LogError(0, RS_RET_EPOLL_CTL_FAILED, "os error (%d) during epoll ADD: %s",
+				        eno, rs_strerror_r(eno, errStr, sizeof(errStr)));
+			ABORT_FINALIZE(RS_RET_EPOLL_CTL_FAILED);
+		}
+	}
+#	endif
 
 finalize_it:
 	RETiRet;
 }
 
 
+/* find the worker which currently owns the least sessions. We do not lock
+ * the session counters, as a slightly outdated value does no harm here.
+ */
+static inline struct wrkrInfo_s *
+getLeastLoadedWrkr(void)
+{
+	struct wrkrInfo_s *pWrkr;
+	int i;
+
+	pWrkr = &wrkrInfo[0];
+	for(i = 1 ; i < nWrkrs ; ++i) {
+		if(wrkrInfo[i].nSess < pWrkr->nSess)
+			pWrkr = &wrkrInfo[i];
+	}
+	return pWrkr;
+}
+
+
 /* add a session to the server 
  */
 static rsRetVal
@@ -971,6 +1117,7 @@ addSess(ptcplstn_t *pLstn, int sock, prop_t *peerName, prop_t *peerIP)
 	pSess->bAtStrtOfFram = 1;
 	pSess->peerName = peerName;
 	pSess->peerIP = peerIP;
+	pSess->pWrkr = getLeastLoadedWrkr();
 
 	/* add to start of server's listener list */
 	pSess->prev = NULL;
@@ -981,7 +1128,8 @@ addSess(ptcplstn_t *pLstn, int sock, prop_t *peerName, prop_t *peerIP)
 	pSrv->pSess = pSess;
 	pthread_mutex_unlock(&pSrv->mutSessLst);
 
-	iRet = addEPollSock(epolld_sess, pSess, sock, &pSess->epd);
+	ATOMIC_INC(&pSess->pWrkr->nSess, &pSess->pWrkr->mutNSess);
+	iRet = addEPollSock(epolld_sess, pSess, sock, &pSess->epd, pSess->pWrkr->efd);
 
 finalize_it:
 	RETiRet;
@@ -999,8 +1147,9 @@ closeSess(ptcpsess_t *pSess)
 	DEFiRet;
 	
 	sock = pSess->sock;
-	CHKiRet(removeEPollSock(sock, pSess->epd));
+	CHKiRet(removeEPollSock(sock, pSess->epd, pSess->pWrkr->efd));
 	close(sock);
+	ATOMIC_DEC(&pSess->pWrkr->nSess, &pSess->pWrkr->mutNSess);
 
 	pthread_mutex_lock(&pSess->pLstn->pSrv->mutSessLst);
 	/* finally unlink session from structures */
@@ -1160,42 +1309,103 @@ finalize_it:
 }
 
 
-/* destroy worker pool structures and wait for workers to terminate
+/* create the epoll sets for all workers. This must be done before the
+ * listeners are started, as these are registered with them.
+ */
+static inline rsRetVal
+createWorkerEPoll(void)
+{
+	int i;
+	DEFiRet;
+
+	if(runModConf->wrkrMax > MAX_wrkrMax)
+		runModConf->wrkrMax = MAX_wrkrMax; /* TODO: make dynamic? */
+	if(runModConf->wrkrMax < 0)
+		runModConf->wrkrMax = 0;
+	nWrkrs = runModConf->wrkrMax + 1; /* the input thread is worker 0 */
+	for(i = 0 ; i < nWrkrs ; ++i) {
+		wrkrInfo[i].nSess = 0;
+		wrkrInfo[i].numCalled = 0;
+		wrkrInfo[i].bRunning = 0;
+		INIT_ATOMIC_HELPER_MUT(wrkrInfo[i].mutNSess);
+#		if defined(EPOLL_CLOEXEC) && defined(HAVE_EPOLL_CREATE1)
+		DBGPRINTF("imptcp uses epoll_create1()\n");
+		wrkrInfo[i].efd = epoll_create1(EPOLL_CLOEXEC);
+		if(wrkrInfo[i].efd < 0 && errno == ENOSYS)
+#		endif
+		{
+			DBGPRINTF("imptcp uses epoll_create()\n");
+			/* reading the docs, the number of epoll events passed to
+			 * epoll_create() seems not to be used at all in kernels. So
+			 * we just provide "a" number, happens to be 10.
+			 */
+			wrkrInfo[i].efd = epoll_create(10);
+		}
+
+		if(wrkrInfo[i].efd < 0) {
+			errmsg.LogError(0, RS_RET_EPOLL_CR_FAILED, "error: epoll_create() failed");
+			nWrkrs = i;
+			ABORT_FINALIZE(RS_RET_NO_RUN);
+		}
+	}
+
+finalize_it:
+	RETiRet;
+}
+
+
+/* start the helper workers. Worker 0 is the input thread, which
+ * is already running.
  */
 static inline void
 startWorkerPool(void)
 {
 	int i;
-	wrkrRunning = 0;
-	if(runModConf->wrkrMax > 16)
-		runModConf->wrkrMax = 16; /* TODO: make dynamic? */
-	DBGPRINTF("imptcp: starting worker pool, %d workers\n", runModConf->wrkrMax);
+	int r;
+	DBGPRINTF("imptcp: starting worker pool, %d workers\n", nWrkrs - 1);
 	pthread_mutex_init(&wrkrMut, NULL);
-	pthread_cond_init(&wrkrIdle, NULL);
-	for(i = 0 ; i < runModConf->wrkrMax ; ++i) {
-		/* init worker info structure! */
-		pthread_cond_init(&wrkrInfo[i].run, NULL);
-		wrkrInfo[i].event = NULL;
-		wrkrInfo[i].numCalled = 0;
-		pthread_create(&wrkrInfo[i].tid, &wrkrThrdAttr, wrkr, &(wrkrInfo[i]));
+	pthread_cond_init(&wrkrTerm, NULL);
+	for(i = 1 ; i < nWrkrs ; ++i) {
+		wrkrInfo[i].bRunning = 1;
+		r = pthread_create(&wrkrInfo[i].tid, &wrkrThrdAttr, wrkr, &(wrkrInfo[i]));
+		if(r != 0) {
+			errmsg.LogError(r, NO_ERRCODE, "imptcp: error creating worker thread %d - "
+					"its sessions will not be served", i);
+			wrkrInfo[i].bRunning = 0;
+		}
 	}
 
 }
 
-/* destroy worker pool structures and wait for workers to terminate
+/* destroy worker pool structures and wait for workers to terminate.
+ * The workers are usually blocked inside epoll_wait(), so we awake them
+ * via SIGTTIN (they inherited the input thread's signal mask) until they
+ * notice the termination request.
  */
 static inline void
 stopWorkerPool(void)
 {
+	struct timespec tTimeout;
 	int i;
 	DBGPRINTF("imptcp: stoping worker pool\n");
-	for(i = 0 ; i < runModConf->wrkrMax ; ++i) {
-		pthread_cond_signal(&wrkrInfo[i].run); /* awake wrkr if not running */
+	for(i = 1 ; i < nWrkrs ; ++i) {
+		pthread_mutex_lock(&wrkrMut);
+		if(!wrkrInfo[i].bRunning) {
+			pthread_mutex_unlock(&wrkrMut);
+			continue;
+		}
+		while(wrkrInfo[i].bRunning) {
+			pthread_kill(wrkrInfo[i].tid, SIGTTIN);
+			timeoutComp(&tTimeout, 100);
+			pthread_cond_timedwait(&wrkrTerm, &wrkrMut, &tTimeout);
+		}
+		pthread_mutex_unlock(&wrkrMut);
 		pthread_join(wrkrInfo[i].tid, NULL);
+	}
+	for(i = 0 ; i < nWrkrs ; ++i) {
 		DBGPRINTF("imptcp: info: worker %d was called %llu times\n", i, wrkrInfo[i].numCalled);
-		pthread_cond_destroy(&wrkrInfo[i].run);
 	}
-	pthread_cond_destroy(&wrkrIdle);
+	pthread_cond_destroy(&wrkrTerm);
 	pthread_mutex_destroy(&wrkrMut);
 }
 
@@ -1332,80 +1542,42 @@ processWorkItem(struct epoll_event *event)
 }
 
 
-/* This function is called to process a complete workset, that
- * is a set of events returned from epoll.
+/* This is the main loop of a worker: wait for events on its epoll
+ * set and process them. As a session is registered with exactly one epoll
+ * set, its events are always processed by the same worker, so no further
+ * synchronization is needed.
  */
-static inline void
-processWorkSet(int nEvents, struct epoll_event events[])
+static void
+wrkrLoop(struct wrkrInfo_s *me)
 {
-	int iEvt;
+	int nEvents;
 	int i;
-	int remainEvents;
-
-	remainEvents = nEvents;
-	for(iEvt = 0 ; (iEvt < nEvents) && (glbl.GetGlobalInputTermState() == 0) ; ++iEvt) {
-		if(remainEvents == 1) {
-			/* process self, save context switch */
-			processWorkItem(events+iEvt);
-		} else {
-			pthread_mutex_lock(&wrkrMut);
-			/* check if there is a free worker */
-			for(i = 0 ; (i < runModConf->wrkrMax) && (wrkrInfo[i].event != NULL) ; ++i)
-				/*do search*/;
-			if(i < runModConf->wrkrMax) {
-				/* worker free -> use it! */
-				wrkrInfo[i].event = events+iEvt;
-				++wrkrRunning;
-				pthread_cond_signal(&wrkrInfo[i].run);
-				pthread_mutex_unlock(&wrkrMut);
-			} else {
-				pthread_mutex_unlock(&wrkrMut);
-				/* no free worker, so we process this one ourselfs */
-				processWorkItem(events+iEvt);
-			}
-		}
-		--remainEvents;
-	}
+	struct epoll_event events[128];
 
-	if(nEvents > 1) {
-		/* we now need to wait until all workers finish. This is because the
-		 * rest of this module can not handle the concurrency introduced
-		 * by workers running during the epoll call.
-		 */
-		pthread_mutex_lock(&wrkrMut);
-		while(wrkrRunning > 0) {
-			pthread_cond_wait(&wrkrIdle, &wrkrMut);
+	while(glbl.GetGlobalInputTermState() == 0) {
+		DBGPRINTF("imptcp going on epoll_wait[%d]\n", me->efd);
+		nEvents = epoll_wait(me->efd, events, sizeof(events)/sizeof(struct epoll_event), -1);
+		DBGPRINTF("imptcp: epoll[%d] returned %d events\n", me->efd, nEvents);
+		for(i = 0 ; (i < nEvents) && (glbl.GetGlobalInputTermState() == 0) ; ++i) {
+			++me->numCalled;
+			processWorkItem(events+i);
 		}
-		pthread_mutex_unlock(&wrkrMut);
 	}
-
 }
 
 
-/* worker to process incoming requests
+/* helper worker thread
  */
 static void *
 wrkr(void *myself)
 {
 	struct wrkrInfo_s *me = (struct wrkrInfo_s*) myself;
-	
-	pthread_mutex_lock(&wrkrMut);
-	while(1) {
-		while(me->event == NULL && glbl.GetGlobalInputTermState() == 0) {
-			pthread_cond_wait(&me->run, &wrkrMut);
-		}
-		if(glbl.GetGlobalInputTermState() == 1)
-			break;
-		pthread_mutex_unlock(&wrkrMut);
 
-		++me->numCalled;
-		processWorkItem(me->event);
+	wrkrLoop(me);
 
-		pthread_mutex_lock(&wrkrMut);
-		me->event = NULL;	/* indicate we are free again */
-		--wrkrRunning;
-		pthread_cond_signal(&wrkrIdle);
-	}
+	pthread_mutex_lock(&wrkrMut);
+	me->bRunning = 0;
+	pthread_cond_broadcast(&wrkrTerm);
 	pthread_mutex_unlock(&wrkrMut);
 
 	return NULL;
@@ -1572,24 +1744,7 @@ CODESTARTactivateCnfPrePrivDrop
 		ABORT_FINALIZE(RS_RET_NO_RUN);
 	}
 
-#	if defined(EPOLL_CLOEXEC) && defined(HAVE_EPOLL_CREATE1)
-	DBGPRINTF("imptcp uses epoll_create1()\n");
-	epollfd = epoll_create1(EPOLL_CLOEXEC);
-	if(epollfd < 0 && errno == ENOSYS)
-#	endif
-	{
-		DBGPRINTF("imptcp uses epoll_create()\n");
-		/* reading the docs, the number of epoll events passed to
-		 * epoll_create() seems not to be used at all in kernels. So
-		 * we just provide "a" number, happens to be 10.
-		 */
-		epollfd = epoll_create(10);
-	}
-
-	if(epollfd < 0) {
-		errmsg.LogError(0, RS_RET_EPOLL_CR_FAILED, "error: epoll_create() failed");
-		ABORT_FINALIZE(RS_RET_NO_RUN);
-	}
+	CHKiRet(createWorkerEPoll());
 
 	/* start up servers, but do not yet read input data */
 	CHKiRet(startupServers());
@@ -1622,17 +1777,10 @@ ENDfreeCnf
 /* This function is called to gather input.
  */
 BEGINrunInput
-	int nEvents;
-	struct epoll_event events[128];
 CODESTARTrunInput
 	startWorkerPool();
 	DBGPRINTF("imptcp: now beginning to process input data\n");
-	while(glbl.GetGlobalInputTermState() == 0) {
-		DBGPRINTF("imptcp going on epoll_wait\n");
-		nEvents = epoll_wait(epollfd, events, sizeof(events)/sizeof(struct epoll_event), -1);
-		DBGPRINTF("imptcp: epoll returned %d events\n", nEvents);
-		processWorkSet(nEvents, events);
-	}
+	wrkrLoop(&wrkrInfo[0]);
 	DBGPRINTF("imptcp: successfully terminated\n");
 	/* we stop the worker pool in AfterRun, in case we get cancelled for some reason (old Interface) */
 ENDrunInput
@@ -1680,6 +1828,7 @@ shutdownSrv(ptcpsrv_t *pSrv)
 
 BEGINafterRun
 	ptcpsrv_t *pSrv, *srvDel;
+	int i;
 CODESTARTafterRun
 	stopWorkerPool();
 
@@ -1692,7 +1841,11 @@ CODESTARTafterRun
 		destructSrv(srvDel);
 	}
 
-	close(epollfd);
+	for(i = 0 ; i < nWrkrs ; ++i) {
+		close(wrkrInfo[i].efd);
+		DESTROY_ATOMIC_HELPER_MUT(wrkrInfo[i].mutNSess);
+	}
+	nWrkrs = 0;
 ENDafterRun
 
 
@@ -31,6 +31,9 @@
 #include <errno.h>
 #include <unistd.h>
 #include <netdb.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/socket.h>
 #if HAVE_SYS_EPOLL_H
 #	include <sys/epoll.h>
 #endif
@@ -78,9 +81,31 @@ static struct lstn_s {
 	prop_t *pInputName;
 	statsobj_t *stats;	/* listener stats */
 	ratelimit_t *ratelimiter;
+	int iWrkr;		/* receiver thread (shard) this listener is bound to */
 	STATSCOUNTER_DEF(ctrSubmit, mutCtrSubmit)
 } *lcnfRoot = NULL, *lcnfLast = NULL;
 
+/* Each receiver thread has its own set of receive buffers, so that no locking
+ * is required while pulling packets off the sockets. Worker 0 is the input
+ * thread itself, additional workers are only started if a listener is
+ * configured with threads > 1.
+ */
+static struct wrkrInfo_s {
+	pthread_t tid;		/* the worker's thread ID (unused for worker 0) */
+	int id;			/* worker (shard) number */
+	thrdInfo_t *pThrd;	/* input thread descriptor, used for termination check */
+	sbool bRunning;		/* is the worker thread still running? (guarded by mutWrkr) */
+	uchar *pRcvBuf;		/* receive buffer (for a batch of packets) */
+	struct sockaddr_storage *frominetBatch; /* sender addresses for a batch of packets */
+#	ifdef HAVE_RECVMMSG
+	struct mmsghdr *recvmsg_mmh; /* recvmmsg() headers, one per packet */
+	struct iovec *recvmsg_iov;
+#	endif
+} *wrkrInfo = NULL;
+static int nWrkrs = 0;			/* number of receiver threads (max threads of all listeners) */
+static pthread_mutex_t mutWrkr;
+static pthread_cond_t condWrkrTerm;	/* signalled when a worker terminates */
+
 static int bLegacyCnfModGlobalsPermitted;/* are legacy module-global config parameters permitted? */
 static int bDoACLCheck;			/* are ACL checks neeed? Cached once immediately before listener startup */
 static int iMaxLine;			/* maximum UDP message size supported */
@@ -88,12 +113,16 @@ static time_t ttLastDiscard = 0;	/* timestamp when a message from a non-permitte
 					 * This shall prevent remote DoS when the "discard on disallowed sender"
 					 * message is configured to be logged on occurance of such a case.
 					 */
-static uchar *pRcvBuf = NULL;		/* receive buffer (for a single packet). We use a global and alloc
-					 * it so that we can check available memory in willRun() and request
-					 * termination if we can not get it. -- rgerhards, 2007-12-27
+#ifdef HAVE_RECVMMSG
+static int bHaveRecvmmsg = 1;		/* set to 0 if the kernel does not support recvmmsg(). Shared
+					 * by all workers, but as it is only ever reset, no sync is needed.
 					 */
+#endif
 
 #define TIME_REQUERY_DFLT 2
+#define BATCH_SIZE_DFLT 32	/* number of packets received by one recvmmsg() call */
+#define BATCH_SIZE_MAX 1024	/* Linux does not permit more (UIO_MAXIOV) */
+#define THREADS_MAX 32		/* max number of receiver threads per listener */
 #define SCHED_PRIO_UNSET -12345678	/* a value that indicates that the scheduling priority has not been set */
 /* config vars for legacy config system */
 static struct configSettings_s {
@@ -112,6 +141,7 @@ struct instanceConf_s {
 	ruleset_t *pBindRuleset;	/* ruleset to bind listener to (use system default if unspecified) */
 	int ratelimitInterval;
 	int ratelimitBurst;
+	int nThreads;			/* number of receiver threads (sockets) for this listener */
 	struct instanceConf_s *next;
 	sbool bAppendPortToInpname;
 };
@@ -123,6 +153,7 @@ struct modConfData_s {
 	int iSchedPolicy;		/* scheduling policy as SCHED_xxx */
 	int iSchedPrio;			/* scheduling priority */
 	int iTimeRequery;		/* how often is time to be queried inside tight recv loop? 0=always */
+	int batchSize;			/* max number of packets to receive with one call */
 	sbool configSetViaV2Method;
 };
 static modConfData_t *loadModConf = NULL;/* modConf ptr to use for the current load process */
@@ -132,7 +163,8 @@ static modConfData_t *runModConf = NULL;/* modConf ptr to use for the current lo
 static struct cnfparamdescr modpdescr[] = {
 	{ "schedulingpolicy", eCmdHdlrGetWord, 0 },
 	{ "schedulingpriority", eCmdHdlrInt, 0 },
-	{ "timerequery", eCmdHdlrInt, 0 }
+	{ "timerequery", eCmdHdlrInt, 0 },
+	{ "batchsize", eCmdHdlrInt, 0 }
 };
 static struct cnfparamblk modpblk =
 	{ CNFPARAMBLK_VERSION,
@@ -148,7 +180,8 @@ static struct cnfparamdescr inppdescr[] = {
 	{ "address", eCmdHdlrString, 0 },
 	{ "ruleset", eCmdHdlrString, 0 },
 	{ "ratelimit.interval", eCmdHdlrInt, 0 },
-	{ "ratelimit.burst", eCmdHdlrInt, 0 }
+	{ "ratelimit.burst", eCmdHdlrInt, 0 },
+	{ "threads", eCmdHdlrPositiveInt, 0 }
 };
 static struct cnfparamblk inppblk =
 	{ CNFPARAMBLK_VERSION,
@@ -177,6 +210,7 @@ createInstance(instanceConf_t **pinst)
 	inst->bAppendPortToInpname = 0;
 	inst->ratelimitBurst = 10000; /* arbitrary high limit */
 	inst->ratelimitInterval = 0; /* off */
+	inst->nThreads = 1;
 
 	/* node created, let's add to config */
 	if(loadModConf->tail == NULL) {
@@ -224,14 +258,21 @@ finalize_it:
 /* This function is called when a new listener shall be added. It takes
  * the instance config description, tries to bind the socket and, if that
  * succeeds, adds it to the list of existing listen sockets.
+ * If the listener shall be served by multiple threads, one set of sockets
+ * is created per thread, all bound to the same address with SO_REUSEPORT.
+ * The kernel then distributes the incoming datagrams by a hash over the
+ * sender and receiver address, so all packets from one source end up in the
+ * same socket and thus the same thread, which keeps their order intact.
+ * Each of these sockets has its own ratelimiter and stats counters.
  */
 static inline rsRetVal
 addListner(instanceConf_t *inst)
 {
 	DEFiRet;
 	uchar *bindAddr;
-	int *newSocks;
+	int *newSocks = NULL;
 	int iSrc;
+	int iWrkr;
 	struct lstn_s *newlcnfinfo;
 	uchar *bindName;
 	uchar *port;
@@ -250,54 +291,64 @@ addListner(instanceConf_t *inst)
 	bindName = (bindAddr == NULL) ? (uchar*)"*" : bindAddr;
 	port = (inst->pszBindPort == NULL || *inst->pszBindPort == '\0') ? (uchar*) "514" : inst->pszBindPort;
 
-	DBGPRINTF("Trying to open syslog UDP ports at %s:%s.\n", bindName, inst->pszBindPort);
-
-	newSocks = net.create_udp_socket(bindAddr, port, 1);
-	if(newSocks != NULL) {
-		/* we now need to add the new sockets to the existing set */
-		/* ready to copy */
-		for(iSrc = 1 ; iSrc <= newSocks[0] ; ++iSrc) {
-			CHKmalloc(newlcnfinfo = (struct lstn_s*) MALLOC(sizeof(struct lstn_s)));
-			newlcnfinfo->next = NULL;
-			newlcnfinfo->sock = newSocks[iSrc];
-			newlcnfinfo->pRuleset = inst->pBindRuleset;
-			snprintf((char*)dispname, sizeof(dispname), "imudp(%s:%s)", bindName, port);
-			dispname[sizeof(dispname)-1] = '\0'; /* just to be on the save side... */
-			CHKiRet(ratelimitNew(&newlcnfinfo->ratelimiter, (char*)dispname, NULL));
-			if(inst->inputname == NULL) {
-				inputname = (uchar*)"imudp";
-			} else {
-				inputname = inst->inputname;
-			}
-			if(inst->bAppendPortToInpname) {
-				snprintf((char*)inpnameBuf, sizeof(inpnameBuf), "%s%s",
-					inputname, port);
-				inpnameBuf[sizeof(inpnameBuf)-1] = '\0';
-				inputname = inpnameBuf;
-			}
-			CHKiRet(prop.Construct(&newlcnfinfo->pInputName));
-			CHKiRet(prop.SetString(newlcnfinfo->pInputName,
-				inputname, ustrlen(inputname)));
-			CHKiRet(prop.ConstructFinalize(newlcnfinfo->pInputName));
-			ratelimitSetLinuxLike(newlcnfinfo->ratelimiter, inst->ratelimitInterval,
-					      inst->ratelimitBurst);
-			/* support statistics gathering */
-			CHKiRet(statsobj.Construct(&(newlcnfinfo->stats)));
-			CHKiRet(statsobj.SetName(newlcnfinfo->stats, dispname));
-			STATSCOUNTER_INIT(newlcnfinfo->ctrSubmit, newlcnfinfo->mutCtrSubmit);
-			CHKiRet(statsobj.AddCounter(newlcnfinfo->stats, UCHAR_CONSTANT("submitted"),
-				ctrType_IntCtr, &(newlcnfinfo->ctrSubmit)));
-			CHKiRet(statsobj.ConstructFinalize(newlcnfinfo->stats));
-			/* link to list. Order must be preserved to take care for 
-			 * conflicting matches.
-			 */
-			if(lcnfRoot == NULL)
-				lcnfRoot = newlcnfinfo;
-			if(lcnfLast == NULL)
-				lcnfLast = newlcnfinfo;
-			else {
-				lcnfLast->next = newlcnfinfo;
-				lcnfLast = newlcnfinfo;
+	DBGPRINTF("Trying to open syslog UDP ports at %s:%s with %d thread(s).\n", bindName,
+		  inst->pszBindPort, inst->nThreads);
+
+	for(iWrkr = 0 ; iWrkr < inst->nThreads ; ++iWrkr) {
+		free(newSocks);
+		newSocks = net.create_udp_socket(bindAddr, port, 1, inst->nThreads > 1);
+		if(newSocks != NULL) {
+			/* we now need to add the new sockets to the existing set */
+			/* ready to copy */
+			for(iSrc = 1 ; iSrc <= newSocks[0] ; ++iSrc) {
+				CHKmalloc(newlcnfinfo = (struct lstn_s*) MALLOC(sizeof(struct lstn_s)));
+				newlcnfinfo->next = NULL;
+				newlcnfinfo->sock = newSocks[iSrc];
+				newlcnfinfo->pRuleset = inst->pBindRuleset;
+				newlcnfinfo->iWrkr = iWrkr;
+				if(inst->nThreads > 1) {
+					snprintf((char*)dispname, sizeof(dispname), "imudp(%s:%s#%d)",
+						 bindName, port, iWrkr);
+				} else {
+					snprintf((char*)dispname, sizeof(dispname), "imudp(%s:%s)", bindName, port);
+				}
+				dispname[sizeof(dispname)-1] = '\0'; /* just to be on the save side... */
+				CHKiRet(ratelimitNew(&newlcnfinfo->ratelimiter, (char*)dispname, NULL));
+				if(inst->inputname == NULL) {
+					inputname = (uchar*)"imudp";
+				} else {
+					inputname = inst->inputname;
+				}
+				if(inst->bAppendPortToInpname) {
+					snprintf((char*)inpnameBuf, sizeof(inpnameBuf), "%s%s",
+						inputname, port);
+					inpnameBuf[sizeof(inpnameBuf)-1] = '\0';
+					inputname = inpnameBuf;
+				}
+				CHKiRet(prop.Construct(&newlcnfinfo->pInputName));
+				CHKiRet(prop.SetString(newlcnfinfo->pInputName,
+					inputname, ustrlen(inputname)));
+				CHKiRet(prop.ConstructFinalize(newlcnfinfo->pInputName));
+				ratelimitSetLinuxLike(newlcnfinfo->ratelimiter, inst->ratelimitInterval,
+						      inst->ratelimitBurst);
+				/* support statistics gathering */
+				CHKiRet(statsobj.Construct(&(newlcnfinfo->stats)));
+				CHKiRet(statsobj.SetName(newlcnfinfo->stats, dispname));
+				STATSCOUNTER_INIT(newlcnfinfo->ctrSubmit, newlcnfinfo->mutCtrSubmit);
+				CHKiRet(statsobj.AddCounter(newlcnfinfo->stats, UCHAR_CONSTANT("submitted"),
+					ctrType_IntCtr, &(newlcnfinfo->ctrSubmit)));
+				CHKiRet(statsobj.ConstructFinalize(newlcnfinfo->stats));
+				/* link to list. Order must be preserved to take care for 
+				 * conflicting matches.
+				 */
+				if(lcnfRoot == NULL)
+					lcnfRoot = newlcnfinfo;
+				if(lcnfLast == NULL)
+					lcnfLast = newlcnfinfo;
+				else {
+					lcnfLast->next = newlcnfinfo;
+					lcnfLast = newlcnfinfo;
+				}
 			}
 		}
 	}
@@ -318,6 +369,77 @@ std_checkRuleset_genErrMsg(__attribute__((unused)) modConfData_t *modConf, insta
 }
 
 
+/* This function processes a single packet received on a listener. It does
+ * the ACL check and, if the sender is permitted, creates the message object
+ * and adds it to the multi-submit buffer. As senders tend to send many
+ * messages in a row, the ACL check is only done if the sender differs from
+ * the one of the previous packet (frominetPrev).
+ */
+static inline rsRetVal
+processPacket(struct lstn_s *lstn, struct sockaddr_storage *frominetPrev, int *pbIsPermitted,
+	      uchar *rcvBuf, ssize_t lenRcvBuf, struct syslogTime *stTime, time_t ttGenTime,
+	      struct sockaddr_storage *frominet, socklen_t socklen, multi_submit_t *multiSub)
+{
+	msg_t *pMsg;
+	DEFiRet;
+
+	if(lenRcvBuf == 0)
+		FINALIZE; /* this looks a bit strange, but practice shows it happens... */
+
+	/* check if we have a different sender than before, if so, we need to query some new values */
+	if(bDoACLCheck) {
+		if(net.CmpHost(frominet, frominetPrev, socklen) != 0) {
+			memcpy(frominetPrev, frominet, socklen); /* update cache indicator */
+			/* Here we check if a host is permitted to send us syslog messages. If it isn't,
+			 * we do not further process the message but log a warning (if we are
+			 * configured to do this). However, if the check would require name resolution,
+			 * it is postponed to the main queue. See also my blog post at
+			 * http://blog.gerhards.net/2009/11/acls-imudp-and-accepting-messages.html
+			 * rgerhards, 2009-11-16
+			 */
+			*pbIsPermitted = net.isAllowedSender2((uchar*)"UDP",
+					    (struct sockaddr *)frominet, "", 0);
+	
+			if(*pbIsPermitted == 0) {
+				DBGPRINTF("msg is not from an allowed sender\n");
+				if(glbl.GetOption_DisallowWarning) {
+					time_t tt;
+					datetime.GetTime(&tt);
+					if(tt > ttLastDiscard + 60) {
+						ttLastDiscard = tt;
+						errmsg.LogError(0, NO_ERRCODE,
+						"UDP message from disallowed sender discarded");
+					}
+				}
+			}
+		}
+	} else {
+		*pbIsPermitted = 1; /* no check -> everything permitted */
+	}
+
+	DBGPRINTF("imudp:recv(%d,%d),acl:%d,msg:%.*s\n", lstn->sock, (int) lenRcvBuf, *pbIsPermitted,
+		  (int) lenRcvBuf, rcvBuf);
+
+	if(*pbIsPermitted != 0)  {
+		/* we now create our own message object and submit it to the queue */
+		CHKiRet(msgConstructWithTime(&pMsg, stTime, ttGenTime));
+		MsgSetRawMsg(pMsg, (char*)rcvBuf, lenRcvBuf);
+		MsgSetInputName(pMsg, lstn->pInputName);
+		MsgSetRuleset(pMsg, lstn->pRuleset);
+		MsgSetFlowControlType(pMsg, eFLOWCTL_NO_DELAY);
+		pMsg->msgFlags  = NEEDS_PARSING | PARSE_HOSTNAME | NEEDS_DNSRESOL;
+		if(*pbIsPermitted == 2)
+			pMsg->msgFlags  |= NEEDS_ACLCHK_U; /* request ACL check after resolution */
+		CHKiRet(msgSetFromSockinfo(pMsg, frominet));
+		CHKiRet(ratelimitAddMsg(lstn->ratelimiter, multiSub, pMsg));
+		STATSCOUNTER_INC(lstn->ctrSubmit, lstn->mutCtrSubmit);
+	}
+
+finalize_it:
+	RETiRet;
+}
+
+
 /* This function is a helper to runInput. I have extracted it
  * from the main loop just so that we do not have that large amount of code
  * in a single place. This function takes a socket and pulls messages from
@@ -331,35 +453,53 @@ std_checkRuleset_genErrMsg(__attribute__((unused)) modConfData_t *modConf, insta
  * handling the workload, we will loss data in any case. So it doesn't really
  * matter where the actual loss occurs - it is always random, because we depend
  * on scheduling order. -- rgerhards, 2008-10-02
+ * If the platform supports it, we receive up to batchSize packets with a
+ * single recvmmsg() call. The time is then queried only once for all of
+ * them, and all messages are submitted to the queue in one batch.
  */
 static inline rsRetVal
-processSocket(thrdInfo_t *pThrd, struct lstn_s *lstn, struct sockaddr_storage *frominetPrev, int *pbIsPermitted)
+processSocket(struct wrkrInfo_s *pWrkr, struct lstn_s *lstn, struct sockaddr_storage *frominetPrev,
+	      int *pbIsPermitted)
 {
 	int iNbrTimeUsed;
 	time_t ttGenTime;
 	struct syslogTime stTime;
-	socklen_t socklen;
-	ssize_t lenRcvBuf;
-	struct sockaddr_storage frominet;
-	msg_t *pMsg;
-	prop_t *propFromHost = NULL;
-	prop_t *propFromHostIP = NULL;
+	socklen_t socklen = 0;
+	ssize_t lenRcvBuf = 0;
+	int nelem;
+	int i;
 	multi_submit_t multiSub;
 	msg_t *pMsgs[CONF_NUM_MULTISUB];
 	char errStr[1024];
 	DEFiRet;
 
-	assert(pThrd != NULL);
+	assert(pWrkr != NULL);
 	multiSub.ppMsgs = pMsgs;
 	multiSub.maxElem = CONF_NUM_MULTISUB;
 	multiSub.nElem = 0;
 	iNbrTimeUsed = 0;
 	while(1) { /* loop is terminated if we have a bad receive, done below in the body */
-		if(pThrd->bShallStop == RSTRUE)
+		if(pWrkr->pThrd->bShallStop == RSTRUE)
 			ABORT_FINALIZE(RS_RET_FORCE_TERM);
-		socklen = sizeof(struct sockaddr_storage);
-		lenRcvBuf = recvfrom(lstn->sock, (char*) pRcvBuf, iMaxLine, 0, (struct sockaddr *)&frominet, &socklen);
-		if(lenRcvBuf < 0) {
+#		ifdef HAVE_RECVMMSG
+		if(bHaveRecvmmsg) {
+			for(i = 0 ; i < runModConf->batchSize ; ++i)
+				pWrkr->recvmsg_mmh[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+			nelem = recvmmsg(lstn->sock, pWrkr->recvmsg_mmh, runModConf->batchSize, 0, NULL);
+			if(nelem < 0 && errno == ENOSYS) {
+				DBGPRINTF("imudp: recvmmsg() not supported by kernel, using recvfrom()\n");
+				bHaveRecvmmsg = 0;
+				continue;
+			}
+		} else
+#		endif
+		{
+			socklen = sizeof(struct sockaddr_storage);
+			lenRcvBuf = recvfrom(lstn->sock, (char*) pWrkr->pRcvBuf, iMaxLine, 0,
+					     (struct sockaddr *)pWrkr->frominetBatch, &socklen);
+			nelem = (lenRcvBuf < 0) ? -1 : 1;
+		}
+		if(nelem < 0) {
 			if(errno != EINTR && errno != EAGAIN) {
 				rs_strerror_r(errno, errStr, sizeof(errStr));
 				DBGPRINTF("INET socket error: %d = %s.\n", errno, errStr);
@@ -368,71 +508,28 @@ processSocket(thrdInfo_t *pThrd, struct lstn_s *lstn, struct sockaddr_storage *f
 			ABORT_FINALIZE(RS_RET_ERR); // this most often is NOT an error, state is not checked by caller!
 		}
 
-		if(lenRcvBuf == 0)
-			continue; /* this looks a bit strange, but practice shows it happens... */
-
-		/* if we reach this point, we had a good receive and can process the packet received */
-		/* check if we have a different sender than before, if so, we need to query some new values */
-		if(bDoACLCheck) {
-			if(net.CmpHost(&frominet, frominetPrev, socklen) != 0) {
-				memcpy(frominetPrev, &frominet, socklen); /* update cache indicator */
-				/* Here we check if a host is permitted to send us syslog messages. If it isn't,
-				 * we do not further process the message but log a warning (if we are
-				 * configured to do this). However, if the check would require name resolution,
-				 * it is postponed to the main queue. See also my blog post at
-				 * http://blog.gerhards.net/2009/11/acls-imudp-and-accepting-messages.html
-				 * rgerhards, 2009-11-16
-				 */
-				*pbIsPermitted = net.isAllowedSender2((uchar*)"UDP",
-						    (struct sockaddr *)&frominet, "", 0);
-		
-				if(*pbIsPermitted == 0) {
-					DBGPRINTF("msg is not from an allowed sender\n");
-					if(glbl.GetOption_DisallowWarning) {
-						time_t tt;
-						datetime.GetTime(&tt);
-						if(tt > ttLastDiscard + 60) {
-							ttLastDiscard = tt;
-							errmsg.LogError(0, NO_ERRCODE,
-							"UDP message from disallowed sender discarded");
-						}
-					}
-				}
-			}
-		} else {
-			*pbIsPermitted = 1; /* no check -> everything permitted */
+		/* if we reach this point, we had a good receive and can process the packets received.
+		 * They all share the same reception time.
+		 */
+		if((runModConf->iTimeRequery == 0) || (iNbrTimeUsed++ % runModConf->iTimeRequery) == 0) {
+			datetime.getCurrTimeCached(&stTime, &ttGenTime, glbl.GetCoarseClock());
 		}
-
-		DBGPRINTF("imudp:recv(%d,%d),acl:%d,msg:%s\n", lstn->sock, (int) lenRcvBuf, *pbIsPermitted, pRcvBuf);
-
-		if(*pbIsPermitted != 0)  {
-			if((runModConf->iTimeRequery == 0) || (iNbrTimeUsed++ % runModConf->iTimeRequery) == 0) {
-				datetime.getCurrTime(&stTime, &ttGenTime);
+		for(i = 0 ; i < nelem ; ++i) {
+#			ifdef HAVE_RECVMMSG
+			if(bHaveRecvmmsg) {
+				lenRcvBuf = pWrkr->recvmsg_mmh[i].msg_len;
+				socklen = pWrkr->recvmsg_mmh[i].msg_hdr.msg_namelen;
 			}
-			/* we now create our own message object and submit it to the queue */
-			CHKiRet(msgConstructWithTime(&pMsg, &stTime, ttGenTime));
-			MsgSetRawMsg(pMsg, (char*)pRcvBuf, lenRcvBuf);
-			MsgSetInputName(pMsg, lstn->pInputName);
-			MsgSetRuleset(pMsg, lstn->pRuleset);
-			MsgSetFlowControlType(pMsg, eFLOWCTL_NO_DELAY);
-			pMsg->msgFlags  = NEEDS_PARSING | PARSE_HOSTNAME | NEEDS_DNSRESOL;
-			if(*pbIsPermitted == 2)
-				pMsg->msgFlags  |= NEEDS_ACLCHK_U; /* request ACL check after resolution */
-			CHKiRet(msgSetFromSockinfo(pMsg, &frominet));
-			CHKiRet(ratelimitAddMsg(lstn->ratelimiter, &multiSub, pMsg));
-			STATSCOUNTER_INC(lstn->ctrSubmit, lstn->mutCtrSubmit);
+#			endif
+			CHKiRet(processPacket(lstn, frominetPrev, pbIsPermitted,
+					      pWrkr->pRcvBuf + i * (iMaxLine + 1), lenRcvBuf, &stTime,
+					      ttGenTime, &pWrkr->frominetBatch[i], socklen, &multiSub));
 		}
 	}
 
 
 finalize_it:
 	multiSubmitFlush(&multiSub);
-
-	if(propFromHost != NULL)
-		prop.Destruct(&propFromHost);
-	if(propFromHostIP != NULL)
-		prop.Destruct(&propFromHostIP);
-
 	RETiRet;
 }
 
@@ -562,14 +659,16 @@ finalize_it:
  * we either use the traditional (but slower) select() or the Linux-specific epoll()
  * interface. ./configure settings control which one is used.
  * rgerhards, 2009-09-09
+ * Each receiver thread runs its own instance of the loop, serving only those
+ * listeners that are bound to it.
  */
 #if defined(HAVE_EPOLL_CREATE1) || defined(HAVE_EPOLL_CREATE)
 #define NUM_EPOLL_EVENTS 10
-rsRetVal rcvMainLoop(thrdInfo_t *pThrd)
+static rsRetVal rcvMainLoop(struct wrkrInfo_s *pWrkr)
 {
 	DEFiRet;
 	int nfds;
-	int efd;
+	int efd = -1;
 	int i;
 	struct sockaddr_storage frominetPrev;
 	int bIsPermitted;
@@ -588,7 +687,12 @@ rsRetVal rcvMainLoop(thrdInfo_t *pThrd)
 	/* count num listeners -- do it here in order to avoid inconsistency */
 	nLstn = 0;
 	for(lstn = lcnfRoot ; lstn != NULL ; lstn = lstn->next)
-		++nLstn;
+		if(lstn->iWrkr == pWrkr->id)
+			++nLstn;
+	if(nLstn == 0) {
+		DBGPRINTF("imudp: worker %d has no listeners, terminating\n", pWrkr->id);
+		FINALIZE;
+	}
 	CHKmalloc(udpEPollEvt = calloc(nLstn, sizeof(struct epoll_event)));
 
 #if defined(EPOLL_CLOEXEC) && defined(HAVE_EPOLL_CREATE1)
@@ -611,6 +715,8 @@ rsRetVal rcvMainLoop(thrdInfo_t *pThrd)
 	 */
 	i = 0;
 	for(lstn = lcnfRoot ; lstn != NULL ; lstn = lstn->next) {
+		if(lstn->iWrkr != pWrkr->id)
+			continue;
 		if(lstn->sock != -1) {
 			udpEPollEvt[i].events = EPOLLIN | EPOLLET;
 			udpEPollEvt[i].data.ptr = lstn;
@@ -628,15 +734,17 @@ rsRetVal rcvMainLoop(thrdInfo_t *pThrd)
 		nfds = epoll_wait(efd, currEvt, NUM_EPOLL_EVENTS, -1);
 		DBGPRINTF("imudp: epoll_wait() returned with %d fds\n", nfds);
 
-		if(pThrd->bShallStop == RSTRUE)
+		if(pWrkr->pThrd->bShallStop == RSTRUE)
 			break; /* terminate input! */
 
 		for(i = 0 ; i < nfds ; ++i) {
-			processSocket(pThrd, currEvt[i].data.ptr, &frominetPrev, &bIsPermitted);
+			processSocket(pWrkr, currEvt[i].data.ptr, &frominetPrev, &bIsPermitted);
 		}
 	}
 
 finalize_it:
+	if(efd != -1)
+		close(efd);
 	if(udpEPollEvt != NULL)
 		free(udpEPollEvt);
 
@@ -644,7 +752,7 @@ finalize_it:
 }
 #else /* #if HAVE_EPOLL_CREATE1 */
 /* this is the code for the select() interface */
-rsRetVal rcvMainLoop(thrdInfo_t *pThrd)
+static rsRetVal rcvMainLoop(struct wrkrInfo_s *pWrkr)
 {
 	DEFiRet;
 	int maxfds;
@@ -669,7 +777,7 @@ rsRetVal rcvMainLoop(thrdInfo_t *pThrd)
 
 		/* Add the UDP listen sockets to the list of read descriptors. */
 		for(lstn = lcnfRoot ; lstn != NULL ; lstn = lstn->next) {
-			if (lstn->sock != -1) {
+			if (lstn->sock != -1 && lstn->iWrkr == pWrkr->id) {
 				if(Debug)
 					net.debugListenInfo(lstn->sock, "UDP");
 				FD_SET(lstn->sock, &readfds);
@@ -690,8 +798,8 @@ rsRetVal rcvMainLoop(thrdInfo_t *pThrd)
 			break; /* terminate input! */
 
 		for(lstn = lcnfRoot ; nfds && lstn != NULL ; lstn = lstn->next) {
-			if(FD_ISSET(lstn->sock, &readfds)) {
-		       		processSocket(pThrd, lstn, &frominetPrev, &bIsPermitted);
+			if(lstn->iWrkr == pWrkr->id && FD_ISSET(lstn->sock, &readfds)) {
+		       		processSocket(pWrkr, lstn, &frominetPrev, &bIsPermitted);
 			--nfds; /* indicate we have processed one descriptor */
 			}
 	       }
@@ -703,6 +811,79 @@ rsRetVal rcvMainLoop(thrdInfo_t *pThrd)
 #endif /* #if HAVE_EPOLL_CREATE1 */
 
 
+/* thread function for the additional receiver threads (worker 0 is run
+ * directly by the input thread). Note that we inherit the signal mask of
+ * the input thread, so SIGTTIN can be used to awake us on termination.
+ */
+static void *
+wrkr(void *myself)
+{
+	struct wrkrInfo_s *me = (struct wrkrInfo_s*) myself;
+
+	setSchedParams(runModConf);
+	rcvMainLoop(me);
+
+	pthread_mutex_lock(&mutWrkr);
+	me->bRunning = 0;
+	pthread_cond_broadcast(&condWrkrTerm);
+	pthread_mutex_unlock(&mutWrkr);
+	return NULL;
+}
+
+
+/* start the additional receiver threads. Failure to start one of them is
+ * not fatal, but the listeners bound to it will receive no data.
+ */
+static inline void
+startWorkers(thrdInfo_t *pThrd)
+{
+	int i;
+	int r;
+
+	DBGPRINTF("imudp: starting %d receiver threads\n", nWrkrs);
+	for(i = 0 ; i < nWrkrs ; ++i)
+		wrkrInfo[i].pThrd = pThrd;
+	for(i = 1 ; i < nWrkrs ; ++i) {
+		wrkrInfo[i].bRunning = 1;
+		r = pthread_create(&wrkrInfo[i].tid, NULL, wrkr, &(wrkrInfo[i]));
+		if(r != 0) {
+			errmsg.LogError(r, NO_ERRCODE, "imudp: error creating receiver thread %d - "
+					"the listeners bound to it are inactive", i);
+			wrkrInfo[i].bRunning = 0;
+		}
+	}
+}
+
+
+/* stop the additional receiver threads. They are usually blocked inside
+ * epoll_wait(), so we awake them via SIGTTIN until they have noticed
+ * the termination request. This mimics what the core does for the
+ * input thread itself.
+ */
+static inline void
+stopWorkers(void)
+{
+	struct timespec tTimeout;
+	int i;
+
+	for(i = 1 ; i < nWrkrs ; ++i) {
+		pthread_mutex_lock(&mutWrkr);
+		if(!wrkrInfo[i].bRunning) {
+			pthread_mutex_unlock(&mutWrkr);
+			continue;
+		}
+		while(wrkrInfo[i].bRunning) {
+			pthread_kill(wrkrInfo[i].tid, SIGTTIN);
+			timeoutComp(&tTimeout, 100);
+			pthread_cond_timedwait(&condWrkrTerm, &mutWrkr, &tTimeout);
+		}
+		pthread_mutex_unlock(&mutWrkr);
+		pthread_join(wrkrInfo[i].tid, NULL);
+		DBGPRINTF("imudp: receiver thread %d terminated\n", i);
+	}
+}
+
+
 static inline rsRetVal
 createListner(es_str_t *port, struct cnfparamvals *pvals)
 {
@@ -729,6 +910,8 @@ createListner(es_str_t *port, struct cnfparamvals *pvals)
 			inst->ratelimitBurst = (int) pvals[i].val.d.n;
 		} else if(!strcmp(inppblk.descr[i].name, "ratelimit.interval")) {
 			inst->ratelimitInterval = (int) pvals[i].val.d.n;
+		} else if(!strcmp(inppblk.descr[i].name, "threads")) {
+			inst->nThreads = (int) pvals[i].val.d.n;
 		} else {
 			dbgprintf("imudp: program error, non-handled "
 			  "param '%s'\n", inppblk.descr[i].name);
@@ -776,6 +959,7 @@ CODESTARTbeginCnfLoad
 	/* init our settings */
 	loadModConf->configSetViaV2Method = 0;
 	loadModConf->iTimeRequery = TIME_REQUERY_DFLT;
+	loadModConf->batchSize = BATCH_SIZE_DFLT;
 	loadModConf->iSchedPrio = SCHED_PRIO_UNSET;
 	loadModConf->pszSchedPolicy = NULL;
 	bLegacyCnfModGlobalsPermitted = 1;
@@ -809,6 +993,8 @@ CODESTARTsetModCnf
 			continue;
 		if(!strcmp(modpblk.descr[i].name, "timerequery")) {
 			loadModConf->iTimeRequery = (int) pvals[i].val.d.n;
+		} else if(!strcmp(modpblk.descr[i].name, "batchsize")) {
+			loadModConf->batchSize = (int) pvals[i].val.d.n;
 		} else if(!strcmp(modpblk.descr[i].name, "schedulingpriority")) {
 			loadModConf->iSchedPrio = (int) pvals[i].val.d.n;
 		} else if(!strcmp(modpblk.descr[i].name, "schedulingpolicy")) {
@@ -854,8 +1040,34 @@ BEGINcheckCnf
 	instanceConf_t *inst;
 CODESTARTcheckCnf
 	checkSchedParam(pModConf); /* this can not cause fatal errors */
+	if(pModConf->batchSize < 1 || pModConf->batchSize > BATCH_SIZE_MAX) {
+		errmsg.LogError(0, RS_RET_PARAM_ERROR, "imudp: batch size %d invalid, must be "
+				"between 1 and %d - using default of %d instead",
+				pModConf->batchSize, BATCH_SIZE_MAX, BATCH_SIZE_DFLT);
+		pModConf->batchSize = BATCH_SIZE_DFLT;
+	}
+#	ifndef HAVE_RECVMMSG
+	pModConf->batchSize = 1; /* we can receive only a single packet at a time */
+#	endif
 	for(inst = pModConf->root ; inst != NULL ; inst = inst->next) {
 		std_checkRuleset(pModConf, inst);
+		if(inst->nThreads > THREADS_MAX) {
+			errmsg.LogError(0, RS_RET_PARAM_ERROR, "imudp: %d threads for %s:%s exceed "
+					"the maximum of %d - using %d", inst->nThreads,
+					inst->pszBindAddr == NULL ? "*" : (char*) inst->pszBindAddr,
+					inst->pszBindPort, THREADS_MAX, THREADS_MAX);
+			inst->nThreads = THREADS_MAX;
+		}
+#		ifndef SO_REUSEPORT
+		if(inst->nThreads > 1) {
+			errmsg.LogError(0, RS_RET_PARAM_ERROR, "imudp: multiple threads for %s:%s "
+					"requested, but SO_REUSEPORT is not supported on this "
+					"platform - using a single thread",
+					inst->pszBindAddr == NULL ? "*" : (char*) inst->pszBindAddr,
+					inst->pszBindPort);
+			inst->nThreads = 1;
+		}
+#		endif
 	}
 	if(pModConf->root == NULL) {
 		errmsg.LogError(0, RS_RET_NO_LISTNERS , "imudp: module loaded, but "
@@ -883,11 +1095,49 @@ finalize_it:
 ENDactivateCnfPrePrivDrop
 
 
+/* allocate the receive buffers for one receiver thread */
+static rsRetVal
+wrkrAllocBufs(struct wrkrInfo_s *pWrkr, int batchSize)
+{
+#	ifdef HAVE_RECVMMSG
+	int i;
+#	endif
+	DEFiRet;
+
+	CHKmalloc(pWrkr->pRcvBuf = MALLOC(batchSize * (iMaxLine + 1) * sizeof(char)));
+	CHKmalloc(pWrkr->frominetBatch = calloc(batchSize, sizeof(struct sockaddr_storage)));
+#	ifdef HAVE_RECVMMSG
+	CHKmalloc(pWrkr->recvmsg_mmh = calloc(batchSize, sizeof(struct mmsghdr)));
+	CHKmalloc(pWrkr->recvmsg_iov = calloc(batchSize, sizeof(struct iovec)));
+	for(i = 0 ; i < batchSize ; ++i) {
+		pWrkr->recvmsg_iov[i].iov_base = pWrkr->pRcvBuf + i * (iMaxLine + 1);
+		pWrkr->recvmsg_iov[i].iov_len = iMaxLine;
+		pWrkr->recvmsg_mmh[i].msg_hdr.msg_name = &pWrkr->frominetBatch[i];
+		pWrkr->recvmsg_mmh[i].msg_hdr.msg_iov = &pWrkr->recvmsg_iov[i];
+		pWrkr->recvmsg_mmh[i].msg_hdr.msg_iovlen = 1;
+	}
+#	endif
+finalize_it:
+	RETiRet;
+}
+
+
 BEGINactivateCnf
+	instanceConf_t *inst;
+	int i;
 CODESTARTactivateCnf
 	/* caching various settings */
 	iMaxLine = glbl.GetMaxLine();
-	CHKmalloc(pRcvBuf = MALLOC((iMaxLine + 1) * sizeof(char)));
+	nWrkrs = 1;
+	for(inst = pModConf->root ; inst != NULL ; inst = inst->next) {
+		if(inst->nThreads > nWrkrs)
+			nWrkrs = inst->nThreads;
+	}
+	CHKmalloc(wrkrInfo = calloc(nWrkrs, sizeof(struct wrkrInfo_s)));
+	for(i = 0 ; i < nWrkrs ; ++i) {
+		wrkrInfo[i].id = i;
+		CHKiRet(wrkrAllocBufs(&wrkrInfo[i], pModConf->batchSize));
+	}
 finalize_it:
 ENDactivateCnf
 
@@ -921,7 +1171,9 @@ CODESTARTrunInput
 	 * privileges within the same instance.
 	 */
 	setSchedParams(runModConf);
-	iRet = rcvMainLoop(pThrd);
+	startWorkers(pThrd);
+	iRet = rcvMainLoop(&wrkrInfo[0]);
+	stopWorkers();
 ENDrunInput
 
 
@@ -935,6 +1187,7 @@ ENDwillRun
 
 BEGINafterRun
 	struct lstn_s *lstn, *lstnDel;
+	int i;
 CODESTARTafterRun
 	/* do cleanup here */
 	net.clearAllowedSenders((uchar*)"UDP");
@@ -948,15 +1201,27 @@ CODESTARTafterRun
 		free(lstnDel);
 	}
 	lcnfRoot = lcnfLast = NULL;
-	if(pRcvBuf != NULL) {
-		free(pRcvBuf);
-		pRcvBuf = NULL;
+	if(wrkrInfo != NULL) {
+		for(i = 0 ; i < nWrkrs ; ++i) {
+			free(wrkrInfo[i].pRcvBuf);
+			free(wrkrInfo[i].frominetBatch);
+#			ifdef HAVE_RECVMMSG
+			free(wrkrInfo[i].recvmsg_mmh);
+			free(wrkrInfo[i].recvmsg_iov);
+#			endif
+		}
+		free(wrkrInfo);
+		wrkrInfo = NULL;
 	}
+	nWrkrs = 0;
 ENDafterRun
 
 
 BEGINmodExit
 CODESTARTmodExit
+	pthread_mutex_destroy(&mutWrkr);
+	pthread_cond_destroy(&condWrkrTerm);
+
 	/* release what we no longer need */
 	objRelease(errmsg, CORE_COMPONENT);
 	objRelease(glbl, CORE_COMPONENT);
@@ -1010,6 +1275,8 @@ CODEmodInit_QueryRegCFSLineHdlr
 	CHKiRet(objUse(prop, CORE_COMPONENT));
 	CHKiRet(objUse(ruleset, CORE_COMPONENT));
 	CHKiRet(objUse(net, LM_NET_FILENAME));
+	pthread_mutex_init(&mutWrkr, NULL);
+	pthread_cond_init(&condWrkrTerm, NULL);
 
 	/* register config file handlers */
 	CHKiRet(omsdRegCFSLineHdlr((uchar *)"inputudpserverbindruleset", 0, eCmdHdlrGetWord,
@@ -105,6 +105,8 @@ statsobj_t *modStats;
 STATSCOUNTER_DEF(ctrSubmit, mutCtrSubmit)
 STATSCOUNTER_DEF(ctrLostRatelimit, mutCtrLostRatelimit)
 STATSCOUNTER_DEF(ctrNumRatelimiters, mutCtrNumRatelimiters)
+STATSCOUNTER_DEF(ctrTrustedHit, mutCtrTrustedHit)
+STATSCOUNTER_DEF(ctrTrustedMiss, mutCtrTrustedMiss)
 
 
 /* a very simple "hash function" for process IDs - we simply use the
@@ -150,6 +152,35 @@ typedef struct lstn_s {
 } lstn_t;
 static lstn_t listeners[MAXFUNIX];
 
+/* Cache for the trusted properties. Obtaining them means reading several
+ * files from /proc for each message, which is costly for chatty processes.
+ * The cache is indexed directly by pid, so it is bounded and lookups are
+ * cheap; a process mapping to an occupied slot replaces the entry there.
+ * An entry belongs to a process identified by pid and start time. Reading
+ * the start time from /proc/<pid>/stat is expensive itself, so on lookup we
+ * just stat() /proc/<pid>: the kernel creates a new inode for it when the pid
+ * is reused, so an unchanged inode number means the entry is still valid.
+ * The inode may also change while the process lives, in that case the start
+ * time tells us it is still the same process. The TTL limits how outdated
+ * the properties can become, as a process may exec or change its cmdline.
+ * The cache is only used by the input thread, so it needs no locking.
+ */
+#define TRUSTED_CACHE_SIZE 1024	/* max number of processes cached */
+#define TRUSTED_CACHE_TTL 10	/* seconds after which an entry is refreshed */
+typedef struct trustedProps_s {
+	pid_t pid;		/* 0 if slot is unused */
+	unsigned long long startTime;	/* process start time (ticks since boot) */
+	ino_t inode;		/* inode of /proc/<pid> when we last checked */
+	time_t tExpire;		/* entry must be refreshed after this time */
+	uchar comm[64];
+	int lenComm;
+	uchar *exe;		/* NULL if it could not be obtained */
+	int lenExe;
+	uchar *cmdline;		/* NULL if it could not be obtained */
+	int lenCmdline;
+} trustedProps_t;
+static trustedProps_t *trustedCache = NULL;	/* only allocated if a listener annotates */
+
 static prop_t *pLocalHostIP = NULL;	/* there is only one global IP for all internally-generated messages */
 static prop_t *pInputName = NULL;	/* our inputName currently is always "imudp", and this will hold it */
 static int startIndexUxLocalSockets; /* process fd from that index on (used to
@@ -698,6 +729,129 @@ finalize_it:
 }
 
 
+/* read the process start time and comm from /proc/<pid>/stat. The comm
+ * property is sanitized the same way getTrustedProp() does.
+ */
+static rsRetVal
+getProcStat(struct ucred *cred, unsigned long long *pStartTime, uchar *comm, size_t lenComm, int *pLenComm)
+{
+	int fd;
+	int i;
+	int lenRead;
+	uchar *p, *pClose;
+	char namebuf[1024];
+	uchar buf[1024];
+	DEFiRet;
+
+	if(snprintf(namebuf, sizeof(namebuf), "/proc/%lu/stat", (long unsigned) cred->pid)
+		>= (int) sizeof(namebuf)) {
+		ABORT_FINALIZE(RS_RET_ERR);
+	}
+
+	if((fd = open(namebuf, O_RDONLY)) == -1) {
+		DBGPRINTF("error reading '%s'\n", namebuf);
+		ABORT_FINALIZE(RS_RET_ERR);
+	}
+	lenRead = read(fd, buf, sizeof(buf) - 1);
+	close(fd);
+	if(lenRead == -1) {
+		DBGPRINTF("error reading file data for '%s'\n", namebuf);
+		ABORT_FINALIZE(RS_RET_ERR);
+	}
+	buf[lenRead] = '\0';
+
+	/* format is "pid (comm) state ...", comm may contain anything, even ')' */
+	p = (uchar*) strchr((char*) buf, '(');
+	pClose = (uchar*) strrchr((char*) buf, ')');
+	if(p == NULL || pClose == NULL || pClose < p)
+		ABORT_FINALIZE(RS_RET_ERR);
+	for(i = 0, ++p ; p < pClose && *p != '\n' && i < (int) lenComm - 1 ; ++i, ++p)
+		comm[i] = iscntrl(*p) ? ' ' : *p;
+	comm[i] = '\0';
+	*pLenComm = i;
+
+	/* start time is field 22, the 19th after state */
+	p = pClose + 1;
+	for(i = 0 ; i < 19 && p != NULL ; ++i)
+		p = (uchar*) strchr((char*) p + 1, ' ');
+	if(p == NULL)
+		ABORT_FINALIZE(RS_RET_ERR);
+	*pStartTime = strtoull((char*) p + 1, NULL, 10);
+
+finalize_it:
+	RETiRet;
+}
+
+
+/* obtain the trusted properties of the sending process, from the cache if
+ * possible (see there). On error, *ppProps is set to NULL; in that case the
+ * process most probably is already gone.
+ */
+static rsRetVal
+getTrustedProps(struct ucred *cred, time_t tt, trustedProps_t **ppProps)
+{
+	trustedProps_t *pProps = NULL;
+	unsigned long long startTime;
+	uchar comm[sizeof(pProps->comm)];
+	int lenComm;
+	uchar propBuf[1024];
+	int lenProp;
+	char namebuf[1024];
+	struct stat stat_buf;
+	DEFiRet;
+
+	if(snprintf(namebuf, sizeof(namebuf), "/proc/%lu", (long unsigned) cred->pid)
+		>= (int) sizeof(namebuf)) {
+		ABORT_FINALIZE(RS_RET_ERR);
+	}
+	if(stat(namebuf, &stat_buf) == -1) {
+		DBGPRINTF("error accessing '%s'\n", namebuf);
+		ABORT_FINALIZE(RS_RET_ERR);
+	}
+	pProps = &trustedCache[(unsigned) cred->pid % TRUSTED_CACHE_SIZE];
+	if(pProps->pid == cred->pid && pProps->inode == stat_buf.st_ino && tt < pProps->tExpire) {
+		STATSCOUNTER_INC(ctrTrustedHit, mutCtrTrustedHit);
+		FINALIZE;
+	}
+
+	CHKiRet(getProcStat(cred, &startTime, comm, sizeof(comm), &lenComm));
+	if(pProps->pid == cred->pid && pProps->startTime == startTime && tt < pProps->tExpire) {
+		/* still the same process, only its inode changed */
+		pProps->inode = stat_buf.st_ino;
+		STATSCOUNTER_INC(ctrTrustedHit, mutCtrTrustedHit);
+		FINALIZE;
+	}
+
+	STATSCOUNTER_INC(ctrTrustedMiss, mutCtrTrustedMiss);
+	free(pProps->exe);
+	pProps->exe = NULL;
+	free(pProps->cmdline);
+	pProps->cmdline = NULL;
+	pProps->pid = cred->pid;
+	pProps->startTime = startTime;
+	pProps->inode = stat_buf.st_ino;
+	pProps->tExpire = tt + TRUSTED_CACHE_TTL;
+	memcpy(pProps->comm, comm, lenComm + 1);
+	pProps->lenComm = lenComm;
+	if(getTrustedExe(cred, propBuf, sizeof(propBuf), &lenProp) == RS_RET_OK) {
+		CHKmalloc(pProps->exe = (uchar*) malloc(lenProp + 1));
+		memcpy(pProps->exe, propBuf, lenProp + 1);
+		pProps->lenExe = lenProp;
+	}
+	if(getTrustedProp(cred, "cmdline", propBuf, sizeof(propBuf), &lenProp) == RS_RET_OK) {
+		CHKmalloc(pProps->cmdline = (uchar*) malloc(lenProp + 1));
+		memcpy(pProps->cmdline, propBuf, lenProp + 1);
+		pProps->lenCmdline = lenProp;
+	}
+
+finalize_it:
+	if(iRet != RS_RET_OK && pProps != NULL)
+		pProps->pid = 0; /* incomplete, must not be used again */
+	*ppProps = (iRet == RS_RET_OK) ? pProps : NULL;
+	RETiRet;
+}
+
+
 /* copy a trusted property in escaped mode. That is, the property can contain
  * any character and so it must be properly quoted AND escaped.
  * It is assumed the output buffer is large enough. Returns the number of
@@ -740,6 +894,7 @@ SubmitMsg(uchar *pRcv, int lenRcv, lstn_t *pLstn, struct ucred *cred, struct tim
 	time_t tt;
 	int lenProp;
 	ratelimit_t *ratelimiter = NULL;
+	trustedProps_t *pProps;
 	uchar propBuf[1024];
 	uchar msgbuf[8192];
 	uchar *pmsgbuf;
@@ -777,9 +932,9 @@ SubmitMsg(uchar *pRcv, int lenRcv, lstn_t *pLstn, struct ucred *cred, struct tim
 	}
 
 	if(ts == NULL) {
-		datetime.getCurrTime(&st, &tt);
+		datetime.getCurrTimeCached(&st, &tt, glbl.GetCoarseClock());
 	} else {
-		datetime.timeval2syslogTime(ts, &st);
+		datetime.timeval2syslogTimeCached(ts, &st);
 		tt = ts->tv_sec;
 	}
 
@@ -798,6 +953,7 @@ SubmitMsg(uchar *pRcv, int lenRcv, lstn_t *pLstn, struct ucred *cred, struct tim
 			CHKmalloc(pmsgbuf = malloc(lenRcv+4096));
 		}
 
+		getTrustedProps(cred, tt, &pProps); /* NULL if not available */
 		if (pLstn->bParseTrusted) {
 			json = json_object_new_object();
 			/* create value string, create field, and add it */
@@ -807,16 +963,16 @@ SubmitMsg(uchar *pRcv, int lenRcv, lstn_t *pLstn, struct ucred *cred, struct tim
 			json_object_object_add(json, "uid", jval);
 			jval = json_object_new_int(cred->gid);
 			json_object_object_add(json, "gid", jval);
-			if(getTrustedProp(cred, "comm", propBuf, sizeof(propBuf), &lenProp) == RS_RET_OK) {
-				jval = json_object_new_string((char*)propBuf);
+			if(pProps != NULL) {
+				jval = json_object_new_string((char*)pProps->comm);
 				json_object_object_add(json, "appname", jval);
 			}
-			if(getTrustedExe(cred, propBuf, sizeof(propBuf), &lenProp) == RS_RET_OK) {
-				jval = json_object_new_string((char*)propBuf);
+			if(pProps != NULL && pProps->exe != NULL) {
+				jval = json_object_new_string((char*)pProps->exe);
 				json_object_object_add(json, "exe", jval);
 			}
-			if(getTrustedProp(cred, "cmdline", propBuf, sizeof(propBuf), &lenProp) == RS_RET_OK) {
-				jval = json_object_new_string((char*)propBuf);
+			if(pProps != NULL && pProps->cmdline != NULL) {
+				jval = json_object_new_string((char*)pProps->cmdline);
 				json_object_object_add(json, "cmd", jval);
 			}
 		} else {
@@ -829,20 +985,20 @@ SubmitMsg(uchar *pRcv, int lenRcv, lstn_t *pLstn, struct ucred *cred, struct tim
 			memcpy(pmsgbuf+toffs, propBuf, lenProp);
 			toffs = toffs + lenProp;
 	
-			if(getTrustedProp(cred, "comm", propBuf, sizeof(propBuf), &lenProp) == RS_RET_OK) {
+			if(pProps != NULL) {
 				memcpy(pmsgbuf+toffs, " _COMM=", 7);
-				memcpy(pmsgbuf+toffs+7, propBuf, lenProp);
-				toffs = toffs + 7 + lenProp;
+				memcpy(pmsgbuf+toffs+7, pProps->comm, pProps->lenComm);
+				toffs = toffs + 7 + pProps->lenComm;
 			}
-			if(getTrustedExe(cred, propBuf, sizeof(propBuf), &lenProp) == RS_RET_OK) {
+			if(pProps != NULL && pProps->exe != NULL) {
 				memcpy(pmsgbuf+toffs, " _EXE=", 6);
-				memcpy(pmsgbuf+toffs+6, propBuf, lenProp);
-				toffs = toffs + 6 + lenProp;
+				memcpy(pmsgbuf+toffs+6, pProps->exe, pProps->lenExe);
+				toffs = toffs + 6 + pProps->lenExe;
 			}
-			if(getTrustedProp(cred, "cmdline", propBuf, sizeof(propBuf), &lenProp) == RS_RET_OK) {
+			if(pProps != NULL && pProps->cmdline != NULL) {
 				memcpy(pmsgbuf+toffs, " _CMDLINE=", 10);
 				toffs = toffs + 10 + 
-					copyescaped(pmsgbuf+toffs+10, propBuf, lenProp);
+					copyescaped(pmsgbuf+toffs+10, pProps->cmdline, pProps->lenCmdline);
 			}
 
 			/* finalize string */
@@ -1372,7 +1528,15 @@ ENDrunInput
 
 
 BEGINwillRun
+	int i;
 CODESTARTwillRun
+	for(i = 0 ; i < nfd ; ++i) {
+		if(listeners[i].bAnnotate) {
+			CHKmalloc(trustedCache = calloc(TRUSTED_CACHE_SIZE, sizeof(trustedProps_t)));
+			break;
+		}
+	}
+finalize_it:
 ENDwillRun
 
 
@@ -1405,6 +1569,15 @@ CODESTARTafterRun
 
 	discardLogSockets();
 	nfd = 1;
+
+	if(trustedCache != NULL) {
+		for(i = 0 ; i < TRUSTED_CACHE_SIZE ; ++i) {
+			free(trustedCache[i].exe);
+			free(trustedCache[i].cmdline);
+		}
+		free(trustedCache);
+		trustedCache = NULL;
+	}
 ENDafterRun
 
 
@@ -1596,6 +1769,12 @@ CODEmodInit_QueryRegCFSLineHdlr
 	STATSCOUNTER_INIT(ctrNumRatelimiters, mutCtrNumRatelimiters);
 	CHKiRet(statsobj.AddCounter(modStats, UCHAR_CONSTANT("ratelimit.numratelimiters"),
 		ctrType_IntCtr, &ctrNumRatelimiters));
+	STATSCOUNTER_INIT(ctrTrustedHit, mutCtrTrustedHit);
+	CHKiRet(statsobj.AddCounter(modStats, UCHAR_CONSTANT("trustedprops.cache.hit"),
+		ctrType_IntCtr, &ctrTrustedHit));
+	STATSCOUNTER_INIT(ctrTrustedMiss, mutCtrTrustedMiss);
+	CHKiRet(statsobj.AddCounter(modStats, UCHAR_CONSTANT("trustedprops.cache.miss"),
+		ctrType_IntCtr, &ctrTrustedMiss));
 	CHKiRet(statsobj.ConstructFinalize(modStats));
 
 ENDmodInit
@@ -355,12 +355,14 @@ BEGINdoAction
 CODESTARTdoAction
 	pMsg = (msg_t*) ppString[0];
 	lenMsg = getMSGLen(pMsg);
-	msg = getMSG(pMsg);
+	/* the message is anonymized in place */
+	CHKiRet(MsgGetWritableMSG(pMsg, &msg));
 	for(i = 0 ; i < lenMsg ; ++i) {
 		anonip(pData, msg, &lenMsg, &i);
 	}
 	if(lenMsg != getMSGLen(pMsg))
 		setMSGLen(pMsg, lenMsg);
+finalize_it:
 ENDdoAction
 
 
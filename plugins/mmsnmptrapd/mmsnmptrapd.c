@@ -253,6 +253,7 @@ dbgprintf("XXXX: severity for message is %d\n", sevCode);
 	MsgSetHOSTNAME(pMsg, pszHost, lenHost);
 	if(sevCode != -1)
 		pMsg->iSeverity = sevCode; /* we update like the parser does! */
+	MsgSetModified(pMsg);
 finalize_it:
 ENDdoAction
 
@@ -0,0 +1,632 @@
+/* pmrfc3164fmt.c
+ * This is a parser module for RFC3164-like (legacy syslog) messages whose
+ * header layout deviates from what the "one size fits all" pmrfc3164 parser
+ * expects. The accepted layouts are described declaratively via the
+ * module's "format" parameter, e.g.
+ *
+ *   module(load="pmrfc3164fmt" format=["%timestamp% %hostname% %tag%",
+ *                                      "%hostname%: %timestamp3339% %tag%"])
+ *
+ * Each layout is compiled at config load time into a short sequence of
+ * parse steps with precomputed field terminators. At runtime, layouts are
+ * tried in the order given. The first one that matches the complete header
+ * sets the message properties, everything after it becomes MSG. If no
+ * layout matches, the message is passed on to the next parser in the
+ * chain (usually rsyslog.rfc3164), so the module must be placed before it.
+ *
+ * Layout syntax:
+ *   %timestamp%        RFC3339 or RFC3164 timestamp
+ *   %timestamp3164%    RFC3164 timestamp only
+ *   %timestamp3339%    RFC3339 timestamp only
+ *   %hostname%         host name (alnum, '.', '_' and '-')
+ *   %tag%              syslog tag
+ *   %word%             a field that is skipped
+ *   %%                 a literal percent sign
+ * All other characters must literally be present in the message.
+ *
+ * Copyright 2013 Adiscon GmbH.
+ *
+ * This file is part of rsyslog.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *       -or-
+ *       see COPYING.ASL20 in the source distribution
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "config.h"
+#include "rsyslog.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <ctype.h>
+#include "conf.h"
+#include "syslogd-types.h"
+#include "template.h"
+#include "msg.h"
+#include "module-template.h"
+#include "glbl.h"
+#include "errmsg.h"
+#include "parser.h"
+#include "datetime.h"
+#include "unicode-helper.h"
+
+MODULE_TYPE_PARSER
+MODULE_TYPE_NOKEEP
+MODULE_CNFNAME("pmrfc3164fmt")
+PARSER_NAME("rsyslog.rfc3164fmt")
+
+/* internal structures
+ */
+DEF_PMOD_STATIC_DATA
+DEFobjCurrIf(errmsg)
+DEFobjCurrIf(glbl)
+DEFobjCurrIf(parser)
+DEFobjCurrIf(datetime)
+
+/* parse steps a layout is compiled into */
+typedef enum {
+	FMT_LITERAL,
+	FMT_TS_ANY,
+	FMT_TS_3164,
+	FMT_TS_3339,
+	FMT_HOSTNAME,
+	FMT_TAG,
+	FMT_WORD
+} fmtOpType_t;
+
+typedef struct fmtOp_s {
+	fmtOpType_t opType;
+	uchar *lit;	/* FMT_LITERAL: text to match */
+	int lenLit;
+	uchar term;	/* fields: terminating character (first char of next literal) */
+	sbool bTermAtEnd; /* field is last in layout: terminates at SP (tag: also ':') */
+} fmtOp_t;
+
+typedef struct fmtLayout_s {
+	uchar *pszFmt;		/* original format string, for messages */
+	fmtOp_t *ops;
+	int nOps;
+	sbool bHasHostname;
+	uchar firstChar[32];	/* bitmap of bytes a matching header may start with */
+} fmtLayout_t;
+
+struct modConfData_s {
+	rsconf_t *pConf;	/* our overall config object */
+	fmtLayout_t *layouts;
+	int nLayouts;
+};
+static modConfData_t *loadModConf = NULL;/* modConf ptr to use for the current load process */
+static modConfData_t *runModConf = NULL;/* modConf ptr to use for the current exec process */
+
+/* module-global parameters */
+static struct cnfparamdescr modpdescr[] = {
+	{ "format", eCmdHdlrArray, 0 }
+};
+static struct cnfparamblk modpblk =
+	{ CNFPARAMBLK_VERSION,
+	  sizeof(modpdescr)/sizeof(struct cnfparamdescr),
+	  modpdescr
+	};
+
+/* static data */
+static int bParseHOSTNAMEandTAG;	/* cache for the equally-named global param - performance enhancement */
+
+
+#define isHostnameChar(c) (isalnum(c) || (c) == '.' || (c) == '_' || (c) == '-')
+#define setFirstChar(pLay, c) ((pLay)->firstChar[(uchar)(c) >> 3] |= 1 << ((uchar)(c) & 7))
+#define isFirstChar(pLay, c) ((pLay)->firstChar[(uchar)(c) >> 3] & (1 << ((uchar)(c) & 7)))
+
+
+BEGINisCompatibleWithFeature
+CODESTARTisCompatibleWithFeature
+	if(eFeat == sFEATUREAutomaticSanitazion)
+		iRet = RS_RET_OK;
+	if(eFeat == sFEATUREAutomaticPRIParsing)
+		iRet = RS_RET_OK;
+ENDisCompatibleWithFeature
+
+
+/* add a parse step to a layout under construction */
+static rsRetVal
+addOp(fmtLayout_t *pLay, fmtOpType_t opType, uchar *lit, int lenLit)
+{
+	fmtOp_t *newOps;
+	DEFiRet;
+
+	CHKmalloc(newOps = realloc(pLay->ops, (pLay->nOps + 1) * sizeof(fmtOp_t)));
+	pLay->ops = newOps;
+	memset(&pLay->ops[pLay->nOps], 0, sizeof(fmtOp_t));
+	pLay->ops[pLay->nOps].opType = opType;
+	if(opType == FMT_LITERAL) {
+		CHKmalloc(pLay->ops[pLay->nOps].lit = malloc(lenLit));
+		memcpy(pLay->ops[pLay->nOps].lit, lit, lenLit);
+		pLay->ops[pLay->nOps].lenLit = lenLit;
+	}
+	++pLay->nOps;
+finalize_it:
+	RETiRet;
+}
+
+
+/* add a literal, merging it with a directly preceding one */
+static rsRetVal
+addLiteral(fmtLayout_t *pLay, uchar *lit, int lenLit)
+{
+	fmtOp_t *pOp;
+	uchar *newLit;
+	DEFiRet;
+
+	if(pLay->nOps > 0 && pLay->ops[pLay->nOps-1].opType == FMT_LITERAL) {
+		pOp = &pLay->ops[pLay->nOps-1];
+		CHKmalloc(newLit = realloc(pOp->lit, pOp->lenLit + lenLit));
+		memcpy(newLit + pOp->lenLit, lit, lenLit);
+		pOp->lit = newLit;
+		pOp->lenLit += lenLit;
+	} else {
+		CHKiRet(addOp(pLay, FMT_LITERAL, lit, lenLit));
+	}
+finalize_it:
+	RETiRet;
+}
+
+
+/* compute the set of bytes a message matching this layout may
+ * start with. This permits to skip layouts that can not match
+ * without actually running them.
+ */
+static void
+computeFirstChars(fmtLayout_t *pLay)
+{
+	int c;
+	uchar *pMon;
+	fmtOp_t *pOp;
+
+	memset(pLay->firstChar, 0, sizeof(pLay->firstChar));
+	if(pLay->nOps == 0) {
+		memset(pLay->firstChar, 0xff, sizeof(pLay->firstChar));
+		return;
+	}
+	pOp = &pLay->ops[0];
+	switch(pOp->opType) {
+	case FMT_LITERAL:
+		setFirstChar(pLay, pOp->lit[0]);
+		break;
+	case FMT_TS_ANY:
+	case FMT_TS_3164:
+	case FMT_TS_3339:
+		if(pOp->opType != FMT_TS_3339) {
+			/* first letters of the month names; the timestamp parser
+			 * also accepts them in lower case */
+			for(pMon = (uchar*) "JFMASONDjfmasond" ; *pMon ; ++pMon)
+				setFirstChar(pLay, *pMon);
+		}
+		if(pOp->opType != FMT_TS_3164) {
+			for(c = '0' ; c <= '9' ; ++c)
+				setFirstChar(pLay, c);
+		}
+		break;
+	case FMT_HOSTNAME:
+		for(c = 0 ; c < 256 ; ++c)
+			if(isHostnameChar(c))
+				setFirstChar(pLay, c);
+		break;
+	case FMT_TAG:
+	case FMT_WORD:
+		/* a field may be empty, so we can not say anything specific */
+		memset(pLay->firstChar, 0xff, sizeof(pLay->firstChar));
+		break;
+	}
+}
+
+
+/* compile a layout description into its parse steps. */
+static rsRetVal
+compileLayout(fmtLayout_t *pLay, uchar *pszFmt)
+{
+	uchar *p;
+	uchar *pEnd;
+	fmtOp_t *pOp;
+	fmtOp_t *pNext;
+	int lenName;
+	int i;
+	DEFiRet;
+
+	memset(pLay, 0, sizeof(fmtLayout_t));
+	pLay->pszFmt = pszFmt;
+	p = pszFmt;
+	while(*p) {
+		if(*p != '%') {
+			CHKiRet(addLiteral(pLay, p, 1));
+			++p;
+			continue;
+		}
+		if(p[1] == '%') {
+			CHKiRet(addLiteral(pLay, p, 1));
+			p += 2;
+			continue;
+		}
+		pEnd = (uchar*) strchr((char*)p + 1, '%');
+		if(pEnd == NULL) {
+			errmsg.LogError(0, RS_RET_INVALID_PARAMS, "pmrfc3164fmt: unterminated "
+				"field name in format '%s'", pszFmt);
+			ABORT_FINALIZE(RS_RET_INVALID_PARAMS);
+		}
+		++p;
+		lenName = pEnd - p;
+		if(lenName == 9 && !strncmp((char*)p, "timestamp", 9)) {
+			CHKiRet(addOp(pLay, FMT_TS_ANY, NULL, 0));
+		} else if(lenName == 13 && !strncmp((char*)p, "timestamp3164", 13)) {
+			CHKiRet(addOp(pLay, FMT_TS_3164, NULL, 0));
+		} else if(lenName == 13 && !strncmp((char*)p, "timestamp3339", 13)) {
+			CHKiRet(addOp(pLay, FMT_TS_3339, NULL, 0));
+		} else if(lenName == 8 && !strncmp((char*)p, "hostname", 8)) {
+			CHKiRet(addOp(pLay, FMT_HOSTNAME, NULL, 0));
+			pLay->bHasHostname = 1;
+		} else if(lenName == 3 && !strncmp((char*)p, "tag", 3)) {
+			CHKiRet(addOp(pLay, FMT_TAG, NULL, 0));
+		} else if(lenName == 4 && !strncmp((char*)p, "word", 4)) {
+			CHKiRet(addOp(pLay, FMT_WORD, NULL, 0));
+		} else {
+			errmsg.LogError(0, RS_RET_INVALID_PARAMS, "pmrfc3164fmt: unknown "
+				"field '%%%.*s%%' in format '%s'", lenName, p, pszFmt);
+			ABORT_FINALIZE(RS_RET_INVALID_PARAMS);
+		}
+		p = pEnd + 1;
+	}
+
+	/* now resolve field terminators. Two fields must be separated by a
+	 * literal, as we would otherwise not know where the first one ends.
+	 * The timestamp parsers consume the SP after the timestamp, so we need
+	 * to remove it from the following literal.
+	 */
+	for(i = 0 ; i < pLay->nOps ; ++i) {
+		pOp = &pLay->ops[i];
+		if(pOp->opType == FMT_LITERAL)
+			continue;
+		pNext = (i + 1 < pLay->nOps) ? &pLay->ops[i+1] : NULL;
+		if(pNext != NULL && pNext->opType != FMT_LITERAL) {
+			errmsg.LogError(0, RS_RET_INVALID_PARAMS, "pmrfc3164fmt: fields must be "
+				"separated by literal text in format '%s'", pszFmt);
+			ABORT_FINALIZE(RS_RET_INVALID_PARAMS);
+		}
+		if(pOp->opType == FMT_TS_ANY || pOp->opType == FMT_TS_3164 || pOp->opType == FMT_TS_3339) {
+			if(pNext == NULL)
+				continue;
+			if(pNext->lit[0] != ' ') {
+				errmsg.LogError(0, RS_RET_INVALID_PARAMS, "pmrfc3164fmt: timestamp "
+					"must be followed by a space in format '%s'", pszFmt);
+				ABORT_FINALIZE(RS_RET_INVALID_PARAMS);
+			}
+			if(pNext->lenLit == 1) {
+				free(pNext->lit);
+				memmove(pNext, pNext + 1, (pLay->nOps - i - 2) * sizeof(fmtOp_t));
+				--pLay->nOps;
+			} else {
+				memmove(pNext->lit, pNext->lit + 1, pNext->lenLit - 1);
+				--pNext->lenLit;
+			}
+		} else if(pNext == NULL) {
+			pOp->bTermAtEnd = 1;
+			pOp->term = ' ';
+		} else {
+			pOp->term = pNext->lit[0];
+		}
+	}
+	computeFirstChars(pLay);
+
+finalize_it:
+	RETiRet;
+}
+
+
+static void
+freeLayout(fmtLayout_t *pLay)
+{
+	int i;
+	for(i = 0 ; i < pLay->nOps ; ++i)
+		free(pLay->ops[i].lit);
+	free(pLay->ops);
+	free(pLay->pszFmt);
+}
+
+
+/* try to match a single layout against the message. Nothing is
+ * modified in the message unless the complete layout matches.
+ */
+static rsRetVal
+tryLayout(fmtLayout_t *pLay, msg_t *pMsg, uchar *p2parse, int lenMsg)
+{
+	struct syslogTime tTIMESTAMP;
+	sbool bHaveTS = 0;
+	int offsHost = -1, lenHost = 0;
+	int offsTAG = -1, lenTAG = 0;
+	fmtOp_t *pOp;
+	rsRetVal localRet;
+	int i, iOp;
+	DEFiRet;
+
+	if(pLay->bHasHostname && !(pMsg->msgFlags & PARSE_HOSTNAME))
+		ABORT_FINALIZE(RS_RET_COULD_NOT_PARSE);
+	if(lenMsg > 0 && !isFirstChar(pLay, *p2parse))
+		ABORT_FINALIZE(RS_RET_COULD_NOT_PARSE);
+
+	for(iOp = 0 ; iOp < pLay->nOps ; ++iOp) {
+		pOp = &pLay->ops[iOp];
+		switch(pOp->opType) {
+		case FMT_LITERAL:
+			if(lenMsg < pOp->lenLit || memcmp(p2parse, pOp->lit, pOp->lenLit))
+				ABORT_FINALIZE(RS_RET_COULD_NOT_PARSE);
+			p2parse += pOp->lenLit;
+			lenMsg -= pOp->lenLit;
+			break;
+		case FMT_TS_ANY:
+		case FMT_TS_3339:
+		case FMT_TS_3164:
+			localRet = RS_RET_INVLD_TIME;
+			if(pOp->opType != FMT_TS_3164)
+				localRet = datetime.ParseTIMESTAMP3339(&tTIMESTAMP, &p2parse, &lenMsg);
+			if(localRet != RS_RET_OK && pOp->opType != FMT_TS_3339)
+				localRet = datetime.ParseTIMESTAMP3164(&tTIMESTAMP, &p2parse, &lenMsg);
+			if(localRet != RS_RET_OK)
+				ABORT_FINALIZE(RS_RET_COULD_NOT_PARSE);
+			bHaveTS = 1;
+			break;
+		case FMT_HOSTNAME:
+			for(i = 0 ; i < lenMsg && isHostnameChar(p2parse[i]) ; ++i)
+				/* just scan */;
+			if(i == 0 || i >= CONF_HOSTNAME_MAXSIZE
+			   || (i < lenMsg && p2parse[i] != pOp->term))
+				ABORT_FINALIZE(RS_RET_COULD_NOT_PARSE);
+			offsHost = p2parse - pMsg->pszRawMsg;
+			lenHost = i;
+			p2parse += i;
+			lenMsg -= i;
+			if(pOp->bTermAtEnd && lenMsg > 0) {
+				++p2parse; /* "eat" SP delimiter */
+				--lenMsg;
+			}
+			break;
+		case FMT_TAG:
+		case FMT_WORD:
+			if(pOp->bTermAtEnd) {
+				for(i = 0 ; i < lenMsg && p2parse[i] != ' '
+					&& (pOp->opType == FMT_WORD || p2parse[i] != ':') ; ++i)
+					/* just scan */;
+			} else {
+				for(i = 0 ; i < lenMsg && p2parse[i] != pOp->term ; ++i)
+					/* just scan */;
+				if(i == lenMsg)
+					ABORT_FINALIZE(RS_RET_COULD_NOT_PARSE);
+			}
+			if(pOp->opType == FMT_TAG) {
+				if(i >= CONF_TAG_MAXSIZE - 1)
+					ABORT_FINALIZE(RS_RET_COULD_NOT_PARSE);
+				offsTAG = p2parse - pMsg->pszRawMsg;
+				/* like in pmrfc3164, a colon is part of the TAG */
+				lenTAG = (i < lenMsg && p2parse[i] == ':') ? i + 1 : i;
+			}
+			p2parse += i;
+			lenMsg -= i;
+			if(pOp->bTermAtEnd && lenMsg > 0) {
+				/* "eat" the delimiter. For the TAG, only the colon is
+				 * eaten, a SP after it is already CONTENT.
+				 */
+				if(pOp->opType == FMT_WORD || *p2parse == ':') {
+					++p2parse;
+					--lenMsg;
+				}
+			}
+			break;
+		}
+	}
+
+	/* we have a match, so now we can populate the message */
+	if(bHaveTS) {
+		if(pMsg->msgFlags & IGNDATE)
+			memcpy(&pMsg->tTIMESTAMP, &pMsg->tRcvdAt, sizeof(struct syslogTime));
+		else
+			memcpy(&pMsg->tTIMESTAMP, &tTIMESTAMP, sizeof(struct syslogTime));
+	}
+	if(offsHost != -1)
+		MsgSetLazyField(pMsg, MSG_LAZY_HOSTNAME, offsHost, lenHost);
+	if(offsTAG != -1)
+		MsgSetLazyField(pMsg, MSG_LAZY_TAG, offsTAG, lenTAG);
+	MsgSetMSGoffs(pMsg, p2parse - pMsg->pszRawMsg);
+
+finalize_it:
+	RETiRet;
+}
+
+
+BEGINparse
+	uchar *p2parse;
+	int lenMsg;
+	int i;
+CODESTARTparse
+	assert(pMsg != NULL);
+	assert(pMsg->pszRawMsg != NULL);
+	if(runModConf == NULL || runModConf->nLayouts == 0
+	   || !bParseHOSTNAMEandTAG || (pMsg->msgFlags & INTERNAL_MSG))
+		ABORT_FINALIZE(RS_RET_COULD_NOT_PARSE);
+
+	lenMsg = pMsg->iLenRawMsg - pMsg->offAfterPRI; /* note: offAfterPRI is already the number of PRI chars (do not add one!) */
+	p2parse = pMsg->pszRawMsg + pMsg->offAfterPRI; /* point to start of text, after PRI */
+
+	iRet = RS_RET_COULD_NOT_PARSE;
+	for(i = 0 ; i < runModConf->nLayouts && iRet == RS_RET_COULD_NOT_PARSE ; ++i) {
+		iRet = tryLayout(&runModConf->layouts[i], pMsg, p2parse, lenMsg);
+	}
+	if(iRet == RS_RET_OK) {
+		DBGPRINTF("pmrfc3164fmt: message matched format '%s'\n", runModConf->layouts[i-1].pszFmt);
+		setProtocolVersion(pMsg, 0);
+	}
+finalize_it:
+ENDparse
+
+
+/* The batch entry point tries each layout on all messages of the batch
+ * that are not yet matched. Thus a layout's parse steps are run back to
+ * back over many messages, and its first-byte filter quickly sorts out
+ * those that can not match.
+ */
+BEGINparseBatch
+	int *pPending = NULL;	/* index of messages not yet matched */
+	int nPending;
+	int nKeep;
+	msg_t *pMsg;
+	int i, j;
+CODESTARTparseBatch
+	for(i = 0 ; i < nMsgs ; ++i)
+		pRet[i] = RS_RET_COULD_NOT_PARSE;
+	if(runModConf == NULL || runModConf->nLayouts == 0 || !bParseHOSTNAMEandTAG)
+		FINALIZE;
+
+	CHKmalloc(pPending = malloc(nMsgs * sizeof(int)));
+	nPending = 0;
+	for(i = 0 ; i < nMsgs ; ++i) {
+		if(!(ppMsg[i]->msgFlags & INTERNAL_MSG))
+			pPending[nPending++] = i;
+	}
+
+	for(i = 0 ; i < runModConf->nLayouts && nPending > 0 ; ++i) {
+		nKeep = 0;
+		for(j = 0 ; j < nPending ; ++j) {
+			pMsg = ppMsg[pPending[j]];
+			if(tryLayout(&runModConf->layouts[i], pMsg, pMsg->pszRawMsg + pMsg->offAfterPRI,
+			             pMsg->iLenRawMsg - pMsg->offAfterPRI) == RS_RET_OK) {
+				setProtocolVersion(pMsg, 0);
+				pRet[pPending[j]] = RS_RET_OK;
+			} else {
+				pPending[nKeep++] = pPending[j];
+			}
+		}
+		DBGPRINTF("pmrfc3164fmt: format '%s' matched %d of %d messages\n",
+			  runModConf->layouts[i].pszFmt, nPending - nKeep, nPending);
+		nPending = nKeep;
+	}
+
+finalize_it:
+	free(pPending);
+ENDparseBatch
+
+
+BEGINbeginCnfLoad
+CODESTARTbeginCnfLoad
+	loadModConf = pModConf;
+	pModConf->pConf = pConf;
+	pModConf->layouts = NULL;
+	pModConf->nLayouts = 0;
+ENDbeginCnfLoad
+
+BEGINsetModCnf
+	struct cnfparamvals *pvals = NULL;
+	struct cnfarray *ar;
+	uchar *pszFmt;
+	int i, j;
+CODESTARTsetModCnf
+	pvals = nvlstGetParams(lst, &modpblk, NULL);
+	if(pvals == NULL) {
+		errmsg.LogError(0, RS_RET_MISSING_CNFPARAMS, "error processing module "
+				"config parameters [module(...)]");
+		ABORT_FINALIZE(RS_RET_MISSING_CNFPARAMS);
+	}
+
+	if(Debug) {
+		dbgprintf("module (global) param blk for pmrfc3164fmt:\n");
+		cnfparamsPrint(&modpblk, pvals);
+	}
+
+	for(i = 0 ; i < modpblk.nParams ; ++i) {
+		if(!pvals[i].bUsed)
+			continue;
+		if(!strcmp(modpblk.descr[i].name, "format")) {
+			ar = pvals[i].val.d.ar;
+			CHKmalloc(loadModConf->layouts = calloc(ar->nmemb, sizeof(fmtLayout_t)));
+			for(j = 0 ; j < ar->nmemb ; ++j) {
+				CHKmalloc(pszFmt = (uchar*)es_str2cstr(ar->arr[j], NULL));
+				iRet = compileLayout(&loadModConf->layouts[j], pszFmt);
+				++loadModConf->nLayouts; /* also count failed one, so it is freed */
+				if(iRet != RS_RET_OK)
+					FINALIZE;
+			}
+		} else {
+			dbgprintf("pmrfc3164fmt: program error, non-handled "
+			  "param '%s' in setModCnf\n", modpblk.descr[i].name);
+		}
+	}
+finalize_it:
+	if(pvals != NULL)
+		cnfparamvalsDestruct(pvals, &modpblk);
+ENDsetModCnf
+
+BEGINendCnfLoad
+CODESTARTendCnfLoad
+	loadModConf = NULL; /* done loading */
+ENDendCnfLoad
+
+BEGINcheckCnf
+CODESTARTcheckCnf
+	if(pModConf->nLayouts == 0) {
+		errmsg.LogError(0, NO_ERRCODE, "pmrfc3164fmt: warning: no formats given, "
+				"parser will not process any message");
+	}
+ENDcheckCnf
+
+BEGINactivateCnf
+CODESTARTactivateCnf
+	runModConf = pModConf;
+ENDactivateCnf
+
+BEGINfreeCnf
+	int i;
+CODESTARTfreeCnf
+	for(i = 0 ; i < pModConf->nLayouts ; ++i)
+		freeLayout(&pModConf->layouts[i]);
+	free(pModConf->layouts);
+ENDfreeCnf
+
+
+BEGINmodExit
+CODESTARTmodExit
+	/* release what we no longer need */
+	objRelease(errmsg, CORE_COMPONENT);
+	objRelease(glbl, CORE_COMPONENT);
+	objRelease(parser, CORE_COMPONENT);
+	objRelease(datetime, CORE_COMPONENT);
+ENDmodExit
+
+
+BEGINqueryEtryPt
+CODESTARTqueryEtryPt
+CODEqueryEtryPt_STD_PMOD_QUERIES
+CODEqueryEtryPt_STD_PMOD_BATCH_QUERIES
+CODEqueryEtryPt_STD_CONF2_QUERIES
+CODEqueryEtryPt_STD_CONF2_setModCnf_QUERIES
+CODEqueryEtryPt_IsCompatibleWithFeature_IF_OMOD_QUERIES
+ENDqueryEtryPt
+
+
+BEGINmodInit()
+CODESTARTmodInit
+	*ipIFVersProvided = CURR_MOD_IF_VERSION; /* we only support the current interface specification */
+CODEmodInit_QueryRegCFSLineHdlr
+	CHKiRet(objUse(glbl, CORE_COMPONENT));
+	CHKiRet(objUse(errmsg, CORE_COMPONENT));
+	CHKiRet(objUse(parser, CORE_COMPONENT));
+	CHKiRet(objUse(datetime, CORE_COMPONENT));
+
+	DBGPRINTF("pmrfc3164fmt parser init called\n");
+ 	bParseHOSTNAMEandTAG = glbl.GetParseHOSTNAMEandTAG(); /* cache value, is set only during rsyslogd option processing */
+ENDmodInit
+
+/* vim:set ai:
+ */
@@ -111,6 +111,8 @@ CODESTARTparse
 
 	*/
 	snaremessage=0;
+	/* we modify the raw message in place */
+	CHKiRet(MsgMakeRawMsgWritable(pMsg));
 	lenMsg = pMsg->iLenRawMsg - pMsg->offAfterPRI; /* note: offAfterPRI is already the number of PRI chars (do not add one!) */
 	p2parse = pMsg->pszRawMsg + pMsg->offAfterPRI; /* point to start of text, after PRI */
 	dbgprintf("pmsnare: msg to look at: [%d]'%s'\n", lenMsg, p2parse);
@@ -196,6 +196,7 @@
 #	define ATOMIC_INC_uint64(data, phlpmut) ((void) __sync_fetch_and_add(data, 1))
 #	define ATOMIC_DEC_unit64(data, phlpmut) ((void) __sync_sub_and_fetch(data, 1))
 #	define ATOMIC_INC_AND_FETCH_uint64(data, phlpmut) __sync_fetch_and_add(data, 1)
+#	define ATOMIC_ADD_uint64(data, phlpmut, val) ((void) __sync_fetch_and_add(data, val))
 
 #	define DEF_ATOMIC_HELPER_MUT64(x)
 #	define INIT_ATOMIC_HELPER_MUT64(x)
@@ -211,6 +212,11 @@
 		--(*(data)); \
 		pthread_mutex_unlock(phlpmut); \
 	}
+#	define ATOMIC_ADD_uint64(data, phlpmut, val)  { \
+		pthread_mutex_lock(phlpmut); \
+		*(data) += (val); \
+		pthread_mutex_unlock(phlpmut); \
+	}
 
 	static inline unsigned
 	ATOMIC_INC_AND_FETCH_uint64(uint64 *data, pthread_mutex_t *phlpmut) {
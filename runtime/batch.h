@@ -56,6 +56,10 @@ struct batch_obj_s {
 	void *staticActParams[CONF_OMOD_NUMSTRINGS_MAXSIZE]; /**< for anything else */
 	size_t staticLenStrings[CONF_OMOD_NUMSTRINGS_MAXSIZE];
 				/* and the same for the message length (if used) */
+	struct template *pCachedTpl[CONF_OMOD_NUMSTRINGS_MAXSIZE];
+				/* template staticActStrings[i] was last rendered from, NULL if none... */
+	unsigned cachedModCount[CONF_OMOD_NUMSTRINGS_MAXSIZE];
+				/* ...and the message's iModCount at that time (see prepareDoActionParams) */
 	/* end action work variables */
 };
 
@@ -30,6 +30,9 @@
 #include <stdarg.h>
 #include <ctype.h>
 #include <assert.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
 #ifdef HAVE_SYS_TIME_H
 #	include <sys/time.h>
 #endif
@@ -41,6 +44,7 @@
 #include "srUtils.h"
 #include "stringbuf.h"
 #include "errmsg.h"
+#include "hdrscan.h"
 
 /* static data */
 DEFobjStaticHelpers
@@ -49,6 +53,46 @@ DEFobjCurrIf(errmsg)
 /* the following table of ten powers saves us some computation */
 static const int tenPowers[6] = { 1, 10, 100, 1000, 10000, 100000 };
 
+/* Per-thread cache of formatted timestamps. Messages usually arrive in
+ * bursts where many of them share the same second (and all messages of a
+ * receive batch share the same tRcvdAt), so for each output format we keep
+ * the last timestamp formatted by this thread and just copy the result if
+ * the next one is within the same second. Fractional seconds are not part
+ * of the key: formats that contain them get them patched into the cached
+ * string. As the cache is thread-local, no locking is required.
+ */
+#define TSCACHE_3164		0
+#define TSCACHE_3164_BUGGY	1
+#define TSCACHE_3339		2
+#define TSCACHE_MYSQL		3
+#define TSCACHE_PGSQL		4
+#define TSCACHE_UNIX		5
+#define TSCACHE_NUM_ENTRIES	6
+
+typedef struct tsCacheEntry_s {
+	sbool bValid;
+	struct syslogTime ts;	/* key - only the second-resolution fields and offset are used */
+	int len;		/* length of buf (without \0) */
+	char buf[CONST_LEN_TIMESTAMP_3339 + 1];
+} tsCacheEntry_t;
+
+static pthread_key_t keyTsCache;	/* per-thread array of TSCACHE_NUM_ENTRIES cache entries */
+
+/* Per-thread cache of the broken-down current time. Inputs obtain the
+ * current time for (almost) every message, but converting it via
+ * localtime_r() is far more expensive than reading the clock. As the
+ * broken-down time only changes when the second changes, we keep the
+ * result for the last second seen by this thread and just update the
+ * fractional part.
+ */
+typedef struct curTimeCache_s {
+	sbool bValid;
+	time_t ttSeconds;	/* key */
+	struct syslogTime st;
+} curTimeCache_t;
+
+static pthread_key_t keyCurTimeCache;
+
 /* ------------------------------ methods ------------------------------ */
 
 
@@ -134,6 +178,64 @@ static void getCurrTime(struct syslogTime *t, time_t *ttSeconds)
 }
 
 
+/* same as timeval2syslogTime(), but the broken-down time is cached per
+ * thread and only re-computed if the second changes.
+ */
+static void
+timeval2syslogTimeCached(struct timeval *tp, struct syslogTime *t)
+{
+	curTimeCache_t *pCache;
+
+	if((pCache = pthread_getspecific(keyCurTimeCache)) == NULL) {
+		if(   (pCache = calloc(1, sizeof(curTimeCache_t))) == NULL
+		   || pthread_setspecific(keyCurTimeCache, pCache) != 0) {
+			free(pCache);
+			timeval2syslogTime(tp, t);
+			return;
+		}
+	}
+	if(!pCache->bValid || pCache->ttSeconds != tp->tv_sec) {
+		timeval2syslogTime(tp, &pCache->st);
+		pCache->ttSeconds = tp->tv_sec;
+		pCache->bValid = 1;
+	}
+	memcpy(t, &pCache->st, sizeof(struct syslogTime));
+	t->secfrac = tp->tv_usec;
+}
+
+
+/* Cached version of getCurrTime(), meant for inputs, which obtain the
+ * time for each message (or batch of messages). If bCoarse is set and
+ * the system supports it, CLOCK_REALTIME_COARSE is used. That clock is
+ * considerably cheaper to read, but only has a resolution of a few
+ * milliseconds (the fractional seconds are still reported with
+ * microsecond precision).
+ */
+static void
+getCurrTimeCached(struct syslogTime *t, time_t *ttSeconds, int bCoarse)
+{
+	struct timespec ts;
+	struct timeval tp;
+
+	assert(t != NULL);
+#	ifdef CLOCK_REALTIME_COARSE
+	if(bCoarse) {
+		clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+	} else {
+		clock_gettime(CLOCK_REALTIME, &ts);
+	}
+#	else
+	clock_gettime(CLOCK_REALTIME, &ts);
+#	endif
+	tp.tv_sec = ts.tv_sec;
+	tp.tv_usec = ts.tv_nsec / 1000;
+	if(ttSeconds != NULL)
+		*ttSeconds = tp.tv_sec;
+
+	timeval2syslogTimeCached(&tp, t);
+}
+
+
 /* A fast alternative to getCurrTime() and time() that only obtains
  * a timestamp like time() does. I was told that gettimeofday(), at
  * least under Linux, is much faster than time() and I could confirm
@@ -169,35 +271,6 @@ getTime(time_t *ttSeconds)
  */
 
 
-/**
- * Parse a 32 bit integer number from a string.
- *
- * \param ppsz Pointer to the Pointer to the string being parsed. It
- *             must be positioned at the first digit. Will be updated 
- *             so that on return it points to the first character AFTER
- *             the integer parsed.
- * \param pLenStr pointer to string length, decremented on exit by
- *                characters processed
- * 		  Note that if an empty string (len < 1) is passed in,
- * 		  the method always returns zero.
- * \retval The number parsed.
- */
-static inline int
-srSLMGParseInt32(uchar** ppsz, int *pLenStr)
-{
-	register int i;
-
-	i = 0;
-	while(*pLenStr > 0 && **ppsz >= '0' && **ppsz <= '9') {
-		i = i * 10 + **ppsz - '0';
-		++(*ppsz);
-		--(*pLenStr);
-	}
-
-	return i;
-}
-
-
 /**
  * Parse a TIMESTAMP-3339.
  * updates the parse pointer position. The pTime parameter
@@ -213,12 +286,7 @@ ParseTIMESTAMP3339(struct syslogTime *pTime, uchar** ppszTS, int *pLenStr)
 {
 	uchar *pszTS = *ppszTS;
 	/* variables to temporarily hold time information while we parse */
-	int year;
-	int month;
-	int day;
-	int hour; /* 24 hour clock */
-	int minute;
-	int second;
+	struct hdrscan_dt dt;
 	int secfrac;	/* fractional seconds (must be 32 bit!) */
 	int secfracPrecision;
 	char OffsetMode;	/* UTC offset + or - */
@@ -233,48 +301,12 @@ ParseTIMESTAMP3339(struct syslogTime *pTime, uchar** ppszTS, int *pLenStr)
 	assert(pszTS != NULL);
 
 	lenStr = *pLenStr;
-	year = srSLMGParseInt32(&pszTS, &lenStr);
-
-	/* We take the liberty to accept slightly malformed timestamps e.g. in 
-	 * the format of 2003-9-1T1:0:0. This doesn't hurt on receiving. Of course,
-	 * with the current state of affairs, we would never run into this code
-	 * here because at postion 11, there is no "T" in such cases ;)
-	 */
-	if(lenStr == 0 || *pszTS++ != '-')
-		ABORT_FINALIZE(RS_RET_INVLD_TIME);
-	--lenStr;
-	month = srSLMGParseInt32(&pszTS, &lenStr);
-	if(month < 1 || month > 12)
-		ABORT_FINALIZE(RS_RET_INVLD_TIME);
-
-	if(lenStr == 0 || *pszTS++ != '-')
-		ABORT_FINALIZE(RS_RET_INVLD_TIME);
-	--lenStr;
-	day = srSLMGParseInt32(&pszTS, &lenStr);
-	if(day < 1 || day > 31)
-		ABORT_FINALIZE(RS_RET_INVLD_TIME);
-
-	if(lenStr == 0 || *pszTS++ != 'T')
-		ABORT_FINALIZE(RS_RET_INVLD_TIME);
-	--lenStr;
-
-	hour = srSLMGParseInt32(&pszTS, &lenStr);
-	if(hour < 0 || hour > 23)
-		ABORT_FINALIZE(RS_RET_INVLD_TIME);
-
-	if(lenStr == 0 || *pszTS++ != ':')
-		ABORT_FINALIZE(RS_RET_INVLD_TIME);
-	--lenStr;
-	minute = srSLMGParseInt32(&pszTS, &lenStr);
-	if(minute < 0 || minute > 59)
-		ABORT_FINALIZE(RS_RET_INVLD_TIME);
-
-	if(lenStr == 0 || *pszTS++ != ':')
-		ABORT_FINALIZE(RS_RET_INVLD_TIME);
-	--lenStr;
-	second = srSLMGParseInt32(&pszTS, &lenStr);
-	if(second < 0 || second > 60)
+	if(hdrScan3339DateTimeFixed(pszTS, lenStr, &dt)) {
+		pszTS += 19;
+		lenStr -= 19;
+	} else if(!hdrScan3339DateTime(&pszTS, &lenStr, &dt)) {
 		ABORT_FINALIZE(RS_RET_INVLD_TIME);
+	}
 
 	/* Now let's see if we have secfrac */
 	if(lenStr > 0 && *pszTS == '.') {
@@ -329,12 +361,12 @@ ParseTIMESTAMP3339(struct syslogTime *pTime, uchar** ppszTS, int *pLenStr)
 	/* we had success, so update parse pointer and caller-provided timestamp */
 	*ppszTS = pszTS;
 	pTime->timeType = 2;
-	pTime->year = year;
-	pTime->month = month;
-	pTime->day = day;
-	pTime->hour = hour;
-	pTime->minute = minute;
-	pTime->second = second;
+	pTime->year = dt.year;
+	pTime->month = dt.month;
+	pTime->day = dt.day;
+	pTime->hour = dt.hour;
+	pTime->minute = dt.minute;
+	pTime->second = dt.second;
 	pTime->secfrac = secfrac;
 	pTime->secfracPrecision = secfracPrecision;
 	pTime->OffsetMode = OffsetMode;
@@ -630,6 +662,94 @@ finalize_it:
  * END CODE-LIBLOGGING                                             *
  *******************************************************************/
 
+/* obtain the cache entry for format iEntry of the current thread. Returns
+ * NULL if no cache could be allocated, in which case the caller must format
+ * the timestamp without caching.
+ */
+static inline tsCacheEntry_t *
+tsCacheGetEntry(int iEntry)
+{
+	tsCacheEntry_t *pCache;
+
+	if((pCache = pthread_getspecific(keyTsCache)) == NULL) {
+		if((pCache = calloc(TSCACHE_NUM_ENTRIES, sizeof(tsCacheEntry_t))) == NULL)
+			return NULL;
+		if(pthread_setspecific(keyTsCache, pCache) != 0) {
+			free(pCache);
+			return NULL;
+		}
+	}
+	return pCache + iEntry;
+}
+
+
+/* check if the cache entry holds the same timestamp (at second resolution).
+ * The second is compared first, as it is the field most likely to differ.
+ */
+static inline int
+tsCacheMatches(tsCacheEntry_t *pEntry, struct syslogTime *ts)
+{
+	return    pEntry->bValid
+	       && pEntry->ts.second == ts->second
+	       && pEntry->ts.minute == ts->minute
+	       && pEntry->ts.hour == ts->hour
+	       && pEntry->ts.day == ts->day
+	       && pEntry->ts.month == ts->month
+	       && pEntry->ts.year == ts->year
+	       && pEntry->ts.OffsetMode == ts->OffsetMode
+	       && pEntry->ts.OffsetHour == ts->OffsetHour
+	       && pEntry->ts.OffsetMinute == ts->OffsetMinute;
+}
+
+
+/* write the fractional seconds digits (without leading dot) to pBuf and
+ * return the number of digits written. Nothing is written if the timestamp
+ * has no fractional seconds.
+ */
+static inline int
+formatSecFracDigits(struct syslogTime *ts, char *pBuf)
+{
+	int iBuf = 0;
+	int power;
+	int secfrac;
+	short digit;
+
+	if(ts->secfracPrecision > 0) {
+		power = tenPowers[(ts->secfracPrecision - 1) % 6];
+		secfrac = ts->secfrac;
+		while(power > 0) {
+			digit = secfrac / power;
+			secfrac -= digit * power;
+			power /= 10;
+			pBuf[iBuf++] = digit + '0';
+		}
+	}
+	return iBuf;
+}
+
+
+/* Format a timestamp of one of the fixed-length formats via the per-thread
+ * cache. fmtFunc is the uncached formatter, bBuggyDay is only used by the
+ * 3164 formatter (all other formatters ignore it).
+ */
+static inline int
+formatViaCache(int iEntry, struct syslogTime *ts, char *pBuf,
+	       int (*fmtFunc)(struct syslogTime*, char*, int), int bBuggyDay)
+{
+	tsCacheEntry_t *pEntry;
+
+	if((pEntry = tsCacheGetEntry(iEntry)) == NULL)
+		return fmtFunc(ts, pBuf, bBuggyDay);
+	if(!tsCacheMatches(pEntry, ts)) {
+		pEntry->ts = *ts;
+		pEntry->len = fmtFunc(ts, pEntry->buf, bBuggyDay);
+		pEntry->bValid = 1;
+	}
+	memcpy(pBuf, pEntry->buf, strlen(pEntry->buf) + 1);
+	return pEntry->len;
+}
+
+
 /**
  * Format a syslogTimestamp into format required by MySQL.
  * We are using the 14 digits format. For example 20041111122600 
@@ -639,7 +759,8 @@ finalize_it:
  * returns the size of the timestamp written in bytes (without
  * the string terminator). If 0 is returend, an error occured.
  */
-int formatTimestampToMySQL(struct syslogTime *ts, char* pBuf)
+static int
+doFormatTimestampToMySQL(struct syslogTime *ts, char* pBuf, int __attribute__((unused)) dummy)
 {
 	/* currently we do not consider localtime/utc. This may later be
 	 * added. If so, I recommend using a property replacer option
@@ -669,7 +790,15 @@ int formatTimestampToMySQL(struct syslogTime *ts, char* pBuf)
 
 }
 
-int formatTimestampToPgSQL(struct syslogTime *ts, char *pBuf)
+int formatTimestampToMySQL(struct syslogTime *ts, char* pBuf)
+{
+	assert(ts != NULL);
+	assert(pBuf != NULL);
+	return formatViaCache(TSCACHE_MYSQL, ts, pBuf, doFormatTimestampToMySQL, 0);
+}
+
+static int
+doFormatTimestampToPgSQL(struct syslogTime *ts, char *pBuf, int __attribute__((unused)) dummy)
 {
 	/* see note in formatTimestampToMySQL, applies here as well */
 	assert(ts != NULL);
@@ -698,6 +827,13 @@ int formatTimestampToPgSQL(struct syslogTime *ts, char *pBuf)
 	return 19;
 }
 
+int formatTimestampToPgSQL(struct syslogTime *ts, char *pBuf)
+{
+	assert(ts != NULL);
+	assert(pBuf != NULL);
+	return formatViaCache(TSCACHE_PGSQL, ts, pBuf, doFormatTimestampToPgSQL, 0);
+}
+
 
 /**
  * Format a syslogTimestamp to just the fractional seconds.
@@ -711,25 +847,14 @@ int formatTimestampToPgSQL(struct syslogTime *ts, char *pBuf)
 int formatTimestampSecFrac(struct syslogTime *ts, char* pBuf)
 {
 	int iBuf;
-	int power;
-	int secfrac;
-	short digit;
 
 	assert(ts != NULL);
 	assert(pBuf != NULL);
 
-	iBuf = 0;
-	if(ts->secfracPrecision > 0)
-	{	
-		power = tenPowers[(ts->secfracPrecision - 1) % 6];
-		secfrac = ts->secfrac;
-		while(power > 0) {
-			digit = secfrac / power;
-			secfrac -= digit * power;
-			power /= 10;
-			pBuf[iBuf++] = digit + '0';
-		}
+	if(ts->secfracPrecision > 0) {
+		iBuf = formatSecFracDigits(ts, pBuf);
 	} else {
+		iBuf = 0;
 		pBuf[iBuf++] = '0';
 	}
 	pBuf[iBuf] = '\0';
@@ -738,24 +863,11 @@ int formatTimestampSecFrac(struct syslogTime *ts, char* pBuf)
 }
 
 
-/**
- * Format a syslogTimestamp to a RFC3339 timestamp string (as
- * specified in syslog-protocol).
- * The caller must provide the timestamp as well as a character
- * buffer that will receive the resulting string. The function
- * returns the size of the timestamp written in bytes (without
- * the string terminator). If 0 is returend, an error occured.
- */
-int formatTimestamp3339(struct syslogTime *ts, char* pBuf)
+/* uncached version of formatTimestamp3339(), see there */
+static int
+doFormatTimestamp3339(struct syslogTime *ts, char* pBuf)
 {
 	int iBuf;
-	int power;
-	int secfrac;
-	short digit;
-
-	BEGINfunc
-	assert(ts != NULL);
-	assert(pBuf != NULL);
 
 	/* start with fixed parts */
 	/* year yyyy */
@@ -788,14 +900,7 @@ int formatTimestamp3339(struct syslogTime *ts, char* pBuf)
 
 	if(ts->secfracPrecision > 0) {
 		pBuf[iBuf++] = '.';
-		power = tenPowers[(ts->secfracPrecision - 1) % 6];
-		secfrac = ts->secfrac;
-		while(power > 0) {
-			digit = secfrac / power;
-			secfrac -= digit * power;
-			power /= 10;
-			pBuf[iBuf++] = digit + '0';
-		}
+		iBuf += formatSecFracDigits(ts, pBuf + iBuf);
 	}
 
 	if(ts->OffsetMode == 'Z') {
@@ -811,6 +916,48 @@ int formatTimestamp3339(struct syslogTime *ts, char* pBuf)
 
 	pBuf[iBuf] = '\0';
 
+	return iBuf;
+}
+
+/**
+ * Format a syslogTimestamp to a RFC3339 timestamp string (as
+ * specified in syslog-protocol).
+ * The caller must provide the timestamp as well as a character
+ * buffer that will receive the resulting string. The function
+ * returns the size of the timestamp written in bytes (without
+ * the string terminator). If 0 is returend, an error occured.
+ * The per-thread cache holds the timestamp without fractional
+ * seconds, these are inserted after the (fixed-size) date/time part.
+ */
+int formatTimestamp3339(struct syslogTime *ts, char* pBuf)
+{
+	tsCacheEntry_t *pEntry;
+	int iBuf;
+
+	BEGINfunc
+	assert(ts != NULL);
+	assert(pBuf != NULL);
+
+	if((pEntry = tsCacheGetEntry(TSCACHE_3339)) == NULL) {
+		iBuf = doFormatTimestamp3339(ts, pBuf);
+	} else {
+		if(!tsCacheMatches(pEntry, ts)) {
+			pEntry->ts = *ts;
+			pEntry->ts.secfracPrecision = 0;
+			pEntry->len = doFormatTimestamp3339(&pEntry->ts, pEntry->buf);
+			pEntry->bValid = 1;
+		}
+		memcpy(pBuf, pEntry->buf, 19);
+		iBuf = 19;
+		if(ts->secfracPrecision > 0) {
+			pBuf[iBuf++] = '.';
+			iBuf += formatSecFracDigits(ts, pBuf + iBuf);
+		}
+		/* offset part, including \0 */
+		memcpy(pBuf + iBuf, pEntry->buf + 19, pEntry->len - 19 + 1);
+		iBuf += pEntry->len - 19;
+	}
+
 	ENDfunc
 	return iBuf;
 }
@@ -826,7 +973,8 @@ int formatTimestamp3339(struct syslogTime *ts, char* pBuf)
  * day character if day < 10. syslog-ng seems to do that, and some
  * parsing scripts (in migration cases) rely on that.
  */
-int formatTimestamp3164(struct syslogTime *ts, char* pBuf, int bBuggyDay)
+static int
+doFormatTimestamp3164(struct syslogTime *ts, char* pBuf, int bBuggyDay)
 {
 	static char* monthNames[12] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun",
 					"Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
@@ -854,6 +1002,14 @@ int formatTimestamp3164(struct syslogTime *ts, char* pBuf, int bBuggyDay)
 	return 16;	/* traditional: number of bytes written */
 }
 
+int formatTimestamp3164(struct syslogTime *ts, char* pBuf, int bBuggyDay)
+{
+	assert(ts != NULL);
+	assert(pBuf != NULL);
+	return formatViaCache(bBuggyDay ? TSCACHE_3164_BUGGY : TSCACHE_3164, ts, pBuf,
+			      doFormatTimestamp3164, bBuggyDay);
+}
+
 
 /**
  * convert syslog timestamp to time_t
@@ -973,12 +1129,18 @@ time_t syslogTime2time_t(struct syslogTime *ts)
  * Important: pBuf must point to a buffer of at least 11 bytes.
  * rgerhards, 2012-03-29
  */
-int formatTimestampUnix(struct syslogTime *ts, char *pBuf)
+static int
+doFormatTimestampUnix(struct syslogTime *ts, char *pBuf, int __attribute__((unused)) dummy)
 {
 	snprintf(pBuf, 11, "%u", (unsigned) syslogTime2time_t(ts));
 	return 11;
 }
 
+int formatTimestampUnix(struct syslogTime *ts, char *pBuf)
+{
+	return formatViaCache(TSCACHE_UNIX, ts, pBuf, doFormatTimestampUnix, 0);
+}
+
 
 /* queryInterface function
  * rgerhards, 2008-03-05
@@ -997,6 +1159,8 @@ CODESTARTobjQueryInterface(datetime)
 	pIf->getCurrTime = getCurrTime;
 	pIf->GetTime = getTime;
 	pIf->timeval2syslogTime = timeval2syslogTime;
+	pIf->getCurrTimeCached = getCurrTimeCached;
+	pIf->timeval2syslogTimeCached = timeval2syslogTimeCached;
 	pIf->ParseTIMESTAMP3339 = ParseTIMESTAMP3339;
 	pIf->ParseTIMESTAMP3164 = ParseTIMESTAMP3164;
 	pIf->formatTimestampToMySQL = formatTimestampToMySQL;
@@ -1017,6 +1181,10 @@ ENDobjQueryInterface(datetime)
 BEGINAbstractObjClassInit(datetime, 1, OBJ_IS_CORE_MODULE) /* class, version */
 	/* request objects we use */
 	CHKiRet(objUse(errmsg, CORE_COMPONENT));
+	if(pthread_key_create(&keyTsCache, free) != 0)
+		ABORT_FINALIZE(RS_RET_ERR);
+	if(pthread_key_create(&keyCurTimeCache, free) != 0)
+		ABORT_FINALIZE(RS_RET_ERR);
 ENDObjClassInit(datetime)
 
 /* vi:set ai:
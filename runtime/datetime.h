@@ -47,8 +47,11 @@ BEGINinterface(datetime) /* name must also be changed in ENDinterface macro! */
 	/* v7, 2012-03-29 */
 	int (*formatTimestampUnix)(struct syslogTime *ts, char*pBuf);
 	time_t (*syslogTime2time_t)(struct syslogTime *ts);
+	/* v8 added getCurrTimeCached() and timeval2syslogTimeCached() */
+	void (*getCurrTimeCached)(struct syslogTime *t, time_t *ttSeconds, int bCoarse);
+	void (*timeval2syslogTimeCached)(struct timeval *tp, struct syslogTime *t);
 ENDinterface(datetime)
-#define datetimeCURR_IF_VERSION 7 /* increment whenever you change the interface structure! */
+#define datetimeCURR_IF_VERSION 8 /* increment whenever you change the interface structure! */
 /* interface changes:
  * 1 - initial version
  * 2 - not compatible to 1 - bugfix required ParseTIMESTAMP3164 to accept char ** as
@@ -58,6 +61,7 @@ ENDinterface(datetime)
  * 4 - formatTimestamp3164 takes a third int parameter
  * 5 - merge of versions 3 + 4 (2010-03-09)
  * 6 - see above
+ * 8 - getCurrTimeCached() and timeval2syslogTimeCached() added
  */
 
 /* prototypes */
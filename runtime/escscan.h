@@ -0,0 +1,189 @@
+/* escscan.h
+ * Scanning kernels used by the output escaping code (template option
+ * sql/stdsql/json and the json property option) and by the message
+ * sanitizer. They find the first character that needs to be escaped,
+ * so that the callers can copy clean runs as a whole and need not
+ * allocate anything at all if a string is already clean (which is the
+ * usual case).
+ *
+ * If the compiler targets SSE2 (always the case on x86_64) or AVX2, the
+ * string is checked in 16 or 32 byte blocks, otherwise (and for the
+ * remaining bytes) we fall back to a simple loop.
+ *
+ * Copyright 2013 Adiscon GmbH.
+ *
+ * This file is part of the rsyslog runtime library.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *       -or-
+ *       see COPYING.ASL20 in the source distribution
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef INCLUDED_ESCSCAN_H
+#define INCLUDED_ESCSCAN_H
+
+#include <stddef.h>
+#if defined(__AVX2__)
+#	include <immintrin.h>
+#elif defined(__SSE2__)
+#	include <emmintrin.h>
+#endif
+
+
+/* check if a character must be escaped in a JSON string value. We
+ * escape control characters, '"' and '\\' (as jsonAddVal() always did).
+ */
+static inline int
+escIsJSONSpecial(unsigned char c)
+{
+	return c < 0x20 || c == '"' || c == '\\';
+}
+
+
+/* return the offset of the first character inside p[0..len-1] that needs
+ * JSON escaping, or len if there is none.
+ */
+static inline size_t
+escScanJSON(const unsigned char *p, size_t len)
+{
+	size_t i = 0;
+#if defined(__AVX2__)
+	const __m256i vQuote32 = _mm256_set1_epi8('"');
+	const __m256i vBSlash32 = _mm256_set1_epi8('\\');
+	const __m256i vCtl32 = _mm256_set1_epi8(0x1f);
+	__m256i v32;
+	unsigned mask32;
+
+	for( ; i + 32 <= len ; i += 32) {
+		v32 = _mm256_loadu_si256((const __m256i*) (p + i));
+		/* unsigned c <= 0x1f is the same as max(c, 0x1f) == 0x1f */
+		mask32 = _mm256_movemask_epi8(_mm256_or_si256(
+			_mm256_or_si256(_mm256_cmpeq_epi8(v32, vQuote32), _mm256_cmpeq_epi8(v32, vBSlash32)),
+			_mm256_cmpeq_epi8(_mm256_max_epu8(v32, vCtl32), vCtl32)));
+		if(mask32 != 0)
+			return i + __builtin_ctz(mask32);
+	}
+#endif
+#if defined(__SSE2__)
+	const __m128i vQuote = _mm_set1_epi8('"');
+	const __m128i vBSlash = _mm_set1_epi8('\\');
+	const __m128i vCtl = _mm_set1_epi8(0x1f);
+	__m128i v;
+	unsigned mask;
+
+	for( ; i + 16 <= len ; i += 16) {
+		v = _mm_loadu_si128((const __m128i*) (p + i));
+		mask = _mm_movemask_epi8(_mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(v, vQuote), _mm_cmpeq_epi8(v, vBSlash)),
+			_mm_cmpeq_epi8(_mm_max_epu8(v, vCtl), vCtl)));
+		if(mask != 0)
+			return i + __builtin_ctz(mask);
+	}
+#endif
+	for( ; i < len ; ++i)
+		if(escIsJSONSpecial(p[i]))
+			break;
+	return i;
+}
+
+
+/* return the offset of the first occurence of any of the characters
+ * c1, c2 or c3 inside p[0..len-1], or len if there is none. If less than
+ * three characters are to be searched, simply pass one of them again.
+ */
+static inline size_t
+escScanChars(const unsigned char *p, size_t len, unsigned char c1, unsigned char c2, unsigned char c3)
+{
+	size_t i = 0;
+#if defined(__AVX2__)
+	const __m256i v1_32 = _mm256_set1_epi8(c1);
+	const __m256i v2_32 = _mm256_set1_epi8(c2);
+	const __m256i v3_32 = _mm256_set1_epi8(c3);
+	__m256i v32;
+	unsigned mask32;
+
+	for( ; i + 32 <= len ; i += 32) {
+		v32 = _mm256_loadu_si256((const __m256i*) (p + i));
+		mask32 = _mm256_movemask_epi8(_mm256_or_si256(
+			_mm256_or_si256(_mm256_cmpeq_epi8(v32, v1_32), _mm256_cmpeq_epi8(v32, v2_32)),
+			_mm256_cmpeq_epi8(v32, v3_32)));
+		if(mask32 != 0)
+			return i + __builtin_ctz(mask32);
+	}
+#endif
+#if defined(__SSE2__)
+	const __m128i v1 = _mm_set1_epi8(c1);
+	const __m128i v2 = _mm_set1_epi8(c2);
+	const __m128i v3 = _mm_set1_epi8(c3);
+	__m128i v;
+	unsigned mask;
+
+	for( ; i + 16 <= len ; i += 16) {
+		v = _mm_loadu_si128((const __m128i*) (p + i));
+		mask = _mm_movemask_epi8(_mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(v, v1), _mm_cmpeq_epi8(v, v2)),
+			_mm_cmpeq_epi8(v, v3)));
+		if(mask != 0)
+			return i + __builtin_ctz(mask);
+	}
+#endif
+	for( ; i < len ; ++i)
+		if(p[i] == c1 || p[i] == c2 || p[i] == c3)
+			break;
+	return i;
+}
+
+
+/* return the offset of the first control character (< 0x20, including
+ * NUL) inside p[0..len-1] or, if bHigh is set, of the first character
+ * > 0x7f, whichever comes first. Returns len if there is none. This is
+ * what the message sanitizer needs to look at.
+ */
+static inline size_t
+escScanCtl(const unsigned char *p, size_t len, int bHigh)
+{
+	size_t i = 0;
+#if defined(__AVX2__)
+	const __m256i vCtl32 = _mm256_set1_epi8(0x1f);
+	__m256i v32;
+	unsigned mask32;
+
+	for( ; i + 32 <= len ; i += 32) {
+		v32 = _mm256_loadu_si256((const __m256i*) (p + i));
+		mask32 = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(v32, vCtl32), vCtl32));
+		if(bHigh)
+			mask32 |= _mm256_movemask_epi8(v32); /* high bit set */
+		if(mask32 != 0)
+			return i + __builtin_ctz(mask32);
+	}
+#endif
+#if defined(__SSE2__)
+	const __m128i vCtl = _mm_set1_epi8(0x1f);
+	__m128i v;
+	unsigned mask;
+
+	for( ; i + 16 <= len ; i += 16) {
+		v = _mm_loadu_si128((const __m128i*) (p + i));
+		mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(v, vCtl), vCtl));
+		if(bHigh)
+			mask |= _mm_movemask_epi8(v);
+		if(mask != 0)
+			return i + __builtin_ctz(mask);
+	}
+#endif
+	for( ; i < len ; ++i)
+		if(p[i] < 0x20 || (bHigh && p[i] > 0x7f))
+			break;
+	return i;
+}
+
+#endif /* #ifndef INCLUDED_ESCSCAN_H */
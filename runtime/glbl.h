@@ -78,12 +78,13 @@ BEGINinterface(glbl) /* name must also be changed in ENDinterface macro! */
 	 */
 	SIMP_PROP(FdSetSize, int)
 	/* v7: was neeeded to mean v5+v6 - do NOT add anything else for that version! */
-	/* next change is v9! */
 	/* v8 - 2012-03-21 */
 	prop_t* (*GetLocalHostIP)(void);
+	/* v9 added CoarseClock */
+	SIMP_PROP(CoarseClock, int)
 #undef	SIMP_PROP
 ENDinterface(glbl)
-#define glblCURR_IF_VERSION 7 /* increment whenever you change the interface structure! */
+#define glblCURR_IF_VERSION 9 /* increment whenever you change the interface structure! */
 /* version 2 had PreserveFQDN added - rgerhards, 2008-12-08 */
 
 /* the remaining prototypes */
@@ -0,0 +1,214 @@
+/* hdrscan.h
+ * Scanning kernels used when parsing syslog headers: the date and time
+ * part of RFC3339 timestamps and the location of SP-delimited header
+ * fields (RFC5424).
+ *
+ * Almost all senders emit timestamps in the fixed layout
+ * "YYYY-MM-DDTHH:MM:SS", so we check and convert that layout in one
+ * go (the first 16 bytes are validated with a handful of SSE2 operations
+ * if the compiler targets SSE2). Anything else is handed to the generic
+ * scalar parser, which also accepts slightly malformed timestamps. The
+ * fast path only accepts strings the scalar parser accepts with the
+ * very same result, tests/hdrscan_fuzz.c verifies this.
+ *
+ * Copyright 2013 Adiscon GmbH.
+ *
+ * This file is part of the rsyslog runtime library.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *       -or-
+ *       see COPYING.ASL20 in the source distribution
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef INCLUDED_HDRSCAN_H
+#define INCLUDED_HDRSCAN_H
+
+#include <stdint.h>
+#if defined(__SSE2__)
+#	include <emmintrin.h>
+#endif
+
+/* date and time part of a timestamp, as obtained by the scanners below */
+struct hdrscan_dt {
+	int year;
+	int month;
+	int day;
+	int hour;
+	int minute;
+	int second;
+};
+
+
+/**
+ * Parse a 32 bit integer number from a string.
+ *
+ * \param ppsz Pointer to the Pointer to the string being parsed. It
+ *             must be positioned at the first digit. Will be updated
+ *             so that on return it points to the first character AFTER
+ *             the integer parsed.
+ * \param pLenStr pointer to string length, decremented on exit by
+ *                characters processed
+ * 		  Note that if an empty string (len < 1) is passed in,
+ * 		  the method always returns zero.
+ * \retval The number parsed.
+ */
+static inline int
+srSLMGParseInt32(uchar** ppsz, int *pLenStr)
+{
+	register int i;
+
+	i = 0;
+	while(*pLenStr > 0 && **ppsz >= '0' && **ppsz <= '9') {
+		i = i * 10 + **ppsz - '0';
+		++(*ppsz);
+		--(*pLenStr);
+	}
+
+	return i;
+}
+
+
+/* generic parser for the "YYYY-MM-DDTHH:MM:SS" part of a RFC3339
+ * timestamp. Returns 1 on success, in which case *ppsz and *pLenStr are
+ * advanced past the seconds. On failure, 0 is returned and the parse
+ * position is undefined.
+ * We take the liberty to accept slightly malformed timestamps e.g. in
+ * the format of 2003-9-1T1:0:0. This doesn't hurt on receiving.
+ */
+static inline int
+hdrScan3339DateTime(uchar **ppsz, int *pLenStr, struct hdrscan_dt *pDt)
+{
+	pDt->year = srSLMGParseInt32(ppsz, pLenStr);
+
+	if(*pLenStr == 0 || *(*ppsz)++ != '-')
+		return 0;
+	--(*pLenStr);
+	pDt->month = srSLMGParseInt32(ppsz, pLenStr);
+	if(pDt->month < 1 || pDt->month > 12)
+		return 0;
+
+	if(*pLenStr == 0 || *(*ppsz)++ != '-')
+		return 0;
+	--(*pLenStr);
+	pDt->day = srSLMGParseInt32(ppsz, pLenStr);
+	if(pDt->day < 1 || pDt->day > 31)
+		return 0;
+
+	if(*pLenStr == 0 || *(*ppsz)++ != 'T')
+		return 0;
+	--(*pLenStr);
+	pDt->hour = srSLMGParseInt32(ppsz, pLenStr);
+	if(pDt->hour < 0 || pDt->hour > 23)
+		return 0;
+
+	if(*pLenStr == 0 || *(*ppsz)++ != ':')
+		return 0;
+	--(*pLenStr);
+	pDt->minute = srSLMGParseInt32(ppsz, pLenStr);
+	if(pDt->minute < 0 || pDt->minute > 59)
+		return 0;
+
+	if(*pLenStr == 0 || *(*ppsz)++ != ':')
+		return 0;
+	--(*pLenStr);
+	pDt->second = srSLMGParseInt32(ppsz, pLenStr);
+	if(pDt->second < 0 || pDt->second > 60)
+		return 0;
+
+	return 1;
+}
+
+
+static inline int
+hdrScanIsDigit(uchar c)
+{
+	return c >= '0' && c <= '9';
+}
+
+#define HDRSCAN_DIG(p, i) ((p)[i] - '0')
+
+/* fast path for the "YYYY-MM-DDTHH:MM:SS" part of a RFC3339 timestamp
+ * in exactly that layout. Returns 1 if p contains such a (valid) part,
+ * which then is 19 bytes long. Returns 0 if the generic parser must be
+ * used; this does not necessarily mean the timestamp is invalid.
+ */
+static inline int
+hdrScan3339DateTimeFixed(uchar *p, int lenStr, struct hdrscan_dt *pDt)
+{
+	/* the 20th char must terminate the seconds, else the generic
+	 * parser would read more digits.
+	 */
+	if(   lenStr < 19 || p[16] != ':' || !hdrScanIsDigit(p[17]) || !hdrScanIsDigit(p[18])
+	   || (lenStr > 19 && hdrScanIsDigit(p[19])))
+		return 0;
+#if defined(__SSE2__)
+	{
+	const __m128i v = _mm_loadu_si128((const __m128i*) p);
+	const __m128i vDig = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+	unsigned maskDig;
+	unsigned maskSep;
+
+	/* unsigned d <= 9 is the same as min(d, 9) == d */
+	maskDig = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(vDig, _mm_set1_epi8(9)), vDig));
+	maskSep = _mm_movemask_epi8(_mm_cmpeq_epi8(v,
+			_mm_setr_epi8(0, 0, 0, 0, '-', 0, 0, '-', 0, 0, 'T', 0, 0, ':', 0, 0)));
+	/* digits at 0-3, 5-6, 8-9, 11-12, 14-15; separators at 4, 7, 10, 13 */
+	if((maskDig & 0xdb6f) != 0xdb6f || (maskSep & 0x2490) != 0x2490)
+		return 0;
+	}
+#else
+	if(   !hdrScanIsDigit(p[0]) || !hdrScanIsDigit(p[1]) || !hdrScanIsDigit(p[2])
+	   || !hdrScanIsDigit(p[3]) || p[4] != '-' || !hdrScanIsDigit(p[5])
+	   || !hdrScanIsDigit(p[6]) || p[7] != '-' || !hdrScanIsDigit(p[8])
+	   || !hdrScanIsDigit(p[9]) || p[10] != 'T' || !hdrScanIsDigit(p[11])
+	   || !hdrScanIsDigit(p[12]) || p[13] != ':' || !hdrScanIsDigit(p[14])
+	   || !hdrScanIsDigit(p[15]))
+		return 0;
+#endif
+	pDt->year = HDRSCAN_DIG(p, 0) * 1000 + HDRSCAN_DIG(p, 1) * 100
+		  + HDRSCAN_DIG(p, 2) * 10 + HDRSCAN_DIG(p, 3);
+	pDt->month = HDRSCAN_DIG(p, 5) * 10 + HDRSCAN_DIG(p, 6);
+	pDt->day = HDRSCAN_DIG(p, 8) * 10 + HDRSCAN_DIG(p, 9);
+	pDt->hour = HDRSCAN_DIG(p, 11) * 10 + HDRSCAN_DIG(p, 12);
+	pDt->minute = HDRSCAN_DIG(p, 14) * 10 + HDRSCAN_DIG(p, 15);
+	pDt->second = HDRSCAN_DIG(p, 17) * 10 + HDRSCAN_DIG(p, 18);
+	if(   pDt->month < 1 || pDt->month > 12 || pDt->day < 1 || pDt->day > 31
+	   || pDt->hour > 23 || pDt->minute > 59 || pDt->second > 60)
+		return 0;
+	return 1;
+}
+#undef HDRSCAN_DIG
+
+
+/* return a bitmask of the positions of character c inside the first
+ * min(lenStr, 64) bytes of p (bit 0 is p[0]).
+ */
+static inline uint64_t
+hdrScanCharMask(uchar *p, int lenStr, uchar c)
+{
+	uint64_t mask = 0;
+	int i = 0;
+#if defined(__SSE2__)
+	const __m128i vc = _mm_set1_epi8(c);
+
+	for( ; i + 16 <= lenStr && i < 64 ; i += 16) {
+		mask |= (uint64_t) (unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(
+				_mm_loadu_si128((const __m128i*) (p + i)), vc)) << i;
+	}
+#endif
+	for( ; i < lenStr && i < 64 ; ++i)
+		if(p[i] == c)
+			mask |= (uint64_t) 1 << i;
+	return mask;
+}
+
+#endif /* #ifndef INCLUDED_HDRSCAN_H */
@@ -0,0 +1,394 @@
+/* jsonw.c
+ * A streaming JSON writer. Values are serialized directly into a
+ * (reusable) byte buffer, so no json-c object tree needs to be built just
+ * to turn it into text afterwards. The output format is exactly what
+ * json-c generates, including its whitespace and escaping rules, so that
+ * output does not change compared to versions that used json-c for
+ * serialization.
+ *
+ * Usage is like this:
+ *	jsonwInit(&w, 256);
+ *	jsonwBeginObject(&w);
+ *	jsonwKey(&w, "msg", 3); jsonwString(&w, pszMsg, lenMsg);
+ *	jsonwEndObject(&w);
+ *	... use w.buf, w.len ...
+ *	jsonwReset(&w); (for next message) or jsonwExit(&w);
+ *
+ * Copyright 2013 Adiscon GmbH.
+ *
+ * This file is part of the rsyslog runtime library.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *       -or-
+ *       see COPYING.ASL20 in the source distribution
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rsyslog.h"
+#include "escscan.h"
+#include "jsonw.h"
+
+
+/* make sure there is room for at least needed more bytes plus the
+ * terminating NUL.
+ */
+static rsRetVal
+jsonwGrow(jsonw_t *pW, size_t needed)
+{
+	uchar *pNew;
+	size_t newSize;
+	DEFiRet;
+
+	newSize = (pW->size == 0) ? 128 : pW->size;
+	while(newSize < pW->len + needed + 1)
+		newSize *= 2;
+	CHKmalloc(pNew = realloc(pW->buf, newSize));
+	pW->buf = pNew;
+	pW->size = newSize;
+
+finalize_it:
+	RETiRet;
+}
+
+
+static inline rsRetVal
+jsonwAdd(jsonw_t *pW, const char *p, size_t len)
+{
+	DEFiRet;
+
+	if(pW->len + len + 1 > pW->size)
+		CHKiRet(jsonwGrow(pW, len));
+	memcpy(pW->buf + pW->len, p, len);
+	pW->len += len;
+	pW->buf[pW->len] = '\0';
+
+finalize_it:
+	RETiRet;
+}
+
+
+/* add a JSON-escaped string (without the quotes). In JSONW_ESC_JSONC
+ * style, we also escape the slash, like json-c does. Clean runs are
+ * located via escScanJSON() and copied as a whole.
+ */
+static rsRetVal
+jsonwAddEscaped(jsonw_t *pW, uchar *p, size_t len, int escStyle)
+{
+	size_t i, iClean;
+	uchar *pSlash;
+	char numbuf[7];
+	DEFiRet;
+
+	i = 0;
+	while(i < len) {
+		iClean = i + escScanJSON(p + i, len - i);
+		if(   escStyle == JSONW_ESC_JSONC
+		   && (pSlash = memchr(p + i, '/', iClean - i)) != NULL)
+			iClean = pSlash - p;
+		if(iClean > i)
+			CHKiRet(jsonwAdd(pW, (char*) p + i, iClean - i));
+		if(iClean == len)
+			break;
+		switch(p[iClean]) {
+		case '\b': CHKiRet(jsonwAdd(pW, "\\b", 2)); break;
+		case '\n': CHKiRet(jsonwAdd(pW, "\\n", 2)); break;
+		case '\r': CHKiRet(jsonwAdd(pW, "\\r", 2)); break;
+		case '\t': CHKiRet(jsonwAdd(pW, "\\t", 2)); break;
+		case '"':  CHKiRet(jsonwAdd(pW, "\\\"", 2)); break;
+		case '\\': CHKiRet(jsonwAdd(pW, "\\\\", 2)); break;
+		case '/':  CHKiRet(jsonwAdd(pW, "\\/", 2)); break;
+		case '\f':
+			if(escStyle == JSONW_ESC_TPL) {
+				CHKiRet(jsonwAdd(pW, "\\f", 2));
+				break;
+			}
+			/*FALLTHROUGH*/
+		default:
+			snprintf(numbuf, sizeof(numbuf),
+				 (escStyle == JSONW_ESC_TPL) ? "\\u%4.4X" : "\\u%4.4x", p[iClean]);
+			CHKiRet(jsonwAdd(pW, numbuf, 6));
+			break;
+		}
+		i = iClean + 1;
+	}
+
+finalize_it:
+	RETiRet;
+}
+
+
+/* emit whatever separator is required in front of a new value */
+static inline rsRetVal
+jsonwBeginValue(jsonw_t *pW)
+{
+	uchar *pState;
+	DEFiRet;
+
+	pState = &pW->state[pW->depth];
+	if(*pState & JSONW_IN_ARRAY) {
+		if(*pState & JSONW_HAVE_ELEM) {
+			CHKiRet(jsonwAdd(pW, ", ", 2));
+		} else {
+			CHKiRet(jsonwAdd(pW, " ", 1));
+		}
+	}
+	*pState |= JSONW_HAVE_ELEM;
+
+finalize_it:
+	RETiRet;
+}
+
+
+static rsRetVal
+jsonwOpen(jsonw_t *pW, char c, uchar type)
+{
+	DEFiRet;
+
+	if(pW->depth == JSONW_MAX_DEPTH)
+		ABORT_FINALIZE(RS_RET_JSONW_NESTING);
+	CHKiRet(jsonwBeginValue(pW));
+	CHKiRet(jsonwAdd(pW, &c, 1));
+	pW->state[++pW->depth] = type;
+
+finalize_it:
+	RETiRet;
+}
+
+
+static rsRetVal
+jsonwClose(jsonw_t *pW, char *pszClose, uchar type)
+{
+	DEFiRet;
+
+	if(pW->depth == 0 || !(pW->state[pW->depth] & type))
+		ABORT_FINALIZE(RS_RET_JSONW_NESTING);
+	CHKiRet(jsonwAdd(pW, pszClose, 2));
+	--pW->depth;
+
+finalize_it:
+	RETiRet;
+}
+
+
+/* initialize a writer, preallocating initSize bytes. The writer object
+ * itself is provided by the caller, usually on the stack or inside its
+ * instance data.
+ */
+rsRetVal
+jsonwInit(jsonw_t *pW, size_t initSize)
+{
+	DEFiRet;
+
+	pW->buf = NULL;
+	pW->size = 0;
+	pW->len = 0;
+	pW->depth = 0;
+	pW->state[0] = 0;
+	if(initSize < 2)
+		initSize = 2;
+	CHKmalloc(pW->buf = malloc(initSize));
+	pW->size = initSize;
+	pW->buf[0] = '\0';
+
+finalize_it:
+	RETiRet;
+}
+
+
+void
+jsonwExit(jsonw_t *pW)
+{
+	free(pW->buf);
+	pW->buf = NULL;
+	pW->size = 0;
+	pW->len = 0;
+}
+
+
+/* hand the buffer over to the caller, who must free() it. The writer
+ * must be re-initialized before it can be used again.
+ */
+uchar *
+jsonwDetach(jsonw_t *pW, size_t *pLen)
+{
+	uchar *buf;
+
+	buf = pW->buf;
+	if(pLen != NULL)
+		*pLen = pW->len;
+	pW->buf = NULL;
+	pW->size = 0;
+	pW->len = 0;
+	return buf;
+}
+
+
+rsRetVal
+jsonwBeginObject(jsonw_t *pW)
+{
+	return jsonwOpen(pW, '{', JSONW_IN_OBJECT);
+}
+
+
+rsRetVal
+jsonwEndObject(jsonw_t *pW)
+{
+	return jsonwClose(pW, " }", JSONW_IN_OBJECT);
+}
+
+
+rsRetVal
+jsonwBeginArray(jsonw_t *pW)
+{
+	return jsonwOpen(pW, '[', JSONW_IN_ARRAY);
+}
+
+
+rsRetVal
+jsonwEndArray(jsonw_t *pW)
+{
+	return jsonwClose(pW, " ]", JSONW_IN_ARRAY);
+}
+
+
+/* write the name of the next member of the current object. Must be
+ * followed by exactly one value.
+ */
+rsRetVal
+jsonwKey(jsonw_t *pW, uchar *key, size_t lenKey)
+{
+	uchar *pState;
+	DEFiRet;
+
+	pState = &pW->state[pW->depth];
+	if(!(*pState & JSONW_IN_OBJECT))
+		ABORT_FINALIZE(RS_RET_JSONW_NESTING);
+	if(*pState & JSONW_HAVE_ELEM)
+		CHKiRet(jsonwAdd(pW, ",", 1));
+	*pState |= JSONW_HAVE_ELEM;
+	CHKiRet(jsonwAdd(pW, " \"", 2));
+	CHKiRet(jsonwAddEscaped(pW, key, lenKey, JSONW_ESC_JSONC));
+	CHKiRet(jsonwAdd(pW, "\": ", 3));
+
+finalize_it:
+	RETiRet;
+}
+
+
+rsRetVal
+jsonwString(jsonw_t *pW, uchar *p, size_t len)
+{
+	DEFiRet;
+
+	CHKiRet(jsonwBeginValue(pW));
+	CHKiRet(jsonwAdd(pW, "\"", 1));
+	CHKiRet(jsonwAddEscaped(pW, p, len, JSONW_ESC_JSONC));
+	CHKiRet(jsonwAdd(pW, "\"", 1));
+
+finalize_it:
+	RETiRet;
+}
+
+
+/* add JSON-escaped text without any framing (quotes, separators). This is
+ * for callers that build the surrounding JSON themselves, like the json and
+ * jsonf template options.
+ */
+rsRetVal
+jsonwEscaped(jsonw_t *pW, uchar *p, size_t len, int escStyle)
+{
+	return jsonwAddEscaped(pW, p, len, escStyle);
+}
+
+
+rsRetVal
+jsonwInt(jsonw_t *pW, int64 n)
+{
+	char numbuf[32];
+	int lenNum;
+	DEFiRet;
+
+	CHKiRet(jsonwBeginValue(pW));
+	lenNum = snprintf(numbuf, sizeof(numbuf), "%lld", (long long) n);
+	CHKiRet(jsonwAdd(pW, numbuf, lenNum));
+
+finalize_it:
+	RETiRet;
+}
+
+
+rsRetVal
+jsonwDouble(jsonw_t *pW, double d)
+{
+	char numbuf[64];
+	int lenNum;
+	DEFiRet;
+
+	CHKiRet(jsonwBeginValue(pW));
+	lenNum = snprintf(numbuf, sizeof(numbuf), "%lf", d);
+	if(lenNum >= (int) sizeof(numbuf))
+		lenNum = sizeof(numbuf) - 1;
+	CHKiRet(jsonwAdd(pW, numbuf, lenNum));
+
+finalize_it:
+	RETiRet;
+}
+
+
+rsRetVal
+jsonwBool(jsonw_t *pW, int b)
+{
+	DEFiRet;
+
+	CHKiRet(jsonwBeginValue(pW));
+	if(b) {
+		CHKiRet(jsonwAdd(pW, "true", 4));
+	} else {
+		CHKiRet(jsonwAdd(pW, "false", 5));
+	}
+
+finalize_it:
+	RETiRet;
+}
+
+
+rsRetVal
+jsonwNull(jsonw_t *pW)
+{
+	DEFiRet;
+
+	CHKiRet(jsonwBeginValue(pW));
+	CHKiRet(jsonwAdd(pW, "null", 4));
+
+finalize_it:
+	RETiRet;
+}
+
+
+/* add an already serialized JSON value as is. The caller is responsible
+ * for it being valid JSON.
+ */
+rsRetVal
+jsonwRaw(jsonw_t *pW, uchar *p, size_t len)
+{
+	DEFiRet;
+
+	CHKiRet(jsonwBeginValue(pW));
+	CHKiRet(jsonwAdd(pW, (char*) p, len));
+
+finalize_it:
+	RETiRet;
+}
@@ -0,0 +1,79 @@
+/* header for jsonw.c
+ *
+ * Copyright 2013 Adiscon GmbH.
+ *
+ * This file is part of the rsyslog runtime library.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *       -or-
+ *       see COPYING.ASL20 in the source distribution
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef INCLUDED_JSONW_H
+#define INCLUDED_JSONW_H
+
+/* maximum nesting level of containers; deeper structures are
+ * rejected with RS_RET_JSONW_NESTING.
+ */
+#define JSONW_MAX_DEPTH 64
+
+/* per-level state */
+#define JSONW_IN_OBJECT	0x01
+#define JSONW_IN_ARRAY	0x02
+#define JSONW_HAVE_ELEM	0x04	/* at least one element written, need separator */
+
+/* escaping styles for strings */
+#define JSONW_ESC_JSONC	0	/* byte-compatible with json-c (escapes the slash) */
+#define JSONW_ESC_TPL	1	/* as the json/jsonf template options always did it */
+
+/* The writer. Output is appended to buf, which is always kept
+ * NUL-terminated. After jsonwReset() the buffer is reused, so a writer
+ * that lives as long as its caller (e.g. a module instance) needs no
+ * allocation at all once it has grown to the typical size.
+ */
+struct jsonw_s {
+	uchar *buf;
+	size_t len;	/* current length, excluding the NUL */
+	size_t size;	/* allocated size of buf */
+	int depth;	/* current nesting level, 0 is top level */
+	uchar state[JSONW_MAX_DEPTH + 1];
+};
+
+/* prototypes */
+rsRetVal jsonwInit(jsonw_t *pW, size_t initSize);
+void jsonwExit(jsonw_t *pW);
+uchar *jsonwDetach(jsonw_t *pW, size_t *pLen);
+rsRetVal jsonwBeginObject(jsonw_t *pW);
+rsRetVal jsonwEndObject(jsonw_t *pW);
+rsRetVal jsonwBeginArray(jsonw_t *pW);
+rsRetVal jsonwEndArray(jsonw_t *pW);
+rsRetVal jsonwKey(jsonw_t *pW, uchar *key, size_t lenKey);
+rsRetVal jsonwString(jsonw_t *pW, uchar *p, size_t len);
+rsRetVal jsonwInt(jsonw_t *pW, int64 n);
+rsRetVal jsonwDouble(jsonw_t *pW, double d);
+rsRetVal jsonwBool(jsonw_t *pW, int b);
+rsRetVal jsonwNull(jsonw_t *pW);
+rsRetVal jsonwRaw(jsonw_t *pW, uchar *p, size_t len);
+rsRetVal jsonwEscaped(jsonw_t *pW, uchar *p, size_t len, int escStyle);
+
+/* discard the current content, but keep the buffer */
+static inline void
+jsonwReset(jsonw_t *pW)
+{
+	pW->len = 0;
+	pW->depth = 0;
+	pW->state[0] = 0;
+	if(pW->buf != NULL)
+		pW->buf[0] = '\0';
+}
+
+#endif /* #ifndef INCLUDED_JSONW_H */
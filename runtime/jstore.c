@@ -0,0 +1,747 @@
+/* jstore.c
+ * A native store for the structured (CEE/JSON) properties of a message.
+ *
+ * All nodes and strings of a store live inside an arena that is allocated
+ * together with the store object. So for the typical message only a
+ * single malloc() is required, no matter how many properties are set.
+ * Arena space is only reclaimed when the store is destructed (or split
+ * off by jstoreMakeWritable()), so replacing values leaves some garbage
+ * behind. Given the short lifetime of messages, this is a good trade-off.
+ *
+ * Member names are hashed once when a node is created; lookups compare
+ * hash and length before doing the actual string compare.
+ *
+ * json-c objects are only used at module boundaries. There are
+ * converters in both directions for that purpose.
+ *
+ * Copyright 2013 Adiscon GmbH.
+ *
+ * This file is part of the rsyslog runtime library.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *       -or-
+ *       see COPYING.ASL20 in the source distribution
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <libestr.h>
+#include <json/json.h>
+/* For struct json_object_iter, should not be necessary in future versions */
+#include <json/json_object_private.h>
+
+#include "rsyslog.h"
+#include "unicode-helper.h"
+#include "jsonw.h"
+#include "jstore.h"
+
+/* all arena allocations are rounded up so that nodes are properly aligned */
+#define JST_ALIGN(len) (((len) + 7) & ~((size_t) 7))
+
+/* FNV-1a, good enough for the short names we deal with */
+static inline unsigned
+jstHash(uchar *p, size_t len)
+{
+	unsigned hash = 2166136261u;
+	size_t i;
+
+	for(i = 0 ; i < len ; ++i) {
+		hash ^= p[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+
+/* allocate memory from the arena. Returns NULL if we are out of memory. */
+static void *
+jstAlloc(jstore_t *pThis, size_t len)
+{
+	jstchunk_t *pChunk;
+	size_t size;
+	void *p;
+
+	len = JST_ALIGN(len);
+	pChunk = pThis->pCurr;
+	if(pChunk->used + len > pChunk->size) {
+		size = pChunk->size * 2;
+		if(size < len)
+			size = len;
+		if((pChunk = malloc(sizeof(jstchunk_t) + size)) == NULL)
+			return NULL;
+		pChunk->pNext = NULL;
+		pChunk->size = size;
+		pChunk->used = 0;
+		pChunk->buf = (uchar*) (pChunk + 1);
+		pThis->pCurr->pNext = pChunk;
+		pThis->pCurr = pChunk;
+	}
+	p = pChunk->buf + pChunk->used;
+	pChunk->used += len;
+	return p;
+}
+
+
+/* create a new node. The key (if any) is copied into the arena directly
+ * behind the node itself.
+ */
+static jstnode_t *
+jstNewNode(jstore_t *pThis, uchar type, uchar *key, size_t lenKey)
+{
+	jstnode_t *pNode;
+
+	pNode = jstAlloc(pThis, sizeof(jstnode_t) + ((key == NULL) ? 0 : lenKey + 1));
+	if(pNode == NULL)
+		return NULL;
+	pNode->pNext = NULL;
+	pNode->type = type;
+	if(key == NULL) {
+		pNode->key = NULL;
+		pNode->lenKey = 0;
+		pNode->hashKey = 0;
+	} else {
+		pNode->key = (uchar*) (pNode + 1);
+		memcpy(pNode->key, key, lenKey);
+		pNode->key[lenKey] = '\0';
+		pNode->lenKey = lenKey;
+		pNode->hashKey = jstHash(key, lenKey);
+	}
+	if(type == JST_OBJECT || type == JST_ARRAY) {
+		pNode->v.c.pFirst = NULL;
+		pNode->v.c.pLast = NULL;
+		pNode->v.c.nElem = 0;
+	}
+	return pNode;
+}
+
+
+static rsRetVal
+jstNewStrNode(jstore_t *pThis, uchar *key, size_t lenKey, uchar *val, size_t lenVal, jstnode_t **ppNode)
+{
+	jstnode_t *pNode;
+	DEFiRet;
+
+	CHKmalloc(pNode = jstNewNode(pThis, JST_STRING, key, lenKey));
+	CHKmalloc(pNode->v.str.psz = jstAlloc(pThis, lenVal + 1));
+	memcpy(pNode->v.str.psz, val, lenVal);
+	pNode->v.str.psz[lenVal] = '\0';
+	pNode->v.str.len = lenVal;
+	*ppNode = pNode;
+
+finalize_it:
+	RETiRet;
+}
+
+
+/* find a member inside an object. If ppPrev is non-NULL, the predecessor
+ * is also returned (for unlinking).
+ */
+static jstnode_t *
+jstFindMember(jstnode_t *pObj, uchar *key, size_t lenKey, unsigned hash, jstnode_t **ppPrev)
+{
+	jstnode_t *pNode;
+	jstnode_t *pPrev = NULL;
+
+	for(pNode = pObj->v.c.pFirst ; pNode != NULL ; pNode = pNode->pNext) {
+		if(   pNode->hashKey == hash
+		   && pNode->lenKey == lenKey
+		   && !memcmp(pNode->key, key, lenKey))
+			break;
+		pPrev = pNode;
+	}
+	if(ppPrev != NULL)
+		*ppPrev = pPrev;
+	return pNode;
+}
+
+
+static inline void
+jstAppend(jstnode_t *pCont, jstnode_t *pNode)
+{
+	pNode->pNext = NULL;
+	if(pCont->v.c.pLast == NULL)
+		pCont->v.c.pFirst = pNode;
+	else
+		pCont->v.c.pLast->pNext = pNode;
+	pCont->v.c.pLast = pNode;
+	++pCont->v.c.nElem;
+}
+
+
+static inline void
+jstUnlink(jstnode_t *pCont, jstnode_t *pPrev, jstnode_t *pNode)
+{
+	if(pPrev == NULL)
+		pCont->v.c.pFirst = pNode->pNext;
+	else
+		pPrev->pNext = pNode->pNext;
+	if(pCont->v.c.pLast == pNode)
+		pCont->v.c.pLast = pPrev;
+	--pCont->v.c.nElem;
+}
+
+
+/* replace pOld by pNew, keeping the member order */
+static inline void
+jstReplace(jstnode_t *pCont, jstnode_t *pPrev, jstnode_t *pOld, jstnode_t *pNew)
+{
+	pNew->pNext = pOld->pNext;
+	if(pPrev == NULL)
+		pCont->v.c.pFirst = pNew;
+	else
+		pPrev->pNext = pNew;
+	if(pCont->v.c.pLast == pOld)
+		pCont->v.c.pLast = pNew;
+}
+
+
+/* move all members of pSrc into pDst. Existing members of the same
+ * name are replaced.
+ */
+static void
+jstMerge(jstnode_t *pDst, jstnode_t *pSrc)
+{
+	jstnode_t *pNode, *pNext, *pOld, *pPrev;
+
+	for(pNode = pSrc->v.c.pFirst ; pNode != NULL ; pNode = pNext) {
+		pNext = pNode->pNext;
+		pOld = jstFindMember(pDst, pNode->key, pNode->lenKey, pNode->hashKey, &pPrev);
+		if(pOld == NULL)
+			jstAppend(pDst, pNode);
+		else
+			jstReplace(pDst, pPrev, pOld, pNode);
+	}
+	pSrc->v.c.pFirst = pSrc->v.c.pLast = NULL;
+	pSrc->v.c.nElem = 0;
+}
+
+
+/* put a (named) value into an object. If an object is assigned to an
+ * existing object, the two are merged. It is forbidden to replace
+ * a container by a plain value.
+ */
+static rsRetVal
+jstPut(jstnode_t *pObj, jstnode_t *pNode)
+{
+	jstnode_t *pOld, *pPrev;
+	DEFiRet;
+
+	pOld = jstFindMember(pObj, pNode->key, pNode->lenKey, pNode->hashKey, &pPrev);
+	if(pOld == NULL) {
+		jstAppend(pObj, pNode);
+	} else if(pOld->type == JST_OBJECT) {
+		if(pNode->type != JST_OBJECT) {
+			DBGPRINTF("jstore: trying to update a container node with "
+				  "a leaf, name is '%s' - forbidden\n", pNode->key);
+			ABORT_FINALIZE(RS_RET_INVLD_SETOP);
+		}
+		jstMerge(pOld, pNode);
+	} else {
+		jstReplace(pObj, pPrev, pOld, pNode);
+	}
+
+finalize_it:
+	RETiRet;
+}
+
+
+/* Walk a property path like "!usr!msg" and return the parent
+ * container as well as the name of the leaf. If bCreate is set,
+ * missing intermediate objects are created - this must only be
+ * done on writable stores!
+ */
+static rsRetVal
+jstFindParent(jstore_t *pThis, uchar *path, size_t lenPath, int bCreate,
+	      jstnode_t **ppParent, uchar **ppLeaf, size_t *pLenLeaf)
+{
+	uchar *p = path;
+	uchar *pEnd = path + lenPath;
+	size_t len;
+	jstnode_t *pParent = pThis->pRoot;
+	jstnode_t *pChild;
+	DEFiRet;
+
+	if(p < pEnd && *p == '!')
+		++p;
+	while(1) {
+		for(len = 0 ; p + len < pEnd && p[len] != '!' ; ++len)
+			/* just skip */;
+		if(p + len == pEnd)
+			break; /* this is the leaf */
+		pChild = jstFindMember(pParent, p, len, jstHash(p, len), NULL);
+		if(pChild == NULL) {
+			if(!bCreate)
+				ABORT_FINALIZE(RS_RET_JNAME_NOTFOUND);
+			CHKmalloc(pChild = jstNewNode(pThis, JST_OBJECT, p, len));
+			jstAppend(pParent, pChild);
+		} else if(pChild->type != JST_OBJECT) {
+			ABORT_FINALIZE(RS_RET_JNAME_INVALID);
+		}
+		pParent = pChild;
+		p += len + 1;
+	}
+
+	*ppParent = pParent;
+	*ppLeaf = p;
+	*pLenLeaf = len;
+
+finalize_it:
+	RETiRet;
+}
+
+
+/* convert a json-c object into store nodes */
+static rsRetVal
+jstFromJSON(jstore_t *pThis, uchar *key, size_t lenKey, struct json_object *json, jstnode_t **ppNode)
+{
+	jstnode_t *pNode = NULL;
+	jstnode_t *pChild;
+	struct json_object_iter it;
+	char *psz;
+	int arrayLen, i;
+	DEFiRet;
+
+	if(json == NULL) {
+		CHKmalloc(pNode = jstNewNode(pThis, JST_NULL, key, lenKey));
+		FINALIZE;
+	}
+
+	switch(json_object_get_type(json)) {
+	case json_type_boolean:
+		CHKmalloc(pNode = jstNewNode(pThis, JST_BOOL, key, lenKey));
+		pNode->v.n = json_object_get_boolean(json) ? 1 : 0;
+		break;
+	case json_type_double:
+		CHKmalloc(pNode = jstNewNode(pThis, JST_DOUBLE, key, lenKey));
+		pNode->v.d = json_object_get_double(json);
+		break;
+	case json_type_int:
+		CHKmalloc(pNode = jstNewNode(pThis, JST_INT, key, lenKey));
+		pNode->v.n = json_object_get_int64(json);
+		break;
+	case json_type_string:
+		psz = (char*) json_object_get_string(json);
+		CHKiRet(jstNewStrNode(pThis, key, lenKey, (uchar*) psz, strlen(psz), &pNode));
+		break;
+	case json_type_object:
+		CHKmalloc(pNode = jstNewNode(pThis, JST_OBJECT, key, lenKey));
+		json_object_object_foreachC(json, it) {
+			CHKiRet(jstFromJSON(pThis, (uchar*) it.key, strlen(it.key), it.val, &pChild));
+			jstAppend(pNode, pChild);
+		}
+		break;
+	case json_type_array:
+		CHKmalloc(pNode = jstNewNode(pThis, JST_ARRAY, key, lenKey));
+		arrayLen = json_object_array_length(json);
+		for(i = 0 ; i < arrayLen ; ++i) {
+			CHKiRet(jstFromJSON(pThis, NULL, 0, json_object_array_get_idx(json, i), &pChild));
+			jstAppend(pNode, pChild);
+		}
+		break;
+	case json_type_null:
+	default:
+		CHKmalloc(pNode = jstNewNode(pThis, JST_NULL, key, lenKey));
+		break;
+	}
+
+finalize_it:
+	*ppNode = pNode;
+	RETiRet;
+}
+
+
+/* copy a node (and all of its descendants) into another store */
+static rsRetVal
+jstCopyNode(jstore_t *pThis, jstnode_t *pSrc, jstnode_t **ppNode)
+{
+	jstnode_t *pNode = NULL;
+	jstnode_t *pChild, *pCopy;
+	DEFiRet;
+
+	if(pSrc->type == JST_STRING) {
+		CHKiRet(jstNewStrNode(pThis, pSrc->key, pSrc->lenKey, pSrc->v.str.psz,
+				      pSrc->v.str.len, &pNode));
+		FINALIZE;
+	}
+	CHKmalloc(pNode = jstNewNode(pThis, pSrc->type, pSrc->key, pSrc->lenKey));
+	switch(pSrc->type) {
+	case JST_OBJECT:
+	case JST_ARRAY:
+		for(pChild = pSrc->v.c.pFirst ; pChild != NULL ; pChild = pChild->pNext) {
+			CHKiRet(jstCopyNode(pThis, pChild, &pCopy));
+			jstAppend(pNode, pCopy);
+		}
+		break;
+	case JST_DOUBLE:
+		pNode->v.d = pSrc->v.d;
+		break;
+	case JST_BOOL:
+	case JST_INT:
+		pNode->v.n = pSrc->v.n;
+		break;
+	default:
+		break;
+	}
+
+finalize_it:
+	*ppNode = pNode;
+	RETiRet;
+}
+
+
+/* Construct a new, empty store. */
+rsRetVal
+jstoreConstruct(jstore_t **ppThis)
+{
+	jstore_t *pThis;
+	DEFiRet;
+
+	CHKmalloc(pThis = malloc(sizeof(jstore_t)));
+	pThis->iRefCount = 1;
+	INIT_ATOMIC_HELPER_MUT(pThis->mutRefCount);
+	pThis->chunk0.pNext = NULL;
+	pThis->chunk0.size = sizeof(pThis->arena);
+	pThis->chunk0.used = 0;
+	pThis->chunk0.buf = pThis->arena;
+	pThis->pCurr = &pThis->chunk0;
+	if((pThis->pRoot = jstNewNode(pThis, JST_OBJECT, NULL, 0)) == NULL) {
+		free(pThis);
+		ABORT_FINALIZE(RS_RET_OUT_OF_MEMORY);
+	}
+	*ppThis = pThis;
+
+finalize_it:
+	RETiRet;
+}
+
+
+jstore_t *
+jstoreAddRef(jstore_t *pThis)
+{
+	ATOMIC_INC(&pThis->iRefCount, &pThis->mutRefCount);
+	return pThis;
+}
+
+
+void
+jstoreDestruct(jstore_t **ppThis)
+{
+	jstore_t *pThis = *ppThis;
+	jstchunk_t *pChunk, *pDel;
+
+	if(ATOMIC_DEC_AND_FETCH(&pThis->iRefCount, &pThis->mutRefCount) == 0) {
+		for(pChunk = pThis->chunk0.pNext ; pChunk != NULL ; ) {
+			pDel = pChunk;
+			pChunk = pChunk->pNext;
+			free(pDel);
+		}
+		DESTROY_ATOMIC_HELPER_MUT(pThis->mutRefCount);
+		free(pThis);
+	}
+	*ppThis = NULL;
+}
+
+
+/* Make sure the caller holds a private copy of the store before it is
+ * modified. If the store is shared, a (compacted) copy is made and the
+ * caller's reference to the shared store is released.
+ */
+rsRetVal
+jstoreMakeWritable(jstore_t **ppThis)
+{
+	jstore_t *pNew = NULL;
+	jstnode_t *pNode, *pCopy;
+	DEFiRet;
+
+	if(ATOMIC_FETCH_32BIT(&(*ppThis)->iRefCount, &(*ppThis)->mutRefCount) == 1)
+		FINALIZE;
+
+	CHKiRet(jstoreConstruct(&pNew));
+	for(pNode = (*ppThis)->pRoot->v.c.pFirst ; pNode != NULL ; pNode = pNode->pNext) {
+		CHKiRet(jstCopyNode(pNew, pNode, &pCopy));
+		jstAppend(pNew->pRoot, pCopy);
+	}
+	jstoreDestruct(ppThis);
+	*ppThis = pNew;
+	pNew = NULL;
+
+finalize_it:
+	if(pNew != NULL)
+		jstoreDestruct(&pNew);
+	RETiRet;
+}
+
+
+/* find the node for a property path (e.g. "!usr!msg"). The path does
+ * not need to be NUL-terminated. Returns NULL if not found.
+ */
+jstnode_t *
+jstoreFind(jstore_t *pThis, uchar *path, size_t lenPath)
+{
+	jstnode_t *pParent;
+	uchar *leaf;
+	size_t lenLeaf;
+
+	if(jstoreIsRootPath(path, lenPath))
+		return pThis->pRoot;
+	if(jstFindParent(pThis, path, lenPath, 0, &pParent, &leaf, &lenLeaf) != RS_RET_OK)
+		return NULL;
+	return jstFindMember(pParent, leaf, lenLeaf, jstHash(leaf, lenLeaf), NULL);
+}
+
+
+/* set a property from a json-c object. If the path is the root, the object
+ * is merged into the root. The json-c object is always consumed.
+ */
+rsRetVal
+jstoreSetJSON(jstore_t *pThis, uchar *path, struct json_object *json)
+{
+	jstnode_t *pParent, *pNode;
+	uchar *leaf;
+	size_t lenLeaf;
+	size_t lenPath;
+	DEFiRet;
+
+	lenPath = ustrlen(path);
+	if(jstoreIsRootPath(path, lenPath)) {
+		if(json == NULL || json_object_get_type(json) != json_type_object)
+			ABORT_FINALIZE(RS_RET_INVLD_SETOP);
+		CHKiRet(jstFromJSON(pThis, NULL, 0, json, &pNode));
+		jstMerge(pThis->pRoot, pNode);
+	} else {
+		CHKiRet(jstFindParent(pThis, path, lenPath, 1, &pParent, &leaf, &lenLeaf));
+		CHKiRet(jstFromJSON(pThis, leaf, lenLeaf, json, &pNode));
+		CHKiRet(jstPut(pParent, pNode));
+	}
+
+finalize_it:
+	if(json != NULL)
+		json_object_put(json);
+	RETiRet;
+}
+
+
+rsRetVal
+jstoreSetStr(jstore_t *pThis, uchar *path, uchar *val, size_t lenVal)
+{
+	jstnode_t *pParent, *pNode;
+	uchar *leaf;
+	size_t lenLeaf;
+	size_t lenPath;
+	DEFiRet;
+
+	lenPath = ustrlen(path);
+	if(jstoreIsRootPath(path, lenPath))
+		ABORT_FINALIZE(RS_RET_INVLD_SETOP);
+	CHKiRet(jstFindParent(pThis, path, lenPath, 1, &pParent, &leaf, &lenLeaf));
+	CHKiRet(jstNewStrNode(pThis, leaf, lenLeaf, val, lenVal, &pNode));
+	CHKiRet(jstPut(pParent, pNode));
+
+finalize_it:
+	RETiRet;
+}
+
+
+rsRetVal
+jstoreSetInt(jstore_t *pThis, uchar *path, int64 n)
+{
+	jstnode_t *pParent, *pNode;
+	uchar *leaf;
+	size_t lenLeaf;
+	size_t lenPath;
+	DEFiRet;
+
+	lenPath = ustrlen(path);
+	if(jstoreIsRootPath(path, lenPath))
+		ABORT_FINALIZE(RS_RET_INVLD_SETOP);
+	CHKiRet(jstFindParent(pThis, path, lenPath, 1, &pParent, &leaf, &lenLeaf));
+	CHKmalloc(pNode = jstNewNode(pThis, JST_INT, leaf, lenLeaf));
+	pNode->v.n = n;
+	CHKiRet(jstPut(pParent, pNode));
+
+finalize_it:
+	RETiRet;
+}
+
+
+/* delete a property. Deleting the root removes all properties. */
+rsRetVal
+jstoreDel(jstore_t *pThis, uchar *path)
+{
+	jstnode_t *pParent, *pNode, *pPrev;
+	uchar *leaf;
+	size_t lenLeaf;
+	size_t lenPath;
+	DEFiRet;
+
+	lenPath = ustrlen(path);
+	if(jstoreIsRootPath(path, lenPath)) {
+		pThis->pRoot->v.c.pFirst = pThis->pRoot->v.c.pLast = NULL;
+		pThis->pRoot->v.c.nElem = 0;
+		FINALIZE;
+	}
+	CHKiRet(jstFindParent(pThis, path, lenPath, 0, &pParent, &leaf, &lenLeaf));
+	pNode = jstFindMember(pParent, leaf, lenLeaf, jstHash(leaf, lenLeaf), &pPrev);
+	if(pNode == NULL)
+		ABORT_FINALIZE(RS_RET_JNAME_NOTFOUND);
+	jstUnlink(pParent, pPrev, pNode);
+
+finalize_it:
+	RETiRet;
+}
+
+
+/* convert a node into a json-c object. This is meant to be used at
+ * module boundaries only. The caller receives a new reference.
+ */
+struct json_object *
+jstoreNodeToJSON(jstnode_t *pNode)
+{
+	struct json_object *json = NULL;
+	jstnode_t *pChild;
+
+	switch(pNode->type) {
+	case JST_BOOL:
+		json = json_object_new_boolean((json_bool) pNode->v.n);
+		break;
+	case JST_DOUBLE:
+		json = json_object_new_double(pNode->v.d);
+		break;
+	case JST_INT:
+		json = json_object_new_int64(pNode->v.n);
+		break;
+	case JST_STRING:
+		json = json_object_new_string_len((char*) pNode->v.str.psz, pNode->v.str.len);
+		break;
+	case JST_OBJECT:
+		json = json_object_new_object();
+		for(pChild = pNode->v.c.pFirst ; pChild != NULL ; pChild = pChild->pNext)
+			json_object_object_add(json, (char*) pChild->key, jstoreNodeToJSON(pChild));
+		break;
+	case JST_ARRAY:
+		json = json_object_new_array();
+		for(pChild = pNode->v.c.pFirst ; pChild != NULL ; pChild = pChild->pNext)
+			json_object_array_add(json, jstoreNodeToJSON(pChild));
+		break;
+	case JST_NULL:
+	default:
+		break;
+	}
+	return json;
+}
+
+
+/* serialize a node as JSON text into the provided writer.
+ * The format is the same json-c generates.
+ */
+rsRetVal
+jstoreNodeToJSONW(jstnode_t *pNode, jsonw_t *pW)
+{
+	jstnode_t *pChild;
+	DEFiRet;
+
+	switch(pNode->type) {
+	case JST_BOOL:
+		CHKiRet(jsonwBool(pW, pNode->v.n != 0));
+		break;
+	case JST_DOUBLE:
+		CHKiRet(jsonwDouble(pW, pNode->v.d));
+		break;
+	case JST_INT:
+		CHKiRet(jsonwInt(pW, pNode->v.n));
+		break;
+	case JST_STRING:
+		CHKiRet(jsonwString(pW, pNode->v.str.psz, pNode->v.str.len));
+		break;
+	case JST_OBJECT:
+		CHKiRet(jsonwBeginObject(pW));
+		for(pChild = pNode->v.c.pFirst ; pChild != NULL ; pChild = pChild->pNext) {
+			CHKiRet(jsonwKey(pW, pChild->key, pChild->lenKey));
+			CHKiRet(jstoreNodeToJSONW(pChild, pW));
+		}
+		CHKiRet(jsonwEndObject(pW));
+		break;
+	case JST_ARRAY:
+		CHKiRet(jsonwBeginArray(pW));
+		for(pChild = pNode->v.c.pFirst ; pChild != NULL ; pChild = pChild->pNext)
+			CHKiRet(jstoreNodeToJSONW(pChild, pW));
+		CHKiRet(jsonwEndArray(pW));
+		break;
+	case JST_NULL:
+	default:
+		CHKiRet(jsonwNull(pW));
+		break;
+	}
+
+finalize_it:
+	RETiRet;
+}
+
+
+/* obtain the string value of a node, as it is used inside templates.
+ * Strings are handed out directly from the arena, so no copy is made
+ * for them. Containers are returned in their JSON representation, null
+ * values as empty string.
+ */
+rsRetVal
+jstoreNodeGetStr(jstnode_t *pNode, uchar **ppRes, rs_size_t *pLen, unsigned short *pbMustBeFreed)
+{
+	jsonw_t w;
+	int bHaveWriter = 0;
+	char numbuf[64];
+	DEFiRet;
+
+	switch(pNode->type) {
+	case JST_STRING:
+		*ppRes = pNode->v.str.psz;
+		*pLen = pNode->v.str.len;
+		*pbMustBeFreed = 0;
+		break;
+	case JST_BOOL:
+		*ppRes = pNode->v.n ? UCHAR_CONSTANT("true") : UCHAR_CONSTANT("false");
+		*pLen = pNode->v.n ? 4 : 5;
+		*pbMustBeFreed = 0;
+		break;
+	case JST_INT:
+	case JST_DOUBLE:
+		if(pNode->type == JST_INT)
+			*pLen = snprintf(numbuf, sizeof(numbuf), "%lld", pNode->v.n);
+		else
+			*pLen = snprintf(numbuf, sizeof(numbuf), "%lf", pNode->v.d);
+		CHKmalloc(*ppRes = (uchar*) strdup(numbuf));
+		*pbMustBeFreed = 1;
+		break;
+	case JST_OBJECT:
+	case JST_ARRAY:
+		CHKiRet(jsonwInit(&w, 256));
+		bHaveWriter = 1;
+		CHKiRet(jstoreNodeToJSONW(pNode, &w));
+		*pLen = w.len;
+		*ppRes = jsonwDetach(&w, NULL);
+		*pbMustBeFreed = 1;
+		break;
+	case JST_NULL:
+	default:
+		*ppRes = UCHAR_CONSTANT("");
+		*pLen = 0;
+		*pbMustBeFreed = 0;
+		break;
+	}
+
+finalize_it:
+	if(bHaveWriter)
+		jsonwExit(&w);
+	RETiRet;
+}
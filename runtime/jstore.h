@@ -0,0 +1,106 @@
+/* header for jstore.c
+ *
+ * Copyright 2013 Adiscon GmbH.
+ *
+ * This file is part of the rsyslog runtime library.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *       -or-
+ *       see COPYING.ASL20 in the source distribution
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef INCLUDED_JSTORE_H
+#define INCLUDED_JSTORE_H
+#include <json/json.h>
+#include <libestr.h>
+#include "atomic.h"
+
+/* node types, order follows json-c's enum json_type */
+#define JST_NULL	0
+#define JST_BOOL	1
+#define JST_DOUBLE	2
+#define JST_INT		3
+#define JST_OBJECT	4
+#define JST_ARRAY	5
+#define JST_STRING	6
+
+/* size of the arena that is allocated together with the store. Most
+ * messages carry only a handful of properties, so they need just this
+ * single allocation.
+ */
+#define JSTORE_INLINE_SIZE 1024
+
+struct jstnode_s {
+	jstnode_t *pNext;	/* next sibling inside the parent container */
+	uchar *key;		/* member name, NUL-terminated (NULL for array elements) */
+	unsigned lenKey;
+	unsigned hashKey;	/* computed once when the node is created */
+	uchar type;		/* one of JST_* */
+	union {
+		int64 n;	/* JST_INT and JST_BOOL */
+		double d;
+		struct {
+			uchar *psz;	/* NUL-terminated, but may contain NUL */
+			unsigned len;
+		} str;
+		struct {
+			jstnode_t *pFirst;
+			jstnode_t *pLast;
+			unsigned nElem;
+		} c;		/* JST_OBJECT and JST_ARRAY */
+	} v;
+};
+
+typedef struct jstchunk_s jstchunk_t;
+struct jstchunk_s {
+	jstchunk_t *pNext;
+	size_t size;
+	size_t used;
+	uchar *buf;
+};
+
+/* The store itself. It is reference-counted so that duplicated messages
+ * can share it. A shared store is read-only, writers must call
+ * jstoreMakeWritable() first, which splits off a private (and compacted)
+ * copy if needed.
+ */
+struct jstore_s {
+	int iRefCount;
+	DEF_ATOMIC_HELPER_MUT(mutRefCount);
+	jstnode_t *pRoot;	/* always a JST_OBJECT */
+	jstchunk_t *pCurr;	/* chunk we currently allocate from */
+	jstchunk_t chunk0;	/* first chunk, describes arena below */
+	uchar arena[JSTORE_INLINE_SIZE];
+};
+
+/* prototypes */
+rsRetVal jstoreConstruct(jstore_t **ppThis);
+jstore_t *jstoreAddRef(jstore_t *pThis);
+void jstoreDestruct(jstore_t **ppThis);
+rsRetVal jstoreMakeWritable(jstore_t **ppThis);
+jstnode_t *jstoreFind(jstore_t *pThis, uchar *path, size_t lenPath);
+rsRetVal jstoreSetJSON(jstore_t *pThis, uchar *path, struct json_object *json);
+rsRetVal jstoreSetStr(jstore_t *pThis, uchar *path, uchar *val, size_t lenVal);
+rsRetVal jstoreSetInt(jstore_t *pThis, uchar *path, int64 n);
+rsRetVal jstoreDel(jstore_t *pThis, uchar *path);
+struct json_object *jstoreNodeToJSON(jstnode_t *pNode);
+rsRetVal jstoreNodeToJSONW(jstnode_t *pNode, jsonw_t *pW);
+rsRetVal jstoreNodeGetStr(jstnode_t *pNode, uchar **ppRes, rs_size_t *pLen, unsigned short *pbMustBeFreed);
+
+/* check if a path denotes the root object ("!" or empty) */
+static inline int
+jstoreIsRootPath(uchar *path, size_t lenPath)
+{
+	return lenPath == 0 || (lenPath == 1 && path[0] == '!');
+}
+
+#endif /* #ifndef INCLUDED_JSTORE_H */
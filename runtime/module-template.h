@@ -587,6 +587,14 @@ static rsRetVal queryEtryPt(uchar *name, rsRetVal (**pEtryPoint)())\
 		*pEtryPoint = GetParserName;\
 	}
 
+/* the following block is to be added for parser modules that
+ * support the (optional) batch entry point.
+ */
+#define CODEqueryEtryPt_STD_PMOD_BATCH_QUERIES \
+	  else if(!strcmp((char*) name, "parseBatch")) {\
+		*pEtryPoint = parseBatch;\
+	}
+
 /* the following definition is the standard block for queryEtryPt for Strgen
  * modules. This can be used if no specific handling (e.g. to cover version
  * differences) is needed.
@@ -953,6 +961,26 @@ static rsRetVal parse(msg_t *pMsg)\
 }
 
 
+/* parseBatch() - optional batch entry point of parser modules
+ * Receives all messages of a batch that are to be tried by this parser.
+ * The per-message result (with the same semantics as the return code of
+ * parse()) must be stored in pRet[i]. This permits modules to do setup
+ * work once per batch instead of once per message.
+ */
+#define BEGINparseBatch \
+static rsRetVal parseBatch(msg_t **ppMsg, int nMsgs, rsRetVal *pRet)\
+{\
+	DEFiRet;
+
+#define CODESTARTparseBatch \
+	assert(ppMsg != NULL);\
+	assert(pRet != NULL);
+
+#define ENDparseBatch \
+	RETiRet;\
+}
+
+
 /* strgen() - main entry point of parser modules
  */
 #define BEGINstrgen \
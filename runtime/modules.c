@@ -689,6 +689,11 @@ doModInit(rsRetVal (*modInit)(int, int*, rsRetVal(**)(), rsRetVal(*)(), modInfo_
 			CHKiRet(objUse(parser, CORE_COMPONENT));
 			/* here, we create a new parser object */
 			CHKiRet((*pNew->modQueryEtryPt)((uchar*)"parse", &pNew->mod.pm.parse));
+			localRet = (*pNew->modQueryEtryPt)((uchar*)"parseBatch", &pNew->mod.pm.parseBatch);
+			if(localRet == RS_RET_MODULE_ENTRY_POINT_NOT_FOUND)
+				pNew->mod.pm.parseBatch = NULL;
+			else if(localRet != RS_RET_OK)
+				ABORT_FINALIZE(localRet);
 			CHKiRet((*pNew->modQueryEtryPt)((uchar*)"GetParserName", &GetName));
 			CHKiRet(GetName(&pName));
 			CHKiRet(parser.Construct(&pParser));
@@ -846,6 +851,7 @@ static void modPrintList(void)
 		case eMOD_PARSER:
 			dbgprintf("Parser Module Entry Points\n");
 			dbgprintf("\tparse:              0x%lx\n", (unsigned long) pMod->mod.pm.parse);
+			dbgprintf("\tparseBatch:         0x%lx\n", (unsigned long) pMod->mod.pm.parseBatch);
 			break;
 		case eMOD_STRGEN:
 			dbgprintf("Strgen Module Entry Points\n");
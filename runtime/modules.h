@@ -148,6 +148,7 @@ struct modInfo_s {
 		} lm;
 		struct { /* data for parser modules */
 			rsRetVal (*parse)(msg_t*);
+			rsRetVal (*parseBatch)(msg_t**, int, rsRetVal*); /* optional, may be NULL */
 		} pm;
 		struct { /* data for strgen modules */
 			rsRetVal (*strgen)(msg_t*, uchar**, size_t *);
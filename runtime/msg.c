@@ -47,9 +47,6 @@
 #if HAVE_MALLOC_H
 #  include <malloc.h>
 #endif
-#ifdef USE_LIBUUID
-  #include <uuid/uuid.h>
-#endif
 #include "rsyslog.h"
 #include "srUtils.h"
 #include "stringbuf.h"
@@ -65,6 +62,8 @@
 #include "net.h"
 #include "var.h"
 #include "rsconf.h"
+#include "escscan.h"
+#include "jsonw.h"
 
 /* static data */
 DEFobjStaticHelpers
@@ -284,9 +283,6 @@ static struct {
 	{ UCHAR_CONSTANT("190"), 5},
 	{ UCHAR_CONSTANT("191"), 5}
 	};
-static char hexdigit[16] =
-	{'0', '1', '2', '3', '4', '5', '6', '7', '8',
-	 '9', 'A', 'B', 'C', 'D', 'E', 'F' };
 
 /*syslog facility names (as of RFC5424) */
 static char *syslog_fac_names[24] = { "kern", "user", "mail", "daemon", "auth", "syslog", "lpr",
@@ -314,12 +310,64 @@ static char *syslog_number_names[24] = { "0", "1", "2", "3", "4", "5", "6", "7",
 #if defined(HAVE_MALLOC_TRIM) && !defined(HAVE_ATOMIC_BUILTINS)
 static pthread_mutex_t mutTrimCtr;	 /* mutex to handle malloc trim */
 #endif
+#ifndef HAVE_ATOMIC_BUILTINS
+static pthread_mutex_t mutMsgBuf;	 /* mutex to handle shared buffer refcounts */
+#endif
 
 /* some forward declarations */
 static int getAPPNAMELen(msg_t *pM, sbool bLockMutex);
-static rsRetVal jsonPathFindParent(msg_t *pM, uchar *name, uchar *leaf, struct json_object **parent, int bCreate);
-static uchar * jsonPathGetLeaf(uchar *name, int lenName);
-static struct json_object *jsonDeepCopy(struct json_object *src);
+static void msgDoResolveLazy(msg_t *pM, int iFields);
+static rsRetVal msgGetJSONStr(msg_t *pM, uchar **ppsz, rs_size_t *pLen,
+			      unsigned short *pbMustBeFreed, sbool bLockMutex);
+
+
+/* Field buffers that do not fit into the msg_t-included fixed buffers
+ * (raw message, long HOSTNAME and TAG) carry a reference counter in front
+ * of the data. That way, MsgDup() can share them instead of copying the
+ * (potentially large) content. A buffer shared by more than one message
+ * is read-only: all setters below allocate a new buffer if they find a
+ * shared one, so the duplicate is split off on first write (copy-on-write).
+ * Note that parsers modify the raw message in place, but they only work
+ * on freshly received messages, which never share their buffer.
+ */
+typedef struct msgBufHdr_s {
+	int iRefCount;
+	int dummy;	/* keep data 8-byte aligned */
+} msgBufHdr_t;
+#define msgBufHdr(p) ((msgBufHdr_t*) ((p) - sizeof(msgBufHdr_t)))
+
+static inline uchar *
+msgBufAlloc(size_t len)
+{
+	msgBufHdr_t *pHdr;
+
+	if((pHdr = MALLOC(sizeof(msgBufHdr_t) + len)) == NULL)
+		return NULL;
+	pHdr->iRefCount = 1;
+	return (uchar*) pHdr + sizeof(msgBufHdr_t);
+}
+
+static inline uchar *
+msgBufAddRef(uchar *p)
+{
+	ATOMIC_INC(&msgBufHdr(p)->iRefCount, &mutMsgBuf);
+	return p;
+}
+
+static inline void
+msgBufFree(uchar *p)
+{
+	if(p == NULL)
+		return;
+	if(ATOMIC_DEC_AND_FETCH(&msgBufHdr(p)->iRefCount, &mutMsgBuf) == 0)
+		free(msgBufHdr(p));
+}
+
+static inline int
+msgBufIsShared(uchar *p)
+{
+	return ATOMIC_FETCH_32BIT(&msgBufHdr(p)->iRefCount, &mutMsgBuf) > 1;
+}
 
 
 /* the locking and unlocking implementations: */
@@ -337,6 +385,23 @@ MsgUnlock(msg_t *pThis)
 }
 
 
+/* make sure the header fields in bitmask iFields (MSG_LAZY_BIT) are
+ * extracted, if the parser has only recorded their location.
+ */
+static inline void
+msgResolveLazy(msg_t *pM, int iFields, sbool bLockMutex)
+{
+	if((pM->lazyPending & iFields) == 0)
+		return;
+	if(bLockMutex == LOCK_MUTEX)
+		MsgLock(pM);
+	/* re-check inside msgDoResolveLazy, things may have changed while unlocked */
+	msgDoResolveLazy(pM, iFields);
+	if(bLockMutex == LOCK_MUTEX)
+		MsgUnlock(pM);
+}
+
+
 /* set RcvFromIP name in msg object WITHOUT calling AddRef.
  * rgerhards, 2013-01-22
  */
@@ -691,14 +756,8 @@ static inline rsRetVal msgBaseConstruct(msg_t **ppThis)
 	pM->iLenHOSTNAME = 0;
 	pM->pszRawMsg = NULL;
 	pM->pszHOSTNAME = NULL;
-	pM->pszRcvdAt3164 = NULL;
-	pM->pszRcvdAt3339 = NULL;
-	pM->pszRcvdAt_MySQL = NULL;
-        pM->pszRcvdAt_PgSQL = NULL;
 	pM->pszTIMESTAMP3164 = NULL;
 	pM->pszTIMESTAMP3339 = NULL;
-	pM->pszTIMESTAMP_MySQL = NULL;
-        pM->pszTIMESTAMP_PgSQL = NULL;
 	pM->pCSStrucData = NULL;
 	pM->pCSAPPNAME = NULL;
 	pM->pCSPROCID = NULL;
@@ -707,17 +766,26 @@ static inline rsRetVal msgBaseConstruct(msg_t **ppThis)
 	pM->pRcvFromIP = NULL;
 	pM->rcvFrom.pRcvFrom = NULL;
 	pM->pRuleset = NULL;
-	pM->json = NULL;
+	pM->pJStore = NULL;
+	pM->pszJSONStr = NULL;
 	memset(&pM->tRcvdAt, 0, sizeof(pM->tRcvdAt));
 	memset(&pM->tTIMESTAMP, 0, sizeof(pM->tTIMESTAMP));
 	pM->TAG.pszTAG = NULL;
 	pM->pszTimestamp3164[0] = '\0';
 	pM->pszTimestamp3339[0] = '\0';
+	pM->pszTIMESTAMP_MySQL[0] = '\0';
+	pM->pszTIMESTAMP_PgSQL[0] = '\0';
+	pM->pszRcvdAt3164[0] = '\0';
+	pM->pszRcvdAt3339[0] = '\0';
+	pM->pszRcvdAt_MySQL[0] = '\0';
+	pM->pszRcvdAt_PgSQL[0] = '\0';
 	pM->pszTIMESTAMP_SecFrac[0] = '\0';
 	pM->pszRcvdAt_SecFrac[0] = '\0';
 	pM->pszTIMESTAMP_Unix[0] = '\0';
 	pM->pszRcvdAt_Unix[0] = '\0';
-	pM->pszUUID = NULL;
+	pM->pszUUID[0] = '\0';
+	pM->lazyPending = 0;
+	pM->iModCount = 0;
 	pthread_mutex_init(&pM->mut, NULL);
 
 	/* DEV debugging only! dbgprintf("msgConstruct\t0x%x, ref 1\n", (int)pM);*/
@@ -768,8 +836,10 @@ rsRetVal msgConstruct(msg_t **ppThis)
 	 * to obtain a timestamp. The memcpy() should not really make a difference,
 	 * especially as I think there is no codepath currently where it would not be
 	 * required (after I have cleaned up the pathes ;)). -- rgerhards, 2008-10-02
+	 * This is called for each message inputs like imfile create, so we use the
+	 * cached time service.
 	 */
-	datetime.getCurrTime(&((*ppThis)->tRcvdAt), &((*ppThis)->ttGenTime));
+	datetime.getCurrTimeCached(&((*ppThis)->tRcvdAt), &((*ppThis)->ttGenTime), glbl.GetCoarseClock());
 	memcpy(&(*ppThis)->tTIMESTAMP, &(*ppThis)->tRcvdAt, sizeof(struct syslogTime));
 
 finalize_it:
@@ -796,12 +866,17 @@ msgConstructForDeserializer(msg_t **ppThis)
 static inline void freeTAG(msg_t *pThis)
 {
 	if(pThis->iLenTAG >= CONF_TAG_BUFSIZE)
-		free(pThis->TAG.pszTAG);
+		msgBufFree(pThis->TAG.pszTAG);
 }
 static inline void freeHOSTNAME(msg_t *pThis)
 {
 	if(pThis->iLenHOSTNAME >= CONF_HOSTNAME_BUFSIZE)
-		free(pThis->pszHOSTNAME);
+		msgBufFree(pThis->pszHOSTNAME);
+}
+static inline void freeRawMsg(msg_t *pThis)
+{
+	if(pThis->pszRawMsg != pThis->szRawMsg)
+		msgBufFree(pThis->pszRawMsg);
 }
 
 
@@ -821,8 +896,7 @@ CODESTARTobjDestruct(msg)
 	if(currRefCount == 0)
 	{
 		/* DEV Debugging Only! dbgprintf("msgDestruct\t0x%lx, RefCount now 0, doing DESTROY\n", (unsigned long)pThis); */
-		if(pThis->pszRawMsg != pThis->szRawMsg)
-			free(pThis->pszRawMsg);
+		freeRawMsg(pThis);
 		freeTAG(pThis);
 		freeHOSTNAME(pThis);
 		if(pThis->pInputName != NULL)
@@ -835,12 +909,6 @@ CODESTARTobjDestruct(msg)
 		}
 		if(pThis->pRcvFromIP != NULL)
 			prop.Destruct(&pThis->pRcvFromIP);
-		free(pThis->pszRcvdAt3164);
-		free(pThis->pszRcvdAt3339);
-		free(pThis->pszRcvdAt_MySQL);
-		free(pThis->pszRcvdAt_PgSQL);
-		free(pThis->pszTIMESTAMP_MySQL);
-		free(pThis->pszTIMESTAMP_PgSQL);
 		if(pThis->iLenPROGNAME >= CONF_PROGNAME_BUFSIZE)
 			free(pThis->PROGNAME.ptr);
 		if(pThis->pCSStrucData != NULL)
@@ -851,10 +919,9 @@ CODESTARTobjDestruct(msg)
 			rsCStrDestruct(&pThis->pCSPROCID);
 		if(pThis->pCSMSGID != NULL)
 			rsCStrDestruct(&pThis->pCSMSGID);
-		if(pThis->json != NULL)
-			json_object_put(pThis->json);
-		if(pThis->pszUUID != NULL)
-			free(pThis->pszUUID);
+		if(pThis->pJStore != NULL)
+			jstoreDestruct(&pThis->pJStore);
+		free(pThis->pszJSONStr);
 #	ifndef HAVE_ATOMIC_BUILTINS
 		MsgUnlock(pThis);
 # 	endif
@@ -892,12 +959,9 @@ ENDobjDestruct(msg)
  * to keep the fuction code somewhat more readyble. It is my
  * replacement for inline functions in CPP
  */
-#define tmpCOPYSZ(name) \
+#define tmpSHARESZ(name) \
 	if(pOld->psz##name != NULL) { \
-		if((pNew->psz##name = srUtilStrDup(pOld->psz##name, pOld->iLen##name)) == NULL) {\
-			msgDestruct(&pNew);\
-			return NULL;\
-		}\
+		pNew->psz##name = msgBufAddRef(pOld->psz##name); \
 		pNew->iLen##name = pOld->iLen##name;\
 	}
 
@@ -919,6 +983,10 @@ ENDobjDestruct(msg)
  * can never run into a situation where the message object is being
  * modified while its content is copied - it's forbidden by definition.
  * rgerhards, 2007-07-10
+ * The duplicate is copy-on-write: heap buffers (raw message, long TAG and
+ * HOSTNAME) as well as the structured properties are shared with the
+ * original and only split off when one of the messages modifies them.
+ * Everything that lives inside msg_t itself is simply copied.
  */
 msg_t* MsgDup(msg_t* pOld)
 {
@@ -971,18 +1039,14 @@ msg_t* MsgDup(msg_t* pOld)
 		if(pOld->iLenTAG < CONF_TAG_BUFSIZE) {
 			memcpy(pNew->TAG.szBuf, pOld->TAG.szBuf, pOld->iLenTAG + 1);
 		} else {
-			if((pNew->TAG.pszTAG = srUtilStrDup(pOld->TAG.pszTAG, pOld->iLenTAG)) == NULL) {
-				msgDestruct(&pNew);
-				return NULL;
-			}
-			pNew->iLenTAG = pOld->iLenTAG;
+			pNew->TAG.pszTAG = msgBufAddRef(pOld->TAG.pszTAG);
 		}
 	}
-	if(pOld->iLenRawMsg < CONF_RAWMSG_BUFSIZE) {
+	if(pOld->pszRawMsg == pOld->szRawMsg) {
 		memcpy(pNew->szRawMsg, pOld->szRawMsg, pOld->iLenRawMsg + 1);
 		pNew->pszRawMsg = pNew->szRawMsg;
 	} else {
-		tmpCOPYSZ(RawMsg);
+		tmpSHARESZ(RawMsg);
 	}
 	if(pOld->pszHOSTNAME == NULL) {
 		pNew->pszHOSTNAME = NULL;
@@ -991,7 +1055,7 @@ msg_t* MsgDup(msg_t* pOld)
 			memcpy(pNew->szHOSTNAME, pOld->szHOSTNAME, pOld->iLenHOSTNAME + 1);
 			pNew->pszHOSTNAME = pNew->szHOSTNAME;
 		} else {
-			tmpCOPYSZ(HOSTNAME);
+			tmpSHARESZ(HOSTNAME);
 		}
 	}
 
@@ -999,9 +1063,16 @@ msg_t* MsgDup(msg_t* pOld)
 	tmpCOPYCSTR(APPNAME);
 	tmpCOPYCSTR(PROCID);
 	tmpCOPYCSTR(MSGID);
+	/* not yet extracted header fields refer to the raw message, which is identical */
+	pNew->lazyPending = pOld->lazyPending;
+	if(pOld->lazyPending != 0) {
+		memcpy(pNew->lazyOff, pOld->lazyOff, sizeof(pNew->lazyOff));
+		memcpy(pNew->lazyLen, pOld->lazyLen, sizeof(pNew->lazyLen));
+	}
 
-	if(pOld->json != NULL)
-		pNew->json = jsonDeepCopy(pOld->json);
+	/* structured properties are shared, the store is split on first write */
+	if(pOld->pJStore != NULL)
+		pNew->pJStore = jstoreAddRef(pOld->pJStore);
 
 	/* we do not copy all other cache properties, as we do not even know
 	 * if they are needed once again. So we let them re-create if needed.
@@ -1010,7 +1081,7 @@ msg_t* MsgDup(msg_t* pOld)
 	ENDfunc
 	return pNew;
 }
-#undef tmpCOPYSZ
+#undef tmpSHARESZ
 #undef tmpCOPYCSTR
 
 
@@ -1030,11 +1101,18 @@ static rsRetVal MsgSerialize(msg_t *pThis, strm_t *pStrm)
 {
 	uchar *psz;
 	int len;
+	uchar *pszJSON;
+	rs_size_t lenJSON;
+	unsigned short bJSONMustBeFreed;
+	rsRetVal localRet;
+	uchar szUUID[UUIDGEN_LEN_HEX + 1];
 	DEFiRet;
 
 	assert(pThis != NULL);
 	assert(pStrm != NULL);
 
+	msgResolveLazy(pThis, MSG_LAZY_ALL, LOCK_MUTEX);
+
 	/* then serialize elements */
 	CHKiRet(obj.BeginSerialize(pStrm, (obj_t*) pThis));
 	objSerializeSCALAR(pStrm, iProtocolVersion, SHORT);
@@ -1056,9 +1134,12 @@ static rsRetVal MsgSerialize(msg_t *pThis, strm_t *pStrm)
 	CHKiRet(obj.SerializeProp(pStrm, UCHAR_CONSTANT("pszRcvFrom"), PROPTYPE_PSZ, (void*) psz));
 	psz = getRcvFromIP(pThis); 
 	CHKiRet(obj.SerializeProp(pStrm, UCHAR_CONSTANT("pszRcvFromIP"), PROPTYPE_PSZ, (void*) psz));
-	if(pThis->json != NULL) {
-		psz = (uchar*) json_object_get_string(pThis->json);
-		CHKiRet(obj.SerializeProp(pStrm, UCHAR_CONSTANT("json"), PROPTYPE_PSZ, (void*) psz));
+	if(pThis->pJStore != NULL) {
+		CHKiRet(msgGetJSONStr(pThis, &pszJSON, &lenJSON, &bJSONMustBeFreed, LOCK_MUTEX));
+		localRet = obj.SerializeProp(pStrm, UCHAR_CONSTANT("json"), PROPTYPE_PSZ, (void*) pszJSON);
+		if(bJSONMustBeFreed)
+			free(pszJSON);
+		CHKiRet(localRet);
 	}
 
 	objSerializePTR(pStrm, pCSStrucData, CSTR);
@@ -1066,7 +1147,12 @@ static rsRetVal MsgSerialize(msg_t *pThis, strm_t *pStrm)
 	objSerializePTR(pStrm, pCSPROCID, CSTR);
 	objSerializePTR(pStrm, pCSMSGID, CSTR);
 	
-	objSerializePTR(pStrm, pszUUID, PSZ);
+	/* the uuid may be generated by a different thread (see getUUID()) */
+	MsgLock(pThis);
+	memcpy(szUUID, pThis->pszUUID, sizeof(szUUID));
+	MsgUnlock(pThis);
+	if(szUUID[0] != '\0')
+		CHKiRet(obj.SerializeProp(pStrm, UCHAR_CONSTANT("pszUUID"), PROPTYPE_PSZ, szUUID));
 
 	if(pThis->pRuleset != NULL) {
 		rulesetGetName(pThis->pRuleset);
@@ -1199,6 +1285,8 @@ MsgDeserialize(msg_t *pMsg, strm_t *pStrm)
 		tokener = json_tokener_new();
 		json = json_tokener_parse_ex(tokener, (char*)rsCStrGetSzStrNoNULL(pVar->val.pStr),
 					     cstrLen(pVar->val.pStr));
+		json_tokener_free(tokener);
+		msgAddJSON(pMsg, (uchar*)"!", json);
 		reinitVar(pVar);
 		CHKiRet(objDeserializeProperty(pVar, pStrm));
 	}
@@ -1223,7 +1311,8 @@ MsgDeserialize(msg_t *pMsg, strm_t *pStrm)
 		CHKiRet(objDeserializeProperty(pVar, pStrm));
 	}
 	if(isProp("pszUUID")) {
-		pMsg->pszUUID = ustrdup(rsCStrGetSzStrNoNULL(pVar->val.pStr));
+		strncpy((char*) pMsg->pszUUID, (char*) rsCStrGetSzStrNoNULL(pVar->val.pStr), UUIDGEN_LEN_HEX);
+		pMsg->pszUUID[UUIDGEN_LEN_HEX] = '\0';
 		reinitVar(pVar);
 		CHKiRet(objDeserializeProperty(pVar, pStrm));
 	}
@@ -1295,6 +1384,7 @@ static rsRetVal aquirePROCIDFromTAG(msg_t *pM)
 	if(getProtocolVersion(pM) != 0)
 		return RS_RET_OK; /* we can only emulate if we have legacy format */
 
+	msgResolveLazy(pM, MSG_LAZY_BIT(MSG_LAZY_TAG), MUTEX_ALREADY_LOCKED);
 	pszTag = (uchar*) ((pM->iLenTAG < CONF_TAG_BUFSIZE) ? pM->TAG.szBuf : pM->TAG.pszTAG);
 
 	/* find first '['... */
@@ -1353,6 +1443,7 @@ aquireProgramName(msg_t *pM)
 	DEFiRet;
 
 	assert(pM != NULL);
+	msgResolveLazy(pM, MSG_LAZY_BIT(MSG_LAZY_TAG), MUTEX_ALREADY_LOCKED);
 	pszTag = (uchar*) ((pM->iLenTAG < CONF_TAG_BUFSIZE) ? pM->TAG.szBuf : pM->TAG.pszTAG);
 	for(  i = 0
 	    ; (i < pM->iLenTAG) && isprint((int) pszTag[i])
@@ -1394,59 +1485,25 @@ char *getProtocolVersionString(msg_t *pM)
 }
 
 #ifdef USE_LIBUUID
-/* note: libuuid seems not to be thread-safe, so we need
- * to get some safeguards in place.
+/* The uuid is generated on first use. uuidgen works with per-thread
+ * state, so no global lock is needed. The message lock must be held for
+ * the check, too: the uuid is written in place, so a reader that does not
+ * synchronize with the writer could see a partially generated uuid. Once
+ * set, the uuid never changes, so it can be used after unlocking.
  */
-static void msgSetUUID(msg_t *pM)
-{
-	size_t lenRes = sizeof(uuid_t) * 2 + 1;
-	char hex_char [] = "0123456789ABCDEF";
-	unsigned int byte_nbr;
-	uuid_t uuid;
-	static pthread_mutex_t mutUUID = PTHREAD_MUTEX_INITIALIZER;
-
-	dbgprintf("[MsgSetUUID] START\n");
-	assert(pM != NULL);
-
-	if((pM->pszUUID = (uchar*) MALLOC(lenRes)) == NULL) {
-		pM->pszUUID = (uchar *)"";
-	} else {
-		pthread_mutex_lock(&mutUUID);
-		uuid_generate(uuid);
-		pthread_mutex_unlock(&mutUUID);
-		for (byte_nbr = 0; byte_nbr < sizeof (uuid_t); byte_nbr++) {
-			pM->pszUUID[byte_nbr * 2 + 0] = hex_char[uuid [byte_nbr] >> 4];
-			pM->pszUUID[byte_nbr * 2 + 1] = hex_char[uuid [byte_nbr] & 15];
-		}
-
-		dbgprintf("[MsgSetUUID] UUID : %s LEN: %d \n", pM->pszUUID, (int)lenRes);
-		pM->pszUUID[lenRes] = '\0';
-	}
-	dbgprintf("[MsgSetUUID] END\n");
-}
-
 void getUUID(msg_t *pM, uchar **pBuf, int *piLen)
 {
-	dbgprintf("[getUUID] START\n");
 	if(pM == NULL) {
-		dbgprintf("[getUUID] pM is NULL\n");
 		*pBuf=	UCHAR_CONSTANT("");
 		*piLen = 0;
 	} else {
-		if(pM->pszUUID == NULL) {
-			dbgprintf("[getUUID] pM->pszUUID is NULL\n");
-			MsgLock(pM);
-			/* re-query, things may have changed in the mean time... */
-			if(pM->pszUUID == NULL)
-				msgSetUUID(pM);
-			MsgUnlock(pM);
-		} else { /* UUID already there we reuse it */
-			dbgprintf("[getUUID] pM->pszUUID already exists\n");
-		}
+		MsgLock(pM);
+		if(pM->pszUUID[0] == '\0')
+			uuidgenGenerateHex(pM->pszUUID);
+		MsgUnlock(pM);
 		*pBuf = pM->pszUUID;
-		*piLen = sizeof(uuid_t) * 2;
+		*piLen = UUIDGEN_LEN_HEX;
 	}
-	dbgprintf("[getUUID] END\n");
 }
 #endif
 
@@ -1474,6 +1531,7 @@ getRawMsg(msg_t *pM, uchar **pBuf, int *piLen)
 void setMSGLen(msg_t *pM, int lenMsg)
 {
 	pM->iLenMSG = lenMsg;
+	MsgSetModified(pM);
 }
 
 int getMSGLen(msg_t *pM)
@@ -1542,26 +1600,18 @@ getTimeReported(msg_t *pM, enum tplFormatTypes eFmt)
 		return(pM->pszTIMESTAMP3164);
 	case tplFmtMySQLDate:
 		MsgLock(pM);
-		if(pM->pszTIMESTAMP_MySQL == NULL) {
-			if((pM->pszTIMESTAMP_MySQL = MALLOC(15)) == NULL) {
-				MsgUnlock(pM);
-				return "";
-			}
+		if(pM->pszTIMESTAMP_MySQL[0] == '\0') {
 			datetime.formatTimestampToMySQL(&pM->tTIMESTAMP, pM->pszTIMESTAMP_MySQL);
 		}
 		MsgUnlock(pM);
 		return(pM->pszTIMESTAMP_MySQL);
-        case tplFmtPgSQLDate:
-                MsgLock(pM);
-                if(pM->pszTIMESTAMP_PgSQL == NULL) {
-                        if((pM->pszTIMESTAMP_PgSQL = MALLOC(21)) == NULL) {
-                                MsgUnlock(pM);
-                                return "";
-                        }
-                        datetime.formatTimestampToPgSQL(&pM->tTIMESTAMP, pM->pszTIMESTAMP_PgSQL);
-                }
-                MsgUnlock(pM);
-                return(pM->pszTIMESTAMP_PgSQL);
+	case tplFmtPgSQLDate:
+		MsgLock(pM);
+		if(pM->pszTIMESTAMP_PgSQL[0] == '\0') {
+			datetime.formatTimestampToPgSQL(&pM->tTIMESTAMP, pM->pszTIMESTAMP_PgSQL);
+		}
+		MsgUnlock(pM);
+		return(pM->pszTIMESTAMP_PgSQL);
 	case tplFmtRFC3339Date:
 		MsgLock(pM);
 		if(pM->pszTIMESTAMP3339 == NULL) {
@@ -1601,45 +1651,29 @@ static inline char *getTimeGenerated(msg_t *pM, enum tplFormatTypes eFmt)
 	switch(eFmt) {
 	case tplFmtDefault:
 		MsgLock(pM);
-		if(pM->pszRcvdAt3164 == NULL) {
-			if((pM->pszRcvdAt3164 = MALLOC(16)) == NULL) {
-				MsgUnlock(pM);
-				return "";
-			}
+		if(pM->pszRcvdAt3164[0] == '\0') {
 			datetime.formatTimestamp3164(&pM->tRcvdAt, pM->pszRcvdAt3164, 0);
 		}
 		MsgUnlock(pM);
 		return(pM->pszRcvdAt3164);
 	case tplFmtMySQLDate:
 		MsgLock(pM);
-		if(pM->pszRcvdAt_MySQL == NULL) {
-			if((pM->pszRcvdAt_MySQL = MALLOC(15)) == NULL) {
-				MsgUnlock(pM);
-				return "";
-			}
+		if(pM->pszRcvdAt_MySQL[0] == '\0') {
 			datetime.formatTimestampToMySQL(&pM->tRcvdAt, pM->pszRcvdAt_MySQL);
 		}
 		MsgUnlock(pM);
 		return(pM->pszRcvdAt_MySQL);
-        case tplFmtPgSQLDate:
-                MsgLock(pM);
-                if(pM->pszRcvdAt_PgSQL == NULL) {
-                        if((pM->pszRcvdAt_PgSQL = MALLOC(21)) == NULL) {
-                                MsgUnlock(pM);
-                                return "";
-                        }
-                        datetime.formatTimestampToPgSQL(&pM->tRcvdAt, pM->pszRcvdAt_PgSQL);
-                }
-                MsgUnlock(pM);
-                return(pM->pszRcvdAt_PgSQL);
+	case tplFmtPgSQLDate:
+		MsgLock(pM);
+		if(pM->pszRcvdAt_PgSQL[0] == '\0') {
+			datetime.formatTimestampToPgSQL(&pM->tRcvdAt, pM->pszRcvdAt_PgSQL);
+		}
+		MsgUnlock(pM);
+		return(pM->pszRcvdAt_PgSQL);
 	case tplFmtRFC3164Date:
 	case tplFmtRFC3164BuggyDate:
 		MsgLock(pM);
-		if(pM->pszRcvdAt3164 == NULL) {
-			if((pM->pszRcvdAt3164 = MALLOC(16)) == NULL) {
-					MsgUnlock(pM);
-					return "";
-				}
+		if(pM->pszRcvdAt3164[0] == '\0') {
 			datetime.formatTimestamp3164(&pM->tRcvdAt, pM->pszRcvdAt3164,
 						     (eFmt == tplFmtRFC3164BuggyDate));
 		}
@@ -1647,11 +1681,7 @@ static inline char *getTimeGenerated(msg_t *pM, enum tplFormatTypes eFmt)
 		return(pM->pszRcvdAt3164);
 	case tplFmtRFC3339Date:
 		MsgLock(pM);
-		if(pM->pszRcvdAt3339 == NULL) {
-			if((pM->pszRcvdAt3339 = MALLOC(33)) == NULL) {
-				MsgUnlock(pM);
-				return "";
-			}
+		if(pM->pszRcvdAt3339[0] == '\0') {
 			datetime.formatTimestamp3339(&pM->tRcvdAt, pM->pszRcvdAt3339);
 		}
 		MsgUnlock(pM);
@@ -1791,6 +1821,7 @@ rsRetVal MsgSetAPPNAME(msg_t *pMsg, char* pszAPPNAME)
 	}
 	/* if we reach this point, we have the object */
 	iRet = rsCStrSetSzStr(pMsg->pCSAPPNAME, (uchar*) pszAPPNAME);
+	pMsg->lazyPending &= ~MSG_LAZY_BIT(MSG_LAZY_APPNAME);
 
 finalize_it:
 	RETiRet;
@@ -1810,6 +1841,7 @@ rsRetVal MsgSetPROCID(msg_t *pMsg, char* pszPROCID)
 	/* if we reach this point, we have the object */
 	CHKiRet(rsCStrSetSzStr(pMsg->pCSPROCID, (uchar*) pszPROCID));
 	CHKiRet(cstrFinalize(pMsg->pCSPROCID));
+	pMsg->lazyPending &= ~MSG_LAZY_BIT(MSG_LAZY_PROCID);
 
 finalize_it:
 	RETiRet;
@@ -1855,6 +1887,7 @@ char *getPROCID(msg_t *pM, sbool bLockMutex)
 	ISOBJ_TYPE_assert(pM, msg);
 	if(bLockMutex == LOCK_MUTEX)
 		MsgLock(pM);
+	msgResolveLazy(pM, MSG_LAZY_BIT(MSG_LAZY_PROCID), MUTEX_ALREADY_LOCKED);
 	preparePROCID(pM, MUTEX_ALREADY_LOCKED);
 	if(pM->pCSPROCID == NULL)
 		pszRet = UCHAR_CONSTANT("-");
@@ -1878,6 +1911,7 @@ rsRetVal MsgSetMSGID(msg_t *pMsg, char* pszMSGID)
 	}
 	/* if we reach this point, we have the object */
 	iRet = rsCStrSetSzStr(pMsg->pCSMSGID, (uchar*) pszMSGID);
+	pMsg->lazyPending &= ~MSG_LAZY_BIT(MSG_LAZY_MSGID);
 
 finalize_it:
 	RETiRet;
@@ -1897,6 +1931,7 @@ static inline char *getParseSuccess(msg_t *pM)
  */
 static inline char *getMSGID(msg_t *pM)
 {
+	msgResolveLazy(pM, MSG_LAZY_BIT(MSG_LAZY_MSGID), LOCK_MUTEX);
 	if (pM->pCSMSGID == NULL) {
 		return "-"; 
 	}
@@ -1914,6 +1949,7 @@ void MsgSetParseSuccess(msg_t *pMsg, int bSuccess)
 {
 	assert(pMsg != NULL);
 	pMsg->bParseSuccess = bSuccess;
+	MsgSetModified(pMsg);
 }
 
 /* rgerhards 2009-06-12: set associated ruleset
@@ -1940,7 +1976,7 @@ void MsgSetTAG(msg_t *pMsg, uchar* pszBuf, size_t lenBuf)
 		/* small enough: use fixed buffer (faster!) */
 		pBuf = pMsg->TAG.szBuf;
 	} else {
-		if((pBuf = (uchar*) MALLOC(pMsg->iLenTAG + 1)) == NULL) {
+		if((pBuf = msgBufAlloc(pMsg->iLenTAG + 1)) == NULL) {
 			/* truncate message, better than completely loosing it... */
 			pBuf = pMsg->TAG.szBuf;
 			pMsg->iLenTAG = CONF_TAG_BUFSIZE - 1;
@@ -1951,6 +1987,7 @@ void MsgSetTAG(msg_t *pMsg, uchar* pszBuf, size_t lenBuf)
 
 	memcpy(pBuf, pszBuf, pMsg->iLenTAG);
 	pBuf[pMsg->iLenTAG] = '\0'; /* this also works with truncation! */
+	pMsg->lazyPending &= ~MSG_LAZY_BIT(MSG_LAZY_TAG);
 }
 
 
@@ -1969,6 +2006,7 @@ static inline void tryEmulateTAG(msg_t *pM, sbool bLockMutex)
 
 	if(bLockMutex == LOCK_MUTEX)
 		MsgLock(pM);
+	msgResolveLazy(pM, MSG_LAZY_BIT(MSG_LAZY_TAG), MUTEX_ALREADY_LOCKED);
 	if(pM->iLenTAG > 0) {
 		if(bLockMutex == LOCK_MUTEX)
 			MsgUnlock(pM);
@@ -1999,6 +2037,7 @@ getTAG(msg_t *pM, uchar **ppBuf, int *piLen)
 		*ppBuf = UCHAR_CONSTANT("");
 		*piLen = 0;
 	} else {
+		msgResolveLazy(pM, MSG_LAZY_BIT(MSG_LAZY_TAG), LOCK_MUTEX);
 		if(pM->iLenTAG == 0)
 			tryEmulateTAG(pM, LOCK_MUTEX);
 		if(pM->iLenTAG == 0) {
@@ -2016,15 +2055,15 @@ int getHOSTNAMELen(msg_t *pM)
 {
 	if(pM == NULL)
 		return 0;
-	else
-		if(pM->pszHOSTNAME == NULL) {
-			resolveDNS(pM);
-			if(pM->rcvFrom.pRcvFrom == NULL)
-				return 0;
-			else
-				return prop.GetStringLen(pM->rcvFrom.pRcvFrom);
-		} else
-			return pM->iLenHOSTNAME;
+	msgResolveLazy(pM, MSG_LAZY_BIT(MSG_LAZY_HOSTNAME), LOCK_MUTEX);
+	if(pM->pszHOSTNAME == NULL) {
+		resolveDNS(pM);
+		if(pM->rcvFrom.pRcvFrom == NULL)
+			return 0;
+		else
+			return prop.GetStringLen(pM->rcvFrom.pRcvFrom);
+	} else
+		return pM->iLenHOSTNAME;
 }
 
 
@@ -2032,20 +2071,20 @@ char *getHOSTNAME(msg_t *pM)
 {
 	if(pM == NULL)
 		return "";
-	else
-		if(pM->pszHOSTNAME == NULL) {
-			resolveDNS(pM);
-			if(pM->rcvFrom.pRcvFrom == NULL) {
-				return "";
-			} else {
-				uchar *psz;
-				int len;
-				prop.GetString(pM->rcvFrom.pRcvFrom, &psz, &len);
-				return (char*) psz;
-			}
+	msgResolveLazy(pM, MSG_LAZY_BIT(MSG_LAZY_HOSTNAME), LOCK_MUTEX);
+	if(pM->pszHOSTNAME == NULL) {
+		resolveDNS(pM);
+		if(pM->rcvFrom.pRcvFrom == NULL) {
+			return "";
 		} else {
-			return (char*) pM->pszHOSTNAME;
+			uchar *psz;
+			int len;
+			prop.GetString(pM->rcvFrom.pRcvFrom, &psz, &len);
+			return (char*) psz;
 		}
+	} else {
+		return (char*) pM->pszHOSTNAME;
+	}
 }
 
 
@@ -2081,6 +2120,7 @@ rsRetVal MsgSetStructuredData(msg_t *pMsg, char* pszStrucData)
 	}
 	/* if we reach this point, we have the object */
 	iRet = rsCStrSetSzStr(pMsg->pCSStrucData, (uchar*) pszStrucData);
+	pMsg->lazyPending &= ~MSG_LAZY_BIT(MSG_LAZY_STRUCDATA);
 
 finalize_it:
 	RETiRet;
@@ -2105,6 +2145,7 @@ static inline char *getStructuredData(msg_t *pM)
 	uchar *pszRet;
 
 	MsgLock(pM);
+	msgResolveLazy(pM, MSG_LAZY_BIT(MSG_LAZY_STRUCDATA), MUTEX_ALREADY_LOCKED);
 	if(pM->pCSStrucData == NULL)
 		pszRet = UCHAR_CONSTANT("-");
 	else 
@@ -2181,6 +2222,7 @@ char *getAPPNAME(msg_t *pM, sbool bLockMutex)
 	assert(pM != NULL);
 	if(bLockMutex == LOCK_MUTEX)
 		MsgLock(pM);
+	msgResolveLazy(pM, MSG_LAZY_BIT(MSG_LAZY_APPNAME), MUTEX_ALREADY_LOCKED);
 	prepareAPPNAME(pM, MUTEX_ALREADY_LOCKED);
 	if(pM->pCSAPPNAME == NULL)
 		pszRet = UCHAR_CONSTANT("");
@@ -2196,6 +2238,7 @@ char *getAPPNAME(msg_t *pM, sbool bLockMutex)
 static int getAPPNAMELen(msg_t *pM, sbool bLockMutex)
 {
 	assert(pM != NULL);
+	msgResolveLazy(pM, MSG_LAZY_BIT(MSG_LAZY_APPNAME), bLockMutex);
 	prepareAPPNAME(pM, bLockMutex);
 	return (pM->pCSAPPNAME == NULL) ? 0 : rsCStrLen(pM->pCSAPPNAME);
 }
@@ -2326,7 +2369,7 @@ void MsgSetHOSTNAME(msg_t *pThis, uchar* pszHOSTNAME, int lenHOSTNAME)
 	if(pThis->iLenHOSTNAME < CONF_HOSTNAME_BUFSIZE) {
 		/* small enough: use fixed buffer (faster!) */
 		pThis->pszHOSTNAME = pThis->szHOSTNAME;
-	} else if((pThis->pszHOSTNAME = (uchar*) MALLOC(pThis->iLenHOSTNAME + 1)) == NULL) {
+	} else if((pThis->pszHOSTNAME = msgBufAlloc(pThis->iLenHOSTNAME + 1)) == NULL) {
 		/* truncate message, better than completely loosing it... */
 		pThis->pszHOSTNAME = pThis->szHOSTNAME;
 		pThis->iLenHOSTNAME = CONF_HOSTNAME_BUFSIZE - 1;
@@ -2334,6 +2377,7 @@ void MsgSetHOSTNAME(msg_t *pThis, uchar* pszHOSTNAME, int lenHOSTNAME)
 
 	memcpy(pThis->pszHOSTNAME, pszHOSTNAME, pThis->iLenHOSTNAME);
 	pThis->pszHOSTNAME[pThis->iLenHOSTNAME] = '\0'; /* this also works with truncation! */
+	pThis->lazyPending &= ~MSG_LAZY_BIT(MSG_LAZY_HOSTNAME);
 }
 
 
@@ -2365,23 +2409,30 @@ void MsgSetMSGoffs(msg_t *pMsg, short offs)
  * (hopefully) relatively seldom being called, so some performance impact is
  * uncritical. In any case, pszMSG is copied, so if it was dynamically allocated,
  * the caller is responsible for freeing it.
+ * If the raw message buffer is shared with a duplicate (see MsgDup()), we
+ * always need a new buffer, as the shared one must not be modified.
  * rgerhards, 2009-06-23
  */
 rsRetVal MsgReplaceMSG(msg_t *pThis, uchar* pszMSG, int lenMSG)
 {
 	int lenNew;
 	uchar *bufNew;
+	int bShared;
 	DEFiRet;
 	ISOBJ_TYPE_assert(pThis, msg);
 	assert(pszMSG != NULL);
 
 	lenNew = pThis->iLenRawMsg + lenMSG - pThis->iLenMSG;
-	if(lenMSG > pThis->iLenMSG && lenNew >= CONF_RAWMSG_BUFSIZE) {
+	bShared = pThis->pszRawMsg != pThis->szRawMsg && msgBufIsShared(pThis->pszRawMsg);
+	if(bShared || (lenMSG > pThis->iLenMSG && lenNew >= CONF_RAWMSG_BUFSIZE)) {
 		/*  we have lost our "bet" and need to alloc a new buffer ;) */
-		CHKmalloc(bufNew = MALLOC(lenNew + 1));
+		if(lenNew < CONF_RAWMSG_BUFSIZE) {
+			bufNew = pThis->szRawMsg;
+		} else {
+			CHKmalloc(bufNew = msgBufAlloc(lenNew + 1));
+		}
 		memcpy(bufNew, pThis->pszRawMsg, pThis->offMSG);
-		if(pThis->pszRawMsg != pThis->szRawMsg)
-			free(pThis->pszRawMsg);
+		freeRawMsg(pThis);
 		pThis->pszRawMsg = bufNew;
 	}
 
@@ -2390,11 +2441,132 @@ rsRetVal MsgReplaceMSG(msg_t *pThis, uchar* pszMSG, int lenMSG)
 	pThis->pszRawMsg[lenNew] = '\0'; /* this also works with truncation! */
 	pThis->iLenRawMsg = lenNew;
 	pThis->iLenMSG = lenMSG;
+	MsgSetModified(pThis);
 
 finalize_it:
 	RETiRet;
 }
 
+/* Make sure the raw message buffer may be modified in place. If it is
+ * shared with a duplicate (see MsgDup()), a private copy is created, so
+ * that the other messages are not affected. Everything that writes into
+ * pszRawMsg directly (e.g. via getMSG()) must call this first. Note that
+ * pointers into the raw message obtained before the call become invalid.
+ */
+rsRetVal
+MsgMakeRawMsgWritable(msg_t *pThis)
+{
+	uchar *bufNew;
+	DEFiRet;
+	ISOBJ_TYPE_assert(pThis, msg);
+
+	if(   pThis->pszRawMsg == NULL
+	   || pThis->pszRawMsg == pThis->szRawMsg
+	   || !msgBufIsShared(pThis->pszRawMsg))
+		FINALIZE;
+
+	CHKmalloc(bufNew = msgBufAlloc(pThis->iLenRawMsg + 1));
+	memcpy(bufNew, pThis->pszRawMsg, pThis->iLenRawMsg + 1);
+	freeRawMsg(pThis);
+	pThis->pszRawMsg = bufNew;
+
+finalize_it:
+	RETiRet;
+}
+
+/* Obtain MSG for modification in place. The raw buffer is made private
+ * (see MsgMakeRawMsgWritable()) and the message is flagged as modified, so
+ * that strings rendered from it before are not reused. The caller may
+ * change at most getMSGLen() bytes; if MSG is shortened, setMSGLen() must
+ * be called afterwards.
+ */
+rsRetVal
+MsgGetWritableMSG(msg_t *pThis, uchar **ppMsg)
+{
+	DEFiRet;
+	CHKiRet(MsgMakeRawMsgWritable(pThis));
+	MsgSetModified(pThis);
+	*ppMsg = getMSG(pThis);
+finalize_it:
+	RETiRet;
+}
+
+/* Record the location of a header field inside the raw message instead of
+ * extracting it. Parsers use this so that fields which are never used by
+ * any template or filter do not need to be copied. The field is extracted
+ * by msgDoResolveLazy() on first access. offs and len are relative to
+ * pszRawMsg, which must not be modified in that range afterwards.
+ */
+void MsgSetLazyField(msg_t *pMsg, int iField, int offs, int len)
+{
+	assert(pMsg != NULL);
+	assert(iField >= 0 && iField < MSG_LAZY_NUMFIELDS);
+	assert(offs >= 0 && offs + len <= pMsg->iLenRawMsg);
+	pMsg->lazyOff[iField] = offs;
+	pMsg->lazyLen[iField] = len;
+	pMsg->lazyPending |= MSG_LAZY_BIT(iField);
+}
+
+
+/* extract all pending header fields given in iFields from the raw message.
+ * Must be called with the message locked (or during construction). Note that
+ * the pending bit is only cleared after the field is set, because
+ * msgResolveLazy() checks it without holding the lock.
+ */
+static void
+msgDoResolveLazy(msg_t *pM, int iFields)
+{
+	int i;
+	int len;
+	uchar *p;
+	char *psz;
+	char szBuf[CONF_TAG_MAXSIZE];
+
+	for(i = 0 ; i < MSG_LAZY_NUMFIELDS ; ++i) {
+		if((pM->lazyPending & iFields & MSG_LAZY_BIT(i)) == 0)
+			continue;
+		p = pM->pszRawMsg + pM->lazyOff[i];
+		len = pM->lazyLen[i];
+		if(i == MSG_LAZY_HOSTNAME) {
+			MsgSetHOSTNAME(pM, p, len);
+		} else if(i == MSG_LAZY_TAG) {
+			MsgSetTAG(pM, p, len);
+		} else {
+			/* the cstr-based setters need a NUL-terminated string */
+			if(len < (int) sizeof(szBuf)) {
+				psz = szBuf;
+			} else if((psz = malloc(len + 1)) == NULL) {
+				DBGPRINTF("msgDoResolveLazy: out of memory, field %d lost\n", i);
+				pM->lazyPending &= ~MSG_LAZY_BIT(i);
+				continue;
+			}
+			memcpy(psz, p, len);
+			psz[len] = '\0';
+			switch(i) {
+			case MSG_LAZY_APPNAME:
+				MsgSetAPPNAME(pM, psz);
+				break;
+			case MSG_LAZY_PROCID:
+				MsgSetPROCID(pM, psz);
+				break;
+			case MSG_LAZY_MSGID:
+				MsgSetMSGID(pM, psz);
+				break;
+			case MSG_LAZY_STRUCDATA:
+				MsgSetStructuredData(pM, psz);
+				break;
+			}
+			if(psz != szBuf)
+				free(psz);
+		}
+		/* the setters clear the bit once the field is in place, this makes
+		 * sure we do not retry a failed one over and over again.
+		 */
+		pM->lazyPending &= ~MSG_LAZY_BIT(i);
+	}
+}
+
+
 /* set raw message in message object. Size of message is provided.
  * The function makes sure that the stored rawmsg is properly
  * terminated by '\0'.
@@ -2403,14 +2575,15 @@ finalize_it:
 void MsgSetRawMsg(msg_t *pThis, char* pszRawMsg, size_t lenMsg)
 {
 	assert(pThis != NULL);
-	if(pThis->pszRawMsg != pThis->szRawMsg)
-		free(pThis->pszRawMsg);
+	/* pending header fields point into the old buffer, get them out first */
+	msgResolveLazy(pThis, MSG_LAZY_ALL, MUTEX_ALREADY_LOCKED);
+	freeRawMsg(pThis);
 
 	pThis->iLenRawMsg = lenMsg;
 	if(pThis->iLenRawMsg < CONF_RAWMSG_BUFSIZE) {
 		/* small enough: use fixed buffer (faster!) */
 		pThis->pszRawMsg = pThis->szRawMsg;
-	} else if((pThis->pszRawMsg = (uchar*) MALLOC(pThis->iLenRawMsg + 1)) == NULL) {
+	} else if((pThis->pszRawMsg = msgBufAlloc(pThis->iLenRawMsg + 1)) == NULL) {
 		/* truncate message, better than completely loosing it... */
 		pThis->pszRawMsg = pThis->szRawMsg;
 		pThis->iLenRawMsg = CONF_RAWMSG_BUFSIZE - 1;
@@ -2510,38 +2683,145 @@ static uchar *getNOW(eNOWType eNow, struct syslogTime *t)
 #undef tmpBUFSIZE /* clean up */
 
 
+/* find a property and return a json-c rendition of it. Modules that need
+ * json-c (e.g. via tplToJSON() or $!-variables in RainerScript) only get the
+ * subtree they ask for converted, core processing works on the native store.
+ * The object is private to the caller, which must release it via
+ * json_object_put(). It is not shared between callers, as json-c's reference
+ * counts and its cached string form are not thread-safe. Returns NULL if
+ * not found.
+ * Must be called with the message locked.
+ */
+static struct json_object *
+msgFindJSONView(msg_t *pM, es_str_t *propName)
+{
+	jstnode_t *pNode;
+
+	if(pM->pJStore == NULL)
+		return NULL;
+	if(jstoreIsRootPath(es_getBufAddr(propName), es_strlen(propName)))
+		pNode = pM->pJStore->pRoot;
+	else
+		pNode = jstoreFind(pM->pJStore, es_getBufAddr(propName), es_strlen(propName));
+	return (pNode == NULL) ? NULL : jstoreNodeToJSON(pNode);
+}
+
+
+/* drop the serialized form of the structured properties, which is
+ * outdated as soon as the store is modified.
+ * Must be called with the message locked.
+ */
+static inline void
+msgInvalidateJSONCaches(msg_t *pM)
+{
+	if(pM->pszJSONStr != NULL) {
+		free(pM->pszJSONStr);
+		pM->pszJSONStr = NULL;
+	}
+}
+
+
+/* obtain the structured properties as JSON text ($!all-json). It is
+ * serialized on first use and kept until the properties are modified,
+ * so multiple actions (and the disk queue) share a single serialization.
+ * As the cached text is dropped by the next modification, which may be
+ * done by a different thread, the caller receives a private copy. It
+ * must be freed if *pbMustBeFreed is set.
+ */
+static rsRetVal
+msgGetJSONStr(msg_t *pM, uchar **ppsz, rs_size_t *pLen, unsigned short *pbMustBeFreed,
+	      sbool bLockMutex)
+{
+	jsonw_t w;
+	int bHaveWriter = 0;
+	DEFiRet;
+
+	*pbMustBeFreed = 0;
+	if(bLockMutex == LOCK_MUTEX)
+		MsgLock(pM);
+	if(pM->pJStore == NULL) {
+		*ppsz = UCHAR_CONSTANT("{}");
+		*pLen = 2;
+		FINALIZE;
+	}
+	if(pM->pszJSONStr == NULL) {
+		CHKiRet(jsonwInit(&w, 256));
+		bHaveWriter = 1;
+		CHKiRet(jstoreNodeToJSONW(pM->pJStore->pRoot, &w));
+		pM->lenJSONStr = w.len;
+		pM->pszJSONStr = jsonwDetach(&w, NULL);
+	}
+	CHKmalloc(*ppsz = MALLOC(pM->lenJSONStr + 1));
+	memcpy(*ppsz, pM->pszJSONStr, pM->lenJSONStr + 1);
+	*pLen = pM->lenJSONStr;
+	*pbMustBeFreed = 1;
+
+finalize_it:
+	if(bLockMutex == LOCK_MUTEX)
+		MsgUnlock(pM);
+	if(bHaveWriter)
+		jsonwExit(&w);
+	RETiRet;
+}
+
+
+/* prepare the structured properties for modification: create the store
+ * if not yet present, split off a private copy if it is shared with a
+ * duplicate and drop the (now outdated) JSON text.
+ * Must be called with the message locked.
+ */
+static inline rsRetVal
+msgPrepareJStoreWrite(msg_t *pM)
+{
+	DEFiRet;
+
+	if(pM->pJStore == NULL) {
+		CHKiRet(jstoreConstruct(&pM->pJStore));
+	} else {
+		CHKiRet(jstoreMakeWritable(&pM->pJStore));
+	}
+	msgInvalidateJSONCaches(pM);
+
+finalize_it:
+	RETiRet;
+}
+
+
 /* Get a CEE-Property as string value*/
 rsRetVal
 getCEEPropVal(msg_t *pM, es_str_t *propName, uchar **pRes, rs_size_t *buflen, unsigned short *pbMustBeFreed)
 {
-	uchar *name = NULL;
-	uchar *leaf;
-	struct json_object *parent;
-	struct json_object *field;
+	jstnode_t *pNode;
+	uchar *pCopy;
 	DEFiRet;
 
 	if(*pbMustBeFreed)
 		free(*pRes);
 	*pRes = NULL;
-	// TODO: mutex?
-	if(pM->json == NULL) goto finalize_it;
+	*pbMustBeFreed = 0;
+	MsgLock(pM);
+	if(pM->pJStore == NULL) goto finalize_it;
 
-	if(!es_strbufcmp(propName, (uchar*)"!", 1)) {
-		field = pM->json;
-	} else {
-		name = (uchar*)es_str2cstr(propName, NULL);
-		leaf = jsonPathGetLeaf(name, ustrlen(name));
-		CHKiRet(jsonPathFindParent(pM, name, leaf, &parent, 1));
-		field = json_object_object_get(parent, (char*)leaf);
-	}
-	if(field != NULL) {
-		*pRes = (uchar*) strdup(json_object_get_string(field));
-		*buflen = (int) ustrlen(*pRes);
+	if(jstoreIsRootPath(es_getBufAddr(propName), es_strlen(propName))) {
+		CHKiRet(msgGetJSONStr(pM, pRes, buflen, pbMustBeFreed, MUTEX_ALREADY_LOCKED));
+		FINALIZE;
+	}
+	pNode = jstoreFind(pM->pJStore, es_getBufAddr(propName), es_strlen(propName));
+	if(pNode == NULL) goto finalize_it;
+	CHKiRet(jstoreNodeGetStr(pNode, pRes, buflen, pbMustBeFreed));
+	if(pNode->type == JST_STRING) {
+		/* the string lives inside the store, which may be modified
+		 * by a different thread as soon as we unlock
+		 */
+		CHKmalloc(pCopy = MALLOC(*buflen + 1));
+		memcpy(pCopy, *pRes, *buflen);
+		pCopy[*buflen] = '\0';
+		*pRes = pCopy;
 		*pbMustBeFreed = 1;
 	}
 
 finalize_it:
-	free(name);
+	MsgUnlock(pM);
 	if(*pRes == NULL) {
 		/* could not find any value, so set it to empty */
 		*pRes = (unsigned char*)"";
@@ -2551,124 +2831,54 @@ finalize_it:
 }
 
 
-/* Get a CEE-Property as native json object
+/* Get a CEE-Property as native json object. The caller receives its
+ * own object and must release it via json_object_put().
  */
 rsRetVal
 msgGetCEEPropJSON(msg_t *pM, es_str_t *propName, struct json_object **pjson)
 {
-	uchar *name = NULL;
-	uchar *leaf;
-	struct json_object *parent;
 	DEFiRet;
 
-	// TODO: mutex?
-	if(pM->json == NULL) {
-		ABORT_FINALIZE(RS_RET_NOT_FOUND);
-	}
-
-	if(!es_strbufcmp(propName, (uchar*)"!", 1)) {
-		*pjson = pM->json;
-		FINALIZE;
-	}
-	name = (uchar*)es_str2cstr(propName, NULL);
-	leaf = jsonPathGetLeaf(name, ustrlen(name));
-	CHKiRet(jsonPathFindParent(pM, name, leaf, &parent, 1));
-	*pjson = json_object_object_get(parent, (char*)leaf);
+	MsgLock(pM);
+	*pjson = msgFindJSONView(pM, propName);
+	MsgUnlock(pM);
 	if(*pjson == NULL) {
 		ABORT_FINALIZE(RS_RET_NOT_FOUND);
 	}
 
 finalize_it:
-	free(name);
 	RETiRet;
 }
 
 
-/* Encode a JSON value and add it to provided string. Note that 
- * the string object may be NULL. In this case, it is created
- * if and only if escaping is needed.
+/* Get a CEE-Property as RainerScript variable. Strings and numbers are
+ * taken directly from the native store, all other types are passed as
+ * json-c object, which is released together with the variable.
  */
-static rsRetVal
-jsonAddVal(uchar *pSrc, unsigned buflen, es_str_t **dst)
+void
+msgGetCEEPropVar(msg_t *pM, es_str_t *propName, struct var *ret)
 {
-	unsigned char c;
-	es_size_t i;
-	char numbuf[4];
-	int j;
-	DEFiRet;
+	jstnode_t *pNode = NULL;
 
-	for(i = 0 ; i < buflen ; ++i) {
-		c = pSrc[i];
-		if(   (c >= 0x23 && c <= 0x5b)
-		   || (c >= 0x5d /* && c <= 0x10FFFF*/)
-		   || c == 0x20 || c == 0x21) {
-			/* no need to escape */
-			if(*dst != NULL)
-				es_addChar(dst, c);
-		} else {
-			if(*dst == NULL) {
-				if(i == 0) {
-					/* we hope we have only few escapes... */
-					*dst = es_newStr(buflen+10);
-				} else {
-					*dst = es_newStrFromBuf((char*)pSrc, i);
-				}
-				if(*dst == NULL) {
-					ABORT_FINALIZE(RS_RET_OUT_OF_MEMORY);
-				}
-			}
-			/* we must escape, try RFC4627-defined special sequences first */
-			switch(c) {
-			case '\0':
-				es_addBuf(dst, "\\u0000", 6);
-				break;
-			case '\"':
-				es_addBuf(dst, "\\\"", 2);
-				break;
-			case '/':
-				es_addBuf(dst, "\\/", 2);
-				break;
-			case '\\':
-				es_addBuf(dst, "\\\\", 2);
-				break;
-			case '\010':
-				es_addBuf(dst, "\\b", 2);
-				break;
-			case '\014':
-				es_addBuf(dst, "\\f", 2);
-				break;
-			case '\n':
-				es_addBuf(dst, "\\n", 2);
-				break;
-			case '\r':
-				es_addBuf(dst, "\\r", 2);
-				break;
-			case '\t':
-				es_addBuf(dst, "\\t", 2);
-				break;
-			default:
-				/* TODO : proper Unicode encoding (see header comment) */
-				for(j = 0 ; j < 4 ; ++j) {
-					numbuf[3-j] = hexdigit[c % 16];
-					c = c / 16;
-				}
-				es_addBuf(dst, "\\u", 2);
-				es_addBuf(dst, numbuf, 4);
-				break;
-			}
-		}
+	MsgLock(pM);
+	if(pM->pJStore != NULL)
+		pNode = jstoreFind(pM->pJStore, es_getBufAddr(propName), es_strlen(propName));
+	if(pNode != NULL && pNode->type == JST_STRING
+	   && (ret->d.estr = es_newStrFromBuf((char*) pNode->v.str.psz, pNode->v.str.len)) != NULL) {
+		ret->datatype = 'S';
+	} else if(pNode != NULL && pNode->type == JST_INT) {
+		ret->datatype = 'N';
+		ret->d.n = pNode->v.n;
+	} else {
+		ret->datatype = 'J';
+		ret->d.json = (pNode == NULL) ? NULL : jstoreNodeToJSON(pNode);
 	}
-finalize_it:
-	RETiRet;
+	MsgUnlock(pM);
 }
 
 
 /* encode a property in JSON escaped format. This is a helper
  * to MsgGetProp. It needs to update all provided parameters.
- * Note: Code is borrowed from libee (my own code, so ASL 2.0
- * is fine with it); this function may later be replaced by
- * some "better" and more complete implementation (maybe from
- * libee or its helpers).
  * For performance reasons, we begin to copy the string only
  * when we recognice that we actually need to do some escaping.
  * rgerhards, 2012-03-16
@@ -2678,66 +2888,68 @@ jsonEncode(uchar **ppRes, unsigned short *pbMustBeFreed, int *pBufLen)
 {
 	unsigned buflen;
 	uchar *pSrc;
-	es_str_t *dst = NULL;
+	jsonw_t w;
+	int bHaveWriter = 0;
 	DEFiRet;
 
 	pSrc = *ppRes;
 	buflen = (*pBufLen == -1) ? ustrlen(pSrc) : *pBufLen;
-	CHKiRet(jsonAddVal(pSrc, buflen, &dst));
+	if(escScanJSON(pSrc, buflen) == buflen)
+		FINALIZE; /* nothing to escape */
 
-	if(dst != NULL) {
-		/* we updated the string and need to replace the
-		 * previous data.
-		 */
-		if(*pbMustBeFreed)
-			free(*ppRes);
-		*ppRes = (uchar*)es_str2cstr(dst, NULL);
-		*pbMustBeFreed = 1;
-		*pBufLen = -1;
-		es_deleteStr(dst);
-	}
+	/* we hope we have only few escapes... */
+	CHKiRet(jsonwInit(&w, buflen + 10));
+	bHaveWriter = 1;
+	CHKiRet(jsonwEscaped(&w, pSrc, buflen, JSONW_ESC_TPL));
+	if(*pbMustBeFreed)
+		free(*ppRes);
+	*pBufLen = w.len;
+	*ppRes = jsonwDetach(&w, NULL);
+	*pbMustBeFreed = 1;
 
 finalize_it:
+	if(bHaveWriter)
+		jsonwExit(&w);
 	RETiRet;
 }
 
 
 /* Format a property as JSON field, that means
- * "name"="value"
+ * "name":"value"
  * where value is JSON-escaped (here we assume that the name
  * only contains characters from the valid character set).
- * Note: this function duplicates code from jsonEncode(). 
- * TODO: these two functions should be combined, at least if
- * that makes any sense from a performance PoV - definitely
- * something to consider at a later stage. rgerhards, 2012-04-19
+ * The field is directly rendered into the writer's buffer, which
+ * we then hand over as result.
  */
 static rsRetVal
 jsonField(struct templateEntry *pTpe, uchar **ppRes, unsigned short *pbMustBeFreed, int *pBufLen)
 {
 	unsigned buflen;
 	uchar *pSrc;
-	es_str_t *dst = NULL;
+	jsonw_t w;
+	int bHaveWriter = 0;
 	DEFiRet;
 
 	pSrc = *ppRes;
 	buflen = (*pBufLen == -1) ? ustrlen(pSrc) : *pBufLen;
 	/* we hope we have only few escapes... */
-	dst = es_newStr(buflen+pTpe->lenFieldName+15);
-	es_addChar(&dst, '"');
-	es_addBuf(&dst, (char*)pTpe->fieldName, pTpe->lenFieldName);
-	es_addBufConstcstr(&dst, "\":\"");
-	CHKiRet(jsonAddVal(pSrc, buflen, &dst));
-	es_addChar(&dst, '"');
+	CHKiRet(jsonwInit(&w, buflen + pTpe->lenFieldName + 15));
+	bHaveWriter = 1;
+	CHKiRet(jsonwRaw(&w, UCHAR_CONSTANT("\""), 1));
+	CHKiRet(jsonwRaw(&w, pTpe->fieldName, pTpe->lenFieldName));
+	CHKiRet(jsonwRaw(&w, UCHAR_CONSTANT("\":\""), 3));
+	CHKiRet(jsonwEscaped(&w, pSrc, buflen, JSONW_ESC_TPL));
+	CHKiRet(jsonwRaw(&w, UCHAR_CONSTANT("\""), 1));
 
 	if(*pbMustBeFreed)
 		free(*ppRes);
-	/* we know we do not have \0 chars - so the size does not change */
-	*pBufLen = es_strlen(dst);
-	*ppRes = (uchar*)es_str2cstr(dst, NULL);
+	*pBufLen = w.len;
+	*ppRes = jsonwDetach(&w, NULL);
 	*pbMustBeFreed = 1;
-	es_deleteStr(dst);
 
 finalize_it:
+	if(bHaveWriter)
+		jsonwExit(&w);
 	RETiRet;
 }
 
@@ -2967,15 +3179,11 @@ uchar *MsgGetProp(msg_t *pMsg, struct templateEntry *pTpe,
 			pRes = glbl.GetLocalHostName();
 			break;
 		case PROP_CEE_ALL_JSON:
-			if(pMsg->json == NULL) {
-				if(*pbMustBeFreed == 1)
-					free(pRes);
-				pRes = (uchar*) "{}";
-				bufLen = 2;
-				*pbMustBeFreed = 0;
-			} else {
-				pRes = (uchar*)strdup(json_object_get_string(pMsg->json));
-				*pbMustBeFreed = 1;
+			if(*pbMustBeFreed == 1)
+				free(pRes);
+			*pbMustBeFreed = 0;
+			if(msgGetJSONStr(pMsg, &pRes, &bufLen, pbMustBeFreed, LOCK_MUTEX) != RS_RET_OK) {
+				RET_OUT_OF_MEMORY;
 			}
 			break;
 		case PROP_CEE:
@@ -3629,26 +3837,26 @@ uchar *MsgGetProp(msg_t *pMsg, struct templateEntry *pTpe,
 es_str_t*
 msgGetCEEVarNew(msg_t *pMsg, char *name)
 {
-	uchar *leaf;
-	char *val;
+	jstnode_t *pNode;
+	uchar *val;
+	rs_size_t lenVal;
+	unsigned short bMustBeFreed = 0;
 	es_str_t *estr = NULL;
-	struct json_object *json, *parent;
 
 	ISOBJ_TYPE_assert(pMsg, msg);
 
-	if(pMsg->json == NULL) {
-		estr = es_newStr(1);
-		goto done;
-	}
-	leaf = jsonPathGetLeaf((uchar*)name, strlen(name));
-	if(jsonPathFindParent(pMsg, (uchar*)name, leaf, &parent, 1) != RS_RET_OK) {
+	MsgLock(pMsg);
+	if(   pMsg->pJStore == NULL
+	   || (pNode = jstoreFind(pMsg->pJStore, (uchar*)name, strlen(name))) == NULL
+	   || jstoreNodeGetStr(pNode, &val, &lenVal, &bMustBeFreed) != RS_RET_OK) {
 		estr = es_newStr(1);
 		goto done;
 	}
-	json = json_object_object_get(parent, (char*)leaf);
-	val = (char*)json_object_get_string(json);
-	estr = es_newStrFromCStr(val, strlen(val));
+	estr = es_newStrFromCStr((char*)val, lenVal);
+	if(bMustBeFreed)
+		free(val);
 done:
+	MsgUnlock(pMsg);
 	return estr;
 }
 
@@ -3776,282 +3984,108 @@ MsgGetSeverity(msg_t *pMsg, int *piSeverity)
 }
 
 
-static uchar *
-jsonPathGetLeaf(uchar *name, int lenName)
-{
-	int i;
-	for(i = lenName ; name[i] != '!' && i >= 0 ; --i)
-		/* just skip */;
-	if(name[i] == '!')
-		++i;
-	return name + i;
-}
-
-
-static rsRetVal
-jsonPathFindNext(struct json_object *root, uchar **name, uchar *leaf,
-		 struct json_object **found, int bCreate)
-{
-	uchar namebuf[1024];
-	struct json_object *json;
-	size_t i;
-	uchar *p = *name;
-	DEFiRet;
-
-	if(*p == '!')
-		++p;
-	for(i = 0 ; *p && *p != '!' && p != leaf && i < sizeof(namebuf)-1 ; ++i, ++p)
-		namebuf[i] = *p;
-	if(i > 0) {
-		namebuf[i] = '\0';
-		dbgprintf("AAAA: next JSONPath elt: '%s'\n", namebuf);
-		json = json_object_object_get(root, (char*)namebuf);
-	} else
-		json = root;
-	if(json == NULL) {
-		if(!bCreate) {
-			ABORT_FINALIZE(RS_RET_JNAME_INVALID);
-		} else {
-			json = json_object_new_object();
-			json_object_object_add(root, (char*)namebuf, json);
-		}
-	}
-
-	*name = p;
-	*found = json;
-finalize_it:
-	RETiRet;
-}
-
-static rsRetVal
-jsonPathFindParent(msg_t *pM, uchar *name, uchar *leaf, struct json_object **parent, int bCreate)
-{
-	DEFiRet;
-	*parent = pM->json;
-	while(name < leaf-1) {
-		jsonPathFindNext(*parent, &name, leaf, parent, bCreate);
-	}
-	RETiRet;
-}
-
-static rsRetVal
-jsonMerge(struct json_object *existing, struct json_object *json)
-{
-	/* TODO: check & handle duplicate names */
-	DEFiRet;
-	struct json_object_iter it;
-
-	json_object_object_foreachC(json, it) {
-DBGPRINTF("AAAA jsonMerge adds '%s'\n", it.key);
-		json_object_object_add(existing, it.key,
-			json_object_get(it.val));
-	}
-	/* note: json-c does ref counting. We added all descandants refcounts
-	 * in the loop above. So when we now free(_put) the root object, only
-	 * root gets freed().
-	 */
-	json_object_put(json);
-	RETiRet;
-}
-
-/* find a JSON structure element (field or container doesn't matter).  */
+/* find a JSON structure element (field or container doesn't matter).
+ * The caller must release the returned object via json_object_put().
+ */
 rsRetVal
 jsonFind(msg_t *pM, es_str_t *propName, struct json_object **jsonres)
 {
-	uchar *name = NULL;
-	uchar *leaf;
-	struct json_object *parent;
-	struct json_object *field;
-	DEFiRet;
-
-	if(pM->json == NULL) {
-		field = NULL;
-		goto finalize_it;
-	}
-
-	if(!es_strbufcmp(propName, (uchar*)"!", 1)) {
-		field = pM->json;
-	} else {
-		name = (uchar*)es_str2cstr(propName, NULL);
-		leaf = jsonPathGetLeaf(name, ustrlen(name));
-		CHKiRet(jsonPathFindParent(pM, name, leaf, &parent, 0));
-		field = json_object_object_get(parent, (char*)leaf);
-	}
-	*jsonres = field;
-
-finalize_it:
-	free(name);
-	RETiRet;
+	MsgLock(pM);
+	*jsonres = msgFindJSONView(pM, propName);
+	MsgUnlock(pM);
+	return RS_RET_OK;
 }
 
+
+/* add a json-c object to the message's structured properties. The
+ * object is converted to the native representation and always consumed.
+ */
 rsRetVal
 msgAddJSON(msg_t *pM, uchar *name, struct json_object *json)
 {
-	/* TODO: error checks! This is a quick&dirty PoC! */
-	struct json_object *parent, *leafnode;
-	uchar *leaf;
 	DEFiRet;
 
 	MsgLock(pM);
-	if(name[0] == '!' && name[1] == '\0') {
-		if(pM->json == NULL)
-			pM->json = json;
-		else
-			CHKiRet(jsonMerge(pM->json, json));
-	} else {
-		if(pM->json == NULL) {
-			/* now we need a root obj */
-			pM->json = json_object_new_object();
-		}
-		leaf = jsonPathGetLeaf(name, ustrlen(name));
-		CHKiRet(jsonPathFindParent(pM, name, leaf, &parent, 1));
-		leafnode = json_object_object_get(parent, (char*)leaf);
-		if(leafnode == NULL) {
-			json_object_object_add(parent, (char*)leaf, json);
-		} else {
-			if(json_object_get_type(json) == json_type_object) {
-				CHKiRet(jsonMerge(pM->json, json));
-			} else {
-//dbgprintf("AAAA: leafnode already exists, type is %d, update with %d\n", (int)json_object_get_type(leafnode), (int)json_object_get_type(json));
-				/* TODO: improve the code below, however, the current
-				 *       state is not really bad */
-				if(json_object_get_type(leafnode) == json_type_object) {
-					DBGPRINTF("msgAddJSON: trying to update a container "
-						  "node with a leaf, name is '%s' - "
-						  "forbidden\n", name);
-					json_object_put(json);
-					ABORT_FINALIZE(RS_RET_INVLD_SETOP);
-				}
-				/* json-c code indicates we can simply replace a
-				 * json type. Unfortunaltely, this is not documented
-				 * as part of the interface spec. We still use it,
-				 * because it speeds up processing. If it does not work
-				 * at some point, use
-				 * json_object_object_del(parent, (char*)leaf);
-				 * before adding. rgerhards, 2012-09-17
-				 */
-				json_object_object_add(parent, (char*)leaf, json);
-			}
-		}
+	if((iRet = msgPrepareJStoreWrite(pM)) != RS_RET_OK) {
+		json_object_put(json);
+		FINALIZE;
 	}
+	CHKiRet(jstoreSetJSON(pM->pJStore, name, json));
+	MsgSetModified(pM);
 
 finalize_it:
 	MsgUnlock(pM);
 	RETiRet;
 }
 
+
 rsRetVal
 msgDelJSON(msg_t *pM, uchar *name)
 {
-	struct json_object *parent, *leafnode;
-	uchar *leaf;
 	DEFiRet;
 
-dbgprintf("AAAA: unset variable '%s'\n", name);
 	MsgLock(pM);
 	if(name[0] == '!' && name[1] == '\0') {
 		/* strange, but I think we should permit this. After all,
 		 * we trust rsyslog.conf to be written by the admin.
 		 */
 		DBGPRINTF("unsetting JSON root object\n");
-		json_object_put(pM->json);
-		pM->json = NULL;
+		if(pM->pJStore != NULL)
+			jstoreDestruct(&pM->pJStore);
+		msgInvalidateJSONCaches(pM);
 	} else {
-		if(pM->json == NULL) {
-			/* now we need a root obj */
-			pM->json = json_object_new_object();
-		}
-		leaf = jsonPathGetLeaf(name, ustrlen(name));
-		CHKiRet(jsonPathFindParent(pM, name, leaf, &parent, 1));
-		leafnode = json_object_object_get(parent, (char*)leaf);
-DBGPRINTF("AAAA: unset found JSON value path '%s', " "leaf '%s', leafnode %p\n", name, leaf, leafnode);
-		if(leafnode == NULL) {
+		if(pM->pJStore == NULL) {
 			DBGPRINTF("unset JSON: could not find '%s'\n", name);
 			ABORT_FINALIZE(RS_RET_JNAME_NOTFOUND);
-		} else {
-			DBGPRINTF("deleting JSON value path '%s', "
-				  "leaf '%s', type %d\n",
-				  name, leaf, json_object_get_type(leafnode));
-			json_object_object_del(parent, (char*)leaf);
+		}
+		CHKiRet(msgPrepareJStoreWrite(pM));
+		iRet = jstoreDel(pM->pJStore, name);
+		if(iRet != RS_RET_OK) {
+			DBGPRINTF("unset JSON: could not find '%s'\n", name);
 		}
 	}
+	MsgSetModified(pM);
 
 finalize_it:
 	MsgUnlock(pM);
 	RETiRet;
 }
 
-static struct json_object *
-jsonDeepCopy(struct json_object *src)
-{
-	struct json_object *dst = NULL, *json;
-	struct json_object_iter it;
-	int arrayLen, i;
-
-	if(src == NULL) goto done;
-
-	switch(json_object_get_type(src)) {
-	case json_type_boolean:
-		dst = json_object_new_boolean(json_object_get_boolean(src));
-		break;
-	case json_type_double:
-		dst = json_object_new_double(json_object_get_double(src));
-		break;
-	case json_type_int:
-		dst = json_object_new_int(json_object_get_int(src));
-		break;
-	case json_type_string:
-		dst = json_object_new_string(json_object_get_string(src));
-		break;
-	case json_type_object:
-		dst = json_object_new_object();
-		json_object_object_foreachC(src, it) {
-			json = jsonDeepCopy(it.val);
-			json_object_object_add(dst, it.key, json);
-		}
-		break;
-	case json_type_array:
-		arrayLen = json_object_array_length(src);
-		dst = json_object_new_array();
-		for(i = 0 ; i < arrayLen ; ++i) {
-			json = json_object_array_get_idx(src, i);
-			json = jsonDeepCopy(json);
-			json_object_array_add(dst, json);
-		}
-		break;
-	default:DBGPRINTF("jsonDeepCopy(): error unknown type %d\n",
-			 json_object_get_type(src));
-		dst = NULL;
-		break;
-	}
-done:	return dst;
-}
-
 
 rsRetVal
 msgSetJSONFromVar(msg_t *pMsg, uchar *varname, struct var *v)
 {
 	struct json_object *json = NULL;
-	char *cstr;
 	DEFiRet;
+
+	/* the var keeps its reference to the json-c object (it is released
+	 * by the caller), so we need our own one as the store consumes it.
+	 */
+	if(v->datatype == 'J')
+		json = json_object_get(v->d.json);
+	MsgLock(pMsg);
+	CHKiRet(msgPrepareJStoreWrite(pMsg));
 	switch(v->datatype) {
 	case 'S':/* string */
-		cstr = es_str2cstr(v->d.estr, NULL);
-		json = json_object_new_string(cstr);
-		free(cstr);
+		CHKiRet(jstoreSetStr(pMsg->pJStore, varname+1, es_getBufAddr(v->d.estr),
+				     es_strlen(v->d.estr)));
 		break;
 	case 'N':/* number (integer) */
-		json = json_object_new_int((int) v->d.n);
+		CHKiRet(jstoreSetInt(pMsg->pJStore, varname+1, v->d.n));
 		break;
 	case 'J':/* native JSON */
-		json = jsonDeepCopy(v->d.json);
+		iRet = jstoreSetJSON(pMsg->pJStore, varname+1, json);
+		json = NULL; /* always consumed */
 		break;
 	default:DBGPRINTF("msgSetJSONFromVar: unsupported datatype %c\n",
 		v->datatype);
 		ABORT_FINALIZE(RS_RET_ERR);
 	}
-	msgAddJSON(pMsg, varname+1, json);
+	MsgSetModified(pMsg);
 finalize_it:
+	MsgUnlock(pMsg);
+	if(json != NULL)
+		json_object_put(json);
 	RETiRet;
 }
 
@@ -4075,6 +4109,7 @@ BEGINObjClassInit(msg, 1, OBJ_IS_CORE_MODULE)
 #	if HAVE_MALLOC_TRIM
 	INIT_ATOMIC_HELPER_MUT(mutTrimCtr);
 #	endif
+	INIT_ATOMIC_HELPER_MUT(mutMsgBuf);
 ENDObjClassInit(msg)
 /* vim:set ai:
  */
@@ -35,9 +35,22 @@
 #include "syslogd-types.h"
 #include "template.h"
 #include "atomic.h"
+#include "jstore.h"
+#include "uuidgen.h"
 #include "libee/libee.h"
 
 
+/* header fields that parsers may record lazily, see MsgSetLazyField() */
+#define MSG_LAZY_HOSTNAME	0
+#define MSG_LAZY_TAG		1
+#define MSG_LAZY_APPNAME	2
+#define MSG_LAZY_PROCID		3
+#define MSG_LAZY_MSGID		4
+#define MSG_LAZY_STRUCDATA	5
+#define MSG_LAZY_NUMFIELDS	6
+#define MSG_LAZY_BIT(field)	(1 << (field))
+#define MSG_LAZY_ALL		((1 << MSG_LAZY_NUMFIELDS) - 1)
+
 /* rgerhards 2004-11-08: The following structure represents a
  * syslog message. 
  *
@@ -80,14 +93,8 @@ struct msg {
 	uchar	*pszRawMsg;	/* message as it was received on the wire. This is important in case we
 				 * need to preserve cryptographic verifiers.  */
 	uchar	*pszHOSTNAME;	/* HOSTNAME from syslog message */
-	char *pszRcvdAt3164;	/* time as RFC3164 formatted string (always 15 charcters) */
-	char *pszRcvdAt3339;	/* time as RFC3164 formatted string (32 charcters at most) */
-	char *pszRcvdAt_MySQL;	/* rcvdAt as MySQL formatted string (always 14 charcters) */
-        char *pszRcvdAt_PgSQL;  /* rcvdAt as PgSQL formatted string (always 21 characters) */
 	char *pszTIMESTAMP3164;	/* TIMESTAMP as RFC3164 formatted string (always 15 charcters) */
 	char *pszTIMESTAMP3339;	/* TIMESTAMP as RFC3339 formatted string (32 charcters at most) */
-	char *pszTIMESTAMP_MySQL;/* TIMESTAMP as MySQL formatted string (always 14 charcters) */
-        char *pszTIMESTAMP_PgSQL;/* TIMESTAMP as PgSQL formatted string (always 21 characters) */
 	cstr_t *pCSStrucData;   /* STRUCTURED-DATA */
 	cstr_t *pCSAPPNAME;	/* APP-NAME */
 	cstr_t *pCSPROCID;	/* PROCID */
@@ -109,7 +116,9 @@ struct msg {
 				   it obviously is solved in way or another...). */
 	struct syslogTime tRcvdAt;/* time the message entered this program */
 	struct syslogTime tTIMESTAMP;/* (parsed) value of the timestamp */
-	struct json_object *json;
+	jstore_t *pJStore;	/* structured (CEE) properties, shared with duplicates (copy-on-write) */
+	uchar *pszJSONStr;	/* serialized pJStore, built on demand (see msgGetJSONStr()) */
+	rs_size_t lenJSONStr;
 	/* some fixed-size buffers to save malloc()/free() for frequently used fields (from the default templates) */
 	uchar szRawMsg[CONF_RAWMSG_BUFSIZE];	/* most messages are small, and these are stored here (without malloc/free!) */
 	uchar szHOSTNAME[CONF_HOSTNAME_BUFSIZE];
@@ -123,11 +132,23 @@ struct msg {
 	} TAG;
 	char pszTimestamp3164[CONST_LEN_TIMESTAMP_3164 + 1];
 	char pszTimestamp3339[CONST_LEN_TIMESTAMP_3339 + 1];
+	char pszTIMESTAMP_MySQL[CONST_LEN_TIMESTAMP_MYSQL + 1];
+	char pszTIMESTAMP_PgSQL[CONST_LEN_TIMESTAMP_PGSQL + 1];
+	/* rcvdAt formatted strings; empty until first requested */
+	char pszRcvdAt3164[CONST_LEN_TIMESTAMP_3164 + 1];
+	char pszRcvdAt3339[CONST_LEN_TIMESTAMP_3339 + 1];
+	char pszRcvdAt_MySQL[CONST_LEN_TIMESTAMP_MYSQL + 1];
+	char pszRcvdAt_PgSQL[CONST_LEN_TIMESTAMP_PGSQL + 1];
 	char pszTIMESTAMP_SecFrac[7]; /* Note: a pointer is 64 bits/8 char, so this is actually fewer than a pointer! */
 	char pszRcvdAt_SecFrac[7];	     /* same as above. Both are fractional seconds for their respective timestamp */
 	char pszTIMESTAMP_Unix[12]; /* almost as small as a pointer! */
 	char pszRcvdAt_Unix[12];
-    uchar *pszUUID; /* The message's UUID */
+	uchar pszUUID[UUIDGEN_LEN_HEX + 1]; /* The message's UUID, empty until first requested */
+	/* header fields located by the parser, but not yet extracted (see MsgSetLazyField()) */
+	int	lazyOff[MSG_LAZY_NUMFIELDS];	/* offset of field inside pszRawMsg */
+	int	lazyLen[MSG_LAZY_NUMFIELDS];	/* length of field */
+	int	lazyPending;			/* bitmask (MSG_LAZY_BIT) of fields not yet extracted */
+	unsigned iModCount;	/* incremented whenever the message is modified after parsing, see MsgSetModified() */
 };
 
 
@@ -175,7 +196,10 @@ rsRetVal MsgSetAfterPRIOffs(msg_t *pMsg, short offs);
 void MsgSetMSGoffs(msg_t *pMsg, short offs);
 void MsgSetRawMsgWOSize(msg_t *pMsg, char* pszRawMsg);
 void MsgSetRawMsg(msg_t *pMsg, char* pszRawMsg, size_t lenMsg);
+void MsgSetLazyField(msg_t *pMsg, int iField, int offs, int len);
 rsRetVal MsgReplaceMSG(msg_t *pThis, uchar* pszMSG, int lenMSG);
+rsRetVal MsgMakeRawMsgWritable(msg_t *pThis);
+rsRetVal MsgGetWritableMSG(msg_t *pThis, uchar **ppMsg);
 uchar *MsgGetProp(msg_t *pMsg, struct templateEntry *pTpe,
                   propid_t propid, es_str_t *propName,
 		  rs_size_t *pPropLen, unsigned short *pbMustBeFreed, struct syslogTime *ttNow);
@@ -208,6 +232,7 @@ uchar *getRcvFrom(msg_t *pM);
 rsRetVal propNameToID(cstr_t *pCSPropName, propid_t *pPropID);
 uchar *propIDToName(propid_t propID);
 rsRetVal msgGetCEEPropJSON(msg_t *pM, es_str_t *propName, struct json_object **pjson);
+void msgGetCEEPropVar(msg_t *pM, es_str_t *propName, struct var *ret);
 rsRetVal msgSetJSONFromVar(msg_t *pMsg, uchar *varname, struct var *var);
 rsRetVal msgDelJSON(msg_t *pMsg, uchar *varname);
 rsRetVal jsonFind(msg_t *pM, es_str_t *propName, struct json_object **jsonres);
@@ -234,6 +259,20 @@ MsgSetRawMsgSize(msg_t *pMsg, size_t newLen)
 }
 
 
+/* indicate that a property of an already parsed message has been changed.
+ * Rendered template strings are cached per batch (see prepareDoActionParams()),
+ * and this is what invalidates the cache. All setters that are used after
+ * parsing (set/unset, the msgAddJSON() family, MsgReplaceMSG(), ...) already
+ * call it. Modules that modify message members directly must do so themselves;
+ * MSG itself must be obtained via MsgGetWritableMSG() if it is to be modified.
+ */
+static inline void
+MsgSetModified(msg_t *pMsg)
+{
+	++pMsg->iModCount;
+}
+
+
 /* get the ruleset that is associated with the ruleset.
  * May be NULL. -- rgerhards, 2009-10-27
  */
@@ -1188,8 +1188,11 @@ void closeUDPListenSockets(int *pSockArr)
  * hostname and/or pszPort may be NULL, but not both!
  * bIsServer indicates if a server socket should be created
  * 1 - server, 0 - client
+ * bReusePort requests SO_REUSEPORT, so that multiple sockets can be bound to
+ * the same address and the kernel distributes datagrams among them. If the
+ * platform does not support it, socket creation fails.
  */
-int *create_udp_socket(uchar *hostname, uchar *pszPort, int bIsServer)
+int *create_udp_socket(uchar *hostname, uchar *pszPort, int bIsServer, int bReusePort)
 {
         struct addrinfo hints, *res, *r;
         int error, maxs, *s, *socks, on = 1;
@@ -1261,6 +1264,23 @@ int *create_udp_socket(uchar *hostname, uchar *pszPort, int bIsServer)
 			continue;
 		}
 
+		if(bReusePort) {
+#			ifdef SO_REUSEPORT
+			if(setsockopt(*s, SOL_SOCKET, SO_REUSEPORT, (char *) &on, sizeof(on)) < 0) {
+				errmsg.LogError(errno, NO_ERRCODE, "setsockopt(REUSEPORT)");
+				close(*s);
+				*s = -1;
+				continue;
+			}
+#			else
+			errmsg.LogError(0, NO_ERRCODE, "SO_REUSEPORT requested, but not "
+					"supported on this platform");
+			close(*s);
+			*s = -1;
+			continue;
+#			endif
+		}
+
 		/* We need to enable BSD compatibility. Otherwise an attacker
 		 * could flood our log files by sending us tons of ICMP errors.
 		 */
@@ -541,6 +541,12 @@ Rcv(nsd_t *pNsd, uchar *pRcvBuf, ssize_t *pLenBuf)
 	if(*pLenBuf == 0) {
 		ABORT_FINALIZE(RS_RET_CLOSED);
 	} else if (*pLenBuf < 0) {
+		if(errno == EAGAIN || errno == EWOULDBLOCK) {
+			/* no data available (any more), this happens regularly
+			 * when the caller drains an edge-triggered socket.
+			 */
+			ABORT_FINALIZE(RS_RET_RETRY);
+		}
 		rs_strerror_r(errno, errStr, sizeof(errStr));
 		dbgprintf("error during recv on NSD %p: %s\n", pNsd, errStr);
 		ABORT_FINALIZE(RS_RET_RCV_ERR);
@@ -34,6 +34,7 @@ struct nsd_ptcp_s {
 	uchar *pRemHostName; /**< host name of remote peer (currently used in server mode, only) */
 	struct sockaddr_storage remAddr; /**< remote addr as sockaddr - used for legacy ACL code */
 	int sock;	/**< the socket we use for regular, single-socket, operations */
+	struct nsdpoll_epollevt_lst_s *pPollEvt; /**< our entry in the nsdpoll event list, if any */
 };
 
 /* interface is defined in nsd.h, we just implement it! */
@@ -53,12 +53,9 @@ DEFobjCurrIf(glbl)
 
 /* add new entry to list. We assume that the fd is not already present and DO NOT check this!
  * Returns newly created entry in pEvtLst.
- * Note that we currently need to use level-triggered mode, because the upper layers do not work
- * in parallel. As such, in edge-triggered mode we may not get notified, because new data comes
- * in after we have read everything that was present. To use ET mode, we need to change the upper
- * peers so that they immediately start a new wait before processing the data read. That obviously
- * requires more elaborate redesign and we postpone this until the current more simplictic mode has
- * been proven OK in practice.
+ * Note that we use level-triggered mode by default. Edge-triggered mode must be requested by the
+ * caller via NSDPOLL_EDGE, and the caller must then read until the socket is drained, as we will
+ * not be notified again for data that was already present.
  * rgerhards, 2009-11-18
  */
 static inline rsRetVal
@@ -70,8 +67,9 @@ addEvent(nsdpoll_ptcp_t *pThis, int id, void *pUsr, int mode, nsd_ptcp_t *pSock,
 	pNew->id = id;
 	pNew->pUsr = pUsr;
 	pNew->pSock = pSock;
-	pNew->event.events = 0; /* TODO: at some time we should be able to use EPOLLET */
-	//pNew->event.events = EPOLLET;
+	pNew->event.events = 0;
+	if(mode & NSDPOLL_EDGE)
+		pNew->event.events |= EPOLLET;
 	if(mode & NSDPOLL_IN)
 		pNew->event.events |= EPOLLIN;
 	if(mode & NSDPOLL_OUT)
@@ -79,7 +77,10 @@ addEvent(nsdpoll_ptcp_t *pThis, int id, void *pUsr, int mode, nsd_ptcp_t *pSock,
 	pNew->event.data.ptr = pNew;
 	pthread_mutex_lock(&pThis->mutEvtLst);
 	pNew->pNext = pThis->pRoot;
+	if(pThis->pRoot != NULL)
+		pThis->pRoot->pPrev = pNew;
 	pThis->pRoot = pNew;
+	pSock->pPollEvt = pNew;
 	pthread_mutex_unlock(&pThis->mutEvtLst);
 	*pEvtLst = pNew;
 
@@ -90,18 +91,22 @@ finalize_it:
 
 /* find and unlink the entry identified by id/pUsr from the list.
  * rgerhards, 2009-11-23
+ * The socket remembers its entry, so usually no search is necessary. This
+ * is important with many sessions, as each close would otherwise need to
+ * walk the whole list.
  */
 static inline rsRetVal
-unlinkEvent(nsdpoll_ptcp_t *pThis, int id, void *pUsr, nsdpoll_epollevt_lst_t **ppEvtLst) {
+unlinkEvent(nsdpoll_ptcp_t *pThis, int id, void *pUsr, nsd_ptcp_t *pSock, nsdpoll_epollevt_lst_t **ppEvtLst) {
 	nsdpoll_epollevt_lst_t *pEvtLst;
-	nsdpoll_epollevt_lst_t *pPrev = NULL;
 	DEFiRet;
 
 	pthread_mutex_lock(&pThis->mutEvtLst);
-	pEvtLst = pThis->pRoot;
-	while(pEvtLst != NULL && !(pEvtLst->id == id && pEvtLst->pUsr == pUsr)) {
-		pPrev = pEvtLst;
-		pEvtLst = pEvtLst->pNext;
+	pEvtLst = pSock->pPollEvt;
+	if(pEvtLst == NULL || !(pEvtLst->id == id && pEvtLst->pUsr == pUsr)) {
+		pEvtLst = pThis->pRoot;
+		while(pEvtLst != NULL && !(pEvtLst->id == id && pEvtLst->pUsr == pUsr)) {
+			pEvtLst = pEvtLst->pNext;
+		}
 	}
 	if(pEvtLst == NULL)
 		ABORT_FINALIZE(RS_RET_NOT_FOUND);
@@ -109,10 +114,14 @@ unlinkEvent(nsdpoll_ptcp_t *pThis, int id, void *pUsr, nsdpoll_epollevt_lst_t **
 	*ppEvtLst = pEvtLst;
 
 	/* unlink */
-	if(pPrev == NULL)
+	if(pEvtLst->pPrev == NULL)
 		pThis->pRoot = pEvtLst->pNext;
 	else
-		pPrev->pNext = pEvtLst->pNext;
+		pEvtLst->pPrev->pNext = pEvtLst->pNext;
+	if(pEvtLst->pNext != NULL)
+		pEvtLst->pNext->pPrev = pEvtLst->pPrev;
+	if(pEvtLst->pSock->pPollEvt == pEvtLst)
+		pEvtLst->pSock->pPollEvt = NULL;
 
 finalize_it:
 	pthread_mutex_unlock(&pThis->mutEvtLst);
@@ -198,7 +207,7 @@ Ctl(nsdpoll_t *pNsdpoll, nsd_t *pNsd, int id, void *pUsr, int mode, int op) {
 		}
 	} else if(op == NSDPOLL_DEL) {
 		dbgprintf("removing nsdpoll entry %d/%p, sock %d\n", id, pUsr, pSock->sock);
-		CHKiRet(unlinkEvent(pThis, id, pUsr, &pEventLst));
+		CHKiRet(unlinkEvent(pThis, id, pUsr, pSock, &pEventLst));
 		if(epoll_ctl(pThis->efd, EPOLL_CTL_DEL, pSock->sock, &pEventLst->event) < 0) {
 			errSave = errno;
 			rs_strerror_r(errSave, errStr, sizeof(errStr));
@@ -42,6 +42,7 @@ struct nsdpoll_epollevt_lst_s {
 	void *pUsr;
 	nsd_ptcp_t *pSock;	/* our associated netstream driver data */
 	nsdpoll_epollevt_lst_t *pNext;
+	nsdpoll_epollevt_lst_t *pPrev;
 };
 
 /* the nsdpoll_ptcp object */
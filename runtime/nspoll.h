@@ -33,6 +33,7 @@
 /* and some mode specifiers for waiting on input/output */
 #define NSDPOLL_IN	1	/* EPOLLIN */
 #define NSDPOLL_OUT	2	/* EPOLLOUT */
+#define NSDPOLL_EDGE	4	/* EPOLLET - caller must read until the descriptor is drained */
 /* next is 4, 8, 16, ... - must be bit values, as they are ored! */
 
 /* the nspoll object */
@@ -29,6 +29,8 @@
 #include <ctype.h>
 #include <string.h>
 #include <assert.h>
+#include <pthread.h>
+#include <netinet/in.h>
 #ifdef USE_NETZIP
 #include <zlib.h>
 #endif
@@ -44,6 +46,10 @@
 #include "unicode-helper.h"
 #include "dirty.h"
 #include "cfsysline.h"
+#include "prop.h"
+#include "statsobj.h"
+#include "escscan.h"
+#include "batch.h"
 
 /* some defines */
 #define DEFUPRI		(LOG_USER|LOG_NOTICE)
@@ -54,9 +60,29 @@ DEFobjCurrIf(glbl)
 DEFobjCurrIf(errmsg)
 DEFobjCurrIf(datetime)
 DEFobjCurrIf(ruleset)
+DEFobjCurrIf(statsobj)
 
 /* static data */
 
+/* The parser chain cache remembers, per (input name, sender), which parser
+ * of the chain accepted the last message, so that this parser can be tried
+ * first for the next one. Note that this changes semantics if a parser
+ * earlier in the chain would also have accepted the message (most notably,
+ * pmrfc3164 accepts everything): a sender that switches its format (or a
+ * relay forwarding different formats) may then see messages parsed by the
+ * wrong parser. So the cache must be explicitly enabled by the user.
+ * The cache is kept per thread, so no locking is necessary. It is direct
+ * mapped; a collision just means that we need to walk the full chain.
+ */
+#define PARSCACHE_NUM_ENTRIES 256	/* must be a power of 2 */
+typedef struct parsCacheEntry_s {
+	uint64 hash;		/* hash over input name and sender */
+	parserList_t *pList;	/* parser chain the entry applies to */
+	parserList_t *pHit;	/* element of pList that parsed the last message */
+} parsCacheEntry_t;
+
+static pthread_key_t keyParsCache;	/* per-thread array of PARSCACHE_NUM_ENTRIES cache entries */
+
 /* config data */
 static uchar cCCEscapeChar = '#';/* character to be used to start an escape sequence for control chars */
 static int bEscapeCCOnRcv = 1; /* escape control characters on reception: 0 - no, 1 - yes */
@@ -64,6 +90,7 @@ static int bSpaceLFOnRcv = 0; /* replace newlines with spaces on reception: 0 -
 static int bEscape8BitChars = 0; /* escape characters > 127 on reception: 0 - no, 1 - yes */
 static int bEscapeTab = 1;	/* escape tab control character when doing CC escapes: 0 - no, 1 - yes */
 static int bDropTrailingLF = 1; /* drop trailing LF's on reception? */
+static int bParserChainCache = 0; /* try last successful parser first (per input and sender)? */
 
 /* This is the list of all parsers known to us.
  * This is also used to unload all modules on shutdown.
@@ -208,6 +235,20 @@ rsRetVal parserConstructFinalize(parser_t *pThis)
 	DEFiRet;
 
 	ISOBJ_TYPE_assert(pThis, parser);
+
+	CHKiRet(statsobj.Construct(&pThis->stats));
+	CHKiRet(statsobj.SetName(pThis->stats, pThis->pName));
+	STATSCOUNTER_INIT(pThis->ctrAttempted, pThis->mutCtrAttempted);
+	CHKiRet(statsobj.AddCounter(pThis->stats, UCHAR_CONSTANT("attempted"),
+		ctrType_IntCtr, &pThis->ctrAttempted));
+	STATSCOUNTER_INIT(pThis->ctrSucceeded, pThis->mutCtrSucceeded);
+	CHKiRet(statsobj.AddCounter(pThis->stats, UCHAR_CONSTANT("succeeded"),
+		ctrType_IntCtr, &pThis->ctrSucceeded));
+	STATSCOUNTER_INIT(pThis->ctrCacheHit, pThis->mutCtrCacheHit);
+	CHKiRet(statsobj.AddCounter(pThis->stats, UCHAR_CONSTANT("cachehits"),
+		ctrType_IntCtr, &pThis->ctrCacheHit));
+	CHKiRet(statsobj.ConstructFinalize(pThis->stats));
+
 	CHKiRet(AddParserToList(&pParsLstRoot, pThis));
 	DBGPRINTF("Parser '%s' added to list of available parsers.\n", pThis->pName);
 
@@ -218,6 +259,8 @@ finalize_it:
 BEGINobjDestruct(parser) /* be sure to specify the object type also in END and CODESTART macros! */
 CODESTARTobjDestruct(parser)
 	DBGPRINTF("destructing parser '%s'\n", pThis->pName);
+	if(pThis->stats != NULL)
+		statsobj.Destruct(&pThis->stats);
 	free(pThis->pName);
 ENDobjDestruct(parser)
 
@@ -294,6 +337,55 @@ finalize_it:
 }
 
 
+/* A standard parser to parse out the PRI. This is made available in
+ * this module as it is expected that allmost all parsers will need
+ * that functionality and so they do not need to implement it themsleves.
+ * This works on a plain buffer, so that it can be called by the sanitizer
+ * before the message is rewritten. The PRI value is stored in *pPri and
+ * the offset of the first character after the PRI is returned.
+ */
+static inline int
+parsePRIFromBuf(uchar *msgStart, int lenMsg, int *pPri)
+{
+	int pri;
+	uchar *msg;
+
+	msg = msgStart;
+	pri = DEFUPRI;
+	if(*msg == '<') {
+		/* while we process the PRI, we also fill the PRI textual representation
+		 * inside the msg object. This may not be ideal from an OOP point of view,
+		 * but it offers us performance...
+		 */
+		pri = 0;
+		while(--lenMsg > 0 && isdigit((int) *++msg)) {
+			pri = 10 * pri + (*msg - '0');
+		}
+		if(*msg == '>')
+			++msg;
+		if(pri & ~(LOG_FACMASK|LOG_PRIMASK))
+			pri = DEFUPRI;
+	}
+	*pPri = pri;
+	return msg - msgStart;
+}
+
+
+/* store the PRI (as obtained by parsePRIFromBuf()) in the message object */
+static inline void
+setPRI(msg_t *pMsg, int pri, int offAfterPRI)
+{
+	if(pMsg->msgFlags & NO_PRI_IN_RAW) {
+		/* In this case, simply do so as if the pri would be right at top */
+		MsgSetAfterPRIOffs(pMsg, 0);
+	} else {
+		pMsg->iFacility = LOG_FAC(pri);
+		pMsg->iSeverity = LOG_PRI(pri);
+		MsgSetAfterPRIOffs(pMsg, offAfterPRI);
+	}
+}
+
+
 /* sanitize a received message
  * if a message gets to large during sanitization, it is truncated. This is
  * as specified in the upcoming syslog RFC series.
@@ -307,9 +399,15 @@ finalize_it:
  * really matter. Just to be on the save side, we'll log destruction of such
  * NULs in the debug log.
  * rgerhards, 2007-09-14
+ * If bDoPRI is set, the PRI is parsed in the same pass (this saves us from
+ * touching the message once again). The PRI is obtained from the original
+ * buffer, before control characters are escaped. This gives the same result
+ * as parsing the sanitized message: PRI parsing stops at the first non-digit,
+ * and everything in front of the first escaped character is unchanged (unless
+ * the escape character itself is a digit or '>', which we handle below).
  */
 static inline rsRetVal
-SanitizeMsg(msg_t *pMsg)
+sanitizeMsgAndParsePRI(msg_t *pMsg, sbool bDoPRI)
 {
 	DEFiRet;
 	uchar *pszMsg;
@@ -319,6 +417,9 @@ SanitizeMsg(msg_t *pMsg)
 	size_t iDst;
 	size_t iMaxLine;
 	size_t maxDest;
+	size_t lenRun;
+	int pri = DEFUPRI;
+	int offAfterPRI = 0;
 	sbool bUpdatedLen = RSFALSE;
 	uchar szSanBuf[32*1024]; /* buffer used for sanitizing a string */
 
@@ -350,6 +451,9 @@ SanitizeMsg(msg_t *pMsg)
 		bUpdatedLen = RSTRUE;
 	}
 
+	if(bDoPRI && !(pMsg->msgFlags & NO_PRI_IN_RAW))
+		offAfterPRI = parsePRIFromBuf(pszMsg, lenMsg, &pri);
+
 	/* it is much quicker to sweep over the message and see if it actually
 	 * needs sanitation than to do the sanitation in any case. So we first do
 	 * this and terminate when it is not needed - which is expectedly the case
@@ -359,9 +463,11 @@ SanitizeMsg(msg_t *pMsg)
 	 * like to pay the performance penalty. So the penalty is only with those
 	 * that actually use it, because we may call the sanitizer without actual
 	 * need below (but it then still will work perfectly well!). -- rgerhards, 2009-11-27
+	 * The sweep skips clean runs via escScanCtl(), which checks 16 or 32
+	 * bytes at once.
 	 */
 	int bNeedSanitize = 0;
-	for(iSrc = 0 ; iSrc < lenMsg ; iSrc++) {
+	for(iSrc = 0 ; (iSrc += escScanCtl(pszMsg + iSrc, lenMsg - iSrc, bEscape8BitChars)) < lenMsg ; iSrc++) {
 		if(pszMsg[iSrc] < 32) {
 			if(bSpaceLFOnRcv && pszMsg[iSrc] == '\n')
 				pszMsg[iSrc] = ' ';
@@ -370,7 +476,7 @@ SanitizeMsg(msg_t *pMsg)
 				if (!bSpaceLFOnRcv)
 					break;
 			}
-		} else if(pszMsg[iSrc] > 127 && bEscape8BitChars) {
+		} else { /* > 127 and bEscape8BitChars */
 			bNeedSanitize = 1;
 			break;
 		}
@@ -399,6 +505,15 @@ SanitizeMsg(msg_t *pMsg)
 	}
 	iDst = iSrc;
 	while(iSrc < lenMsg && iDst < maxDest - 3) { /* leave some space if last char must be escaped */
+		/* copy the run of characters that need no escaping in one go */
+		lenRun = escScanCtl(pszMsg + iSrc, lenMsg - iSrc, bEscape8BitChars);
+		if(lenRun > maxDest - 3 - iDst)
+			lenRun = maxDest - 3 - iDst;
+		memcpy(pDst + iDst, pszMsg + iSrc, lenRun);
+		iSrc += lenRun;
+		iDst += lenRun;
+		if(iSrc == lenMsg || iDst >= maxDest - 3)
+			break;
 		if((pszMsg[iSrc] < 32) && (pszMsg[iSrc] != '\t' || bEscapeTab)) {
 			/* note: \0 must always be escaped, the rest of the code currently
 			 * can not handle it! -- rgerhards, 2009-08-26
@@ -429,70 +544,204 @@ SanitizeMsg(msg_t *pMsg)
 	pDst[iDst] = '\0';
 
 	MsgSetRawMsg(pMsg, (char*)pDst, iDst); /* save sanitized string */
+	if(bDoPRI && !(pMsg->msgFlags & NO_PRI_IN_RAW) && (isdigit(cCCEscapeChar) || cCCEscapeChar == '>')) {
+		/* an escape sequence may have become part of the PRI */
+		offAfterPRI = parsePRIFromBuf(pMsg->pszRawMsg, pMsg->iLenRawMsg, &pri);
+	}
 
 	if(pDst != szSanBuf)
 		free(pDst);
 
 finalize_it:
+	if(bDoPRI && iRet == RS_RET_OK)
+		setPRI(pMsg, pri, offAfterPRI);
 	RETiRet;
 }
 
-/* A standard parser to parse out the PRI. This is made available in
- * this module as it is expected that allmost all parsers will need
- * that functionality and so they do not need to implement it themsleves.
+
+static rsRetVal
+SanitizeMsg(msg_t *pMsg)
+{
+	return sanitizeMsgAndParsePRI(pMsg, RSFALSE);
+}
+
+
+/* do message sanitazion and PRI parsing, if the parser requests it and it
+ * has not already been done for this message.
  */
 static inline rsRetVal
-ParsePRI(msg_t *pMsg)
+prepareMsgForParser(msg_t *pMsg, parser_t *pParser, sbool *pbIsSanitized, sbool *pbPRIisParsed)
 {
-	int pri;
-	uchar *msg;
-	int lenMsg;
 	DEFiRet;
 
-	/* pull PRI */
-	lenMsg = pMsg->iLenRawMsg;
-	msg = pMsg->pszRawMsg;
-	pri = DEFUPRI;
-	if(pMsg->msgFlags & NO_PRI_IN_RAW) {
-		/* In this case, simply do so as if the pri would be right at top */
-		MsgSetAfterPRIOffs(pMsg, 0);
-	} else {
-		if(*msg == '<') {
-			/* while we process the PRI, we also fill the PRI textual representation
-			 * inside the msg object. This may not be ideal from an OOP point of view,
-			 * but it offers us performance...
-			 */
-			pri = 0;
-			while(--lenMsg > 0 && isdigit((int) *++msg)) {
-				pri = 10 * pri + (*msg - '0');
-			}
-			if(*msg == '>')
-				++msg;
-			if(pri & ~(LOG_FACMASK|LOG_PRIMASK))
-				pri = DEFUPRI;
+	if(pParser->bDoSanitazion && *pbIsSanitized == RSFALSE) {
+		if(pParser->bDoPRIParsing && *pbPRIisParsed == RSFALSE) {
+			CHKiRet(sanitizeMsgAndParsePRI(pMsg, RSTRUE));
+			*pbPRIisParsed = RSTRUE;
+		} else {
+			CHKiRet(SanitizeMsg(pMsg));
 		}
-		pMsg->iFacility = LOG_FAC(pri);
-		pMsg->iSeverity = LOG_PRI(pri);
-		MsgSetAfterPRIOffs(pMsg, msg - pMsg->pszRawMsg);
+		*pbIsSanitized = RSTRUE;
 	}
+
+finalize_it:
 	RETiRet;
 }
 
 
+/* call a parser module and update its counters */
+static inline rsRetVal
+callParser(parser_t *pParser, msg_t *pMsg)
+{
+	rsRetVal localRet;
+
+	STATSCOUNTER_INC(pParser->ctrAttempted, pParser->mutCtrAttempted);
+	localRet = pParser->pModule->mod.pm.parse(pMsg);
+	DBGPRINTF("Parser '%s' returned %d\n", pParser->pName, localRet);
+	if(localRet == RS_RET_OK) {
+		STATSCOUNTER_INC(pParser->ctrSucceeded, pParser->mutCtrSucceeded);
+	}
+	return localRet;
+}
+
+
+/* call a parser module for a group of messages and update its counters.
+ * Modules without a batch entry point are called once for each message.
+ */
+static inline void
+callParserBatch(parser_t *pParser, msg_t **ppMsg, int nMsgs, rsRetVal *pRet)
+{
+	int i;
+	int nOK;
+
+	if(pParser->pModule->mod.pm.parseBatch == NULL) {
+		for(i = 0 ; i < nMsgs ; ++i)
+			pRet[i] = callParser(pParser, ppMsg[i]);
+		return;
+	}
+
+	STATSCOUNTER_ADD(pParser->ctrAttempted, pParser->mutCtrAttempted, nMsgs);
+	if(pParser->pModule->mod.pm.parseBatch(ppMsg, nMsgs, pRet) != RS_RET_OK) {
+		/* the batch as a whole failed (e.g. out of memory), so we try message by message */
+		DBGPRINTF("Parser '%s': batch entry point failed, retrying per message\n", pParser->pName);
+		for(i = 0 ; i < nMsgs ; ++i)
+			pRet[i] = pParser->pModule->mod.pm.parse(ppMsg[i]);
+	}
+	nOK = 0;
+	for(i = 0 ; i < nMsgs ; ++i)
+		if(pRet[i] == RS_RET_OK)
+			++nOK;
+	DBGPRINTF("Parser '%s' parsed %d of %d messages\n", pParser->pName, nOK, nMsgs);
+	STATSCOUNTER_ADD(pParser->ctrSucceeded, pParser->mutCtrSucceeded, nOK);
+}
+
+
+/* We need to log a warning message and drop the message if we did not find a parser.
+ * Note that we log at most the first 1000 message, as this may very well be a problem
+ * that causes a message generation loop. We do not synchronize that counter, it doesn't
+ * matter if we log a handful messages more than we should...
+ */
+static void
+reportUnparsable(msg_t *pMsg, rsRetVal localRet)
+{
+	static int iErrMsgRateLimiter = 0;
+
+	if(++iErrMsgRateLimiter > 1000) {
+		errmsg.LogError(0, localRet, "Error: one message could not be processed by "
+			"any parser, message is being discarded (start of raw msg: '%.50s')", 
+			pMsg->pszRawMsg);
+	}
+	DBGPRINTF("No parser could process the message (state %d), we need to discard it.\n", localRet);
+}
+
+
+/* add len bytes to a FNV-1a hash */
+static inline uint64
+parsCacheHashAdd(uint64 hash, uchar *p, size_t len)
+{
+	size_t i;
+
+	for(i = 0 ; i < len ; ++i) {
+		hash ^= p[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+
+/* compute the parser chain cache key of a message, a hash over its input
+ * name and sender. We must not trigger DNS resolution here, so for
+ * unresolved messages the raw socket address is used.
+ */
+static inline uint64
+parsCacheKey(msg_t *pMsg)
+{
+	struct sockaddr_storage *sa;
+	uint64 hash = 14695981039346656037ULL;
+
+	if(pMsg->pInputName != NULL)
+		hash = parsCacheHashAdd(hash, propGetSzStr(pMsg->pInputName), pMsg->pInputName->len);
+	hash = parsCacheHashAdd(hash, UCHAR_CONSTANT(""), 1); /* separator (the NUL) */
+	if(pMsg->msgFlags & NEEDS_DNSRESOL) {
+		sa = pMsg->rcvFrom.pfrominet;
+		if(sa != NULL && sa->ss_family == AF_INET) {
+			hash = parsCacheHashAdd(hash, (uchar*) &((struct sockaddr_in*) sa)->sin_addr,
+						sizeof(struct in_addr));
+		} else if(sa != NULL && sa->ss_family == AF_INET6) {
+			hash = parsCacheHashAdd(hash, (uchar*) &((struct sockaddr_in6*) sa)->sin6_addr,
+						sizeof(struct in6_addr));
+		}
+	} else if(pMsg->pRcvFromIP != NULL) {
+		hash = parsCacheHashAdd(hash, propGetSzStr(pMsg->pRcvFromIP), pMsg->pRcvFromIP->len);
+	}
+	return hash;
+}
+
+
+/* obtain the parser chain cache entry for hash value hash of the current
+ * thread. Returns NULL if no cache could be allocated, in which case the
+ * caller must do without.
+ */
+static inline parsCacheEntry_t *
+parsCacheGetEntry(uint64 hash)
+{
+	parsCacheEntry_t *pCache;
+
+	if((pCache = pthread_getspecific(keyParsCache)) == NULL) {
+		if((pCache = calloc(PARSCACHE_NUM_ENTRIES, sizeof(parsCacheEntry_t))) == NULL)
+			return NULL;
+		if(pthread_setspecific(keyParsCache, pCache) != 0) {
+			free(pCache);
+			return NULL;
+		}
+	}
+	return pCache + (hash & (PARSCACHE_NUM_ENTRIES - 1));
+}
+
+
 /* Parse a received message. The object's rawmsg property is taken and
  * parsed according to the relevant standards. This can later be
  * extended to support configured parsers.
  * rgerhards, 2008-10-09
+ * If the parser chain cache is enabled, the parser that accepted the last
+ * message of the same input and sender is tried first. If it fails, we
+ * walk the full chain (skipping that parser). The cache is only used if
+ * the first parser of the chain requests sanitazion: then all parsers see
+ * the very same (sanitized) message, no matter in which order they are
+ * called. This is the case for all parsers shipped with rsyslog.
  */
 static rsRetVal
 ParseMsg(msg_t *pMsg)
 {
 	rsRetVal localRet = RS_RET_ERR;
 	parserList_t *pParserList;
+	parserList_t *pThis;
+	parserList_t *pTried;
 	parser_t *pParser;
+	parsCacheEntry_t *pCacheEntry;
+	uint64 hash = 0;
 	sbool bIsSanitized;
 	sbool bPRIisParsed;
-	static int iErrMsgRateLimiter = 0;
 	DEFiRet;
 
 	if(pMsg->iLenRawMsg == 0)
@@ -523,35 +772,43 @@ ParseMsg(msg_t *pMsg)
 
 	bIsSanitized = RSFALSE;
 	bPRIisParsed = RSFALSE;
-	while(pParserList != NULL) {
-		pParser = pParserList->pParser;
-		if(pParser->bDoSanitazion && bIsSanitized == RSFALSE) {
-			CHKiRet(SanitizeMsg(pMsg));
-			if(pParser->bDoPRIParsing && bPRIisParsed == RSFALSE) {
-				CHKiRet(ParsePRI(pMsg));
-				bPRIisParsed = RSTRUE;
+	pCacheEntry = NULL;
+	pTried = NULL;
+	if(bParserChainCache && pParserList != NULL && pParserList->pParser->bDoSanitazion) {
+		hash = parsCacheKey(pMsg);
+		pCacheEntry = parsCacheGetEntry(hash);
+		if(   pCacheEntry != NULL && pCacheEntry->hash == hash && pCacheEntry->pList == pParserList
+		   && pCacheEntry->pHit != pParserList) {
+			pTried = pCacheEntry->pHit;
+			/* prepare the message as the head of the chain would have done */
+			CHKiRet(prepareMsgForParser(pMsg, pParserList->pParser, &bIsSanitized, &bPRIisParsed));
+			localRet = callParser(pTried->pParser, pMsg);
+			if(localRet != RS_RET_COULD_NOT_PARSE) {
+				STATSCOUNTER_INC(pTried->pParser->ctrCacheHit, pTried->pParser->mutCtrCacheHit);
 			}
-			bIsSanitized = RSTRUE;
 		}
-		localRet = pParser->pModule->mod.pm.parse(pMsg);
-		DBGPRINTF("Parser '%s' returned %d\n", pParser->pName, localRet);
-		if(localRet != RS_RET_COULD_NOT_PARSE)
-			break;
-		pParserList = pParserList->pNext;
 	}
 
-	/* We need to log a warning message and drop the message if we did not find a parser.
-	 * Note that we log at most the first 1000 message, as this may very well be a problem
-	 * that causes a message generation loop. We do not synchronize that counter, it doesn't
-	 * matter if we log a handful messages more than we should...
-	 */
-	if(localRet != RS_RET_OK) {
-		if(++iErrMsgRateLimiter > 1000) {
-			errmsg.LogError(0, localRet, "Error: one message could not be processed by "
-			 	"any parser, message is being discarded (start of raw msg: '%.50s')", 
-				pMsg->pszRawMsg);
+	if(pTried == NULL || localRet == RS_RET_COULD_NOT_PARSE) {
+		for(pThis = pParserList ; pThis != NULL ; pThis = pThis->pNext) {
+			if(pThis == pTried)
+				continue; /* already failed */
+			pParser = pThis->pParser;
+			CHKiRet(prepareMsgForParser(pMsg, pParser, &bIsSanitized, &bPRIisParsed));
+			localRet = callParser(pParser, pMsg);
+			if(localRet != RS_RET_COULD_NOT_PARSE)
+				break;
 		}
-		DBGPRINTF("No parser could process the message (state %d), we need to discard it.\n", localRet);
+		if(pCacheEntry != NULL && localRet == RS_RET_OK) {
+			pCacheEntry->hash = hash;
+			pCacheEntry->pList = pParserList;
+			pCacheEntry->pHit = pThis;
+		}
+	}
+
+	/* We need to log a warning message and drop the message if we did not find a parser. */
+	if(localRet != RS_RET_OK) {
+		reportUnparsable(pMsg, localRet);
 		ABORT_FINALIZE(localRet);
 	}
 
@@ -562,6 +819,194 @@ finalize_it:
 	RETiRet;
 }
 
+
+/* get the parser list to be used for a message */
+static inline parserList_t *
+getParserListForMsg(msg_t *pMsg)
+{
+	parserList_t *pParserList;
+
+	pParserList = ruleset.GetParserList(ourConf, pMsg);
+	return (pParserList == NULL) ? pDfltParsLst : pParserList;
+}
+
+
+/* parse the messages of a batch one by one via ParseMsg(). Messages that
+ * can not be parsed are flagged as discarded in the batch.
+ */
+static void
+parseBatchPerMsg(batch_t *pBatch)
+{
+	msg_t *pMsg;
+	int i;
+
+	for(i = 0 ; i < pBatch->nElem && !*(pBatch->pbShutdownImmediate) ; ++i) {
+		pMsg = pBatch->pElem[i].pMsg;
+		if(pBatch->eltState[i] != BATCH_STATE_DISC && (pMsg->msgFlags & NEEDS_PARSING)) {
+			if(ParseMsg(pMsg) != RS_RET_OK)
+				pBatch->eltState[i] = BATCH_STATE_DISC;
+		}
+	}
+}
+
+
+/* parse all messages of a batch that need parsing. This does the same as
+ * calling ParseMsg() for each of them, but works in stages: first, all
+ * messages are collected and grouped by parser list (usually, there is
+ * only one). Then, each parser of the chain is handed the whole group of
+ * messages that no earlier parser could handle. So sanitization and PRI
+ * parsing run in one tight loop over the group, and parser modules that
+ * provide a batch entry point can amortize their setup cost.
+ * Messages that can not be parsed are flagged as discarded in the batch.
+ * As the parser chain cache selects parsers per sender, we fall back to
+ * per-message parsing if it is enabled. We do the same if the work arrays
+ * can not be allocated, so that a low memory condition does not cost us
+ * the whole batch.
+ */
+static rsRetVal
+ParseBatch(batch_t *pBatch)
+{
+	msg_t **ppMsg = NULL;	/* messages that still need to be parsed */
+	int *pIdx = NULL;	/* their index inside the batch */
+	rsRetVal *pRet = NULL;	/* per-message parse result */
+	parserList_t *pParserList;
+	parserList_t *pThis;
+	parser_t *pParser;
+	msg_t *pMsg;
+	sbool bIsSanitized;
+	sbool bPRIisParsed;
+	int nMsgs;
+	int nGrp;
+	int nPending;
+	int nKeep;
+	int i;
+	int j;
+	DEFiRet;
+
+	if(bParserChainCache) {
+		parseBatchPerMsg(pBatch);
+		FINALIZE;
+	}
+
+	ppMsg = malloc(pBatch->nElem * sizeof(msg_t*));
+	pIdx = malloc(pBatch->nElem * sizeof(int));
+	pRet = malloc(pBatch->nElem * sizeof(rsRetVal));
+	if(ppMsg == NULL || pIdx == NULL || pRet == NULL) {
+		/* the batch can still be parsed, just not in stages */
+		DBGPRINTF("batch parser: out of memory, parsing messages one by one\n");
+		parseBatchPerMsg(pBatch);
+		FINALIZE;
+	}
+
+	/* first stage: collect the messages in need of parsing */
+	nMsgs = 0;
+	for(i = 0 ; i < pBatch->nElem && !*(pBatch->pbShutdownImmediate) ; ++i) {
+		pMsg = pBatch->pElem[i].pMsg;
+		if(pBatch->eltState[i] == BATCH_STATE_DISC || !(pMsg->msgFlags & NEEDS_PARSING))
+			continue;
+		if(pMsg->iLenRawMsg == 0) {
+			pBatch->eltState[i] = BATCH_STATE_DISC;
+			continue;
+		}
+#		ifdef USE_NETZIP
+		if(uncompressMessage(pMsg) != RS_RET_OK) {
+			pBatch->eltState[i] = BATCH_STATE_DISC;
+			continue;
+		}
+#		endif
+		ppMsg[nMsgs] = pMsg;
+		pIdx[nMsgs] = i;
+		++nMsgs;
+	}
+
+	while(nMsgs > 0) {
+		/* move all messages using the same parser list as the first one to the front */
+		pParserList = getParserListForMsg(ppMsg[0]);
+		nGrp = 0;
+		for(i = 0 ; i < nMsgs ; ++i) {
+			if(getParserListForMsg(ppMsg[i]) == pParserList) {
+				pMsg = ppMsg[i];
+				ppMsg[i] = ppMsg[nGrp];
+				ppMsg[nGrp] = pMsg;
+				j = pIdx[i];
+				pIdx[i] = pIdx[nGrp];
+				pIdx[nGrp] = j;
+				++nGrp;
+			}
+		}
+		DBGPRINTF("batch parser: %d messages for parser list %p%s\n", nGrp, pParserList,
+			  (pParserList == pDfltParsLst) ? " (the default list)" : "");
+
+		/* now run the group through the chain. All messages still pending at a
+		 * given parser went through the same preparation steps, so we need to
+		 * track the sanitization state only once for the group.
+		 */
+		bIsSanitized = RSFALSE;
+		bPRIisParsed = RSFALSE;
+		nPending = nGrp;
+		for(pThis = pParserList ; pThis != NULL && nPending > 0 ; pThis = pThis->pNext) {
+			pParser = pThis->pParser;
+			if(pParser->bDoSanitazion && bIsSanitized == RSFALSE) {
+				for(j = 0 ; j < nPending ; ++j) {
+					if(pParser->bDoPRIParsing && bPRIisParsed == RSFALSE)
+						pRet[j] = sanitizeMsgAndParsePRI(ppMsg[j], RSTRUE);
+					else
+						pRet[j] = SanitizeMsg(ppMsg[j]);
+				}
+				if(pParser->bDoPRIParsing)
+					bPRIisParsed = RSTRUE;
+				bIsSanitized = RSTRUE;
+				/* drop messages that could not be sanitized */
+				nKeep = 0;
+				for(j = 0 ; j < nPending ; ++j) {
+					if(pRet[j] == RS_RET_OK) {
+						ppMsg[nKeep] = ppMsg[j];
+						pIdx[nKeep] = pIdx[j];
+						++nKeep;
+					} else {
+						pBatch->eltState[pIdx[j]] = BATCH_STATE_DISC;
+					}
+				}
+				nPending = nKeep;
+			}
+
+			callParserBatch(pParser, ppMsg, nPending, pRet);
+
+			nKeep = 0;
+			for(j = 0 ; j < nPending ; ++j) {
+				if(pRet[j] == RS_RET_COULD_NOT_PARSE) {
+					ppMsg[nKeep] = ppMsg[j];
+					pIdx[nKeep] = pIdx[j];
+					++nKeep;
+				} else if(pRet[j] == RS_RET_OK) {
+					ppMsg[j]->msgFlags &= ~NEEDS_PARSING; /* this message is now parsed */
+				} else {
+					reportUnparsable(ppMsg[j], pRet[j]);
+					pBatch->eltState[pIdx[j]] = BATCH_STATE_DISC;
+				}
+			}
+			nPending = nKeep;
+		}
+
+		/* what is still pending could not be processed by any parser */
+		for(j = 0 ; j < nPending ; ++j) {
+			reportUnparsable(ppMsg[j], RS_RET_COULD_NOT_PARSE);
+			pBatch->eltState[pIdx[j]] = BATCH_STATE_DISC;
+		}
+
+		/* the group is done, remove it */
+		nMsgs -= nGrp;
+		memmove(ppMsg, ppMsg + nGrp, nMsgs * sizeof(msg_t*));
+		memmove(pIdx, pIdx + nGrp, nMsgs * sizeof(int));
+	}
+
+finalize_it:
+	free(ppMsg);
+	free(pIdx);
+	free(pRet);
+	RETiRet;
+}
+
 /* set the parser name - string is copied over, call can continue to use it,
  * but must free it if desired.
  */
@@ -644,6 +1089,7 @@ CODESTARTobjQueryInterface(parser)
 	pIf->SetDoSanitazion = SetDoSanitazion;
 	pIf->SetDoPRIParsing = SetDoPRIParsing;
 	pIf->ParseMsg = ParseMsg;
+	pIf->ParseBatch = ParseBatch;
 	pIf->SanitizeMsg = SanitizeMsg;
 	pIf->InitParserList = InitParserList;
 	pIf->DestructParserList = DestructParserList;
@@ -667,6 +1113,7 @@ resetConfigVariables(uchar __attribute__((unused)) *pp, void __attribute__((unus
 	bEscape8BitChars = 0; /* default is to escape control characters */
 	bEscapeTab = 1; /* default is to escape control characters */
 	bDropTrailingLF = 1; /* default is to drop trailing LF's on reception */
+	bParserChainCache = 0;
 
 	return RS_RET_OK;
 }
@@ -700,6 +1147,7 @@ BEGINObjClassExit(parser, OBJ_IS_CORE_MODULE) /* class, version */
 	objRelease(errmsg, CORE_COMPONENT);
 	objRelease(datetime, CORE_COMPONENT);
 	objRelease(ruleset, CORE_COMPONENT);
+	objRelease(statsobj, CORE_COMPONENT);
 ENDObjClassExit(parser)
 
 
@@ -713,6 +1161,9 @@ BEGINObjClassInit(parser, 1, OBJ_IS_CORE_MODULE) /* class, version */
 	CHKiRet(objUse(errmsg, CORE_COMPONENT));
 	CHKiRet(objUse(datetime, CORE_COMPONENT));
 	CHKiRet(objUse(ruleset, CORE_COMPONENT));
+	CHKiRet(objUse(statsobj, CORE_COMPONENT));
+	if(pthread_key_create(&keyParsCache, free) != 0)
+		ABORT_FINALIZE(RS_RET_ERR);
 
 	CHKiRet(regCfSysLineHdlr((uchar *)"controlcharacterescapeprefix", 0, eCmdHdlrGetChar, NULL, &cCCEscapeChar, NULL));
 	CHKiRet(regCfSysLineHdlr((uchar *)"droptrailinglfonreception", 0, eCmdHdlrBinary, NULL, &bDropTrailingLF, NULL));
@@ -720,6 +1171,7 @@ BEGINObjClassInit(parser, 1, OBJ_IS_CORE_MODULE) /* class, version */
 	CHKiRet(regCfSysLineHdlr((uchar *)"spacelfonreceive", 0, eCmdHdlrBinary, NULL, &bSpaceLFOnRcv, NULL));
 	CHKiRet(regCfSysLineHdlr((uchar *)"escape8bitcharactersonreceive", 0, eCmdHdlrBinary, NULL, &bEscape8BitChars, NULL));
 	CHKiRet(regCfSysLineHdlr((uchar *)"escapecontrolcharactertab", 0, eCmdHdlrBinary, NULL, &bEscapeTab, NULL));
+	CHKiRet(regCfSysLineHdlr((uchar *)"parserchaincache", 0, eCmdHdlrBinary, NULL, &bParserChainCache, NULL));
 	CHKiRet(regCfSysLineHdlr((uchar *)"resetconfigvariables", 1, eCmdHdlrCustomHandler, resetConfigVariables, NULL, NULL));
 
 	InitParserList(&pParsLstRoot);
@@ -21,6 +21,8 @@
 #ifndef INCLUDED_PARSER_H
 #define INCLUDED_PARSER_H
 
+#include "statsobj.h"
+
 
 /* we create a small helper object, a list of parsers, that we can use to
  * build a chain of them whereever this is needed (initially thought to be
@@ -39,6 +41,10 @@ struct parser_s {
 	modInfo_t *pModule;	/* pointer to parser's module */
 	sbool bDoSanitazion;	/* do standard message sanitazion before calling parser? */
 	sbool bDoPRIParsing;	/* do standard PRI parsing before calling parser? */
+	statsobj_t *stats;	/* attempt/success counters, reported via impstats */
+	STATSCOUNTER_DEF(ctrAttempted, mutCtrAttempted)
+	STATSCOUNTER_DEF(ctrSucceeded, mutCtrSucceeded)
+	STATSCOUNTER_DEF(ctrCacheHit, mutCtrCacheHit)
 };
 
 /* interfaces */
@@ -59,8 +65,10 @@ BEGINinterface(parser) /* name must also be changed in ENDinterface macro! */
 	rsRetVal (*ParseMsg)(msg_t *pMsg);
 	rsRetVal (*SanitizeMsg)(msg_t *pMsg);
 	rsRetVal (*AddDfltParser)(uchar *);
+	/* v2 added ParseBatch() */
+	rsRetVal (*ParseBatch)(batch_t *pBatch);
 ENDinterface(parser)
-#define parserCURR_IF_VERSION 1 /* increment whenever you change the interface above! */
+#define parserCURR_IF_VERSION 2 /* increment whenever you change the interface above! */
 
 void printParserList(parserList_t *pList);
 
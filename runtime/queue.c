@@ -1612,6 +1612,9 @@ DequeueConsumableElements(qqueue_t *pThis, wti_t *pWti, int *piRemainingQueueSiz
 
 		/* all well, use this element */
 		pWti->batch.pElem[nDequeued].pMsg = pMsg;
+		/* the msg_t may be at the address of an already destructed one */
+		memset(pWti->batch.pElem[nDequeued].pCachedTpl, 0,
+		       sizeof(pWti->batch.pElem[nDequeued].pCachedTpl));
 		pWti->batch.eltState[nDequeued] = BATCH_STATE_RDY;
 		++nDequeued;
 	}
@@ -1299,6 +1299,7 @@ ourConf = loadConf; // TODO: remove, once ourConf is gone!
 	}
 	tellLexEndParsing();
 	rulesetOptimizeAll(loadConf);
+	CHKiRet(tplCompileAll(loadConf));
 
 	tellCoreConfigLoadDone();
 	tellModulesConfigLoadDone();
@@ -33,6 +33,8 @@
  * ############################################################# */
 #define CONST_LEN_TIMESTAMP_3164 15 		/* number of chars (excluding \0!) in a RFC3164 timestamp */
 #define CONST_LEN_TIMESTAMP_3339 32 		/* number of chars (excluding \0!) in a RFC3339 timestamp */
+#define CONST_LEN_TIMESTAMP_MYSQL 14 		/* number of chars (excluding \0!) in a MySQL timestamp */
+#define CONST_LEN_TIMESTAMP_PGSQL 19 		/* number of chars (excluding \0!) in a PgSQL timestamp */
 
 /* ############################################################# *
  * #                    Config Settings                        # *
@@ -402,6 +404,7 @@ enum rsRetVal_				/** return value. All methods return this if not specified oth
 	RS_RET_INVLD_MODE = -2311,/**< invalid mode specified in configuration */
 	RS_RET_INVLD_ANON_BITS = -2312,/**< mmanon: invalid number of bits to anonymize specified */
 	RS_RET_REPLCHAR_IGNORED = -2313,/**< mmanon: replacementChar parameter is ignored */
+	RS_RET_JSONW_NESTING = -2314,/**< JSON writer: containers nested too deep or not properly closed */
 	RS_RET_SIGPROV_ERR = -2320,/**< error in signature provider */
 
 	/* RainerScript error messages (range 1000.. 1999) */
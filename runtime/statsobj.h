@@ -147,6 +147,10 @@ PROTOTYPEObj(statsobj);
 	if(GatherStats) \
 		ATOMIC_DEC_uint64(&ctr, mut);
 
+#define STATSCOUNTER_ADD(ctr, mut, delta) \
+	if(GatherStats) \
+		ATOMIC_ADD_uint64(&ctr, &mut, delta);
+
 /* the next macro works only if the variable is already guarded
  * by mutex (or the users risks a wrong result). It is assumed 
  * that there are not concurrent operations that modify the counter.
@@ -731,6 +731,98 @@ finalize_it:
 }
 
 
+/* read a line from a strm file without copying it, for high-volume readers.
+ * Whole buffers are searched for the LF with memchr() instead of going
+ * through strmReadChar() for every octet. On success, *ppLine points to the
+ * line (without the terminating LF) and *pLenLine is its length. In most
+ * cases, the line is a slice of the stream's I/O buffer. Lines that span
+ * buffer boundaries are assembled in a separate buffer. In any case, the
+ * returned data is only valid until the next read call on the stream, so
+ * the caller must copy it if it needs to keep it.
+ * This is equivalent to ReadLine() in mode 0, including the handling of
+ * incomplete lines at EOF, which are kept in prevLineSegment until the rest
+ * of the line becomes available. The LF is consumed, but it is not part of
+ * the returned line.
+ */
+static rsRetVal
+strmReadLineSlice(strm_t *pThis, uchar **ppLine, size_t *pLenLine)
+{
+	uchar *pStart;
+	uchar *pLF;
+	uchar c;
+	size_t lenAvail;
+	size_t lenLine;
+	DEFiRet;
+
+	ASSERT(pThis != NULL);
+	ASSERT(ppLine != NULL);
+	ASSERT(pLenLine != NULL);
+
+	if(pThis->iUngetC != -1) { /* very rare, only ReadLine() in mode 2 leaves one */
+		if(pThis->prevLineSegment == NULL)
+			CHKiRet(cstrConstruct(&pThis->prevLineSegment));
+		++pThis->iCurrOffs;
+		c = (uchar) pThis->iUngetC;
+		pThis->iUngetC = -1;
+		if(c == '\n') {
+			pStart = NULL;
+			lenLine = 0;
+			goto assemble;
+		}
+		CHKiRet(cstrAppendChar(pThis->prevLineSegment, c));
+	}
+
+	while(1) {
+		if(pThis->iBufPtr >= pThis->iBufPtrMax) {
+			/* EOF is returned to the caller; an incomplete line, if any,
+			 * is already in prevLineSegment.
+			 */
+			CHKiRet(strmReadBuf(pThis));
+		}
+		pStart = pThis->pIOBuf + pThis->iBufPtr;
+		lenAvail = pThis->iBufPtrMax - pThis->iBufPtr;
+		pLF = memchr(pStart, '\n', lenAvail);
+		if(pLF == NULL) {
+			/* no complete line in buffer, keep the segment and read on */
+			if(pThis->prevLineSegment == NULL)
+				CHKiRet(cstrConstruct(&pThis->prevLineSegment));
+			CHKiRet(rsCStrAppendStrWithLen(pThis->prevLineSegment, pStart, lenAvail));
+			pThis->iBufPtr += lenAvail;
+			pThis->iCurrOffs += lenAvail;
+			continue;
+		}
+		lenLine = pLF - pStart;
+		pThis->iBufPtr += lenLine + 1;
+		pThis->iCurrOffs += lenLine + 1;
+		break;
+	}
+
+	if(pThis->prevLineSegment == NULL) {
+		/* the usual case: the line is completely inside the buffer */
+		*ppLine = pStart;
+		*pLenLine = lenLine;
+		FINALIZE;
+	}
+
+assemble:
+	/* the line is assembled from previous segments and the current buffer. We
+	 * move it out of prevLineSegment, because that is persisted with the stream
+	 * and must only contain data not yet returned to the caller.
+	 */
+	if(lenLine > 0)
+		CHKiRet(rsCStrAppendStrWithLen(pThis->prevLineSegment, pStart, lenLine));
+	if(pThis->pLineAssembly != NULL)
+		cstrDestruct(&pThis->pLineAssembly);
+	pThis->pLineAssembly = pThis->prevLineSegment;
+	pThis->prevLineSegment = NULL;
+	*ppLine = rsCStrGetBufBeg(pThis->pLineAssembly);
+	*pLenLine = cstrLen(pThis->pLineAssembly);
+
+finalize_it:
+	RETiRet;
+}
+
+
 /* Standard-Constructor for the strm object
  */
 BEGINobjConstruct(strm) /* be sure to specify the object type also in END macro! */
@@ -743,6 +835,7 @@ BEGINobjConstruct(strm) /* be sure to specify the object type also in END macro!
 	pThis->sIOBufSize = glblGetIOBufSize();
 	pThis->tOpenMode = 0600;
 	pThis->prevLineSegment = NULL;
+	pThis->pLineAssembly = NULL;
 ENDobjConstruct(strm)
 
 
@@ -873,6 +966,10 @@ CODESTARTobjDestruct(strm)
 	free(pThis->pZipBuf);
 	free(pThis->pszCurrFName);
 	free(pThis->pszFName);
+	if(pThis->prevLineSegment != NULL)
+		cstrDestruct(&pThis->prevLineSegment);
+	if(pThis->pLineAssembly != NULL)
+		cstrDestruct(&pThis->pLineAssembly);
 	pThis->bStopWriter = 2; /* RG: use as flag for destruction */
 ENDobjDestruct(strm)
 
@@ -1906,6 +2003,7 @@ CODESTARTobjQueryInterface(strm)
 	pIf->ReadChar = strmReadChar;
 	pIf->UnreadChar = strmUnreadChar;
 	pIf->ReadLine = strmReadLine;
+	pIf->ReadLineSlice = strmReadLineSlice;
 	pIf->SeekCurrOffs = strmSeekCurrOffs;
 	pIf->Write = strmWrite;
 	pIf->WriteChar = strmWriteChar;
@@ -146,6 +146,7 @@ typedef struct strm_s {
 	uchar	*pszSizeLimitCmd;	/* command to carry out when size limit is reached */
 	sbool	bIsTTY;		/* is this a tty file? */
 	cstr_t *prevLineSegment; /* for ReadLine, previous, unwritten part of file */
+	cstr_t *pLineAssembly; /* for ReadLineSlice, line that spanned buffers (NOT persisted) */
 } strm_t;
 
 
@@ -190,8 +191,10 @@ BEGINinterface(strm) /* name must also be changed in ENDinterface macro! */
 	INTERFACEpropSetMeth(strm, bVeryReliableZip, int);
 	/* v8 added  2013-03-21 */
 	rsRetVal (*CheckFileChange)(strm_t *pThis);
+	/* v9 added ReadLineSlice() */
+	rsRetVal (*ReadLineSlice)(strm_t *pThis, uchar **ppLine, size_t *pLenLine);
 ENDinterface(strm)
-#define strmCURR_IF_VERSION 8 /* increment whenever you change the interface structure! */
+#define strmCURR_IF_VERSION 9 /* increment whenever you change the interface structure! */
 
 static inline int
 strmGetCurrFileNum(strm_t *pStrm) {
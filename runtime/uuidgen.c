@@ -0,0 +1,171 @@
+/* uuidgen.c
+ * Fast generation of (version 4, random) UUIDs.
+ *
+ * libuuid is not thread-safe, so previously every uuid was generated
+ * while holding a global mutex. That serializes all workers that use
+ * the $uuid property. Here, each thread seeds a private xorshift128+
+ * generator exactly once from libuuid and then creates UUIDs without
+ * any locking. The generated values carry the v4 version and variant
+ * bits. Note that they are unique, but not meant to be unpredictable.
+ *
+ * This file intentionally has no dependencies on the rest of the
+ * runtime, so that it can also be used by the benchmark in tests/.
+ *
+ * Copyright 2013 Adiscon GmbH.
+ *
+ * This file is part of the rsyslog runtime library.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *       -or-
+ *       see COPYING.ASL20 in the source distribution
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <unistd.h>
+#ifdef USE_LIBUUID
+#	include <uuid/uuid.h>
+#endif
+#include "uuidgen.h"
+
+/* per-thread generator state */
+typedef struct uuidgenState_s {
+	uint64_t s[2];
+} uuidgenState_t;
+
+static pthread_key_t keyState;
+static pthread_once_t onceKeyState = PTHREAD_ONCE_INIT;
+static pthread_mutex_t mutSeed = PTHREAD_MUTEX_INITIALIZER; /* libuuid is not thread-safe */
+
+/* hex representation of all byte values, saves us per-nibble work */
+static const char hexTab[513] =
+	"000102030405060708090A0B0C0D0E0F101112131415161718191A1B1C1D1E1F"
+	"202122232425262728292A2B2C2D2E2F303132333435363738393A3B3C3D3E3F"
+	"404142434445464748494A4B4C4D4E4F505152535455565758595A5B5C5D5E5F"
+	"606162636465666768696A6B6C6D6E6F707172737475767778797A7B7C7D7E7F"
+	"808182838485868788898A8B8C8D8E8F909192939495969798999A9B9C9D9E9F"
+	"A0A1A2A3A4A5A6A7A8A9AAABACADAEAFB0B1B2B3B4B5B6B7B8B9BABBBCBDBEBF"
+	"C0C1C2C3C4C5C6C7C8C9CACBCCCDCECFD0D1D2D3D4D5D6D7D8D9DADBDCDDDEDF"
+	"E0E1E2E3E4E5E6E7E8E9EAEBECEDEEEFF0F1F2F3F4F5F6F7F8F9FAFBFCFDFEFF";
+
+static void
+keyStateInit(void)
+{
+	pthread_key_create(&keyState, free);
+}
+
+
+/* obtain a random seed for a new thread's generator. We use libuuid if
+ * available (which reads /dev/urandom) and fall back to time and ids
+ * otherwise. A seed of all zero bits is invalid for xorshift, so we
+ * make sure we never return one.
+ */
+static void
+seedState(uuidgenState_t *pState)
+{
+#	ifdef USE_LIBUUID
+	uuid_t seed;
+
+	pthread_mutex_lock(&mutSeed);
+	uuid_generate(seed);
+	pthread_mutex_unlock(&mutSeed);
+	memcpy(pState->s, seed, sizeof(pState->s));
+#	else
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	pState->s[0] = ((uint64_t) tv.tv_sec << 20) ^ (uint64_t) tv.tv_usec;
+	pState->s[1] = ((uint64_t) getpid() << 32) ^ (uint64_t) (uintptr_t) pState;
+#	endif
+	if(pState->s[0] == 0 && pState->s[1] == 0)
+		pState->s[1] = 0x9E3779B97F4A7C15ULL;
+}
+
+
+static inline uint64_t
+xorshift128plus(uuidgenState_t *pState)
+{
+	uint64_t s1 = pState->s[0];
+	const uint64_t s0 = pState->s[1];
+
+	pState->s[0] = s0;
+	s1 ^= s1 << 23;
+	pState->s[1] = s1 ^ s0 ^ (s1 >> 17) ^ (s0 >> 26);
+	return pState->s[1] + s0;
+}
+
+
+/* obtain the current thread's generator state, creating and seeding it on
+ * first use. Returns NULL if no state could be set up.
+ */
+static inline uuidgenState_t *
+getState(void)
+{
+	uuidgenState_t *pState;
+
+	pthread_once(&onceKeyState, keyStateInit);
+	if((pState = pthread_getspecific(keyState)) == NULL) {
+		if((pState = malloc(sizeof(uuidgenState_t))) == NULL)
+			return NULL;
+		seedState(pState);
+		if(pthread_setspecific(keyState, pState) != 0) {
+			free(pState);
+			return NULL;
+		}
+	}
+	return pState;
+}
+
+
+/* generate a binary uuid into pUUID, which must have space for
+ * UUIDGEN_LEN_BIN bytes.
+ */
+void
+uuidgenGenerate(unsigned char *pUUID)
+{
+	uuidgenState_t *pState;
+	uuidgenState_t tmpState;
+	uint64_t r[2];
+
+	if((pState = getState()) == NULL) {
+		/* out of memory - a freshly seeded state still gives a unique value */
+		seedState(&tmpState);
+		pState = &tmpState;
+	}
+	r[0] = xorshift128plus(pState);
+	r[1] = xorshift128plus(pState);
+	memcpy(pUUID, r, UUIDGEN_LEN_BIN);
+	pUUID[6] = (pUUID[6] & 0x0f) | 0x40; /* version 4 */
+	pUUID[8] = (pUUID[8] & 0x3f) | 0x80; /* RFC 4122 variant */
+}
+
+
+/* generate a uuid as (upper case) hex string without dashes. pBuf must
+ * have space for UUIDGEN_LEN_HEX + 1 bytes, the string is \0-terminated.
+ */
+void
+uuidgenGenerateHex(unsigned char *pBuf)
+{
+	unsigned char uuid[UUIDGEN_LEN_BIN];
+	int i;
+
+	uuidgenGenerate(uuid);
+	for(i = 0 ; i < UUIDGEN_LEN_BIN ; ++i) {
+		pBuf[i * 2]     = hexTab[uuid[i] * 2];
+		pBuf[i * 2 + 1] = hexTab[uuid[i] * 2 + 1];
+	}
+	pBuf[UUIDGEN_LEN_HEX] = '\0';
+}
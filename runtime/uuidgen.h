@@ -0,0 +1,31 @@
+/* header for uuidgen.c
+ *
+ * Copyright 2013 Adiscon GmbH.
+ *
+ * This file is part of the rsyslog runtime library.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *       -or-
+ *       see COPYING.ASL20 in the source distribution
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef INCLUDED_UUIDGEN_H
+#define INCLUDED_UUIDGEN_H
+
+#define UUIDGEN_LEN_BIN 16			/* size of a binary uuid */
+#define UUIDGEN_LEN_HEX (UUIDGEN_LEN_BIN * 2)	/* size of hex string, without \0 */
+
+/* prototypes */
+void uuidgenGenerate(unsigned char *pUUID);
+void uuidgenGenerateHex(unsigned char *pBuf);
+
+#endif /* #ifndef INCLUDED_UUIDGEN_H */
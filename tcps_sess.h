@@ -49,6 +49,7 @@ struct tcps_sess_s {
 	prop_t *fromHostIP;
 	void *pUsr;		/* a user-pointer */
 	rsRetVal (*DoSubmitMessage)(tcps_sess_t*, uchar*, int); /* submit message callback */
+	int iSessTblIdx;	/* our index inside the tcpsrv session table, -1 if not in table */
 };
 
 
@@ -71,13 +72,15 @@ BEGINinterface(tcps_sess) /* name must also be changed in ENDinterface macro! */
 	rsRetVal (*SetMsgIdx)(tcps_sess_t *pThis, int);
 	rsRetVal (*SetOnMsgReceive)(tcps_sess_t *pThis, rsRetVal (*OnMsgReceive)(tcps_sess_t*, uchar*, int));
 ENDinterface(tcps_sess)
-#define tcps_sessCURR_IF_VERSION 3 /* increment whenever you change the interface structure! */
+#define tcps_sessCURR_IF_VERSION 4 /* increment whenever you change the interface structure! */
 /* interface changes
  * to version v2, rgerhards, 2009-05-22
  * - Data structures changed
  * - SetLstnInfo entry point added
  * version 3, rgerhards, 2013-01-21:
  * - signature of SetHostIP() changed
+ * version 4:
+ * - Data structures changed (iSessTblIdx added)
  */
 
 
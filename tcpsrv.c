@@ -53,6 +53,7 @@
 #include <pthread.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/time.h>
 #if HAVE_FCNTL_H
 #include <fcntl.h>
 #endif
@@ -82,6 +83,7 @@ MODULE_TYPE_NOKEEP
 /* defines */
 #define TCPSESS_MAX_DEFAULT 200 /* default for nbr of tcp sessions if no number is given */
 #define TCPLSTN_MAX_DEFAULT 20 /* default for nbr of listeners */
+#define TCPSRV_ACCEPT_BATCH 64 /* max nbr of connection requests accepted in one go */
 
 /* static data */
 DEFobjStaticHelpers
@@ -158,6 +160,21 @@ addNewLstnPort(tcpsrv_t *pThis, uchar *pszPort, int bSuppOctetFram)
 	STATSCOUNTER_INIT(pEntry->ctrSubmit, pEntry->mutCtrSubmit);
 	CHKiRet(statsobj.AddCounter(pEntry->stats, UCHAR_CONSTANT("submitted"),
 		ctrType_IntCtr, &(pEntry->ctrSubmit)));
+	STATSCOUNTER_INIT(pEntry->ctrSessOpened, pEntry->mutCtrSessOpened);
+	CHKiRet(statsobj.AddCounter(pEntry->stats, UCHAR_CONSTANT("sessions.opened"),
+		ctrType_IntCtr, &(pEntry->ctrSessOpened)));
+	STATSCOUNTER_INIT(pEntry->ctrSessOpenErr, pEntry->mutCtrSessOpenErr);
+	CHKiRet(statsobj.AddCounter(pEntry->stats, UCHAR_CONSTANT("sessions.openfailed"),
+		ctrType_IntCtr, &(pEntry->ctrSessOpenErr)));
+	STATSCOUNTER_INIT(pEntry->ctrSessClosed, pEntry->mutCtrSessClosed);
+	CHKiRet(statsobj.AddCounter(pEntry->stats, UCHAR_CONSTANT("sessions.closed"),
+		ctrType_IntCtr, &(pEntry->ctrSessClosed)));
+	pEntry->nSessActive = 0;
+	CHKiRet(statsobj.AddCounter(pEntry->stats, UCHAR_CONSTANT("sessions.active"),
+		ctrType_Int, &(pEntry->nSessActive)));
+	STATSCOUNTER_INIT(pEntry->ctrAcceptUsecs, pEntry->mutCtrAcceptUsecs);
+	CHKiRet(statsobj.AddCounter(pEntry->stats, UCHAR_CONSTANT("accept.usecs"),
+		ctrType_IntCtr, &(pEntry->ctrAcceptUsecs)));
 	CHKiRet(statsobj.ConstructFinalize(pEntry->stats));
 
 finalize_it:
@@ -198,6 +215,12 @@ finalize_it:
 
 /* Initialize the session table
  * returns 0 if OK, somewhat else otherwise
+ * The session table is kept densely packed: sessions occupy entries
+ * 0..nSess-1, and each session knows its own index. So adding and removing
+ * sessions is O(1) and iterating over them does not need to look at unused
+ * entries, which is important when iSessMax is large (e.g. many thousand TLS
+ * senders). Note that sessions are now also kept in the table when we are in
+ * epoll mode, because we need them for the session limit, stats and cleanup.
  */
 static rsRetVal
 TCPSessTblInit(tcpsrv_t *pThis)
@@ -212,55 +235,77 @@ TCPSessTblInit(tcpsrv_t *pThis)
 		DBGPRINTF("Error: TCPSessInit() could not alloc memory for TCP session table.\n");
 		ABORT_FINALIZE(RS_RET_OUT_OF_MEMORY);
 	}
+	pThis->nSess = 0;
 
 finalize_it:
 	RETiRet;
 }
 
 
-/* find a free spot in the session table. If the table
- * is full, -1 is returned, else the index of the free
- * entry (0 or higher).
+/* add a session to the session table. If the table is full,
+ * RS_RET_MAX_SESS_REACHED is returned. May be called concurrently
+ * by worker threads.
  */
-static int
-TCPSessTblFindFreeSpot(tcpsrv_t *pThis)
+static rsRetVal
+TCPSessTblAdd(tcpsrv_t *pThis, tcps_sess_t *pSess)
 {
-	register int i;
+	DEFiRet;
 
 	ISOBJ_TYPE_assert(pThis, tcpsrv);
+	pthread_mutex_lock(&pThis->mutSessTbl);
+	if(pThis->nSess >= pThis->iSessMax)
+		ABORT_FINALIZE(RS_RET_MAX_SESS_REACHED);
+	pSess->iSessTblIdx = pThis->nSess;
+	pThis->pSessions[pThis->nSess++] = pSess;
+	++pSess->pLstnInfo->nSessActive;
 
-	for(i = 0 ; i < pThis->iSessMax ; ++i) {
-		if(pThis->pSessions[i] == NULL)
-			break;
-	}
+finalize_it:
+	pthread_mutex_unlock(&pThis->mutSessTbl);
+	RETiRet;
+}
 
-	return((i < pThis->iSessMax) ? i : -1);
+
+/* remove a session from the session table. The last session is moved
+ * into the now-free entry, so that the table stays densely packed.
+ * May be called concurrently by worker threads.
+ */
+static void
+TCPSessTblDel(tcpsrv_t *pThis, tcps_sess_t *pSess)
+{
+	int i;
+
+	ISOBJ_TYPE_assert(pThis, tcpsrv);
+	pthread_mutex_lock(&pThis->mutSessTbl);
+	i = pSess->iSessTblIdx;
+	if(i != -1) {
+		assert(pThis->pSessions[i] == pSess);
+		--pThis->nSess;
+		if(i != pThis->nSess) {
+			pThis->pSessions[i] = pThis->pSessions[pThis->nSess];
+			pThis->pSessions[i]->iSessTblIdx = i;
+		}
+		pThis->pSessions[pThis->nSess] = NULL;
+		pSess->iSessTblIdx = -1;
+		--pSess->pLstnInfo->nSessActive;
+	}
+	pthread_mutex_unlock(&pThis->mutSessTbl);
 }
 
 
-/* Get the next session index. Free session tables entries are
- * skipped. This function is provided the index of the last
- * session entry, or -1 if no previous entry was obtained. It
+/* Get the next session index. This function is provided the index
+ * of the last session entry, or -1 if no previous entry was obtained. It
  * returns the index of the next session or -1, if there is no
  * further entry in the table. Please note that the initial call
  * might as well return -1, if there is no session at all in the
  * session table.
+ * Note that removing a session while iterating moves the last session
+ * to the removed one's index, so it will be skipped during this iteration.
  */
-static int
+static inline int
 TCPSessGetNxtSess(tcpsrv_t *pThis, int iCurr)
 {
-	register int i;
-
-	BEGINfunc
-	ISOBJ_TYPE_assert(pThis, tcpsrv);
 	assert(pThis->pSessions != NULL);
-	for(i = iCurr + 1 ; i < pThis->iSessMax ; ++i) {
-		if(pThis->pSessions[i] != NULL)
-			break;
-	}
-
-	ENDfunc
-	return((i < pThis->iSessMax) ? i : -1);
+	return((iCurr + 1 < pThis->nSess) ? iCurr + 1 : -1);
 }
 
 
@@ -280,14 +325,10 @@ static void deinit_tcp_listener(tcpsrv_t *pThis)
 
 	if(pThis->pSessions != NULL) {
 		/* close all TCP connections! */
-		if(!pThis->bUsingEPoll) {
-			i = TCPSessGetNxtSess(pThis, -1);
-			while(i != -1) {
-				tcps_sess.Destruct(&pThis->pSessions[i]);
-				/* now get next... */
-				i = TCPSessGetNxtSess(pThis, i);
-			}
+		for(i = 0 ; i < pThis->nSess ; ++i) {
+			tcps_sess.Destruct(&pThis->pSessions[i]);
 		}
+		pThis->nSess = 0;
 		
 		/* we are done with the session table - so get rid of it...  */
 		free(pThis->pSessions);
@@ -421,19 +462,26 @@ SessAccept(tcpsrv_t *pThis, tcpLstnPortList_t *pLstnInfo, tcps_sess_t **ppSess,
 	DEFiRet;
 	tcps_sess_t *pSess = NULL;
 	netstrm_t *pNewStrm = NULL;
-	int iSess = -1;
 	struct sockaddr_storage *addr;
 	uchar *fromHostFQDN = NULL;
 	prop_t *fromHostIP;
+	struct timeval tvStart, tvEnd;
+	sbool bAccepted = 0;
+	rsRetVal localRet;
 
 	ISOBJ_TYPE_assert(pThis, tcpsrv);
 	assert(pLstnInfo != NULL);
 
+	if(GatherStats)
+		gettimeofday(&tvStart, NULL);
 	CHKiRet(netstrm.AcceptConnReq(pStrm, &pNewStrm));
+	bAccepted = 1;
 
-	/* Add to session list */
-	iSess = TCPSessTblFindFreeSpot(pThis);
-	if(iSess == -1) {
+	/* check if there is space left in the session table. We do the final
+	 * check when adding to the table, but want to avoid the work of setting up
+	 * the session if it is not needed.
+	 */
+	if(pThis->nSess >= pThis->iSessMax) {
 		errno = 0;
 		errmsg.LogError(0, RS_RET_MAX_SESS_REACHED, "too many tcp sessions - dropping incoming request");
 		ABORT_FINALIZE(RS_RET_MAX_SESS_REACHED);
@@ -485,13 +533,28 @@ SessAccept(tcpsrv_t *pThis, tcpLstnPortList_t *pLstnInfo, tcps_sess_t **ppSess,
 		CHKiRet(pThis->pOnSessAccept(pThis, pSess));
 	}
 
+	/* Add to session list */
+	localRet = TCPSessTblAdd(pThis, pSess);
+	if(localRet != RS_RET_OK) {
+		errno = 0;
+		errmsg.LogError(0, localRet, "too many tcp sessions - dropping incoming request");
+		ABORT_FINALIZE(localRet);
+	}
+
 	*ppSess = pSess;
-	if(!pThis->bUsingEPoll)
-		pThis->pSessions[iSess] = pSess;
 	pSess = NULL; /* this is now also handed over */
+	STATSCOUNTER_INC(pLstnInfo->ctrSessOpened, pLstnInfo->mutCtrSessOpened);
+	if(GatherStats) {
+		gettimeofday(&tvEnd, NULL);
+		STATSCOUNTER_ADD(pLstnInfo->ctrAcceptUsecs, pLstnInfo->mutCtrAcceptUsecs,
+			(tvEnd.tv_sec - tvStart.tv_sec) * 1000000 + tvEnd.tv_usec - tvStart.tv_usec);
+	}
 
 finalize_it:
 	if(iRet != RS_RET_OK) {
+		if(bAccepted) {
+			STATSCOUNTER_INC(pLstnInfo->ctrSessOpenErr, pLstnInfo->mutCtrSessOpenErr);
+		}
 		if(pSess != NULL)
 			tcps_sess.Destruct(&pSess);
 		if(pNewStrm != NULL)
@@ -522,6 +585,8 @@ closeSess(tcpsrv_t *pThis, tcps_sess_t **ppSess, nspoll_t *pPoll) {
 	if(pPoll != NULL) {
 		CHKiRet(nspoll.Ctl(pPoll, (*ppSess)->pStrm, 0, *ppSess, NSDPOLL_IN, NSDPOLL_DEL));
 	}
+	TCPSessTblDel(pThis, *ppSess);
+	STATSCOUNTER_INC((*ppSess)->pLstnInfo->ctrSessClosed, (*ppSess)->pLstnInfo->mutCtrSessClosed);
 	pThis->pOnRegularClose(*ppSess);
 	tcps_sess.Destruct(ppSess);
 finalize_it:
@@ -533,6 +598,9 @@ finalize_it:
  * If pPoll is non-NULL, we have a netstream in epoll mode, which means we need
  * to remove any descriptor we close from the epoll set.
  * rgerhards, 2009-07-020
+ * If sessions are registered edge-triggered (see SetUseEdgeTrig()), we must read
+ * until the stream is drained, because we will not be notified again about data
+ * that is already present.
  */
 static rsRetVal
 doReceive(tcpsrv_t *pThis, tcps_sess_t **ppSess, nspoll_t *pPoll)
@@ -544,42 +612,45 @@ doReceive(tcpsrv_t *pThis, tcps_sess_t **ppSess, nspoll_t *pPoll)
 
 	ISOBJ_TYPE_assert(pThis, tcpsrv);
 	DBGPRINTF("netstream %p with new data\n", (*ppSess)->pStrm);
-	/* Receive message */
-	iRet = pThis->pRcvData(*ppSess, buf, sizeof(buf), &iRcvd);
-	switch(iRet) {
-	case RS_RET_CLOSED:
-		if(pThis->bEmitMsgOnClose) {
-			uchar *pszPeer;
-			int lenPeer;
+	do {
+		/* Receive message */
+		iRet = pThis->pRcvData(*ppSess, buf, sizeof(buf), &iRcvd);
+		switch(iRet) {
+		case RS_RET_CLOSED:
+			if(pThis->bEmitMsgOnClose) {
+				uchar *pszPeer;
+				int lenPeer;
+				errno = 0;
+				prop.GetString((*ppSess)->fromHostIP, &pszPeer, &lenPeer);
+				errmsg.LogError(0, RS_RET_PEER_CLOSED_CONN, "Netstream session %p closed by remote peer %s.\n",
+						(*ppSess)->pStrm, pszPeer);
+			}
+			CHKiRet(closeSess(pThis, ppSess, pPoll));
+			break;
+		case RS_RET_RETRY:
+			/* we simply ignore retry - this is not an error, but we also have not received anything */
+			break;
+		case RS_RET_OK:
+			/* valid data received, process it! */
+			localRet = tcps_sess.DataRcvd(*ppSess, buf, iRcvd);
+			if(localRet != RS_RET_OK && localRet != RS_RET_QUEUE_FULL) {
+				/* in this case, something went awfully wrong.
+				 * We are instructed to terminate the session.
+				 */
+				errmsg.LogError(0, localRet, "Tearing down TCP Session - see "
+						    "previous messages for reason(s)\n");
+				CHKiRet(closeSess(pThis, ppSess, pPoll));
+			}
+			break;
+		default:
 			errno = 0;
-			prop.GetString((*ppSess)->fromHostIP, &pszPeer, &lenPeer);
-			errmsg.LogError(0, RS_RET_PEER_CLOSED_CONN, "Netstream session %p closed by remote peer %s.\n",
-					(*ppSess)->pStrm, pszPeer);
-		}
-		CHKiRet(closeSess(pThis, ppSess, pPoll));
-		break;
-	case RS_RET_RETRY:
-		/* we simply ignore retry - this is not an error, but we also have not received anything */
-		break;
-	case RS_RET_OK:
-		/* valid data received, process it! */
-		localRet = tcps_sess.DataRcvd(*ppSess, buf, iRcvd);
-		if(localRet != RS_RET_OK && localRet != RS_RET_QUEUE_FULL) {
-			/* in this case, something went awfully wrong.
-			 * We are instructed to terminate the session.
-			 */
-			errmsg.LogError(0, localRet, "Tearing down TCP Session - see "
-					    "previous messages for reason(s)\n");
+			errmsg.LogError(0, iRet, "netstream session %p will be closed due to error\n",
+					(*ppSess)->pStrm);
 			CHKiRet(closeSess(pThis, ppSess, pPoll));
+			break;
 		}
-		break;
-	default:
-		errno = 0;
-		errmsg.LogError(0, iRet, "netstream session %p will be closed due to error\n",
-				(*ppSess)->pStrm);
-		CHKiRet(closeSess(pThis, ppSess, pPoll));
-		break;
-	}
+	} while(pPoll != NULL && pThis->bUseEdgeTrig && iRet == RS_RET_OK && *ppSess != NULL
+		&& glbl.GetGlobalInputTermState() == 0);
 
 finalize_it:
 	RETiRet;
@@ -591,26 +662,36 @@ static inline rsRetVal
 processWorksetItem(tcpsrv_t *pThis, nspoll_t *pPoll, int idx, void *pUsr)
 {
 	tcps_sess_t *pNewSess = NULL;
+	int i;
 	DEFiRet;
 
 	DBGPRINTF("tcpsrv: processing item %d, pUsr %p, bAbortConn\n", idx, pUsr);
 	if(pUsr == pThis->ppLstn) {
-		DBGPRINTF("New connect on NSD %p.\n", pThis->ppLstn[idx]);
-		iRet = SessAccept(pThis, pThis->ppLstnPort[idx], &pNewSess, pThis->ppLstn[idx]);
-		if(iRet == RS_RET_OK) {
-			if(pPoll != NULL) {
-				CHKiRet(nspoll.Ctl(pPoll, pNewSess->pStrm, 0, pNewSess, NSDPOLL_IN, NSDPOLL_ADD));
+		/* we accept all pending connection requests (up to a limit), not just
+		 * one. The loop ends when there is no more request, in which case the
+		 * driver reports an accept error (EAGAIN). Other errors only affect
+		 * the respective connection request.
+		 */
+		for(i = 0 ; i < TCPSRV_ACCEPT_BATCH ; ++i) {
+			DBGPRINTF("New connect on NSD %p.\n", pThis->ppLstn[idx]);
+			iRet = SessAccept(pThis, pThis->ppLstnPort[idx], &pNewSess, pThis->ppLstn[idx]);
+			if(iRet == RS_RET_OK) {
+				if(pPoll != NULL) {
+					CHKiRet(nspoll.Ctl(pPoll, pNewSess->pStrm, 0, pNewSess,
+							   pThis->bUseEdgeTrig ? NSDPOLL_IN|NSDPOLL_EDGE : NSDPOLL_IN,
+							   NSDPOLL_ADD));
+				}
+				DBGPRINTF("New session created with NSD %p.\n", pNewSess);
+			} else if(iRet == RS_RET_ACCEPT_ERR) {
+				break;
+			} else {
+				DBGPRINTF("tcpsrv: error %d during accept\n", iRet);
 			}
-			DBGPRINTF("New session created with NSD %p.\n", pNewSess);
-		} else {
-			DBGPRINTF("tcpsrv: error %d during accept\n", iRet);
 		}
+		iRet = RS_RET_OK;
 	} else {
 		pNewSess = (tcps_sess_t*) pUsr;
 		doReceive(pThis, &pNewSess, pPoll);
-		if(pPoll == NULL && pNewSess == NULL) {
-			pThis->pSessions[idx] = NULL;
-		}
 	}
 
 finalize_it:
@@ -919,6 +1000,7 @@ BEGINobjConstruct(tcpsrv) /* be sure to specify the object type also in END macr
 	pThis->ratelimitInterval = 0;
 	pThis->ratelimitBurst = 10000;
 	pThis->bUseFlowControl = 1;
+	pthread_mutex_init(&pThis->mutSessTbl, NULL);
 ENDobjConstruct(tcpsrv)
 
 
@@ -967,6 +1049,7 @@ CODESTARTobjDestruct(tcpsrv)
 	free(pThis->ppLstn);
 	free(pThis->ppLstnPort);
 	free(pThis->pszInputName);
+	pthread_mutex_destroy(&pThis->mutSessTbl);
 ENDobjDestruct(tcpsrv)
 
 
@@ -1226,6 +1309,23 @@ SetUseFlowControl(tcpsrv_t *pThis, int bUseFlowControl)
 }
 
 
+/* set if sessions shall be registered edge-triggered in epoll mode. This
+ * saves epoll_wait() calls, but the receive callback must then report
+ * RS_RET_RETRY once there is no more data, as doReceive() reads until
+ * the stream is drained. This is the case for the default netstream
+ * drivers, but a custom receive callback needs to be checked before
+ * enabling it. The default is level-triggered.
+ */
+static rsRetVal
+SetUseEdgeTrig(tcpsrv_t *pThis, int bUseEdgeTrig)
+{
+	DEFiRet;
+	ISOBJ_TYPE_assert(pThis, tcpsrv);
+	pThis->bUseEdgeTrig = bUseEdgeTrig;
+	RETiRet;
+}
+
+
 /* set max number of sessions
  * this must be called before ConstructFinalize, or it will have no effect!
  * rgerhards, 2009-04-09
@@ -1270,6 +1370,7 @@ CODESTARTobjQueryInterface(tcpsrv)
 	pIf->SetbDisableLFDelim = SetbDisableLFDelim;
 	pIf->SetSessMax = SetSessMax;
 	pIf->SetUseFlowControl = SetUseFlowControl;
+	pIf->SetUseEdgeTrig = SetUseEdgeTrig;
 	pIf->SetLstnMax = SetLstnMax;
 	pIf->SetDrvrMode = SetDrvrMode;
 	pIf->SetDrvrAuthMode = SetDrvrAuthMode;
@@ -44,6 +44,11 @@ struct tcpLstnPortList_s {
 	sbool bSuppOctetFram;	/**< do we support octect-counted framing? (if no->legay only!)*/
 	ratelimit_t *ratelimiter;
 	STATSCOUNTER_DEF(ctrSubmit, mutCtrSubmit)
+	STATSCOUNTER_DEF(ctrSessOpened, mutCtrSessOpened)
+	STATSCOUNTER_DEF(ctrSessOpenErr, mutCtrSessOpenErr)
+	STATSCOUNTER_DEF(ctrSessClosed, mutCtrSessClosed)
+	STATSCOUNTER_DEF(ctrAcceptUsecs, mutCtrAcceptUsecs)
+	int nSessActive;		/**< nbr of currently open sessions (dual counter, guarded by mutSessTbl) */
 	tcpLstnPortList_t *pNext;	/**< next port or NULL */
 };
 
@@ -60,7 +65,8 @@ struct tcpsrv_s {
 	ruleset_t *pRuleset;	/**< ruleset to bind to */
 	permittedPeers_t *pPermPeers;/**< driver's permitted peers */
 	sbool bEmitMsgOnClose;	/**< emit an informational message when the remote peer closes connection */
-	sbool bUsingEPoll;	/**< are we in epoll mode (means we do not need to keep track of sessions!) */
+	sbool bUsingEPoll;	/**< are we in epoll mode? */
+	sbool bUseEdgeTrig;	/**< register sessions edge-triggered in epoll mode (see SetUseEdgeTrig()) */
 	sbool bUseFlowControl;	/**< use flow control (make light delayable) */
 	int iLstnCurr;		/**< max nbr of listeners currently supported */
 	netstrm_t **ppLstn;	/**< our netstream listners */
@@ -73,7 +79,9 @@ struct tcpsrv_s {
 	int bDisableLFDelim;	/**< if 1, standard LF frame delimiter is disabled (*very dangerous*) */
 	int ratelimitInterval;
 	int ratelimitBurst;
-	tcps_sess_t **pSessions;/**< array of all of our sessions */
+	tcps_sess_t **pSessions;/**< array of all of our sessions, densely packed */
+	int nSess;		/**< number of sessions currently in pSessions */
+	pthread_mutex_t mutSessTbl; /**< guards the session table (workers add and remove sessions) */
 	void *pUsr;		/**< a user-settable pointer (provides extensibility for "derived classes")*/
 	/* callbacks */
 	int      (*pIsPermittedHost)(struct sockaddr *addr, char *fromHostFQDN, void*pUsrSrv, void*pUsrSess);
@@ -147,8 +155,10 @@ BEGINinterface(tcpsrv) /* name must also be changed in ENDinterface macro! */
 	rsRetVal (*SetKeepAlive)(tcpsrv_t*, int);
 	/* added v13 -- rgerhards, 2012-10-15 */
 	rsRetVal (*SetLinuxLikeRatelimiters)(tcpsrv_t *pThis, int interval, int burst);
+	/* added v14 */
+	rsRetVal (*SetUseEdgeTrig)(tcpsrv_t*, int);
 ENDinterface(tcpsrv)
-#define tcpsrvCURR_IF_VERSION 13 /* increment whenever you change the interface structure! */
+#define tcpsrvCURR_IF_VERSION 14 /* increment whenever you change the interface structure! */
 /* change for v4:
  * - SetAddtlFrameDelim() added -- rgerhards, 2008-12-10
  * - SetInputName() added -- rgerhards, 2008-12-10
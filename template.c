@@ -46,6 +46,7 @@
 #include "rsconf.h"
 #include "msg.h"
 #include "unicode-helper.h"
+#include "escscan.h"
 
 /* static data */
 DEFobjCurrIf(obj)
@@ -112,6 +113,25 @@ DEFobjCurrIf(regexp)
 static int bFirstRegexpErrmsg = 1; /**< did we already do a "can't load regexp" error message? */
 #endif
 
+/* free the compiled form of a template (see tplCompile()) */
+static void
+tplFreeOps(struct template *pTpl)
+{
+	int i;
+
+	if(pTpl->pOps != NULL) {
+		for(i = 0 ; i < pTpl->nOps ; ++i)
+			free(pTpl->pOps[i].pConstant);
+		free(pTpl->pOps);
+		pTpl->pOps = NULL;
+	}
+	pTpl->nOps = 0;
+	pTpl->lenConstants = 0;
+	pTpl->lenEstimate = 0;
+	pTpl->bMsgOnly = 0;
+}
+
+
 /* helper to tplToString and strgen's, extends buffer */
 #define ALLOC_INC 128
 rsRetVal
@@ -131,6 +151,333 @@ finalize_it:
 }
 
 
+/* Renderers for compiled templates. These are selected by tplCompile()
+ * and provide direct access to the most frequently used properties, if
+ * at most the simple options (see tplHasSimpleOpts()) need to be applied.
+ * Everything else goes through the generic MsgGetProp() based renderer.
+ */
+static uchar *
+tplRenderGeneric(msg_t *pMsg, tplOp_t *pOp, rs_size_t *pLen, unsigned short *pbMustBeFreed,
+		 struct syslogTime *ttNow)
+{
+	return MsgGetProp(pMsg, pOp->pTpe, pOp->pTpe->data.field.propid,
+			  pOp->pTpe->data.field.propName, pLen, pbMustBeFreed, ttNow);
+}
+
+static uchar *
+tplRenderMSG(msg_t *pMsg, tplOp_t __attribute__((unused)) *pOp, rs_size_t *pLen,
+	     unsigned short *pbMustBeFreed, struct syslogTime __attribute__((unused)) *ttNow)
+{
+	*pbMustBeFreed = 0;
+	*pLen = getMSGLen(pMsg);
+	return getMSG(pMsg);
+}
+
+static uchar *
+tplRenderHOSTNAME(msg_t *pMsg, tplOp_t __attribute__((unused)) *pOp, rs_size_t *pLen,
+		  unsigned short *pbMustBeFreed, struct syslogTime __attribute__((unused)) *ttNow)
+{
+	uchar *pRes;
+	*pbMustBeFreed = 0;
+	pRes = (uchar*) getHOSTNAME(pMsg);
+	*pLen = getHOSTNAMELen(pMsg);
+	return pRes;
+}
+
+static uchar *
+tplRenderTAG(msg_t *pMsg, tplOp_t __attribute__((unused)) *pOp, rs_size_t *pLen,
+	     unsigned short *pbMustBeFreed, struct syslogTime __attribute__((unused)) *ttNow)
+{
+	uchar *pRes;
+	*pbMustBeFreed = 0;
+	getTAG(pMsg, &pRes, pLen);
+	return pRes;
+}
+
+static uchar *
+tplRenderTIMESTAMP(msg_t *pMsg, tplOp_t *pOp, rs_size_t *pLen,
+		   unsigned short *pbMustBeFreed, struct syslogTime __attribute__((unused)) *ttNow)
+{
+	uchar *pRes;
+	*pbMustBeFreed = 0;
+	pRes = (uchar*) getTimeReported(pMsg, pOp->pTpe->data.field.eDateFormat);
+	*pLen = ustrlen(pRes);
+	return pRes;
+}
+
+static uchar *
+tplRenderPROGRAMNAME(msg_t *pMsg, tplOp_t __attribute__((unused)) *pOp, rs_size_t *pLen,
+		     unsigned short *pbMustBeFreed, struct syslogTime __attribute__((unused)) *ttNow)
+{
+	uchar *pRes;
+	*pbMustBeFreed = 0;
+	pRes = getProgramName(pMsg, LOCK_MUTEX);
+	*pLen = ustrlen(pRes);
+	return pRes;
+}
+
+static uchar *
+tplRenderFROMHOST(msg_t *pMsg, tplOp_t __attribute__((unused)) *pOp, rs_size_t *pLen,
+		  unsigned short *pbMustBeFreed, struct syslogTime __attribute__((unused)) *ttNow)
+{
+	uchar *pRes;
+	*pbMustBeFreed = 0;
+	pRes = getRcvFrom(pMsg);
+	*pLen = ustrlen(pRes);
+	return pRes;
+}
+
+static uchar *
+tplRenderPRI(msg_t *pMsg, tplOp_t __attribute__((unused)) *pOp, rs_size_t *pLen,
+	     unsigned short *pbMustBeFreed, struct syslogTime __attribute__((unused)) *ttNow)
+{
+	uchar *pRes;
+	*pbMustBeFreed = 0;
+	pRes = (uchar*) getPRI(pMsg);
+	*pLen = ustrlen(pRes);
+	return pRes;
+}
+
+static uchar *
+tplRenderRAWMSG(msg_t *pMsg, tplOp_t __attribute__((unused)) *pOp, rs_size_t *pLen,
+		unsigned short *pbMustBeFreed, struct syslogTime __attribute__((unused)) *ttNow)
+{
+	uchar *pRes;
+	*pbMustBeFreed = 0;
+	getRawMsg(pMsg, &pRes, pLen);
+	return pRes;
+}
+
+static uchar *
+tplRenderAPPNAME(msg_t *pMsg, tplOp_t __attribute__((unused)) *pOp, rs_size_t *pLen,
+		 unsigned short *pbMustBeFreed, struct syslogTime __attribute__((unused)) *ttNow)
+{
+	uchar *pRes;
+	*pbMustBeFreed = 0;
+	pRes = (uchar*) getAPPNAME(pMsg, LOCK_MUTEX);
+	*pLen = ustrlen(pRes);
+	return pRes;
+}
+
+static uchar *
+tplRenderPROCID(msg_t *pMsg, tplOp_t __attribute__((unused)) *pOp, rs_size_t *pLen,
+		unsigned short *pbMustBeFreed, struct syslogTime __attribute__((unused)) *ttNow)
+{
+	uchar *pRes;
+	*pbMustBeFreed = 0;
+	pRes = (uchar*) getPROCID(pMsg, LOCK_MUTEX);
+	*pLen = ustrlen(pRes);
+	return pRes;
+}
+
+/* renderer for the simple options "sp-if-no-1st-sp" and "drop-last-lf".
+ * The property itself is obtained via pfGet. Semantics and order are the
+ * same as inside MsgGetProp().
+ */
+static uchar *
+tplRenderSimpleOpts(msg_t *pMsg, tplOp_t *pOp, rs_size_t *pLen,
+		    unsigned short *pbMustBeFreed, struct syslogTime *ttNow)
+{
+	uchar *pRes;
+	uchar cFirst;
+
+	pRes = pOp->pfGet(pMsg, pOp, pLen, pbMustBeFreed, ttNow);
+	if(*pRes && pOp->pTpe->data.field.options.bSPIffNo1stSP) {
+		cFirst = *pRes;
+		if(*pbMustBeFreed)
+			free(pRes);
+		*pbMustBeFreed = 0;
+		*pLen = (cFirst == ' ') ? 0 : 1;
+		return (cFirst == ' ') ? UCHAR_CONSTANT("") : UCHAR_CONSTANT(" ");
+	}
+	/* we render by length, so we can drop the LF without copying */
+	if(pOp->pTpe->data.field.options.bDropLastLF && *pLen > 0 && pRes[*pLen - 1] == '\n')
+		--(*pLen);
+	return pRes;
+}
+
+
+/* check if a field needs at most the options the compiled renderers
+ * handle themselves: date formats (which the getters apply), the
+ * "sp-if-no-1st-sp" and "drop-last-lf" options. The "mandatory" option
+ * is only used by structured output.
+ */
+static inline int
+tplHasSimpleOpts(struct templateEntry *pTpe)
+{
+	if(!pTpe->bComplexProcessing)
+		return 1;
+#	ifdef FEATURE_REGEXP
+	if(pTpe->data.field.has_regex != 0)
+		return 0;
+#	endif
+	return pTpe->data.field.has_fields == 0
+	       && pTpe->data.field.iFromPos == 0 && pTpe->data.field.iToPos == 0
+	       && pTpe->data.field.eCaseConv == tplCaseConvNo
+	       && !pTpe->data.field.options.bDropCC
+	       && !pTpe->data.field.options.bSpaceCC
+	       && !pTpe->data.field.options.bEscapeCC
+	       && !pTpe->data.field.options.bSecPathDrop
+	       && !pTpe->data.field.options.bSecPathReplace
+	       && !pTpe->data.field.options.bCSV
+	       && !pTpe->data.field.options.bJSON
+	       && !pTpe->data.field.options.bJSONf;
+}
+
+
+/* estimated size of a rendered field, used to size the output buffer
+ * before we render the template. This must not be exact, it just
+ * saves us from extending the buffer for the typical message.
+ */
+static inline size_t
+tplFieldLenEstimate(struct templateEntry *pTpe)
+{
+	switch(pTpe->data.field.propid) {
+	case PROP_MSG:
+	case PROP_RAWMSG:
+		return 256;
+	case PROP_STRUCTURED_DATA:
+	case PROP_CEE:
+	case PROP_CEE_ALL_JSON:
+		return 128;
+	default:
+		return 32;
+	}
+}
+
+
+/* Compile the entry list of a template into its array of render
+ * operations. Adjacent constants are fused into a single one. Templates
+ * that are bound to a strgen or are of subtree type have no entries and
+ * thus get an empty list. May be called again if the template changes,
+ * in which case the previous compiled form is discarded.
+ * Direct renderers exist for the header properties, msg and rawmsg, with
+ * no options or only the ones of tplHasSimpleOpts(). Substrings, regex,
+ * field extraction, case conversion, control character handling and the
+ * csv/json options still go through MsgGetProp(). Note that only
+ * tplToString() uses the compiled form, tplToArray() and tplToJSON()
+ * work on the entry list.
+ */
+static rsRetVal
+tplCompile(struct template *pTpl)
+{
+	struct templateEntry *pTpe;
+	tplOp_t *pOp;
+	uchar *pConst;
+	DEFiRet;
+
+	tplFreeOps(pTpl);
+	pTpl->bMsgOnly = 1;
+
+	/* we need at most one operation per entry */
+	if(pTpl->tpenElements == 0)
+		FINALIZE;
+	CHKmalloc(pTpl->pOps = calloc(pTpl->tpenElements, sizeof(tplOp_t)));
+
+	pOp = NULL;
+	for(pTpe = pTpl->pEntryRoot ; pTpe != NULL ; pTpe = pTpe->pNext) {
+		if(pTpe->eEntryType == CONSTANT) {
+			if(pTpe->data.constant.iLenConstant == 0)
+				continue;
+			pTpl->lenConstants += pTpe->data.constant.iLenConstant;
+			if(pOp != NULL && pOp->pfRender == NULL) {
+				/* fuse with previous constant */
+				CHKmalloc(pConst = realloc(pOp->pConstant, pOp->iLenConstant
+							  + pTpe->data.constant.iLenConstant + 1));
+				memcpy(pConst + pOp->iLenConstant, pTpe->data.constant.pConstant,
+				       pTpe->data.constant.iLenConstant + 1);
+				pOp->pConstant = pConst;
+				pOp->iLenConstant += pTpe->data.constant.iLenConstant;
+			} else {
+				pOp = pTpl->pOps + pTpl->nOps++;
+				CHKmalloc(pOp->pConstant = malloc(pTpe->data.constant.iLenConstant + 1));
+				memcpy(pOp->pConstant, pTpe->data.constant.pConstant,
+				       pTpe->data.constant.iLenConstant + 1);
+				pOp->iLenConstant = pTpe->data.constant.iLenConstant;
+			}
+		} else if(pTpe->eEntryType == FIELD) {
+			pOp = pTpl->pOps + pTpl->nOps++;
+			pOp->pTpe = pTpe;
+			pOp->escapeMode = pTpl->optFormatEscape;
+			pOp->pfRender = tplRenderGeneric;
+			if(   (pTpe->data.field.propid >= PROP_SYS_NOW
+			       && pTpe->data.field.propid <= PROP_SYS_MINUTE)
+			   || pTpe->data.field.propid == PROP_SYS_UPTIME)
+				pTpl->bMsgOnly = 0;
+			if(tplHasSimpleOpts(pTpe)) {
+				switch(pTpe->data.field.propid) {
+				case PROP_MSG:
+					pOp->pfRender = tplRenderMSG;
+					break;
+				case PROP_HOSTNAME:
+					pOp->pfRender = tplRenderHOSTNAME;
+					break;
+				case PROP_SYSLOGTAG:
+					pOp->pfRender = tplRenderTAG;
+					break;
+				case PROP_TIMESTAMP:
+					pOp->pfRender = tplRenderTIMESTAMP;
+					break;
+				case PROP_PROGRAMNAME:
+					pOp->pfRender = tplRenderPROGRAMNAME;
+					break;
+				case PROP_FROMHOST:
+					pOp->pfRender = tplRenderFROMHOST;
+					break;
+				case PROP_PRI:
+					pOp->pfRender = tplRenderPRI;
+					break;
+				case PROP_RAWMSG:
+					pOp->pfRender = tplRenderRAWMSG;
+					break;
+				case PROP_APP_NAME:
+					pOp->pfRender = tplRenderAPPNAME;
+					break;
+				case PROP_PROCID:
+					pOp->pfRender = tplRenderPROCID;
+					break;
+				default:
+					break;
+				}
+				if(   pOp->pfRender != tplRenderGeneric
+				   && (   pTpe->data.field.options.bSPIffNo1stSP
+				       || pTpe->data.field.options.bDropLastLF)) {
+					pOp->pfGet = pOp->pfRender;
+					pOp->pfRender = tplRenderSimpleOpts;
+				}
+			}
+			pTpl->lenEstimate += tplFieldLenEstimate(pTpe);
+		}
+	}
+	pTpl->lenEstimate += pTpl->lenConstants + 1;
+	DBGPRINTF("template '%s' compiled: %d entries, %d operations, constant size %u, "
+		  "estimated size %u\n", pTpl->pszName, pTpl->tpenElements, pTpl->nOps,
+		  (unsigned) pTpl->lenConstants, (unsigned) pTpl->lenEstimate);
+
+finalize_it:
+	if(iRet != RS_RET_OK)
+		tplFreeOps(pTpl);
+	RETiRet;
+}
+
+
+/* compile all templates of a config. This is called at the end of
+ * config load, when all templates are fully defined.
+ */
+rsRetVal
+tplCompileAll(rsconf_t *conf)
+{
+	struct template *pTpl;
+	DEFiRet;
+
+	for(pTpl = conf->templates.root ; pTpl != NULL ; pTpl = pTpl->pNext) {
+		CHKiRet(tplCompile(pTpl));
+	}
+finalize_it:
+	RETiRet;
+}
+
+
 /* This functions converts a template into a string.
  *
  * The function takes a pointer to a template and a pointer to a msg object
@@ -146,7 +493,8 @@ tplToString(struct template *pTpl, msg_t *pMsg, uchar **ppBuf, size_t *pLenBuf,
 	    struct syslogTime *ttNow)
 {
 	DEFiRet;
-	struct templateEntry *pTpe;
+	tplOp_t *pOp;
+	int i;
 	size_t iBuf;
 	unsigned short bMustBeFreed = 0;
 	uchar *pVal;
@@ -177,36 +525,29 @@ tplToString(struct template *pTpl, msg_t *pMsg, uchar **ppBuf, size_t *pLenBuf,
 		FINALIZE;
 	}
 	
-	/* we have a "regular" template with template entries */
-
-	/* loop through the template. We obtain one value
-	 * and copy it over to our dynamic string buffer. Then, we
-	 * free the obtained value (if requested). We continue this
-	 * loop until we got hold of all values.
+	/* we have a "regular" template with template entries. These have
+	 * been compiled at config load, so we just need to run the operations.
+	 * We size the buffer up front, so that in the usual case it must not
+	 * be extended while we render.
 	 */
-	pTpe = pTpl->pEntryRoot;
+	if(*pLenBuf < pTpl->lenEstimate)
+		CHKiRet(ExtendBuf(ppBuf, pLenBuf, pTpl->lenEstimate));
+
 	iBuf = 0;
-	while(pTpe != NULL) {
-		if(pTpe->eEntryType == CONSTANT) {
-			pVal = (uchar*) pTpe->data.constant.pConstant;
-			iLenVal = pTpe->data.constant.iLenConstant;
+	for(i = 0 ; i < pTpl->nOps ; ++i) {
+		pOp = pTpl->pOps + i;
+		if(pOp->pfRender == NULL) {
+			pVal = pOp->pConstant;
+			iLenVal = pOp->iLenConstant;
 			bMustBeFreed = 0;
-		} else 	if(pTpe->eEntryType == FIELD) {
-			pVal = (uchar*) MsgGetProp(pMsg, pTpe, pTpe->data.field.propid,
-						   pTpe->data.field.propName,  &iLenVal,
-						   &bMustBeFreed, ttNow);
-			/* we now need to check if we should use SQL option. In this case,
-			 * we must go over the generated string and escape '\'' characters.
-			 * rgerhards, 2005-09-22: the option values below look somewhat misplaced,
+		} else {
+			pVal = pOp->pfRender(pMsg, pOp, &iLenVal, &bMustBeFreed, ttNow);
+			/* rgerhards, 2005-09-22: the option values below look somewhat misplaced,
 			 * but they are handled in this way because of legacy (don't break any
 			 * existing thing).
 			 */
-			if(pTpl->optFormatEscape == SQL_ESCAPE)
-				doEscape(&pVal, &iLenVal, &bMustBeFreed, SQL_ESCAPE);
-			else if(pTpl->optFormatEscape == JSON_ESCAPE)
-				doEscape(&pVal, &iLenVal, &bMustBeFreed, JSON_ESCAPE);
-			else if(pTpl->optFormatEscape == STDSQL_ESCAPE)
-				doEscape(&pVal, &iLenVal, &bMustBeFreed, STDSQL_ESCAPE);
+			if(pOp->escapeMode != NO_ESCAPE)
+				doEscape(&pVal, &iLenVal, &bMustBeFreed, pOp->escapeMode);
 		}
 		/* got source, now copy over */
 		if(iLenVal > 0) { /* may be zero depending on property */
@@ -220,8 +561,6 @@ tplToString(struct template *pTpl, msg_t *pMsg, uchar **ppBuf, size_t *pLenBuf,
 
 		if(bMustBeFreed)
 			free(pVal);
-
-		pTpe = pTpe->pNext;
 	}
 
 	if(iBuf == *pLenBuf) {
@@ -312,6 +651,9 @@ finalize_it:
 /* This functions converts a template into a json object.
  * For further general details, see the very similar funtion
  * tpltoString().
+ * Note that this still builds a json-c object tree, as this is what
+ * modules requesting OMSR_TPL_AS_JSON receive. JSON text is rendered
+ * without json-c by tplToString() for the json and jsonf options.
  * rgerhards, 2012-08-29
  */
 rsRetVal
@@ -330,8 +672,6 @@ tplToJSON(struct template *pTpl, msg_t *pMsg, struct json_object **pjson, struct
 		if(*pjson == NULL) {
 			/* we need to have a root object! */
 			*pjson = json_object_new_object();
-		} else {
-			json_object_get(*pjson); /* inc refcount */
 		}
 		FINALIZE;
 	}
@@ -347,7 +687,7 @@ tplToJSON(struct template *pTpl, msg_t *pMsg, struct json_object **pjson, struct
 			if(pTpe->data.field.propid == PROP_CEE) {
 				localRet = msgGetCEEPropJSON(pMsg, pTpe->data.field.propName, &jsonf);
 				if(localRet == RS_RET_OK) {
-					json_object_object_add(json, (char*)pTpe->fieldName, json_object_get(jsonf));
+					json_object_object_add(json, (char*)pTpe->fieldName, jsonf);
 				} else {
 					DBGPRINTF("tplToJSON: error %d looking up property\n",
 						  localRet);
@@ -432,64 +772,78 @@ rsRetVal
 doEscape(uchar **pp, rs_size_t *pLen, unsigned short *pbMustBeFreed, int mode)
 {
 	DEFiRet;
-	uchar *p = NULL;
-	int iLen;
-	cstr_t *pStrB = NULL;
+	uchar *pSrc;
 	uchar *pszGenerated;
+	uchar c1, c2;
+	size_t lenSrc;
+	size_t lenClean;
+	size_t i;
+	size_t iDst;
+	size_t nEsc;
 
 	assert(pp != NULL);
 	assert(*pp != NULL);
 	assert(pLen != NULL);
 	assert(pbMustBeFreed != NULL);
 
-	/* first check if we need to do anything at all... */
-	if(mode == STDSQL_ESCAPE)
-		for(p = *pp ; *p && *p != '\'' ; ++p)
-			;
-	else if(mode == SQL_ESCAPE)
-		for(p = *pp ; *p && *p != '\'' && *p != '\\' ; ++p)
-			;
-	else if(mode == JSON_ESCAPE)
-		for(p = *pp ; *p && *p != '"' ; ++p)
-			;
-	/* when we get out of the loop, we are either at the
-	 * string terminator or the first character to escape */
-	if(p && *p == '\0')
-		FINALIZE; /* nothing to do in this case! */
+	/* the characters that need to be escaped in the given mode */
+	if(mode == STDSQL_ESCAPE) {
+		c1 = c2 = '\'';
+	} else if(mode == SQL_ESCAPE) {
+		c1 = '\'';
+		c2 = '\\';
+	} else if(mode == JSON_ESCAPE) {
+		c1 = c2 = '"';
+	} else {
+		FINALIZE;
+	}
 
-	p = *pp;
-	iLen = *pLen;
-	CHKiRet(cstrConstruct(&pStrB));
+	/* first check if we need to do anything at all... As always, the
+	 * string ends at the first \0, so we look for that, too.
+	 */
+	pSrc = *pp;
+	lenSrc = *pLen;
+	i = escScanChars(pSrc, lenSrc, c1, c2, '\0');
+	if(i == lenSrc || pSrc[i] == '\0')
+		FINALIZE; /* nothing to do in this case! */
 
-	while(*p) {
-		if((mode == SQL_ESCAPE || mode == STDSQL_ESCAPE) && *p == '\'') {
-			CHKiRet(cstrAppendChar(pStrB, (mode == STDSQL_ESCAPE) ? '\'' : '\\'));
-			iLen++;	/* reflect the extra character */
-		} else if((mode == SQL_ESCAPE) && *p == '\\') {
-			CHKiRet(cstrAppendChar(pStrB, '\\'));
-			iLen++;	/* reflect the extra character */
-		} else if((mode == JSON_ESCAPE) && *p == '"') {
-			CHKiRet(cstrAppendChar(pStrB, '\\'));
-			iLen++;	/* reflect the extra character */
-		}
-		CHKiRet(cstrAppendChar(pStrB, *p));
-		++p;
+	/* count the characters to escape, so that we can allocate the
+	 * result in one step
+	 */
+	nEsc = 0;
+	while(i < lenSrc && pSrc[i] != '\0') {
+		++nEsc;
+		++i;
+		i += escScanChars(pSrc + i, lenSrc - i, c1, c2, '\0');
+	}
+	lenSrc = i;
+	CHKmalloc(pszGenerated = malloc(lenSrc + nEsc + 1));
+
+	/* now copy over the clean runs and escape the rest */
+	i = iDst = 0;
+	while(1) {
+		lenClean = escScanChars(pSrc + i, lenSrc - i, c1, c2, c2);
+		memcpy(pszGenerated + iDst, pSrc + i, lenClean);
+		i += lenClean;
+		iDst += lenClean;
+		if(i == lenSrc)
+			break;
+		/* standard SQL doubles the quote, all others use a backslash */
+		pszGenerated[iDst++] = (mode == STDSQL_ESCAPE) ? '\'' : '\\';
+		pszGenerated[iDst++] = pSrc[i++];
 	}
-	CHKiRet(cstrFinalize(pStrB));
-	CHKiRet(cstrConvSzStrAndDestruct(pStrB, &pszGenerated, 0));
+	pszGenerated[iDst] = '\0';
 
 	if(*pbMustBeFreed)
 		free(*pp); /* discard previous value */
 
 	*pp = pszGenerated;
-	*pLen = iLen;
+	*pLen = iDst;
 	*pbMustBeFreed = 1;
 
 finalize_it:
 	if(iRet != RS_RET_OK) {
 		doEmergencyEscape(*pp, mode);
-		if(pStrB != NULL)
-			cstrDestruct(&pStrB);
 	}
 
 	RETiRet;
@@ -1955,6 +2309,7 @@ void tplDeleteAll(rsconf_t *conf)
 		}
 		pTplDel = pTpl;
 		pTpl = pTpl->pNext;
+		tplFreeOps(pTplDel);
 		free(pTplDel->pszName);
 		if(pTplDel->subtree != NULL)
 			es_deleteStr(pTplDel->subtree);
@@ -2014,6 +2369,7 @@ void tplDeleteNew(rsconf_t *conf)
 		}
 		pTplDel = pTpl;
 		pTpl = pTpl->pNext;
+		tplFreeOps(pTplDel);
 		free(pTplDel->pszName);
 		if(pTplDel->subtree != NULL)
 			es_deleteStr(pTplDel->subtree);
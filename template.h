@@ -35,6 +35,28 @@
 #include "regexp.h"
 #include "stringbuf.h"
 
+struct templateEntry;
+
+/* A compiled template entry ("render operation"). At config load, each
+ * template's entry list is turned into an array of these, see tplCompile().
+ * Adjacent constants are fused into a single operation, and for fields the
+ * renderer is selected based on property and options, so that the common
+ * cases do not need to go through MsgGetProp().
+ */
+struct tplOp_s {
+	/* renderer for fields, NULL for constants */
+	uchar *(*pfRender)(msg_t *pMsg, struct tplOp_s *pOp, rs_size_t *pLen,
+			   unsigned short *pbMustBeFreed, struct syslogTime *ttNow);
+	/* property getter used by pfRender if it needs to apply options */
+	uchar *(*pfGet)(msg_t *pMsg, struct tplOp_s *pOp, rs_size_t *pLen,
+			unsigned short *pbMustBeFreed, struct syslogTime *ttNow);
+	struct templateEntry *pTpe;	/* field entry (NULL for constants) */
+	uchar *pConstant;		/* constant value (possibly fused) */
+	int iLenConstant;
+	char escapeMode;		/* template escape mode for fields (or NO_ESCAPE) */
+};
+typedef struct tplOp_s tplOp_t;
+
 struct template {
 	struct template *pNext;
 	char *pszName;
@@ -44,6 +66,11 @@ struct template {
 	int tpenElements; /* number of elements in templateEntry list */
 	struct templateEntry *pEntryRoot;
 	struct templateEntry *pEntryLast;
+	tplOp_t *pOps;		/* compiled entries, see tplCompile() */
+	int nOps;
+	size_t lenConstants;	/* sum of the length of all constant parts */
+	size_t lenEstimate;	/* expected size of a rendered string, used to size buffers up front */
+	sbool bMsgOnly;		/* result depends on the message only (no $NOW etc), so it may be cached */
 	char optFormatEscape;	/* in text fields, */
 #	define NO_ESCAPE 0	/* 0 - do not escape, */
 #	define SQL_ESCAPE 1	/* 1 - escape "the MySQL way"  */
@@ -142,6 +169,7 @@ void tplDeleteAll(rsconf_t *conf);
 void tplDeleteNew(rsconf_t *conf);
 void tplPrintList(rsconf_t *conf);
 void tplLastStaticInit(rsconf_t *conf, struct template *tpl);
+rsRetVal tplCompileAll(rsconf_t *conf);
 rsRetVal ExtendBuf(uchar **pBuf, size_t *pLenBuf, size_t iMinSize);
 int tplRequiresDateCall(struct template *pTpl);
 /* note: if a compiler warning for undefined type tells you to look at this
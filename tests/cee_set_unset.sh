@@ -0,0 +1,14 @@
+# check that CEE properties can be set, copied and unset
+# added 2013-02-14
+# This file is part of the rsyslog project, released under ASL 2.0
+echo ===============================================================================
+echo \[cee_set_unset.sh\]: CEE property set/copy/unset test
+source $srcdir/diag.sh init
+source $srcdir/diag.sh startup cee_set_unset.conf
+source $srcdir/diag.sh injectmsg  0 5000
+echo doing shutdown
+source $srcdir/diag.sh shutdown-when-empty
+echo wait on shutdown
+source $srcdir/diag.sh wait-shutdown 
+source $srcdir/diag.sh seq-check  0 4999
+source $srcdir/diag.sh exit
@@ -0,0 +1,154 @@
+/* equivalence test for the header scanning kernels in runtime/hdrscan.h.
+ * Random (mostly almost valid) RFC3339 timestamps are fed to both the
+ * fixed-layout fast path and the generic parser. Whenever the fast path
+ * accepts a timestamp, the generic parser must accept it with the same
+ * result. The SP bitmask scanner is checked against a simple loop.
+ * Copyright (C) 2013 by Rainer Gerhards and Adiscon GmbH.
+ * usage: ./hdrscan_fuzz [iterations [seed]]
+ * Part of rsyslog, licensed under GPLv3
+ */
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "typedefs.h"
+#include "hdrscan.h"
+
+static unsigned long long rngState = 88172645463325252ULL;
+
+static unsigned
+rnd(unsigned range)
+{
+	rngState ^= rngState << 13;
+	rngState ^= rngState >> 7;
+	rngState ^= rngState << 17;
+	return (unsigned) (rngState % range);
+}
+
+/* build a timestamp with random (sometimes out of range) values */
+static int
+genTimestamp(char *buf, int *pbCanonical)
+{
+	static const char *tails[] = { "Z", ".123456Z", ".1+02:00", "-05:30", "+23:59 ", "Z host",
+				       "", "0", "9Z", " ", "Zx", ".Z", "+1:2" };
+	int year, month, day, hour, minute, second;
+	int t;
+
+	year = rnd(10000);
+	month = rnd(14);
+	day = rnd(33);
+	hour = rnd(25);
+	minute = rnd(61);
+	second = rnd(62);
+	t = rnd(sizeof(tails) / sizeof(tails[0]));
+	*pbCanonical = month >= 1 && month <= 12 && day >= 1 && day <= 31 && hour <= 23
+		       && minute <= 59 && second <= 60 && tails[t][0] != '0' && tails[t][0] != '9';
+	return sprintf(buf, "%4.4d-%2.2d-%2.2dT%2.2d:%2.2d:%2.2d%s", year, month, day, hour,
+		       minute, second, tails[t]);
+}
+
+static void
+mutate(char *buf, int *pLen)
+{
+	static const char alphabet[] = "0123456789-T:Z.+ x";
+	int n, pos;
+
+	for(n = rnd(4) ; n > 0 && *pLen > 0 ; --n) {
+		pos = rnd(*pLen);
+		switch(rnd(4)) {
+		case 0:	/* random byte */
+			buf[pos] = (char) rnd(256);
+			break;
+		case 1:	/* truncate */
+			*pLen = pos;
+			break;
+		case 2: /* delete one char */
+			memmove(buf + pos, buf + pos + 1, *pLen - pos - 1);
+			--*pLen;
+			break;
+		default:
+			buf[pos] = alphabet[rnd(sizeof(alphabet) - 1)];
+			break;
+		}
+	}
+}
+
+static int
+checkTimestamp(char *buf, int len, int bMustBeFast, unsigned *pnFast)
+{
+	struct hdrscan_dt dtFast, dtGeneric;
+	uchar *p;
+	int lenGeneric;
+	int bFast;
+
+	bFast = hdrScan3339DateTimeFixed((uchar*) buf, len, &dtFast);
+	if(!bFast) {
+		if(bMustBeFast) {
+			printf("fast path missed valid timestamp '%.*s'\n", len, buf);
+			return 1;
+		}
+		return 0;
+	}
+	++*pnFast;
+	p = (uchar*) buf;
+	lenGeneric = len;
+	if(!hdrScan3339DateTime(&p, &lenGeneric, &dtGeneric)) {
+		printf("fast path accepted, generic parser rejected '%.*s'\n", len, buf);
+		return 1;
+	}
+	if(p - (uchar*) buf != 19 || lenGeneric != len - 19 || memcmp(&dtFast, &dtGeneric, sizeof(dtFast))) {
+		printf("fast path and generic parser disagree on '%.*s'\n", len, buf);
+		return 1;
+	}
+	return 0;
+}
+
+static int
+checkCharMask(void)
+{
+	uchar buf[128];
+	uint64_t mask;
+	int len, i;
+
+	len = rnd(100);
+	for(i = 0 ; i < len ; ++i)
+		buf[i] = rnd(4) ? 'a' + rnd(26) : ' ';
+	mask = 0;
+	for(i = 0 ; i < len && i < 64 ; ++i)
+		if(buf[i] == ' ')
+			mask |= (uint64_t) 1 << i;
+	if(hdrScanCharMask(buf, len, ' ') != mask) {
+		printf("SP mask mismatch for '%.*s'\n", len, buf);
+		return 1;
+	}
+	return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+	char buf[128];
+	int len;
+	int bCanonical;
+	unsigned long i, nIter = 2000000;
+	unsigned nFast = 0;
+	unsigned nErr = 0;
+
+	if(argc > 1)
+		nIter = strtoul(argv[1], NULL, 10);
+	if(argc > 2)
+		rngState ^= strtoull(argv[2], NULL, 10);
+
+	for(i = 0 ; i < nIter && nErr < 10 ; ++i) {
+		len = genTimestamp(buf, &bCanonical);
+		if(rnd(2)) {
+			mutate(buf, &len);
+			bCanonical = 0;
+		}
+		nErr += checkTimestamp(buf, len, bCanonical, &nFast);
+		nErr += checkCharMask();
+	}
+
+	printf("hdrscan_fuzz: %lu iterations, %u via fast path, %u errors\n", i, nFast, nErr);
+	return nErr == 0 ? 0 : 1;
+}
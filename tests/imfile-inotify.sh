@@ -0,0 +1,23 @@
+# Test imfile in inotify mode. The input file is created and rotated
+# only after rsyslogd has started. As the polling interval is set very
+# high, the data is only processed in time if the inotify notifications
+# are acted upon.
+#
+# This file is part of the rsyslog project, released  under GPLv3
+echo ====================================================================================
+echo TEST: \[imfile-inotify.sh\]: test imfile inotify mode with file rotation
+source $srcdir/diag.sh init
+rm -f rsyslog.input.1
+source $srcdir/diag.sh startup imfile-inotify.conf
+sleep 1
+./inputfilegen 20000 | head -n 10000 > rsyslog.input
+sleep 1
+mv rsyslog.input rsyslog.input.1
+./inputfilegen 20000 | tail -n 10000 > rsyslog.input
+# give imfile a chance to process the new file
+sleep 2
+source $srcdir/diag.sh shutdown-when-empty # shut down rsyslogd when done processing messages
+source $srcdir/diag.sh wait-shutdown	# we need to wait until rsyslogd is finished!
+source $srcdir/diag.sh seq-check 0 19999
+rm -f rsyslog.input.1
+source $srcdir/diag.sh exit
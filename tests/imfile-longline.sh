@@ -0,0 +1,41 @@
+# Test imfile with lines longer than the stream's 4k read buffer, so that
+# most lines span one or more buffer boundaries. At the end of the file,
+# an incomplete line is written, which must be held back until it is
+# completed by a later write. Each line carries the length of its extra
+# data, which is verified by seq-check -E.
+#
+# This file is part of the rsyslog project, released  under GPLv3
+echo ===============================================================================
+echo \[imfile-longline.sh\]: test imfile with lines spanning read buffers
+source $srcdir/diag.sh init
+# generate lines $1 to $2 with 1 to 10000 octets of extra data
+genlines() {
+	awk -v s=$1 -v e=$2 'BEGIN {
+		x = "X"; while(length(x) < 10000) x = x x;
+		for(i = s ; i <= e ; ++i) {
+			n = (i * 7919) % 10000 + 1;
+			printf "msgnum:%8.8d:%d:%s\n", i, n, substr(x, 1, n);
+		}
+	}'
+}
+# generate $1 octets of extra data, without LF
+gendata() {
+	awk -v n=$1 'BEGIN { x = "X"; while(length(x) < n) x = x x; printf "%s", substr(x, 1, n) }'
+}
+rm -f rsyslog.input
+genlines 0 999 > rsyslog.input
+source $srcdir/diag.sh startup imfile-longline.conf
+sleep 2
+# incomplete line at EOF, its extra data is completed after imfile saw it
+printf "msgnum:00001000:5000:" >> rsyslog.input
+gendata 3000 >> rsyslog.input
+sleep 2
+gendata 2000 >> rsyslog.input
+echo >> rsyslog.input
+genlines 1001 1999 >> rsyslog.input
+sleep 2
+source $srcdir/diag.sh shutdown-when-empty # shut down rsyslogd when done processing messages
+source $srcdir/diag.sh wait-shutdown	# we need to wait until rsyslogd is finished!
+source $srcdir/diag.sh seq-check 0 1999 -E
+rm -f rsyslog.input
+source $srcdir/diag.sh exit
@@ -0,0 +1,32 @@
+# Test imfile in inotify mode with files that are symlinks, as found in
+# e.g. /var/log/containers. The directory watch does not report activity
+# on the files the links point to, so these files must be polled. The
+# target of the link is written to after the link exists and is then
+# rotated. One more file is configured literally and is a symlink as well.
+#
+# This file is part of the rsyslog project, released  under GPLv3
+echo ====================================================================================
+echo TEST: \[imfile-symlink.sh\]: test imfile with symlinked files
+source $srcdir/diag.sh init
+rm -rf rsyslog.input.*.log rsyslog.input.literal rsyslog.input.dir
+mkdir rsyslog.input.dir
+source $srcdir/diag.sh startup imfile-symlink.conf
+sleep 1
+./inputfilegen 20000 | head -n 2500 > rsyslog.input.dir/wild
+ln -s rsyslog.input.dir/wild rsyslog.input.1.log
+./inputfilegen 20000 | head -n 10000 | tail -n 5000 > rsyslog.input.dir/literal
+ln -s rsyslog.input.dir/literal rsyslog.input.literal
+sleep 1
+./inputfilegen 20000 | head -n 5000 | tail -n 2500 >> rsyslog.input.dir/wild
+./inputfilegen 20000 | head -n 15000 | tail -n 5000 >> rsyslog.input.dir/literal
+sleep 3
+# rotate the file the wildcard link points to
+mv rsyslog.input.dir/wild rsyslog.input.dir/wild.1
+./inputfilegen 20000 | tail -n 5000 > rsyslog.input.dir/wild
+# give imfile a chance to process the new file
+sleep 3
+source $srcdir/diag.sh shutdown-when-empty # shut down rsyslogd when done processing messages
+source $srcdir/diag.sh wait-shutdown	# we need to wait until rsyslogd is finished!
+source $srcdir/diag.sh seq-check 0 19999
+rm -rf rsyslog.input.*.log rsyslog.input.literal rsyslog.input.dir
+source $srcdir/diag.sh exit
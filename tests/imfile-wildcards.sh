@@ -0,0 +1,27 @@
+# Test imfile with a wildcard file name. The matching files are only
+# created after rsyslogd has started, one of them is deleted before the
+# last file is written. Two readers are used, so the files are spread
+# across them.
+#
+# This file is part of the rsyslog project, released  under GPLv3
+echo ====================================================================================
+echo TEST: \[imfile-wildcards.sh\]: test imfile with wildcard file names
+source $srcdir/diag.sh init
+rm -f rsyslog.input.*.log
+source $srcdir/diag.sh startup imfile-wildcards.conf
+sleep 1
+./inputfilegen 20000 | head -n 5000 > rsyslog.input.1.log
+./inputfilegen 20000 | head -n 10000 | tail -n 5000 > rsyslog.input.2.log
+./inputfilegen 20000 | head -n 15000 | tail -n 5000 > rsyslog.input.3.log
+# not monitored, does not match
+./inputfilegen 20000 > rsyslog.input.nomatch
+sleep 1
+rm -f rsyslog.input.1.log
+./inputfilegen 20000 | tail -n 5000 > rsyslog.input.4.log
+# give imfile a chance to process the new file
+sleep 2
+source $srcdir/diag.sh shutdown-when-empty # shut down rsyslogd when done processing messages
+source $srcdir/diag.sh wait-shutdown	# we need to wait until rsyslogd is finished!
+source $srcdir/diag.sh seq-check 0 19999
+rm -f rsyslog.input.*.log rsyslog.input.nomatch
+source $srcdir/diag.sh exit
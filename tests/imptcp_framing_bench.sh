@@ -0,0 +1,29 @@
+# Benchmark for the imptcp framing code. Sends tcpflood-generated
+# messages with LF and with octet-counted framing and reports how long
+# rsyslogd needed to receive and process them. Messages are discarded
+# after reception, so the numbers are mostly determined by the input
+# side. This is not part of the regular testbench, call it manually via
+#     srcdir=. ./imptcp_framing_bench.sh [nbr-of-messages]
+#
+# This file is part of the rsyslog project, released  under GPLv3
+NUMMSGS=${1:-1000000}
+echo ====================================================================================
+echo BENCHMARK: \[imptcp_framing_bench.sh\]: imptcp framing, $NUMMSGS messages
+for framing in "" "-O"
+do
+	source $srcdir/diag.sh init
+	source $srcdir/diag.sh startup imptcp_framing_bench.conf
+	STARTTIME=`date +%s%N`
+	source $srcdir/diag.sh tcpflood -c4 -m$NUMMSGS $framing -r -d200 -P129 -s
+	source $srcdir/diag.sh shutdown-when-empty
+	source $srcdir/diag.sh wait-shutdown
+	ENDTIME=`date +%s%N`
+	MSECS=$(( (ENDTIME - STARTTIME) / 1000000 ))
+	if [ "$framing" == "-O" ]; then
+		echo -n "octet-counted framing: "
+	else
+		echo -n "LF framing:            "
+	fi
+	echo "$MSECS ms, $(( NUMMSGS * 1000 / (MSECS + 1) )) msgs/sec"
+done
+source $srcdir/diag.sh exit
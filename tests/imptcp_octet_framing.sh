@@ -0,0 +1,13 @@
+# Test imptcp with octet-counted framing. Frames are of different
+# sizes, so many of them span multiple receive buffers.
+#
+# This file is part of the rsyslog project, released  under GPLv3
+echo ====================================================================================
+echo TEST: \[imptcp_octet_framing.sh\]: test imptcp with octet-counted framing
+source $srcdir/diag.sh init
+source $srcdir/diag.sh startup imptcp_octet_framing.conf
+source $srcdir/diag.sh tcpflood -c4 -m20000 -O -r -d1000 -P129
+source $srcdir/diag.sh shutdown-when-empty # shut down rsyslogd when done processing messages
+source $srcdir/diag.sh wait-shutdown       # and wait for it to terminate
+source $srcdir/diag.sh seq-check 0 19999 -E
+source $srcdir/diag.sh exit
@@ -0,0 +1,19 @@
+# Test imudp with multiple receiver threads for a single listener
+# (SO_REUSEPORT). Several senders are used, so that the messages come
+# from different source ports and are spread over the sockets of the
+# listener. Senders are throttled, as UDP may lose messages otherwise.
+#
+# This file is part of the rsyslog project, released  under GPLv3
+echo ===============================================================================
+echo \[imudp-threads.sh\]: test imudp with two receiver threads
+source $srcdir/diag.sh init
+source $srcdir/diag.sh startup imudp-threads.conf
+./tcpflood -t 127.0.0.1 -m 2500 -i 0 -Tudp -b 50 -W 5000 &
+./tcpflood -t 127.0.0.1 -m 2500 -i 2500 -Tudp -b 50 -W 5000 &
+./tcpflood -t 127.0.0.1 -m 2500 -i 5000 -Tudp -b 50 -W 5000 &
+./tcpflood -t 127.0.0.1 -m 2500 -i 7500 -Tudp -b 50 -W 5000 &
+wait
+source $srcdir/diag.sh shutdown-when-empty # shut down rsyslogd when done processing messages
+source $srcdir/diag.sh wait-shutdown
+source $srcdir/diag.sh seq-check 0 9999
+source $srcdir/diag.sh exit
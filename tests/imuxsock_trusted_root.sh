@@ -0,0 +1,57 @@
+# check the trusted properties imuxsock obtains for the sending process.
+# Several messages are sent by the same process, so all but the first are
+# served from the cache, and then by a new process, which is a cache miss.
+# The first process is named "log) test", which checks that the comm is
+# properly extracted from /proc/<pid>/stat.
+# note: we must be root and no other syslogd running in order to
+# carry out this test.
+# This file is part of the rsyslog project, released under ASL 2.0
+echo ===============================================================================
+echo \[imuxsock_trusted_root.sh\]: test trusted properties in imuxsock
+echo This test must be run as root with no other active syslogd
+if [ "$EUID" -ne 0 ]; then
+    exit 77 # Not root, skip this test
+fi
+LOGGER=`which logger`
+if [ -z "$LOGGER" ]; then
+    exit 77 # no logger available
+fi
+rm -f "log) test" testbench_socket
+cp "$LOGGER" "log) test"
+EXE=`readlink -f "log) test"`
+LOGGER=`readlink -f "$LOGGER"`
+source $srcdir/diag.sh init
+source $srcdir/diag.sh startup imuxsock_trusted_root.conf
+# the same process sends several messages (cache hit)...
+printf 'trustedtest 1\ntrustedtest 2\ntrustedtest 3\n' | "./log) test"
+printf 'trustedtest 1\ntrustedtest 2\ntrustedtest 3\n' | "./log) test" -u testbench_socket
+# ... and then a new one (cache miss)
+$LOGGER trustedtest 4
+$LOGGER -u testbench_socket trustedtest 4
+# the sleep below is needed to prevent too-early termination of rsyslogd
+./msleep 100
+source $srcdir/diag.sh shutdown-when-empty # shut down rsyslogd when done processing messages
+source $srcdir/diag.sh wait-shutdown	# we need to wait until rsyslogd is finished!
+rm -f "log) test" testbench_socket
+for i in 1 2 3; do
+	echo " trustedtest $i @[_PID=x _COMM=log) test _EXE=$EXE _CMDLINE=\"./log) test \"]"
+done > rsyslog.out.expect.log
+echo " trustedtest 4 @[_PID=x _COMM=logger _EXE=$LOGGER _CMDLINE=\"$LOGGER trustedtest 4 \"]" >> rsyslog.out.expect.log
+for i in 1 2 3; do
+	echo "log) test|$EXE|./log) test -u testbench_socket | trustedtest $i"
+done > rsyslog.out.expect2.log
+echo "logger|$LOGGER|$LOGGER -u testbench_socket trustedtest 4 | trustedtest 4" >> rsyslog.out.expect2.log
+# pid, uid and gid depend on the environment
+sed -e 's/_PID=[0-9]* _UID=[0-9]* _GID=[0-9]*/_PID=x/' rsyslog.out.log | cmp - rsyslog.out.expect.log
+if [ ! $? -eq 0 ]; then
+echo "imuxsock_trusted_root.sh failed: annotated messages are:"
+cat rsyslog.out.log
+exit 1
+fi;
+cmp rsyslog2.out.log rsyslog.out.expect2.log
+if [ ! $? -eq 0 ]; then
+echo "imuxsock_trusted_root.sh failed: parsed trusted properties are:"
+cat rsyslog2.out.log
+exit 1
+fi;
+source $srcdir/diag.sh exit
@@ -0,0 +1,28 @@
+# check that $!all-json reflects modifications of the message's
+# structured properties between actions (the serialized form is cached)
+# This file is part of the rsyslog project, released under ASL 2.0
+echo ===============================================================================
+echo \[json_allcache.sh\]: \$!all-json after set/unset
+source $srcdir/diag.sh init
+source $srcdir/diag.sh startup json_allcache.conf
+source $srcdir/diag.sh injectmsg  0 1
+echo doing shutdown
+source $srcdir/diag.sh shutdown-when-empty
+echo wait on shutdown
+source $srcdir/diag.sh wait-shutdown 
+echo '{ "usr": { "msgnum": "00000000" } }' | cmp - rsyslog.out.log
+if [ ! $? -eq 0 ]; then
+echo "json_allcache.sh failed: initial properties"
+exit 1
+fi;
+echo '{ "usr": { "msgnum": "00000000", "path": "\/var\/log" } }' | cmp - rsyslog2.out.log
+if [ ! $? -eq 0 ]; then
+echo "json_allcache.sh failed: after set"
+exit 1
+fi;
+echo '{ "usr": { "path": "\/var\/log" } }' | cmp - rsyslog.out.unset.log
+if [ ! $? -eq 0 ]; then
+echo "json_allcache.sh failed: after unset"
+exit 1
+fi;
+source $srcdir/diag.sh exit
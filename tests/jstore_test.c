@@ -0,0 +1,242 @@
+/* unit test for the native store of the structured message properties
+ * (runtime/jstore.c). Covers inserting, replacing and deleting properties,
+ * nested paths, the json-c converters and the copy-on-write semantics
+ * used by MsgDup().
+ * Copyright (C) 2013 by Rainer Gerhards and Adiscon GmbH.
+ * usage: ./jstore_test
+ * Part of rsyslog, licensed under GPLv3
+ */
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rsyslog.h"
+#include "jsonw.h"
+#include "jstore.h"
+
+/* jstore.c is linked stand-alone, without the debug system */
+int Debug = 0;
+void dbgprintf(char __attribute__((unused)) *fmt, ...) { }
+
+static int nErr = 0;
+
+#define CHECK(cond) \
+	if(!(cond)) { \
+		printf("jstore_test: line %d: check failed: %s\n", __LINE__, #cond); \
+		++nErr; \
+	}
+
+static jstnode_t *
+find(jstore_t *pStore, char *path)
+{
+	return jstoreFind(pStore, (uchar*) path, strlen(path));
+}
+
+/* check that a property holds the string value expected */
+static int
+isStr(jstore_t *pStore, char *path, char *val)
+{
+	jstnode_t *pNode = find(pStore, path);
+	return pNode != NULL && pNode->type == JST_STRING && pNode->v.str.len == strlen(val)
+	       && !memcmp(pNode->v.str.psz, val, pNode->v.str.len);
+}
+
+/* check the template (string) representation of a property */
+static int
+isText(jstore_t *pStore, char *path, char *text)
+{
+	jstnode_t *pNode = find(pStore, path);
+	uchar *pRes;
+	rs_size_t len;
+	unsigned short bMustBeFreed;
+	int r;
+
+	if(pNode == NULL || jstoreNodeGetStr(pNode, &pRes, &len, &bMustBeFreed) != RS_RET_OK)
+		return 0;
+	r = len == (rs_size_t) strlen(text) && !memcmp(pRes, text, len);
+	if(!r)
+		printf("jstore_test: '%s' is '%.*s', expected '%s'\n", path, (int) len, pRes, text);
+	if(bMustBeFreed)
+		free(pRes);
+	return r;
+}
+
+static void
+testInsertReplace(void)
+{
+	jstore_t *pStore;
+
+	CHECK(jstoreConstruct(&pStore) == RS_RET_OK);
+	CHECK(find(pStore, "!") == pStore->pRoot);
+	CHECK(find(pStore, "!a") == NULL);
+	CHECK(jstoreSetStr(pStore, (uchar*) "!a", (uchar*) "x", 1) == RS_RET_OK);
+	CHECK(jstoreSetInt(pStore, (uchar*) "!n", 42) == RS_RET_OK);
+	CHECK(isStr(pStore, "!a", "x"));
+	CHECK(find(pStore, "!n") != NULL && find(pStore, "!n")->type == JST_INT);
+	CHECK(isText(pStore, "!n", "42"));
+	/* replacing must not add a second member of the same name */
+	CHECK(jstoreSetStr(pStore, (uchar*) "!a", (uchar*) "longer", 6) == RS_RET_OK);
+	CHECK(isStr(pStore, "!a", "longer"));
+	CHECK(jstoreSetInt(pStore, (uchar*) "!a", 7) == RS_RET_OK);
+	CHECK(find(pStore, "!a")->type == JST_INT);
+	CHECK(pStore->pRoot->v.c.nElem == 2);
+	/* values may contain NUL */
+	CHECK(jstoreSetStr(pStore, (uchar*) "!z", (uchar*) "a\0b", 3) == RS_RET_OK);
+	CHECK(find(pStore, "!z")->v.str.len == 3);
+	/* the root can not hold a scalar */
+	CHECK(jstoreSetStr(pStore, (uchar*) "!", (uchar*) "x", 1) == RS_RET_INVLD_SETOP);
+	jstoreDestruct(&pStore);
+	CHECK(pStore == NULL);
+}
+
+static void
+testNested(void)
+{
+	jstore_t *pStore;
+
+	CHECK(jstoreConstruct(&pStore) == RS_RET_OK);
+	CHECK(jstoreSetStr(pStore, (uchar*) "!b!c!d", (uchar*) "deep", 4) == RS_RET_OK);
+	CHECK(isStr(pStore, "!b!c!d", "deep"));
+	CHECK(find(pStore, "!b") != NULL && find(pStore, "!b")->type == JST_OBJECT);
+	CHECK(find(pStore, "!b!c")->v.c.nElem == 1);
+	CHECK(jstoreSetStr(pStore, (uchar*) "!b!c!e", (uchar*) "2nd", 3) == RS_RET_OK);
+	CHECK(isText(pStore, "!b", "{ \"c\": { \"d\": \"deep\", \"e\": \"2nd\" } }"));
+	CHECK(find(pStore, "!b!x!d") == NULL);
+	/* a scalar can not be walked through */
+	CHECK(jstoreSetStr(pStore, (uchar*) "!b!c!d!f", (uchar*) "x", 1) == RS_RET_JNAME_INVALID);
+	CHECK(find(pStore, "!b!c!d!f") == NULL);
+	/* a container can not be replaced by a scalar, the subtree is kept */
+	CHECK(jstoreSetInt(pStore, (uchar*) "!b!c", 1) == RS_RET_INVLD_SETOP);
+	CHECK(isStr(pStore, "!b!c!d", "deep"));
+	/* once the scalar is deleted, a container of the same name can be added */
+	CHECK(jstoreDel(pStore, (uchar*) "!b!c!d") == RS_RET_OK);
+	CHECK(jstoreSetStr(pStore, (uchar*) "!b!c!d!f", (uchar*) "x", 1) == RS_RET_OK);
+	CHECK(isText(pStore, "!b!c", "{ \"e\": \"2nd\", \"d\": { \"f\": \"x\" } }"));
+	jstoreDestruct(&pStore);
+}
+
+static void
+testDelete(void)
+{
+	jstore_t *pStore;
+
+	CHECK(jstoreConstruct(&pStore) == RS_RET_OK);
+	CHECK(jstoreSetStr(pStore, (uchar*) "!a", (uchar*) "1", 1) == RS_RET_OK);
+	CHECK(jstoreSetStr(pStore, (uchar*) "!b!c", (uchar*) "2", 1) == RS_RET_OK);
+	CHECK(jstoreSetStr(pStore, (uchar*) "!b!d", (uchar*) "3", 1) == RS_RET_OK);
+	CHECK(jstoreDel(pStore, (uchar*) "!a") == RS_RET_OK);
+	CHECK(find(pStore, "!a") == NULL);
+	CHECK(jstoreDel(pStore, (uchar*) "!a") == RS_RET_JNAME_NOTFOUND);
+	CHECK(jstoreDel(pStore, (uchar*) "!x!y") == RS_RET_JNAME_NOTFOUND);
+	CHECK(jstoreDel(pStore, (uchar*) "!b!c") == RS_RET_OK);
+	CHECK(find(pStore, "!b!c") == NULL);
+	CHECK(isStr(pStore, "!b!d", "3"));
+	/* the last member can be re-added after the first was removed */
+	CHECK(jstoreSetStr(pStore, (uchar*) "!b!e", (uchar*) "4", 1) == RS_RET_OK);
+	CHECK(isText(pStore, "!b", "{ \"d\": \"3\", \"e\": \"4\" }"));
+	CHECK(jstoreDel(pStore, (uchar*) "!") == RS_RET_OK);
+	CHECK(pStore->pRoot->v.c.nElem == 0 && find(pStore, "!b") == NULL);
+	CHECK(isText(pStore, "!", "{ }"));
+	jstoreDestruct(&pStore);
+}
+
+static void
+testJSON(void)
+{
+	jstore_t *pStore;
+	struct json_object *json, *arr;
+
+	CHECK(jstoreConstruct(&pStore) == RS_RET_OK);
+	json = json_object_new_object();
+	arr = json_object_new_array();
+	json_object_array_add(arr, json_object_new_int(1));
+	json_object_array_add(arr, json_object_new_string("two"));
+	json_object_array_add(arr, json_object_new_boolean(1));
+	json_object_object_add(json, "k", arr);
+	json_object_object_add(json, "s", json_object_new_string("q\"uote"));
+	CHECK(jstoreSetJSON(pStore, (uchar*) "!j", json) == RS_RET_OK);
+	CHECK(find(pStore, "!j!k") != NULL && find(pStore, "!j!k")->type == JST_ARRAY);
+	CHECK(isText(pStore, "!j", "{ \"k\": [ 1, \"two\", true ], \"s\": \"q\\\"uote\" }"));
+	/* setting the root merges into it */
+	json = json_object_new_object();
+	json_object_object_add(json, "m", json_object_new_string("v"));
+	CHECK(jstoreSetJSON(pStore, (uchar*) "!", json) == RS_RET_OK);
+	CHECK(isStr(pStore, "!m", "v"));
+	CHECK(find(pStore, "!j") != NULL);
+	CHECK(jstoreSetJSON(pStore, (uchar*) "!", json_object_new_string("x")) == RS_RET_INVLD_SETOP);
+	/* the json-c view of a subtree has the same content */
+	json = jstoreNodeToJSON(find(pStore, "!j"));
+	CHECK(json != NULL && !strcmp(json_object_to_json_string(json),
+			"{ \"k\": [ 1, \"two\", true ], \"s\": \"q\\\"uote\" }"));
+	json_object_put(json);
+	/* integers keep their full 64 bits in both directions */
+	CHECK(jstoreSetJSON(pStore, (uchar*) "!big", json_object_new_int64(5000000000LL)) == RS_RET_OK);
+	CHECK(find(pStore, "!big")->v.n == 5000000000LL);
+	CHECK(jstoreSetInt(pStore, (uchar*) "!neg", -5000000000LL) == RS_RET_OK);
+	json = jstoreNodeToJSON(find(pStore, "!neg"));
+	CHECK(json != NULL && json_object_get_int64(json) == -5000000000LL);
+	json_object_put(json);
+	jstoreDestruct(&pStore);
+}
+
+static void
+testCopyOnWrite(void)
+{
+	jstore_t *pStore, *pDup;
+
+	CHECK(jstoreConstruct(&pStore) == RS_RET_OK);
+	CHECK(jstoreSetStr(pStore, (uchar*) "!a!b", (uchar*) "orig", 4) == RS_RET_OK);
+	pDup = jstoreAddRef(pStore);
+	CHECK(pDup == pStore);
+	CHECK(jstoreMakeWritable(&pDup) == RS_RET_OK);
+	CHECK(pDup != pStore);
+	CHECK(jstoreSetStr(pDup, (uchar*) "!a!b", (uchar*) "copy", 4) == RS_RET_OK);
+	CHECK(isStr(pStore, "!a!b", "orig"));
+	CHECK(isStr(pDup, "!a!b", "copy"));
+	/* a store that is no longer shared is written in place */
+	CHECK(jstoreMakeWritable(&pStore) == RS_RET_OK);
+	CHECK(pStore->iRefCount == 1);
+	jstoreDestruct(&pDup);
+	jstoreDestruct(&pStore);
+}
+
+/* more data than fits into the inline arena */
+static void
+testLarge(void)
+{
+	jstore_t *pStore, *pDup;
+	char name[32];
+	char val[64];
+	int i;
+
+	CHECK(jstoreConstruct(&pStore) == RS_RET_OK);
+	for(i = 0 ; i < 1000 ; ++i) {
+		snprintf(name, sizeof(name), "!grp%d!p%d", i % 10, i);
+		snprintf(val, sizeof(val), "value number %d with some padding", i);
+		CHECK(jstoreSetStr(pStore, (uchar*) name, (uchar*) val, strlen(val)) == RS_RET_OK);
+	}
+	pDup = jstoreAddRef(pStore);
+	CHECK(jstoreMakeWritable(&pDup) == RS_RET_OK);
+	for(i = 0 ; i < 1000 ; ++i) {
+		snprintf(name, sizeof(name), "!grp%d!p%d", i % 10, i);
+		snprintf(val, sizeof(val), "value number %d with some padding", i);
+		CHECK(isStr(pStore, name, val));
+		CHECK(isStr(pDup, name, val));
+	}
+	CHECK(find(pStore, "!grp3")->v.c.nElem == 100);
+	jstoreDestruct(&pDup);
+	jstoreDestruct(&pStore);
+}
+
+int
+main(void)
+{
+	testInsertReplace();
+	testNested();
+	testDelete();
+	testJSON();
+	testCopyOnWrite();
+	testLarge();
+	printf("jstore_test: %d errors\n", nErr);
+	return nErr == 0 ? 0 : 1;
+}
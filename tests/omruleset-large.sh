@@ -0,0 +1,14 @@
+# Test omruleset with messages that are too large for the msg_t-included
+# buffer. In that case the duplicate created by omruleset shares the raw
+# message buffer with the original message.
+# added 2013-02-15
+# This file is part of the rsyslog project, released under GPLv3
+echo ===============================================================================
+echo \[omruleset-large.sh\]: test omruleset with large messages
+source $srcdir/diag.sh init
+source $srcdir/diag.sh startup omruleset-large.conf
+source $srcdir/diag.sh tcpflood -m5000 -r -d2000 -P129
+source $srcdir/diag.sh shutdown-when-empty
+source $srcdir/diag.sh wait-shutdown
+source $srcdir/diag.sh seq-check 0 4999 -E
+source $srcdir/diag.sh exit
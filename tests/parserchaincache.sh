@@ -0,0 +1,15 @@
+# check that messages are still parsed correctly when the parser chain
+# cache is enabled (all messages come from the same input and sender,
+# so all but the first one are parsed via the cache)
+# This file is part of the rsyslog project, released under ASL 2.0
+echo ===============================================================================
+echo \[parserchaincache.sh\]: parser chain cache
+source $srcdir/diag.sh init
+source $srcdir/diag.sh startup parserchaincache.conf
+source $srcdir/diag.sh injectmsg  0 5000
+echo doing shutdown
+source $srcdir/diag.sh shutdown-when-empty
+echo wait on shutdown
+source $srcdir/diag.sh wait-shutdown 
+source $srcdir/diag.sh seq-check  0 4999
+source $srcdir/diag.sh exit
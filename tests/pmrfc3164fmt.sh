@@ -0,0 +1,8 @@
+# test for the declarative rfc3164 format parser
+# This file is part of the rsyslog project, released  under GPLv3
+echo ===============================================================================
+echo \[pmrfc3164fmt.sh\]: test for the declarative rfc3164 format parser
+source $srcdir/diag.sh init
+source $srcdir/diag.sh nettester pmrfc3164fmt udp
+source $srcdir/diag.sh nettester pmrfc3164fmt tcp
+source $srcdir/diag.sh exit
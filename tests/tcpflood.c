@@ -33,6 +33,7 @@
  * -D	randomly drop and re-establish connections. Useful for stress-testing
  *      the TCP receiver.
  * -F	USASCII value for frame delimiter (in octet-stuffing mode), default LF
+ * -O	use octet-counted framing instead of octet-stuffing (not for file input)
  * -R	number of times the test shall be run (very useful for gathering performance
  *      data and other repetitive things). Default: 1
  * -S   number of seconds to sleep between different runs (-R) Default: 30
@@ -124,6 +125,7 @@ static int bBinaryFile = 0;	/* is -I file binary */
 static char *dataFile = NULL;	/* name of data file, if NULL, generate own data */
 static int numFileIterations = 1;/* how often is file data to be sent? */
 static char frameDelim = '\n';	/* default frame delimiter */
+static int bOctetCount = 0;	/* use octet-counted framing? */
 FILE *dataFP = NULL;		/* file pointer for data file, if used */
 static long nConnDrops = 0;	/* counter: number of time connection was dropped (-D option) */
 static int numRuns = 1;		/* number of times the test shall be run */
@@ -341,6 +343,8 @@ genMsg(char *buf, size_t maxBuf, int *pLenBuf, struct instdata *inst)
 	int edLen; /* actual extra data length to use */
 	char extraData[MAX_EXTRADATA_LEN + 1];
 	char dynFileIDBuf[128] = "";
+	char hdr[16];
+	int lenHdr, lenMsg;
 	int done;
 
 	if(dataFP != NULL) {
@@ -379,6 +383,14 @@ genMsg(char *buf, size_t maxBuf, int *pLenBuf, struct instdata *inst)
 		/* use fixed message format from command line */
 		*pLenBuf = snprintf(buf, maxBuf, "%s\n", MsgToSend);
 	}
+	if(bOctetCount && dataFP == NULL) {
+		/* replace the frame delimiter by the octet count header */
+		lenMsg = *pLenBuf - 1;
+		lenHdr = snprintf(hdr, sizeof(hdr), "%d ", lenMsg);
+		memmove(buf + lenHdr, buf, lenMsg);
+		memcpy(buf, hdr, lenHdr);
+		*pLenBuf = lenHdr + lenMsg;
+	}
 	++inst->numSent;
 
 finalize_it: /*EMPTY to keep the compiler happy */;
@@ -830,7 +842,7 @@ int main(int argc, char *argv[])
 
 	setvbuf(stdout, buf, _IONBF, 48);
 	
-	while((opt = getopt(argc, argv, "b:ef:F:t:p:c:C:m:i:I:P:d:Dn:L:M:rsBR:S:T:XW:Yz:Z:")) != -1) {
+	while((opt = getopt(argc, argv, "b:ef:F:t:p:c:C:m:i:I:P:d:Dn:L:M:OrsBR:S:T:XW:Yz:Z:")) != -1) {
 		switch (opt) {
 		case 'b':	batchsize = atoll(optarg);
 				break;
@@ -865,6 +877,8 @@ int main(int argc, char *argv[])
 				break;
 		case 'F':	frameDelim = atoi(optarg);
 				break;
+		case 'O':	bOctetCount = 1;
+				break;
 		case 'L':	tlsLogLevel = atoi(optarg);
 				break;
 		case 'M':	MsgToSend = optarg;
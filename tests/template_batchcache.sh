@@ -0,0 +1,15 @@
+# check that a template string rendered for one action is reused by
+# later actions only as long as the message was not modified in between
+# This file is part of the rsyslog project, released under ASL 2.0
+echo ===============================================================================
+echo \[template_batchcache.sh\]: template render cache across actions
+source $srcdir/diag.sh init
+source $srcdir/diag.sh startup template_batchcache.conf
+source $srcdir/diag.sh injectmsg  0 5000
+echo doing shutdown
+source $srcdir/diag.sh shutdown-when-empty
+echo wait on shutdown
+source $srcdir/diag.sh wait-shutdown 
+source $srcdir/diag.sh seq-check  0 4999
+source $srcdir/diag.sh seq-check2 0 4999
+source $srcdir/diag.sh exit
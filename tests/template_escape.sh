@@ -0,0 +1,18 @@
+# check the sql template option together with the json property option,
+# which both use the vectorized escape scanners.
+# added 2013-02-20
+# This file is part of the rsyslog project, released under ASL 2.0
+echo ===============================================================================
+echo \[template_escape.sh\]: test for sql and json escaping
+$srcdir/killrsyslog.sh # kill rsyslogd if it runs for some reason
+
+./nettester -ttemplate_escape -iudp
+if [ "$?" -ne "0" ]; then
+  exit 1
+fi
+
+echo test via tcp
+./nettester -ttemplate_escape -itcp
+if [ "$?" -ne "0" ]; then
+  exit 1
+fi
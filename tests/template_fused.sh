@@ -0,0 +1,19 @@
+# check that compiled templates render the same as before. The template
+# mixes fused constants, fast-path properties, a property with options
+# and the json escape option.
+# added 2013-02-20
+# This file is part of the rsyslog project, released under ASL 2.0
+echo ===============================================================================
+echo \[template_fused.sh\]: test for compiled templates
+$srcdir/killrsyslog.sh # kill rsyslogd if it runs for some reason
+
+./nettester -ttemplate_fused -iudp
+if [ "$?" -ne "0" ]; then
+  exit 1
+fi
+
+echo test via tcp
+./nettester -ttemplate_fused -itcp
+if [ "$?" -ne "0" ]; then
+  exit 1
+fi
@@ -0,0 +1,100 @@
+/* benchmark for uuid generation, compares the previous approach (libuuid
+ * under a global mutex, hex conversion nibble by nibble) with the
+ * per-thread generator from runtime/uuidgen.c.
+ * Copyright (C) 2013 by Rainer Gerhards and Adiscon GmbH.
+ * usage: ./uuidbench [num-threads [num-uuids-per-thread]]
+ * Part of rsyslog, licensed under GPLv3
+ */
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <uuid/uuid.h>
+#include "uuidgen.h"
+
+static int nPerThread = 1000000;
+static pthread_mutex_t mutUUID = PTHREAD_MUTEX_INITIALIZER;
+static volatile unsigned char sink; /* keep the compiler from optimizing work away */
+
+static void *
+benchLibuuid(void __attribute__((unused)) *arg)
+{
+	char hex_char [] = "0123456789ABCDEF";
+	unsigned char *psz;
+	unsigned byte_nbr;
+	uuid_t uuid;
+	int i;
+
+	for(i = 0 ; i < nPerThread ; ++i) {
+		if((psz = malloc(sizeof(uuid_t) * 2 + 1)) == NULL)
+			break;
+		pthread_mutex_lock(&mutUUID);
+		uuid_generate(uuid);
+		pthread_mutex_unlock(&mutUUID);
+		for(byte_nbr = 0; byte_nbr < sizeof (uuid_t); byte_nbr++) {
+			psz[byte_nbr * 2 + 0] = hex_char[uuid [byte_nbr] >> 4];
+			psz[byte_nbr * 2 + 1] = hex_char[uuid [byte_nbr] & 15];
+		}
+		psz[sizeof(uuid_t) * 2] = '\0';
+		sink ^= psz[0];
+		free(psz);
+	}
+	return NULL;
+}
+
+static void *
+benchUuidgen(void __attribute__((unused)) *arg)
+{
+	unsigned char buf[UUIDGEN_LEN_HEX + 1];
+	int i;
+
+	for(i = 0 ; i < nPerThread ; ++i) {
+		uuidgenGenerateHex(buf);
+		sink ^= buf[0];
+	}
+	return NULL;
+}
+
+static void
+runBench(char *name, void *(*fn)(void*), int nThreads)
+{
+	pthread_t *thrds;
+	struct timeval tvStart, tvEnd;
+	long long usecs;
+	int i;
+
+	if((thrds = calloc(nThreads, sizeof(pthread_t))) == NULL) {
+		perror("calloc");
+		exit(1);
+	}
+	gettimeofday(&tvStart, NULL);
+	for(i = 0 ; i < nThreads ; ++i)
+		pthread_create(&thrds[i], NULL, fn, NULL);
+	for(i = 0 ; i < nThreads ; ++i)
+		pthread_join(thrds[i], NULL);
+	gettimeofday(&tvEnd, NULL);
+	usecs = (tvEnd.tv_sec - tvStart.tv_sec) * 1000000LL + (tvEnd.tv_usec - tvStart.tv_usec);
+	printf("%-8s %d threads, %d uuids each: %lld.%3.3lld s, %.1f ns/uuid\n", name, nThreads,
+	       nPerThread, usecs / 1000000, (usecs % 1000000) / 1000,
+	       (double) usecs * 1000.0 / ((double) nThreads * nPerThread));
+	free(thrds);
+}
+
+int main(int argc, char* argv[])
+{
+	int nThreads = 8;
+
+	if(argc > 3) {
+		fprintf(stderr, "usage: uuidbench [num-threads [num-uuids-per-thread]]\n");
+		return 1;
+	}
+	if(argc > 1)
+		nThreads = atoi(argv[1]);
+	if(argc > 2)
+		nPerThread = atoi(argv[2]);
+
+	runBench("libuuid", benchLibuuid, nThreads);
+	runBench("uuidgen", benchUuidgen, nThreads);
+	return 0;
+}
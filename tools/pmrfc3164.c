@@ -76,8 +76,7 @@ BEGINparse
 	uchar *p2parse;
 	int lenMsg;
 	int i;	/* general index for parsing */
-	uchar bufParseTAG[CONF_TAG_MAXSIZE];
-	uchar bufParseHOSTNAME[CONF_HOSTNAME_MAXSIZE];
+	uchar *pTAG;
 CODESTARTparse
 	DBGPRINTF("Message will now be parsed by the legacy syslog parser (one size fits all... ;)).\n");
 	assert(pMsg != NULL);
@@ -140,24 +139,24 @@ CODESTARTparse
 			i = 0;
 			while(i < lenMsg && (isalnum(p2parse[i]) || p2parse[i] == '.'
 				|| p2parse[i] == '_' || p2parse[i] == '-') && i < (CONF_HOSTNAME_MAXSIZE - 1)) {
-				bufParseHOSTNAME[i] = p2parse[i];
 				++i;
 			}
 
+			/* the hostname is only located here, it is copied out of the
+			 * raw message when (and if) it is actually needed.
+			 */
 			if(i == lenMsg) {
 				/* we have a message that is empty immediately after the hostname,
 				* but the hostname thus is valid! -- rgerhards, 2010-02-22
 				*/
+				MsgSetLazyField(pMsg, MSG_LAZY_HOSTNAME, p2parse - pMsg->pszRawMsg, i);
 				p2parse += i;
 				lenMsg -= i;
-				bufParseHOSTNAME[i] = '\0';
-				MsgSetHOSTNAME(pMsg, bufParseHOSTNAME, i);
 			} else if(i > 0 && p2parse[i] == ' ' && isalnum(p2parse[i-1])) {
 				/* we got a hostname! */
+				MsgSetLazyField(pMsg, MSG_LAZY_HOSTNAME, p2parse - pMsg->pszRawMsg, i);
 				p2parse += i + 1; /* "eat" it (including SP delimiter) */
 				lenMsg -= i + 1;
-				bufParseHOSTNAME[i] = '\0';
-				MsgSetHOSTNAME(pMsg, bufParseHOSTNAME, i);
 			}
 		}
 
@@ -174,22 +173,23 @@ CODESTARTparse
 		 * in RFC3164...). We now receive the full size, but will modify the
 		 * outputs so that only 32 characters max are used by default.
 		 */
+		pTAG = p2parse;
 		i = 0;
 		while(lenMsg > 0 && *p2parse != ':' && *p2parse != ' ' && i < CONF_TAG_MAXSIZE - 2) {
-			bufParseTAG[i++] = *p2parse++;
+			++i;
+			++p2parse;
 			--lenMsg;
 		}
 		if(lenMsg > 0 && *p2parse == ':') {
 			++p2parse; 
 			--lenMsg;
-			bufParseTAG[i++] = ':';
+			++i; /* the colon is part of the TAG */
 		}
 
 		/* no TAG can only be detected if the message immediatly ends, in which case an empty TAG
 		 * is considered OK. So we do not need to check for empty TAG. -- rgerhards, 2009-06-23
 		 */
-		bufParseTAG[i] = '\0';	/* terminate string */
-		MsgSetTAG(pMsg, bufParseTAG, i);
+		MsgSetLazyField(pMsg, MSG_LAZY_TAG, pTAG - pMsg->pszRawMsg, i);
 	} else {/* we enter this code area when the user has instructed rsyslog NOT
 		 * to parse HOSTNAME and TAG - rgerhards, 2006-03-13
 		 */
@@ -42,6 +42,7 @@
 #include "parser.h"
 #include "datetime.h"
 #include "unicode-helper.h"
+#include "hdrscan.h"
 
 MODULE_TYPE_PARSER
 MODULE_TYPE_NOKEEP
@@ -69,30 +70,32 @@ ENDisCompatibleWithFeature
 
 
 /* Helper to parseRFCSyslogMsg. This function parses a field up to
- * (and including) the SP character after it. The field contents is
- * returned in a caller-provided buffer. The parsepointer is advanced
- * to after the terminating SP. The caller must ensure that the 
- * provided buffer is large enough to hold the to be extracted value.
+ * (and including) the SP character after it. The field is not copied,
+ * its length is returned in *pLenField, it starts at the parse pointer
+ * as it was on entry. The parsepointer is advanced
+ * to after the terminating SP.
  * Returns 0 if everything is fine or 1 if either the field is not
  * SP-terminated or any other error occurs. -- rger, 2005-11-24
  * The function now receives the size of the string and makes sure
  * that it does not process more than that. The *pLenStr counter is
  * updated on exit. -- rgerhards, 2009-09-23
  */
-static int parseRFCField(uchar **pp2parse, uchar *pResult, int *pLenStr)
+static int parseRFCField(uchar **pp2parse, int *pLenStr, int *pLenField)
 {
 	uchar *p2parse;
+	int lenField = 0;
 	int iRet = 0;
 
 	assert(pp2parse != NULL);
 	assert(*pp2parse != NULL);
-	assert(pResult != NULL);
+	assert(pLenField != NULL);
 
 	p2parse = *pp2parse;
 
 	/* this is the actual parsing loop */
 	while(*pLenStr > 0  && *p2parse != ' ') {
-		*pResult++ = *p2parse++;
+		++p2parse;
+		++lenField;
 		--(*pLenStr);
 	}
 
@@ -102,10 +105,10 @@ static int parseRFCField(uchar **pp2parse, uchar *pResult, int *pLenStr)
 	} else {
 		iRet = 1; /* there MUST be an SP! */
 	}
-	*pResult = '\0';
 
 	/* set the new parse pointer */
 	*pp2parse = p2parse;
+	*pLenField = lenField;
 	return iRet;
 }
 
@@ -113,25 +116,27 @@ static int parseRFCField(uchar **pp2parse, uchar *pResult, int *pLenStr)
 /* Helper to parseRFCSyslogMsg. This function parses the structured
  * data field of a message. It does NOT parse inside structured data,
  * just gets the field as whole. Parsing the single entities is left
- * to other functions. The parsepointer is advanced
- * to after the terminating SP. The caller must ensure that the 
- * provided buffer is large enough to hold the to be extracted value.
+ * to other functions. As with parseRFCField(), the field is not copied,
+ * only its length is returned in *pLenField (-1 if there is no structured
+ * data at all). The parsepointer is advanced
+ * to after the terminating SP.
  * Returns 0 if everything is fine or 1 if either the field is not
  * SP-terminated or any other error occurs. -- rger, 2005-11-24
  * The function now receives the size of the string and makes sure
  * that it does not process more than that. The *pLenStr counter is
  * updated on exit. -- rgerhards, 2009-09-23
  */
-static int parseRFCStructuredData(uchar **pp2parse, uchar *pResult, int *pLenStr)
+static int parseRFCStructuredData(uchar **pp2parse, int *pLenStr, int *pLenField)
 {
 	uchar *p2parse;
 	int bCont = 1;
 	int iRet = 0;
 	int lenStr;
+	int lenField = 0;
 
 	assert(pp2parse != NULL);
 	assert(*pp2parse != NULL);
-	assert(pResult != NULL);
+	assert(pLenField != NULL);
 
 	p2parse = *pp2parse;
 	lenStr = *pLenStr;
@@ -142,11 +147,13 @@ static int parseRFCStructuredData(uchar **pp2parse, uchar *pResult, int *pLenStr
 	 * structured data. There may also be \] inside the structured data, which
 	 * do NOT terminate an element.
 	 */
-	if(lenStr == 0 || (*p2parse != '[' && *p2parse != '-'))
+	if(lenStr == 0 || (*p2parse != '[' && *p2parse != '-')) {
+		*pLenField = -1;
 		return 1; /* this is NOT structured data! */
+	}
 
 	if(*p2parse == '-') { /* empty structured data? */
-		*pResult++ = '-';
+		++lenField;
 		++p2parse;
 		--lenStr;
 	} else {
@@ -154,7 +161,7 @@ static int parseRFCStructuredData(uchar **pp2parse, uchar *pResult, int *pLenStr
 			if(lenStr < 2) {
 				/* we now need to check if we have only structured data */
 				if(lenStr > 0 && *p2parse == ']') {
-					*pResult++ = *p2parse;
+					++lenField;
 					p2parse++;
 					lenStr--;
 					bCont = 0;
@@ -163,18 +170,19 @@ static int parseRFCStructuredData(uchar **pp2parse, uchar *pResult, int *pLenStr
 					bCont = 0;
 				}
 			} else if(*p2parse == '\\' && *(p2parse+1) == ']') {
-				/* this is escaped, need to copy both */
-				*pResult++ = *p2parse++;
-				*pResult++ = *p2parse++;
+				/* this is escaped, need to take both */
+				lenField += 2;
+				p2parse += 2;
 				lenStr -= 2;
 			} else if(*p2parse == ']' && *(p2parse+1) == ' ') {
-				/* found end, just need to copy the ] and eat the SP */
-				*pResult++ = *p2parse;
+				/* found end, just need to take the ] and eat the SP */
+				++lenField;
 				p2parse += 2;
 				lenStr -= 2;
 				bCont = 0;
 			} else {
-				*pResult++ = *p2parse++;
+				++lenField;
+				++p2parse;
 				--lenStr;
 			}
 		}
@@ -186,11 +194,11 @@ static int parseRFCStructuredData(uchar **pp2parse, uchar *pResult, int *pLenStr
 	} else {
 		iRet = 1; /* there MUST be an SP! */
 	}
-	*pResult = '\0';
 
 	/* set the new parse pointer */
 	*pp2parse = p2parse;
 	*pLenStr = lenStr;
+	*pLenField = lenField;
 	return iRet;
 }
 
@@ -212,9 +220,14 @@ static int parseRFCStructuredData(uchar **pp2parse, uchar *pResult, int *pLenStr
  * rger, 2005-11-24
  */
 BEGINparse
+	static const int hdrFields[4] = { MSG_LAZY_HOSTNAME, MSG_LAZY_APPNAME, MSG_LAZY_PROCID, MSG_LAZY_MSGID };
 	uchar *p2parse;
-	uchar *pBuf = NULL;
+	uchar *pField;
+	uchar *pWindow;
+	uint64_t maskSP;
 	int lenMsg;
+	int lenField;
+	int i;
 	int bContParse = 1;
 CODESTARTparse
 	assert(pMsg != NULL);
@@ -231,13 +244,12 @@ CODESTARTparse
 	p2parse += 2;
 	lenMsg -= 2;
 
-	/* Now get us some memory we can use as a work buffer while parsing.
-	 * We simply allocated a buffer sufficiently large to hold all of the
-	 * message, so we can not run into any troubles. I think this is
-	 * wiser than to use individual buffers.
+	/* The header fields are not copied here. We only record where they
+	 * are inside the raw message, they are extracted when they are
+	 * first accessed (see MsgSetLazyField()). Many configurations never
+	 * use most of them.
 	 */
-	CHKmalloc(pBuf = MALLOC(sizeof(uchar) * (lenMsg + 1)));
-		
+
 	/* IMPORTANT NOTE:
 	 * Validation is not actually done below nor are any errors handled. I have
 	 * NOT included this for the current proof of concept. However, it is strongly
@@ -256,42 +268,40 @@ CODESTARTparse
 		bContParse = 0;
 	}
 
-	/* HOSTNAME */
-	if(bContParse) {
-		parseRFCField(&p2parse, pBuf, &lenMsg);
-		MsgSetHOSTNAME(pMsg, pBuf, ustrlen(pBuf));
-	}
-
-	/* APP-NAME */
-	if(bContParse) {
-		parseRFCField(&p2parse, pBuf, &lenMsg);
-		MsgSetAPPNAME(pMsg, (char*)pBuf);
-	}
-
-	/* PROCID */
-	if(bContParse) {
-		parseRFCField(&p2parse, pBuf, &lenMsg);
-		MsgSetPROCID(pMsg, (char*)pBuf);
-	}
-
-	/* MSGID */
+	/* HOSTNAME, APP-NAME, PROCID and MSGID are plain SP-terminated fields.
+	 * Usually they all fit into the next 64 bytes, so we locate all SPs
+	 * there with a single scan and use parseRFCField() only for what is
+	 * not covered by that.
+	 */
 	if(bContParse) {
-		parseRFCField(&p2parse, pBuf, &lenMsg);
-		MsgSetMSGID(pMsg, (char*)pBuf);
+		pWindow = p2parse;
+		maskSP = hdrScanCharMask(p2parse, lenMsg, ' ');
+		for(i = 0 ; i < 4 ; ++i) {
+			pField = p2parse;
+			if(maskSP != 0) {
+				lenField = __builtin_ctzll(maskSP) - (int) (p2parse - pWindow);
+				maskSP &= maskSP - 1;
+				p2parse += lenField + 1;
+				lenMsg -= lenField + 1;
+			} else {
+				parseRFCField(&p2parse, &lenMsg, &lenField);
+			}
+			MsgSetLazyField(pMsg, hdrFields[i], pField - pMsg->pszRawMsg, lenField);
+		}
 	}
 
 	/* STRUCTURED-DATA */
 	if(bContParse) {
-		parseRFCStructuredData(&p2parse, pBuf, &lenMsg);
-		MsgSetStructuredData(pMsg, (char*)pBuf);
+		pField = p2parse;
+		parseRFCStructuredData(&p2parse, &lenMsg, &lenField);
+		if(lenField >= 0)
+			MsgSetLazyField(pMsg, MSG_LAZY_STRUCDATA, pField - pMsg->pszRawMsg, lenField);
 	}
 
 	/* MSG */
 	MsgSetMSGoffs(pMsg, p2parse - pMsg->pszRawMsg);
 
 finalize_it:
-	if(pBuf != NULL)
-		free(pBuf);
 ENDparse
 
 
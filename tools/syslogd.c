@@ -509,7 +509,6 @@ preprocessBatch(batch_t *pBatch) {
 	int bIsPermitted;
 	msg_t *pMsg;
 	int i;
-	rsRetVal localRet;
 	DEFiRet;
 
 	bSingleRuleset = 1;
@@ -534,18 +533,17 @@ preprocessBatch(batch_t *pBatch) {
 				pMsg->msgFlags &= ~NEEDS_ACLCHK_U;
 			}
 		}
-		if((pMsg->msgFlags & NEEDS_PARSING) != 0) {
-			if((localRet = parser.ParseMsg(pMsg)) != RS_RET_OK)  {
-				DBGPRINTF("Message discarded, parsing error %d\n", localRet);
-				pBatch->eltState[i] = BATCH_STATE_DISC;
-			}
-		}
 		if(pMsg->pRuleset != batchRuleset)
 			bSingleRuleset = 0;
 	}
 
 	batchSetSingleRuleset(pBatch, bSingleRuleset);
 
+	/* now parse all messages that need it in one go, discarded ones
+	 * are flagged inside the batch.
+	 */
+	CHKiRet(parser.ParseBatch(pBatch));
+
 finalize_it:
 	if(propFromHost != NULL)
 		prop.Destruct(&propFromHost);